@@ -0,0 +1,1798 @@
+/**
+ * @file libjxml_bench.c
+ *
+ * @brief Benchmark for the libjxml parser.
+ *
+ * Generates XML documents of each shape of libjxml_corpus.h and increasing size
+ * in memory, and measures libjxml_xml_to_mem_mode() parsing them,
+ * libjxml_mem_to_txt() writing them back and libjxml_free_xml_mem() freeing
+ * them, in every storage mode. Each row reports the throughput of parsing and
+ * writing, the p50 and p99 latency of each step in milliseconds, the allocations
+ * made by the parser per tag or attribute and the peak of the resident memory. A
+ * parser with linear cost keeps the same throughput for every size.
+ *
+ * The versions of the scanner that classifies the text are compared too, alone
+ * and driving the event parser without callbacks.
+ *
+ * The tree is compared with the flat arrays of the same document, walking all
+ * the tags and writing the text.
+ *
+ * Looking up tags and attributes by name is measured walking the lists and with
+ * an index, in a document with many different names at the same level.
+ *
+ * A path query is run on the tree, and on the text without building the tree.
+ *
+ * Reading a file is compared with loading its snapshot, with and without
+ * checking the image.
+ *
+ * The biggest document is parsed with an increasing number of threads.
+ *
+ * Reading the value of the last record is compared on a tree and on a lazy
+ * document, with the time until the value is found and the nodes built.
+ *
+ * Reading the records into C structures is compared building the tree and
+ * copying its values, and binding the text straight to the structures.
+ *
+ * Writing the records of a tree is compared with streaming the same records
+ * with the writer, without any tree.
+ *
+ * Many small files are loaded one after the other, and in a batch with one
+ * thread and with a thread pool.
+ *
+ * Two documents differing in one value are compared walking both trees, and
+ * with their hashes, which are computed once per document.
+ *
+ * Escaping and decoding values is compared with copying them, for text without
+ * anything to escape and for text with an entity every 64 bytes.
+ *
+ * Changing a value of a shared document is compared with reloading it, for the
+ * first and the last record, and measured while threads read it at the same time.
+ *
+ * Converting the text to JSON is compared building the tree and writing it, and
+ * streaming from memory and from a file, with the peak of the resident memory.
+ * The JSON is read back into a tree too.
+ *
+ * When the library is compiled with LIBJXML_STATS, the time of each phase and
+ * the allocations of a document of each storage mode read from a file are
+ * printed too.
+ *
+ * Usage: bench [-c] [-g shape] [max_size]
+ *
+ * The biggest size is given in megabytes, or with a K, M or G suffix such as
+ * 64K or 1G. With -c only the first table is run, printed as comma separated
+ * values to compare runs. With -g the document of that shape and size is
+ * written to the standard output instead, and nothing is measured.
+ *
+ * Allocations are counted wrapping malloc(), calloc() and realloc() at link
+ * time, so the benchmark must be built with the flags of the makefile.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <malloc.h>
+#include <time.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include "libjxml.h"
+#include "libjxml_sax.h"
+#include "libjxml_scan.h"
+#include "libjxml_flat.h"
+#include "libjxml_index.h"
+#include "libjxml_query.h"
+#include "libjxml_snapshot.h"
+#include "libjxml_parallel.h"
+#include "libjxml_lazy.h"
+#include "libjxml_bind.h"
+#include "libjxml_writer.h"
+#include "libjxml_batch.h"
+#include "libjxml_hash.h"
+#include "libjxml_entity.h"
+#include "libjxml_stats.h"
+#include "libjxml_version.h"
+#include "libjxml_json.h"
+#include "libassert.h"
+
+#include "libjxml_corpus.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define BENCH_MIN_SIZE   1024L              /**< Size of the smallest document */
+#define BENCH_MAX_SIZE   (500L*1024L*1024L) /**< Default size of the biggest document */
+#define BENCH_MIN_TIME   0.2                /**< Minimum seconds measured per size */
+#define BENCH_SCAN_SIZE  (64L*1024L*1024L)  /**< Maximum size of the document used for the scanner */
+#define BENCH_SCAN_BLOCKS 64                /**< Blocks classified at once by the scanner */
+#define BENCH_FLAT_SIZE  (16L*1024L*1024L)  /**< Maximum size of the document used for the flat arrays */
+#define BENCH_INDEX_KEYS 1024               /**< Different names nested in the document used for lookups */
+#define BENCH_BIND_SIZE  (16L*1024L*1024L)  /**< Maximum size of the document bound to structures */
+#define BENCH_BATCH_FILES 2000              /**< Number of files loaded in a batch */
+#define BENCH_BATCH_SIZE 4096               /**< Size of each file loaded in a batch */
+#define BENCH_THREADS    8                  /**< Maximum number of threads used to parse */
+#define BENCH_READERS    4                  /**< Maximum number of threads reading a shared document */
+#define BENCH_QUERY      "//record[@id=\"7\"]/value" /**< Query run on the generated document */
+
+/*********************************************************************************
+ *                                    MAIN
+ *********************************************************************************/
+
+/**
+ * @brief Storage modes measured for each size.
+ */
+typedef struct bench_mode_t
+{
+	char * name; /**< Name printed on the report */
+	int    mode; /**< LIBJXML_MODE_* flags */
+}bench_mode_t;
+
+/**
+ * @brief Record of the generated document read into a structure.
+ */
+typedef struct bench_item_t
+{
+	long   id;        /**< Attribute id */
+	char   type [16]; /**< Attribute type */
+	char * name;      /**< Tag name */
+	long   value;     /**< Tag value */
+}bench_item_t;
+
+/**
+ * @brief Records of the generated document.
+ */
+typedef struct bench_items_t
+{
+	bench_item_t * items; /**< Records read */
+	long           count; /**< Number of records */
+}bench_items_t;
+
+/**
+ * @brief Times of each run of a step.
+ */
+typedef struct bench_samples_t
+{
+	double * times;    /**< Seconds of each run */
+	long     count;    /**< Number of runs */
+	long     capacity; /**< Allocated runs */
+}bench_samples_t;
+
+/**
+ * @brief Threads reading a shared document.
+ */
+typedef struct bench_readers_t
+{
+	xml_shared_t * shared_t; /**< Document read */
+	char         * path;     /**< Path of the tag read */
+	long           reads;    /**< Versions read by all the threads */
+	bool           stop;     /**< Set to stop the threads */
+}bench_readers_t;
+
+static const xml_field_t bench_item_fields [] =
+{
+	LIBJXML_ATTRIBUTE (bench_item_t, id, "id", LIBJXML_BIND_LONG),
+	LIBJXML_ATTRIBUTE (bench_item_t, type, "type", LIBJXML_BIND_TEXT),
+	LIBJXML_ELEMENT (bench_item_t, name, "name", LIBJXML_BIND_STRING),
+	LIBJXML_ELEMENT (bench_item_t, value, "value", LIBJXML_BIND_LONG),
+};
+
+static const xml_binding_t bench_item_binding = LIBJXML_BINDING (bench_item_t, "record", bench_item_fields);
+
+static const xml_field_t bench_items_fields [] =
+{
+	LIBJXML_ARRAY_NESTED (bench_items_t, items, count, "record", bench_item_binding),
+};
+
+static const xml_binding_t bench_items_binding = LIBJXML_BINDING (bench_items_t, "records", bench_items_fields);
+
+static const bench_mode_t bench_modes [] =
+{
+	{"malloc", LIBJXML_MODE_MALLOC},
+	{"arena",  LIBJXML_MODE_ARENA},
+	{"slice",  LIBJXML_MODE_SLICE},
+	{"slicear", LIBJXML_MODE_SLICE | LIBJXML_MODE_ARENA},
+};
+
+double bench_now ()
+{
+	struct timespec now;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+long bench_allocations = 0; /**< Calls to malloc, calloc and realloc since the start */
+
+void * __real_malloc (size_t size);
+void * __real_calloc (size_t count, size_t size);
+void * __real_realloc (void * pointer, size_t size);
+
+/*
+ * The benchmark is linked with --wrap, so every allocation of the library goes
+ * through these functions and is counted before reaching the real allocator.
+ * Threads parsing in parallel count at once, so the counter is atomic.
+ */
+void * __wrap_malloc (size_t size)
+{
+	__atomic_fetch_add (&bench_allocations, 1, __ATOMIC_RELAXED);
+	return __real_malloc (size);
+}
+
+void * __wrap_calloc (size_t count, size_t size)
+{
+	__atomic_fetch_add (&bench_allocations, 1, __ATOMIC_RELAXED);
+	return __real_calloc (count, size);
+}
+
+void * __wrap_realloc (void * pointer, size_t size)
+{
+	__atomic_fetch_add (&bench_allocations, 1, __ATOMIC_RELAXED);
+	return __real_realloc (pointer, size);
+}
+
+/*
+ * Linux sets the peak of the resident memory back to the current one when 5 is
+ * written to clear_refs, so each row reports its own peak. The memory freed by
+ * the previous rows is given back first, or it would be counted again.
+ */
+void bench_peak_reset ()
+{
+	FILE * file;
+
+	malloc_trim (0);
+
+	file = fopen ("/proc/self/clear_refs", "w");
+	if (file == NULL)
+		return;
+
+	fputs ("5", file);
+	fclose (file);
+}
+
+/*
+ * Peak of the resident memory in bytes, from the status of the process or, where
+ * it is not available, from getrusage(), which is never set back.
+ */
+long bench_peak ()
+{
+	struct rusage usage;
+	char line [128];
+	long peak = -1;
+	FILE * file;
+
+	file = fopen ("/proc/self/status", "r");
+	if (file != NULL)
+	{
+		while (fgets (line, sizeof (line), file) != NULL)
+			if (strncmp (line, "VmHWM:", 6) == 0)
+				peak = atol (line + 6) * 1024L;
+
+		fclose (file);
+	}
+
+	if (peak < 0)
+	{
+		getrusage (RUSAGE_SELF, &usage);
+		peak = usage.ru_maxrss * 1024L;
+	}
+
+	return peak;
+}
+
+void bench_sample (bench_samples_t * samples_t, double time)
+{
+	if (samples_t->count == samples_t->capacity)
+	{
+		samples_t->capacity = (samples_t->capacity == 0) ? 64 : samples_t->capacity * 2;
+		samples_t->times = (double *) realloc (samples_t->times, samples_t->capacity * sizeof (double));
+		LIBASSERT_PTR (samples_t->times);
+	}
+
+	samples_t->times [samples_t->count] = time;
+	samples_t->count++;
+}
+
+int bench_compare (const void * first, const void * second)
+{
+	double difference = *(const double *) first - *(const double *) second;
+
+	return (difference > 0) - (difference < 0);
+}
+
+/*
+ * Milliseconds of the run at a ratio of the sorted samples, the one with the
+ * closest rank. With few runs the p99 is the slowest one.
+ */
+double bench_percentile (bench_samples_t * samples_t, double ratio)
+{
+	long rank;
+
+	rank = (long) (ratio * (samples_t->count - 1) + 0.5);
+
+	return samples_t->times [rank] * 1e3;
+}
+
+/*
+ * Parses, writes and frees a document until BENCH_MIN_TIME is measured, and
+ * prints the throughput, the latency of each run for each step, the allocations
+ * per node made by the parser and the peak of the resident memory.
+ */
+int bench_row (int shape, const bench_mode_t * mode_t, char * text, long length, bool csv)
+{
+	bench_samples_t steps [3];
+	xml_t * xml_mem_t;
+	char * output;
+	long allocations = 0;
+	long nodes = 0;
+	long before;
+	long peak;
+	double total [3] = {0, 0, 0};
+	double start;
+	double time;
+	int step;
+
+	memset (steps, 0, sizeof (steps));
+	bench_peak_reset ();
+
+	while (total [0] + total [1] + total [2] < BENCH_MIN_TIME)
+	{
+		before = __atomic_load_n (&bench_allocations, __ATOMIC_RELAXED);
+		start = bench_now ();
+		xml_mem_t = libjxml_xml_to_mem_mode (text, mode_t->mode);
+		time = bench_now () - start;
+		allocations = allocations + __atomic_load_n (&bench_allocations, __ATOMIC_RELAXED) - before;
+
+		if (xml_mem_t == NULL)
+		{
+			printf ("\nBench: Error parsing %s document of %ld bytes\n", bench_corpus_name (shape), length);
+			for (step = 0; step < 3; step++)
+				free (steps [step].times);
+			return 1;
+		}
+
+		nodes = nodes + xml_mem_t->nodes;
+		bench_sample (&steps [0], time);
+		total [0] = total [0] + time;
+
+		start = bench_now ();
+		output = libjxml_mem_to_txt (xml_mem_t, LIBJXML_FORMAT_INDENT, NULL);
+		time = bench_now () - start;
+		free (output);
+		bench_sample (&steps [1], time);
+		total [1] = total [1] + time;
+
+		start = bench_now ();
+		libjxml_free_xml_mem (xml_mem_t);
+		time = bench_now () - start;
+		bench_sample (&steps [2], time);
+		total [2] = total [2] + time;
+	}
+
+	peak = bench_peak ();
+
+	for (step = 0; step < 3; step++)
+		qsort (steps [step].times, steps [step].count, sizeof (double), bench_compare);
+
+	printf (csv ? "%s,%s,%ld,%ld,%.1f,%.1f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.3f,%.1f\n" :
+			"%-10s %-8s %11ld %7ld %10.1f %10.1f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %10.2f %8.1f\n",
+			bench_corpus_name (shape), mode_t->name, length, steps [0].count,
+			length * steps [0].count / total [0] / (1024.0 * 1024.0),
+			length * steps [1].count / total [1] / (1024.0 * 1024.0),
+			bench_percentile (&steps [0], 0.5), bench_percentile (&steps [0], 0.99),
+			bench_percentile (&steps [1], 0.5), bench_percentile (&steps [1], 0.99),
+			bench_percentile (&steps [2], 0.5), bench_percentile (&steps [2], 0.99),
+			(nodes > 0) ? (double) allocations / nodes : 0.0, peak / (1024.0 * 1024.0));
+
+	for (step = 0; step < 3; step++)
+		free (steps [step].times);
+
+	return 0;
+}
+
+/*
+ * Measures every shape and storage mode on documents growing 8 times from
+ * BENCH_MIN_SIZE to the biggest size. A parser with linear cost keeps the same
+ * throughput for every size of a shape.
+ */
+int bench_suite (long max_size, bool csv)
+{
+	long size;
+	long length;
+	char * text;
+	unsigned int i;
+	int shape;
+
+	if (csv)
+		printf ("shape,mode,bytes,runs,parse_mb_s,write_mb_s,parse_p50_ms,parse_p99_ms,write_p50_ms,"
+				"write_p99_ms,free_p50_ms,free_p99_ms,allocs_per_node,peak_rss_mb\n");
+	else
+		printf ("%-10s %-8s %11s %7s %10s %10s %9s %9s %9s %9s %9s %9s %10s %8s\n", "shape", "mode",
+				"bytes", "runs", "parse_MB/s", "write_MB/s", "parse_p50", "parse_p99", "write_p50",
+				"write_p99", "free_p50", "free_p99", "allocs/nd", "peak_MB");
+
+	for (shape = 0; shape < BENCH_SHAPES; shape++)
+	{
+		size = (max_size < BENCH_MIN_SIZE) ? max_size : BENCH_MIN_SIZE;
+
+		while (1)
+		{
+			text = bench_corpus (shape, size, &length);
+
+			for (i = 0; i < sizeof (bench_modes) / sizeof (bench_modes [0]); i++)
+			{
+				if (bench_row (shape, &bench_modes [i], text, length, csv) != 0)
+				{
+					free (text);
+					return 1;
+				}
+			}
+
+			free (text);
+
+			if (size >= max_size)
+				break;
+
+			size = size * 8;
+			if (size > max_size)
+				size = max_size;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Sizes are given in megabytes, or in bytes with a K, M or G suffix.
+ */
+long bench_size (char * text)
+{
+	char * end;
+	long size;
+
+	size = strtol (text, &end, 10);
+
+	switch (*end)
+	{
+		case 'K':
+		case 'k':
+			return size * 1024L;
+		case 'G':
+		case 'g':
+			return size * 1024L * 1024L * 1024L;
+		default:
+			return size * 1024L * 1024L;
+	}
+}
+
+/*
+ * Measures the GB/s of each version of the scanner supported by the CPU.
+ */
+void bench_scan (long size)
+{
+	xml_masks_t masks [BENCH_SCAN_BLOCKS];
+	xml_handler_t handler_t;
+	long blocks;
+	long offset;
+	long runs;
+	long length;
+	char * text;
+	double start;
+	double classify;
+	double tokenize;
+	int level;
+
+	memset (&handler_t, 0, sizeof (xml_handler_t));
+
+	if (size > BENCH_SCAN_SIZE)
+		size = BENCH_SCAN_SIZE;
+
+	text = bench_generate (size, &length);
+	blocks = length / LIBJXML_SCAN_BLOCK;
+
+	printf ("\n%-8s %12s %12s %12s\n", "scanner", "bytes", "class_GB/s", "sax_GB/s");
+
+	for (level = LIBJXML_SCAN_SCALAR; level <= LIBJXML_SCAN_AVX512; level++)
+	{
+		if (libjxml_scan_select (level) != level)
+			continue;
+
+		runs = 0;
+		start = bench_now ();
+		do
+		{
+			for (offset = 0; offset + BENCH_SCAN_BLOCKS <= blocks; offset = offset + BENCH_SCAN_BLOCKS)
+				libjxml_scan_classify (text + offset * LIBJXML_SCAN_BLOCK, BENCH_SCAN_BLOCKS, masks);
+			runs++;
+		} while (bench_now () - start < BENCH_MIN_TIME);
+		classify = (bench_now () - start) / runs;
+
+		runs = 0;
+		start = bench_now ();
+		do
+		{
+			libjxml_sax_buffer (text, length, &handler_t);
+			runs++;
+		} while (bench_now () - start < BENCH_MIN_TIME);
+		tokenize = (bench_now () - start) / runs;
+
+		printf ("%-8s %12ld %12.2f %12.2f\n", libjxml_scan_name (level), length,
+				length / classify / 1e9, length / tokenize / 1e9);
+	}
+
+	libjxml_scan_select (LIBJXML_SCAN_AUTO);
+	free (text);
+}
+
+/*
+ * Measures walking and writing a document as a tree and as flat arrays.
+ */
+void bench_flat (long size)
+{
+	xml_iterator_t iterator_t;
+	xml_tag_t * tag_t;
+	xml_attribute_t * attribute_t;
+	xml_flat_t * flat_t;
+	xml_t * xml_mem_t;
+	long runs;
+	long length;
+	long bytes;
+	long tag;
+	char * text;
+	char * output;
+	double start;
+	double convert;
+	double walk [2];
+	double write [2];
+
+	if (size > BENCH_FLAT_SIZE)
+		size = BENCH_FLAT_SIZE;
+
+	text = bench_generate (size, &length);
+	xml_mem_t = libjxml_xml_to_mem_mode (text, LIBJXML_MODE_MALLOC);
+
+	start = bench_now ();
+	flat_t = libjxml_mem_to_flat (xml_mem_t);
+	convert = bench_now () - start;
+
+	/* Both walks add the length of every value, so they read the same fields */
+	runs = 0;
+	bytes = 0;
+	start = bench_now ();
+	do
+	{
+		libjxml_iterator_xml (&iterator_t, xml_mem_t, LIBJXML_WALK_PRE);
+		while ((tag_t = libjxml_iterator_next (&iterator_t)) != NULL)
+		{
+			bytes = bytes + tag_t->value_length;
+			for (attribute_t = tag_t->attribute_t; attribute_t != NULL; attribute_t = attribute_t->next_attribute_t)
+				bytes = bytes + attribute_t->value_length;
+		}
+		libjxml_iterator_free (&iterator_t);
+		runs++;
+	} while (bench_now () - start < BENCH_MIN_TIME);
+	walk [0] = (bench_now () - start) / runs;
+
+	runs = 0;
+	start = bench_now ();
+	do
+	{
+		for (tag = 0; tag < flat_t->tags; tag++)
+			bytes = bytes + flat_t->value_length [tag];
+		for (tag = flat_t->attribute [0]; tag < flat_t->attributes; tag++)
+			bytes = bytes + flat_t->attribute_length [tag];
+		runs++;
+	} while (bench_now () - start < BENCH_MIN_TIME);
+	walk [1] = (bench_now () - start) / runs;
+
+	runs = 0;
+	start = bench_now ();
+	do
+	{
+		output = libjxml_mem_to_txt (xml_mem_t, LIBJXML_FORMAT_INDENT, NULL);
+		free (output);
+		runs++;
+	} while (bench_now () - start < BENCH_MIN_TIME);
+	write [0] = (bench_now () - start) / runs;
+
+	runs = 0;
+	start = bench_now ();
+	do
+	{
+		output = libjxml_flat_to_txt (flat_t, LIBJXML_FORMAT_INDENT, NULL);
+		free (output);
+		runs++;
+	} while (bench_now () - start < BENCH_MIN_TIME);
+	write [1] = (bench_now () - start) / runs;
+
+	printf ("\n%-8s %12s %12s %12s %12s\n", "storage", "bytes", "convert_ms", "walk_ms", "write_ms");
+	printf ("%-8s %12ld %12s %12.3f %12.3f\n", "tree", length, "-", walk [0] * 1e3, write [0] * 1e3);
+	printf ("%-8s %12ld %12.3f %12.3f %12.3f\n", "flat", length, convert * 1e3, walk [1] * 1e3, write [1] * 1e3);
+
+	/* Printed so the walks are not optimized away */
+	if (bytes < 0)
+		printf ("%ld\n", bytes);
+
+	libjxml_flat_free (flat_t);
+	libjxml_free_xml_mem (xml_mem_t);
+	free (text);
+}
+
+/*
+ * Measures the lookups of each tag of a document with many names by name, and
+ * of its attribute, walking the lists and with an index.
+ */
+void bench_index ()
+{
+	bench_doc_t doc_t;
+	xml_index_t * index_t;
+	xml_tag_t * tag_t;
+	xml_attribute_t * attribute_t;
+	xml_t * xml_mem_t;
+	char names [BENCH_INDEX_KEYS][16];
+	char record [96]; /* Two names of 15 characters and two numbers of 20 */
+	char * name;
+	char * id;
+	long found = 0;
+	long runs;
+	long i;
+	double start;
+	double build;
+	double lookup [2];
+
+	doc_t.length = 0;
+	doc_t.text = (char *) malloc (BENCH_INDEX_KEYS * sizeof (record) + 32);
+	LIBASSERT_PTR (doc_t.text);
+
+	bench_append (&doc_t, "<config>");
+	for (i = 0; i < BENCH_INDEX_KEYS; i++)
+	{
+		snprintf (names [i], sizeof (names [i]), "key%ld", i);
+		snprintf (record, sizeof (record), "<%.15s id=\"%ld\">%ld</%.15s>", names [i], i, i, names [i]);
+		bench_append (&doc_t, record);
+	}
+	bench_append (&doc_t, "</config>");
+	doc_t.text [doc_t.length] = '\0';
+
+	xml_mem_t = libjxml_xml_to_mem (doc_t.text);
+
+	start = bench_now ();
+	index_t = libjxml_index_create (xml_mem_t);
+	build = bench_now () - start;
+
+	runs = 0;
+	start = bench_now ();
+	do
+	{
+		for (i = 0; i < BENCH_INDEX_KEYS; i++)
+		{
+			name = libjxml_find_name (xml_mem_t, names [i]);
+			id = libjxml_find_name (xml_mem_t, "id");
+
+			for (tag_t = xml_mem_t->content_t->nested_tag_t; tag_t != NULL; tag_t = tag_t->sibling_tag_t)
+				if (tag_t->name == name)
+					break;
+
+			for (attribute_t = tag_t->attribute_t; attribute_t != NULL; attribute_t = attribute_t->next_attribute_t)
+				if (attribute_t->name == id)
+					break;
+
+			found = found + (attribute_t != NULL);
+		}
+		runs++;
+	} while (bench_now () - start < BENCH_MIN_TIME);
+	lookup [0] = (bench_now () - start) / runs;
+
+	runs = 0;
+	start = bench_now ();
+	do
+	{
+		for (i = 0; i < BENCH_INDEX_KEYS; i++)
+		{
+			tag_t = libjxml_index_child (index_t, xml_mem_t->content_t, names [i]);
+			attribute_t = libjxml_index_attribute (index_t, tag_t, "id");
+
+			found = found + (attribute_t != NULL);
+		}
+		runs++;
+	} while (bench_now () - start < BENCH_MIN_TIME);
+	lookup [1] = (bench_now () - start) / runs;
+
+	printf ("\n%-8s %12s %12s %12s\n", "lookup", "tags", "build_ms", "ns/lookup");
+	printf ("%-8s %12d %12s %12.1f\n", "lists", BENCH_INDEX_KEYS, "-", lookup [0] * 1e9 / BENCH_INDEX_KEYS);
+	printf ("%-8s %12d %12.3f %12.1f\n", "index", BENCH_INDEX_KEYS, build * 1e3, lookup [1] * 1e9 / BENCH_INDEX_KEYS);
+
+	/* Printed so the lookups are not optimized away */
+	if (found < 0)
+		printf ("%ld\n", found);
+
+	libjxml_index_free (index_t);
+	libjxml_free_xml_mem (xml_mem_t);
+	free (doc_t.text);
+}
+
+bool bench_query_found (void * context, char * name, long name_length, char * value, long value_length)
+{
+	(void) name;
+	(void) name_length;
+	(void) value;
+	(void) value_length;
+
+	(*(long *) context)++;
+
+	return true;
+}
+
+/*
+ * Measures a query run on a parsed tree, and run while parsing the text.
+ */
+void bench_query (long size)
+{
+	xml_query_t * query_t;
+	xml_t * xml_mem_t;
+	long found = 0;
+	long runs;
+	long length;
+	char * text;
+	double start;
+	double parse;
+	double tree;
+	double stream;
+
+	if (size > BENCH_FLAT_SIZE)
+		size = BENCH_FLAT_SIZE;
+
+	text = bench_generate (size, &length);
+	query_t = libjxml_query_compile (BENCH_QUERY);
+
+	start = bench_now ();
+	xml_mem_t = libjxml_xml_to_mem_mode (text, LIBJXML_MODE_SLICE | LIBJXML_MODE_ARENA);
+	parse = bench_now () - start;
+
+	runs = 0;
+	start = bench_now ();
+	do
+	{
+		found = found + libjxml_query_run (query_t, xml_mem_t, NULL, NULL);
+		runs++;
+	} while (bench_now () - start < BENCH_MIN_TIME);
+	tree = (bench_now () - start) / runs;
+
+	runs = 0;
+	start = bench_now ();
+	do
+	{
+		libjxml_query_stream_buffer (query_t, text, length, bench_query_found, &found);
+		runs++;
+	} while (bench_now () - start < BENCH_MIN_TIME);
+	stream = (bench_now () - start) / runs;
+
+	printf ("\n%-8s %12s %12s %12s\n", "query", "bytes", "parse_ms", "run_ms");
+	printf ("%-8s %12ld %12.3f %12.3f\n", "tree", length, parse * 1e3, tree * 1e3);
+	printf ("%-8s %12ld %12s %12.3f\n", "stream", length, "-", stream * 1e3);
+
+	/* Printed so the runs are not optimized away */
+	if (found < 0)
+		printf ("%ld\n", found);
+
+	libjxml_free_xml_mem (xml_mem_t);
+	libjxml_query_free (query_t);
+	free (text);
+}
+
+/*
+ * Measures reading a file by parsing it and by loading its snapshot. The first
+ * read parses the file and saves the snapshot.
+ */
+void bench_snapshot (long size)
+{
+	xml_flat_t * flat_t;
+	xml_t * xml_mem_t;
+	char xml_name [] = "/tmp/libjxml_bench_XXXXXX";
+	char image_name [sizeof (xml_name) + 4];
+	long runs;
+	long length;
+	char * text;
+	double start;
+	double save;
+	double parse;
+	double load [2];
+	int xml_fd;
+	int i;
+
+	if (size > BENCH_FLAT_SIZE)
+		size = BENCH_FLAT_SIZE;
+
+	text = bench_generate (size, &length);
+
+	xml_fd = mkstemp (xml_name);
+	if ((xml_fd < 0) || (write (xml_fd, text, length) != length))
+	{
+		printf ("\nBench: Error writing %s\n", xml_name);
+		free (text);
+		return;
+	}
+	close (xml_fd);
+	sprintf (image_name, "%s.img", xml_name);
+
+	runs = 0;
+	start = bench_now ();
+	do
+	{
+		xml_mem_t = libjxml_file_to_mem_mode (xml_name, LIBJXML_MODE_SLICE | LIBJXML_MODE_ARENA);
+		libjxml_free_xml_mem (xml_mem_t);
+		runs++;
+	} while (bench_now () - start < BENCH_MIN_TIME);
+	parse = (bench_now () - start) / runs;
+
+	start = bench_now ();
+	flat_t = libjxml_file_to_flat (xml_name, image_name, 0);
+	save = bench_now () - start;
+	libjxml_flat_free (flat_t);
+
+	for (i = 0; i < 2; i++)
+	{
+		runs = 0;
+		start = bench_now ();
+		do
+		{
+			flat_t = libjxml_file_to_flat (xml_name, image_name, i == 0 ? 0 : LIBJXML_SNAPSHOT_VERIFY);
+			libjxml_flat_free (flat_t);
+			runs++;
+		} while (bench_now () - start < BENCH_MIN_TIME);
+		load [i] = (bench_now () - start) / runs;
+	}
+
+	printf ("\n%-8s %12s %12s\n", "read", "bytes", "read_ms");
+	printf ("%-8s %12ld %12.3f\n", "parse", length, parse * 1e3);
+	printf ("%-8s %12ld %12.3f\n", "first", length, save * 1e3);
+	printf ("%-8s %12ld %12.3f\n", "load", length, load [0] * 1e3);
+	printf ("%-8s %12ld %12.3f\n", "verify", length, load [1] * 1e3);
+
+	unlink (image_name);
+	unlink (xml_name);
+	free (text);
+}
+
+/*
+ * Measures parsing a document with many threads, as many as processors last.
+ */
+void bench_parallel (long size)
+{
+	xml_t * xml_mem_t;
+	long runs;
+	long length;
+	char * text;
+	double start;
+	double parse;
+	int threads;
+
+	text = bench_generate (size, &length);
+
+	printf ("\n%-8s %12s %8s %12s %10s\n", "threads", "bytes", "runs", "parse_ms", "MB/s");
+
+	for (threads = 1; threads <= BENCH_THREADS * 2; threads = threads * 2)
+	{
+		runs = 0;
+		start = bench_now ();
+		do
+		{
+			xml_mem_t = libjxml_xml_to_mem_parallel (text, LIBJXML_MODE_SLICE | LIBJXML_MODE_ARENA,
+													 threads > BENCH_THREADS ? 0 : threads);
+			libjxml_free_xml_mem (xml_mem_t);
+			runs++;
+		} while (bench_now () - start < BENCH_MIN_TIME);
+		parse = (bench_now () - start) / runs;
+
+		if (threads > BENCH_THREADS)
+			printf ("%-8s %12ld %8ld %12.3f %10.1f\n", "all", length, runs, parse * 1e3,
+					length / parse / (1024.0 * 1024.0));
+		else
+			printf ("%-8d %12ld %8ld %12.3f %10.1f\n", threads, length, runs, parse * 1e3,
+					length / parse / (1024.0 * 1024.0));
+	}
+
+	free (text);
+}
+
+/*
+ * The last tag of each level is followed down to a record, so the lazy document
+ * builds one group of each level.
+ */
+void bench_lazy (long size)
+{
+	xml_lazy_t * lazy_t;
+	xml_t * xml_mem_t;
+	xml_tag_t * tag_t;
+	long nodes [2];
+	long runs;
+	long length;
+	char * text;
+	char * value;
+	double start;
+	double lookup [2];
+	int i;
+
+	text = bench_generate (size, &length);
+
+	for (i = 0; i < 2; i++)
+	{
+		runs = 0;
+		start = bench_now ();
+		do
+		{
+			if (i == 0)
+			{
+				xml_mem_t = libjxml_xml_to_mem_mode (text, LIBJXML_MODE_SLICE | LIBJXML_MODE_ARENA);
+				lazy_t = NULL;
+			}
+			else
+			{
+				lazy_t = libjxml_lazy_create (text, length, LIBJXML_MODE_SLICE | LIBJXML_MODE_ARENA);
+				xml_mem_t = libjxml_lazy_xml (lazy_t);
+			}
+
+			tag_t = xml_mem_t->content_t;
+			while ((tag_t != NULL) && (libjxml_token_equal (tag_t->name, tag_t->name_length, "record") == false))
+			{
+				tag_t = (i == 0) ? tag_t->nested_tag_t : libjxml_lazy_nested (lazy_t, tag_t);
+				while ((tag_t != NULL) && (tag_t->sibling_tag_t != NULL))
+					tag_t = tag_t->sibling_tag_t;
+			}
+
+			value = NULL;
+			if (tag_t != NULL)
+				tag_t = (i == 0) ? tag_t->nested_tag_t : libjxml_lazy_nested (lazy_t, tag_t);
+			if (tag_t != NULL)
+				value = (i == 0) ? tag_t->value : libjxml_lazy_value (lazy_t, tag_t, NULL);
+
+			if (value == NULL)
+				printf ("\nBench: Error looking up the last record\n");
+
+			nodes [i] = xml_mem_t->nodes;
+
+			if (i == 0)
+				libjxml_free_xml_mem (xml_mem_t);
+			else
+				libjxml_lazy_free (lazy_t);
+			runs++;
+		} while (bench_now () - start < BENCH_MIN_TIME);
+		lookup [i] = (bench_now () - start) / runs;
+	}
+
+	printf ("\n%-8s %12s %12s %12s\n", "lookup", "bytes", "lookup_ms", "nodes");
+	printf ("%-8s %12ld %12.3f %12ld\n", "tree", length, lookup [0] * 1e3, nodes [0]);
+	printf ("%-8s %12ld %12.3f %12ld\n", "lazy", length, lookup [1] * 1e3, nodes [1]);
+
+	free (text);
+}
+
+/*
+ * The records are written straight under the root, the shape of a message read
+ * into structures. The tree is copied the way a caller would, comparing names.
+ */
+void bench_bind (long size)
+{
+	bench_doc_t doc_t;
+	bench_items_t items_t;
+	bench_item_t * item_t;
+	xml_t * xml_mem_t;
+	xml_tag_t * tag_t;
+	xml_tag_t * nested_t;
+	xml_attribute_t * attribute_t;
+	long runs;
+	long index;
+	long length;
+	double start;
+	double bind [2];
+	int i;
+
+	if (size > BENCH_BIND_SIZE)
+		size = BENCH_BIND_SIZE;
+
+	doc_t.text = (char *) malloc (size + 4096);
+	LIBASSERT_PTR (doc_t.text);
+	doc_t.length = 0;
+	doc_t.target = size;
+	doc_t.records = 0;
+
+	bench_append (&doc_t, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<records>\n");
+	while (doc_t.length < doc_t.target)
+		bench_record (&doc_t, 1);
+	bench_append (&doc_t, "</records>\n");
+	doc_t.text [doc_t.length] = '\0';
+
+	for (i = 0; i < 2; i++)
+	{
+		runs = 0;
+		start = bench_now ();
+		do
+		{
+			if (i == 1)
+			{
+				if (libjxml_bind_parse (&bench_items_binding, &items_t, doc_t.text, doc_t.length) == false)
+					printf ("\nBench: Error binding the records\n");
+			}
+			else
+			{
+				xml_mem_t = libjxml_xml_to_mem_mode (doc_t.text, LIBJXML_MODE_SLICE | LIBJXML_MODE_ARENA);
+				items_t.items = (bench_item_t *) calloc (xml_mem_t->nodes, sizeof (bench_item_t));
+				LIBASSERT_PTR (items_t.items);
+				items_t.count = 0;
+
+				for (tag_t = xml_mem_t->content_t->nested_tag_t; tag_t != NULL; tag_t = tag_t->sibling_tag_t)
+				{
+					item_t = &items_t.items [items_t.count++];
+
+					for (attribute_t = tag_t->attribute_t; attribute_t != NULL; attribute_t = attribute_t->next_attribute_t)
+					{
+						if (libjxml_token_equal (attribute_t->name, attribute_t->name_length, "id"))
+							item_t->id = strtol (attribute_t->value, NULL, 10);
+						else if (libjxml_token_equal (attribute_t->name, attribute_t->name_length, "type"))
+							snprintf (item_t->type, sizeof (item_t->type), "%.*s",
+									  (int) attribute_t->value_length, attribute_t->value);
+					}
+
+					for (nested_t = tag_t->nested_tag_t; nested_t != NULL; nested_t = nested_t->sibling_tag_t)
+					{
+						if (libjxml_token_equal (nested_t->name, nested_t->name_length, "name"))
+							item_t->name = strndup (nested_t->value, nested_t->value_length);
+						else if (libjxml_token_equal (nested_t->name, nested_t->name_length, "value"))
+							item_t->value = strtol (nested_t->value, NULL, 10);
+					}
+				}
+
+				libjxml_free_xml_mem (xml_mem_t);
+			}
+
+			length = items_t.count;
+			if ((length != doc_t.records) || (items_t.items [length - 1].value != (length - 1) * 7))
+				printf ("\nBench: Error reading the records\n");
+
+			if (i == 1)
+			{
+				libjxml_bind_free (&bench_items_binding, &items_t);
+			}
+			else
+			{
+				for (index = 0; index < length; index++)
+					free (items_t.items [index].name);
+				free (items_t.items);
+			}
+			runs++;
+		} while (bench_now () - start < BENCH_MIN_TIME);
+		bind [i] = (bench_now () - start) / runs;
+	}
+
+	printf ("\n%-8s %12s %12s %10s\n", "struct", "bytes", "read_ms", "MB/s");
+	printf ("%-8s %12ld %12.3f %10.1f\n", "tree", doc_t.length, bind [0] * 1e3,
+			doc_t.length / bind [0] / (1024.0 * 1024.0));
+	printf ("%-8s %12ld %12.3f %10.1f\n", "bind", doc_t.length, bind [1] * 1e3,
+			doc_t.length / bind [1] / (1024.0 * 1024.0));
+
+	free (doc_t.text);
+}
+
+/*
+ * Both texts are written to memory, so only the cost of producing the text is
+ * compared. The tree is parsed once, before measuring.
+ */
+void bench_writer (long size)
+{
+	xml_t * xml_mem_t;
+	xml_sink_t * sink_t;
+	xml_writer_t * writer_t;
+	long runs;
+	long length;
+	long records;
+	long index;
+	long written [2];
+	char * text;
+	char * output;
+	char number [32];
+	char name [64];
+	double start;
+	double write [2];
+	int i;
+
+	if (size > BENCH_BIND_SIZE)
+		size = BENCH_BIND_SIZE;
+
+	text = bench_generate (size, &length);
+	xml_mem_t = libjxml_xml_to_mem_mode (text, LIBJXML_MODE_SLICE | LIBJXML_MODE_ARENA);
+
+	records = 0;
+	for (output = strstr (text, "<record "); output != NULL; output = strstr (output + 1, "<record "))
+		records++;
+
+	for (i = 0; i < 2; i++)
+	{
+		runs = 0;
+		start = bench_now ();
+		do
+		{
+			sink_t = libjxml_sink_mem (LIBJXML_SINK_BUFFER);
+
+			if (i == 0)
+			{
+				libjxml_mem_to_sink (xml_mem_t, sink_t, LIBJXML_FORMAT_INDENT);
+			}
+			else
+			{
+				writer_t = libjxml_writer_create (sink_t, LIBJXML_FORMAT_INDENT);
+				libjxml_writer_declaration (writer_t, "1.0", "UTF-8");
+				libjxml_writer_begin (writer_t, "records");
+
+				for (index = 0; index < records; index++)
+				{
+					libjxml_writer_begin (writer_t, "record");
+					sprintf (number, "%ld", index);
+					libjxml_writer_attribute (writer_t, "id", number);
+					libjxml_writer_attribute (writer_t, "type", "sample");
+					sprintf (name, "record %ld", index);
+					libjxml_writer_element (writer_t, "name", name, strlen (name));
+					sprintf (number, "%ld", index * 7);
+					libjxml_writer_element (writer_t, "value", number, strlen (number));
+					libjxml_writer_end (writer_t);
+				}
+
+				libjxml_writer_end (writer_t);
+				libjxml_writer_finish (writer_t);
+			}
+
+			free (libjxml_sink_release (sink_t, &written [i]));
+			runs++;
+		} while (bench_now () - start < BENCH_MIN_TIME);
+		write [i] = (bench_now () - start) / runs;
+	}
+
+	printf ("\n%-8s %12s %12s %10s\n", "output", "bytes", "write_ms", "MB/s");
+	printf ("%-8s %12ld %12.3f %10.1f\n", "tree", written [0], write [0] * 1e3,
+			written [0] / write [0] / (1024.0 * 1024.0));
+	printf ("%-8s %12ld %12.3f %10.1f\n", "stream", written [1], write [1] * 1e3,
+			written [1] / write [1] / (1024.0 * 1024.0));
+
+	libjxml_free_xml_mem (xml_mem_t);
+	free (text);
+}
+
+/*
+ * The files are written once in a new directory, so they are read from the page
+ * cache and only the system calls and the parsing are measured.
+ */
+void bench_batch ()
+{
+	xml_batch_t * results;
+	char directory [] = "/tmp/libjxml_batch_XXXXXX";
+	char * names [BENCH_BATCH_FILES];
+	char * text;
+	long runs;
+	long length;
+	long loaded;
+	double start;
+	double load;
+	FILE * xml_file;
+	int i;
+	int j;
+
+	if (mkdtemp (directory) == NULL)
+	{
+		printf ("\nBench: Error creating %s\n", directory);
+		return;
+	}
+
+	text = bench_generate (BENCH_BATCH_SIZE, &length);
+
+	for (i = 0; i < BENCH_BATCH_FILES; i++)
+	{
+		names [i] = (char *) malloc (sizeof (directory) + 16);
+		LIBASSERT_PTR (names [i]);
+		sprintf (names [i], "%s/%d.xml", directory, i);
+
+		xml_file = fopen (names [i], "w");
+		if (xml_file != NULL)
+		{
+			fwrite (text, 1, length, xml_file);
+			fclose (xml_file);
+		}
+	}
+
+	results = (xml_batch_t *) malloc (BENCH_BATCH_FILES * sizeof (xml_batch_t));
+	LIBASSERT_PTR (results);
+
+	printf ("\n%-8s %12s %8s %12s %10s\n", "batch", "files", "runs", "load_ms", "files/s");
+
+	for (j = 0; j < 3; j++)
+	{
+		runs = 0;
+		start = bench_now ();
+		do
+		{
+			if (j == 0)
+			{
+				loaded = 0;
+				for (i = 0; i < BENCH_BATCH_FILES; i++)
+				{
+					results [i].xml_mem_t = libjxml_file_to_mem_mode (names [i], LIBJXML_MODE_SLICE | LIBJXML_MODE_ARENA);
+					if (results [i].xml_mem_t != NULL)
+						loaded++;
+				}
+				libjxml_batch_free (results, BENCH_BATCH_FILES);
+			}
+			else
+			{
+				loaded = libjxml_batch_load (names, BENCH_BATCH_FILES, LIBJXML_MODE_SLICE | LIBJXML_MODE_ARENA,
+											 (j == 1) ? 1 : 0, results);
+				libjxml_batch_free (results, BENCH_BATCH_FILES);
+			}
+
+			if (loaded != BENCH_BATCH_FILES)
+				printf ("\nBench: Error loading the files of the batch\n");
+			runs++;
+		} while (bench_now () - start < BENCH_MIN_TIME);
+		load = (bench_now () - start) / runs;
+
+		printf ("%-8s %12d %8ld %12.3f %10.0f\n", (j == 0) ? "loop" : (j == 1) ? "pool1" : "pool",
+				BENCH_BATCH_FILES, runs, load * 1e3, BENCH_BATCH_FILES / load);
+	}
+
+	for (i = 0; i < BENCH_BATCH_FILES; i++)
+	{
+		unlink (names [i]);
+		free (names [i]);
+	}
+	rmdir (directory);
+
+	free (results);
+	free (text);
+}
+
+/*
+ * The walk compares every tag of both trees in order, which is what a caller
+ * without hashes does to find out whether anything changed.
+ */
+void bench_diff (long size)
+{
+	xml_t * docs [2];
+	xml_hashes_t * hashes [2];
+	xml_iterator_t iterators [2];
+	xml_tag_t * old_t;
+	xml_tag_t * new_t;
+	long runs;
+	long length;
+	long changes = 0;
+	char * texts [2];
+	char * value;
+	double start;
+	double walk;
+	double hash;
+	double diff;
+	int i;
+
+	if (size > BENCH_FLAT_SIZE)
+		size = BENCH_FLAT_SIZE;
+
+	texts [0] = bench_generate (size, &length);
+	texts [1] = strdup (texts [0]);
+
+	/* The first digit of a value in the middle of the text changes */
+	value = strstr (texts [1] + length / 2, "<value>") + 7;
+	*value = (*value == '9') ? '8' : '9';
+
+	for (i = 0; i < 2; i++)
+		docs [i] = libjxml_xml_to_mem_mode (texts [i], LIBJXML_MODE_SLICE | LIBJXML_MODE_ARENA);
+
+	runs = 0;
+	start = bench_now ();
+	do
+	{
+		changes = 0;
+		libjxml_iterator_xml (&iterators [0], docs [0], LIBJXML_WALK_PRE);
+		libjxml_iterator_xml (&iterators [1], docs [1], LIBJXML_WALK_PRE);
+
+		while (((old_t = libjxml_iterator_next (&iterators [0])) != NULL) &&
+			   ((new_t = libjxml_iterator_next (&iterators [1])) != NULL))
+		{
+			if ((old_t->value_length != new_t->value_length) ||
+				((old_t->value != NULL) && (memcmp (old_t->value, new_t->value, old_t->value_length) != 0)))
+				changes++;
+		}
+
+		libjxml_iterator_free (&iterators [0]);
+		libjxml_iterator_free (&iterators [1]);
+		runs++;
+	} while (bench_now () - start < BENCH_MIN_TIME);
+	walk = (bench_now () - start) / runs;
+
+	runs = 0;
+	start = bench_now ();
+	do
+	{
+		hashes [0] = libjxml_hash_create (docs [0]);
+		libjxml_hash_free (hashes [0]);
+		runs++;
+	} while (bench_now () - start < BENCH_MIN_TIME);
+	hash = (bench_now () - start) / runs;
+
+	hashes [0] = libjxml_hash_create (docs [0]);
+	hashes [1] = libjxml_hash_create (docs [1]);
+
+	runs = 0;
+	start = bench_now ();
+	do
+	{
+		if (libjxml_diff (hashes [0], hashes [1], NULL, NULL) != changes)
+			printf ("\nBench: Error comparing the documents\n");
+		runs++;
+	} while (bench_now () - start < BENCH_MIN_TIME);
+	diff = (bench_now () - start) / runs;
+
+	printf ("\n%-8s %12s %12s %12s\n", "compare", "bytes", "compare_ms", "changes");
+	printf ("%-8s %12ld %12.3f %12ld\n", "walk", length, walk * 1e3, changes);
+	printf ("%-8s %12ld %12.3f %12s\n", "hash", length, hash * 1e3, "-");
+	printf ("%-8s %12ld %12.3f %12ld\n", "diff", length, diff * 1e3, changes);
+
+	for (i = 0; i < 2; i++)
+	{
+		libjxml_hash_free (hashes [i]);
+		libjxml_free_xml_mem (docs [i]);
+		free (texts [i]);
+	}
+}
+
+/*
+ * Text escaped and decoded in a single call, so the speed is the one of the
+ * search for the special characters and of the copy of the runs between them.
+ */
+void bench_entity (long size)
+{
+	char * kinds [] = {"clean", "entities"};
+	char * target;
+	char * text;
+	long runs;
+	long index;
+	double start;
+	double copy;
+	double escape;
+	double decode;
+	int kind;
+
+	if (size > BENCH_FLAT_SIZE)
+		size = BENCH_FLAT_SIZE;
+
+	text = (char *) malloc (size);
+	LIBASSERT_PTR (text);
+
+	target = (char *) malloc (2 * size);
+	LIBASSERT_PTR (target);
+
+	printf ("\n%-8s %12s %12s %12s %12s\n", "entity", "bytes", "copy_GB/s", "escape_GB/s", "decode_GB/s");
+
+	for (kind = 0; kind < 2; kind++)
+	{
+		for (index = 0; index < size; index++)
+			text [index] = (index % 8 == 7) ? ' ' : 'a' + index % 26;
+
+		for (index = 0; (kind == 1) && (index + 64 <= size); index = index + 64)
+			memcpy (text + index, "&amp;", 5);
+
+		runs = 0;
+		start = bench_now ();
+		do
+		{
+			memcpy (target, text, size);
+			runs++;
+		} while (bench_now () - start < BENCH_MIN_TIME);
+		copy = (bench_now () - start) / runs;
+
+		runs = 0;
+		start = bench_now ();
+		do
+		{
+			libjxml_entity_escape (target, text, size, true);
+			runs++;
+		} while (bench_now () - start < BENCH_MIN_TIME);
+		escape = (bench_now () - start) / runs;
+
+		runs = 0;
+		start = bench_now ();
+		do
+		{
+			libjxml_entity_decode (target, text, size);
+			runs++;
+		} while (bench_now () - start < BENCH_MIN_TIME);
+		decode = (bench_now () - start) / runs;
+
+		printf ("%-8s %12ld %12.2f %12.2f %12.2f\n", kinds [kind], size,
+				size / copy / 1e9, size / escape / 1e9, size / decode / 1e9);
+	}
+
+	free (target);
+	free (text);
+}
+
+/*
+ * Reports the counters of a document read from a file and written back, in
+ * each storage mode. Nothing is printed if the library does not count.
+ */
+/*
+ * Builds the path of the value of the first or the last record, following the
+ * first or the last tag of each level.
+ */
+void bench_version_path (xml_t * xml_mem_t, bool last, char * path)
+{
+	xml_tag_t * tag_t = xml_mem_t->content_t;
+	xml_tag_t * first_t;
+	xml_tag_t * other_t;
+	long index;
+
+	path [0] = '\0';
+
+	while (tag_t != NULL)
+	{
+		first_t = tag_t;
+		while ((last) && (tag_t->sibling_tag_t != NULL))
+			tag_t = tag_t->sibling_tag_t;
+
+		index = 1;
+		for (other_t = first_t; other_t != tag_t; other_t = other_t->sibling_tag_t)
+			if (other_t->name == tag_t->name)
+				index++;
+
+		sprintf (path + strlen (path), "/%s[%ld]", tag_t->name, index);
+
+		if (libjxml_token_equal (tag_t->name, tag_t->name_length, "record"))
+		{
+			strcat (path, "/value");
+			return;
+		}
+
+		tag_t = tag_t->nested_tag_t;
+	}
+}
+
+void * bench_version_read (void * context)
+{
+	bench_readers_t * readers_t = (bench_readers_t *) context;
+	xml_version_t * version_t;
+	long reads = 0;
+
+	while (__atomic_load_n (&readers_t->stop, __ATOMIC_RELAXED) == false)
+	{
+		version_t = libjxml_shared_acquire (readers_t->shared_t);
+
+		if (libjxml_version_tag (version_t, readers_t->path) == NULL)
+			printf ("\nBench: Error reading the shared document\n");
+
+		libjxml_version_release (version_t);
+		reads++;
+	}
+
+	__atomic_add_fetch (&readers_t->reads, reads, __ATOMIC_RELAXED);
+
+	return NULL;
+}
+
+/*
+ * Each update commits a new value, and the reload parses the whole text again,
+ * what a caller without versions does to keep the old document for its readers.
+ */
+void bench_version (long size)
+{
+	bench_readers_t readers_t;
+	pthread_t ids [BENCH_READERS];
+	xml_version_t * draft_t;
+	xml_t * xml_mem_t;
+	char paths [2][1024];
+	char value [32];
+	char * text;
+	long length;
+	long runs;
+	double start;
+	double update;
+	int threads;
+	int i;
+
+	if (size > BENCH_FLAT_SIZE)
+		size = BENCH_FLAT_SIZE;
+
+	text = bench_generate (size, &length);
+
+	runs = 0;
+	start = bench_now ();
+	do
+	{
+		xml_mem_t = libjxml_xml_to_mem_mode (text, LIBJXML_MODE_ARENA);
+		libjxml_free_xml_mem (xml_mem_t);
+		runs++;
+	} while (bench_now () - start < BENCH_MIN_TIME);
+	update = (bench_now () - start) / runs;
+
+	printf ("\n%-8s %12s %8s %12s %12s\n", "versions", "bytes", "runs", "update_us", "reads/s");
+	printf ("%-8s %12ld %8ld %12.3f %12s\n", "reload", length, runs, update * 1e6, "-");
+
+	xml_mem_t = libjxml_xml_to_mem_mode (text, LIBJXML_MODE_ARENA);
+	bench_version_path (xml_mem_t, false, paths [0]);
+	bench_version_path (xml_mem_t, true, paths [1]);
+
+	readers_t.shared_t = libjxml_shared_create (xml_mem_t);
+	readers_t.path = paths [1];
+
+	/* The first two rows update without readers, then with more readers each */
+	for (threads = -2; threads <= BENCH_READERS; threads++)
+	{
+		if (threads == 0)
+			continue;
+
+		readers_t.reads = 0;
+		readers_t.stop = false;
+
+		for (i = 0; i < threads; i++)
+			pthread_create (&ids [i], NULL, bench_version_read, &readers_t);
+
+		runs = 0;
+		start = bench_now ();
+		do
+		{
+			sprintf (value, "%ld", runs);
+
+			draft_t = libjxml_shared_edit (readers_t.shared_t);
+			if (libjxml_version_set_value (draft_t, paths [(threads == -2) ? 0 : 1], value, strlen (value)) == false)
+				printf ("\nBench: Error updating the shared document\n");
+			libjxml_shared_commit (readers_t.shared_t, draft_t);
+			runs++;
+		} while (bench_now () - start < BENCH_MIN_TIME);
+		update = (bench_now () - start) / runs;
+
+		__atomic_store_n (&readers_t.stop, true, __ATOMIC_RELAXED);
+		for (i = 0; i < threads; i++)
+			pthread_join (ids [i], NULL);
+
+		if (threads < 0)
+			printf ("%-8s %12ld %8ld %12.3f %12s\n", (threads == -2) ? "first" : "last", length, runs,
+					update * 1e6, "-");
+		else
+			printf ("readers%-1d %12ld %8ld %12.3f %12.0f\n", threads, length, runs, update * 1e6,
+					readers_t.reads / (update * runs));
+	}
+
+	libjxml_shared_free (readers_t.shared_t);
+	free (text);
+}
+
+void bench_json (long size)
+{
+	char * names [] = {"tree", "buffer", "fd"};
+	char xml_name [] = "/tmp/libjxml_bench_XXXXXX";
+	xml_sink_t * sink_t;
+	xml_t * xml_mem_t;
+	char * text;
+	char * json;
+	long length;
+	long json_length;
+	long runs;
+	double start;
+	double elapsed;
+	int null_fd;
+	int xml_fd;
+	int kind;
+
+	if (size > BENCH_FLAT_SIZE)
+		size = BENCH_FLAT_SIZE;
+
+	null_fd = open ("/dev/null", O_WRONLY);
+	xml_fd = mkstemp (xml_name);
+	if ((null_fd < 0) || (xml_fd < 0))
+		return;
+
+	text = bench_generate (size, &length);
+	if (write (xml_fd, text, length) != length)
+		length = 0;
+	close (xml_fd);
+
+	printf ("\n%-8s %12s %8s %12s %12s\n", "json", "bytes", "runs", "MB/s", "peak_MB");
+
+	for (kind = 0; (length > 0) && (kind < 3); kind++)
+	{
+		/* The file is streamed without the text in memory, so the peak is the converter's */
+		if (kind == 2)
+		{
+			free (text);
+			text = NULL;
+		}
+
+		bench_peak_reset ();
+
+		runs = 0;
+		start = bench_now ();
+		do
+		{
+			sink_t = libjxml_sink_fd (null_fd, 0);
+
+			if (kind == 0)
+			{
+				xml_mem_t = libjxml_xml_to_mem_mode (text, LIBJXML_MODE_ARENA);
+				libjxml_mem_to_json (xml_mem_t, sink_t, NULL);
+				libjxml_free_xml_mem (xml_mem_t);
+			}
+			else if (kind == 1)
+				libjxml_xml_to_json (text, length, sink_t, NULL);
+			else
+			{
+				xml_fd = open (xml_name, O_RDONLY);
+				libjxml_fd_to_json (xml_fd, sink_t, NULL);
+				close (xml_fd);
+			}
+
+			libjxml_sink_close (sink_t);
+			runs++;
+		} while (bench_now () - start < BENCH_MIN_TIME);
+		elapsed = (bench_now () - start) / runs;
+
+		printf ("%-8s %12ld %8ld %12.1f %12.1f\n", names [kind], length, runs,
+				length / elapsed / 1e6, bench_peak () / 1e6);
+	}
+
+	/* The JSON is read back into a tree, its throughput counted in JSON bytes */
+	sink_t = libjxml_sink_mem (0);
+	xml_fd = open (xml_name, O_RDONLY);
+	libjxml_fd_to_json (xml_fd, sink_t, NULL);
+	close (xml_fd);
+	json = libjxml_sink_release (sink_t, &json_length);
+
+	runs = 0;
+	start = bench_now ();
+	do
+	{
+		xml_mem_t = libjxml_json_to_mem (json, json_length, LIBJXML_MODE_ARENA, NULL);
+		libjxml_free_xml_mem (xml_mem_t);
+		runs++;
+	} while ((length > 0) && (bench_now () - start < BENCH_MIN_TIME));
+	elapsed = (bench_now () - start) / runs;
+
+	printf ("%-8s %12ld %8ld %12.1f %12s\n", "to_mem", json_length, runs, json_length / elapsed / 1e6, "-");
+
+	close (null_fd);
+	unlink (xml_name);
+	free (json);
+	free (text);
+}
+
+void bench_stats (long size)
+{
+	xml_stats_t stats_t;
+	xml_t * xml_mem_t;
+	char xml_name [] = "/tmp/libjxml_bench_XXXXXX";
+	char * text;
+	char * output;
+	long length;
+	unsigned int i;
+	int xml_fd;
+	int phase;
+
+	if (size > BENCH_FLAT_SIZE)
+		size = BENCH_FLAT_SIZE;
+
+	xml_fd = mkstemp (xml_name);
+	if (xml_fd < 0)
+		return;
+
+	text = bench_generate (size, &length);
+	if (write (xml_fd, text, length) != length)
+		length = 0;
+	close (xml_fd);
+	free (text);
+
+	for (i = 0; (length > 0) && (i < sizeof (bench_modes) / sizeof (bench_modes [0])); i++)
+	{
+		xml_mem_t = libjxml_file_to_mem_mode (xml_name, bench_modes [i].mode);
+		if (xml_mem_t == NULL)
+			break;
+
+		output = libjxml_mem_to_txt (xml_mem_t, LIBJXML_FORMAT_INDENT, NULL);
+		free (output);
+
+		if (libjxml_stats_get (xml_mem_t, &stats_t) == false)
+		{
+			libjxml_free_xml_mem (xml_mem_t);
+			break;
+		}
+
+		if (i == 0)
+		{
+			printf ("\n%-8s %12s", "phases", "bytes");
+			for (phase = 0; phase < LIBJXML_PHASES; phase++)
+				printf (" %9s_ms", libjxml_stats_phase (phase));
+			printf (" %12s %12s\n", "allocations", "alloc_bytes");
+		}
+
+		printf ("%-8s %12ld", bench_modes [i].name, length);
+		for (phase = 0; phase < LIBJXML_PHASES; phase++)
+			printf (" %12.3f", stats_t.seconds [phase] * 1e3);
+		printf (" %12ld %12ld\n", stats_t.allocations, stats_t.bytes);
+
+		libjxml_free_xml_mem (xml_mem_t);
+	}
+
+	unlink (xml_name);
+}
+
+int main (int argc, char ** argv)
+{
+	long max_size = BENCH_MAX_SIZE;
+	long length;
+	char * text;
+	bool csv = false;
+	int shape = -1;
+	int option;
+
+	while ((option = getopt (argc, argv, "cg:")) != -1)
+	{
+		switch (option)
+		{
+			case 'c':
+				csv = true;
+				break;
+			case 'g':
+				shape = bench_corpus_find (optarg);
+				if (shape < 0)
+				{
+					printf ("\nBench: Unknown shape %s\n", optarg);
+					return 1;
+				}
+				break;
+			default:
+				printf ("Usage: bench [-c] [-g shape] [max_size]\n");
+				return 1;
+		}
+	}
+
+	if (optind < argc)
+		max_size = bench_size (argv [optind]);
+
+	if (max_size <= 0)
+	{
+		printf ("\nBench: Wrong size %s\n", argv [optind]);
+		return 1;
+	}
+
+	/* The document is written alone so it can be saved and given to other parsers */
+	if (shape >= 0)
+	{
+		text = bench_corpus (shape, max_size, &length);
+		fwrite (text, 1, length, stdout);
+		free (text);
+		return 0;
+	}
+
+	if (bench_suite (max_size, csv) != 0)
+		return 1;
+
+	/* The comparisons have different columns each, so they are left out of the values */
+	if (csv)
+		return 0;
+
+	bench_scan (max_size);
+	bench_flat (max_size);
+	bench_index ();
+	bench_query (max_size);
+	bench_snapshot (max_size);
+	bench_parallel (max_size);
+	bench_lazy (max_size);
+	bench_bind (max_size);
+	bench_writer (max_size);
+	bench_batch ();
+	bench_diff (max_size);
+	bench_entity (max_size);
+	bench_version (max_size);
+	bench_json (max_size);
+	bench_stats (max_size);
+
+	return 0;
+}
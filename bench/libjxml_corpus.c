@@ -0,0 +1,276 @@
+/**
+ * @file libjxml_corpus.c
+ *
+ * @brief Generator of the XML documents measured by the benchmark.
+ *
+ * Every shape repeats a small unit until the size is reached, so the nodes per
+ * byte stay the same for every size and the throughput of a linear parser does
+ * not change with it. The chains of nested tags are cut at the end of the
+ * document, so small documents are still deep and never much bigger than asked.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libjxml_corpus.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define BENCH_CORPUS_SLACK 4096 /**< Room after the size for the last unit written */
+#define BENCH_DEEP_BYTES   13   /**< Length of the opening and closing tags of a level */
+
+static const char * bench_shape_names [BENCH_SHAPES] =
+{
+	"records",
+	"deep",
+	"wide",
+	"attributes",
+	"text",
+};
+
+static const char bench_words [] = "lorem ipsum dolor sit amet, consectetur adipiscing elit, "
+								   "sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. ";
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+void bench_group (bench_doc_t * doc_t, int level, int indent);
+void bench_corpus_deep (bench_doc_t * doc_t);
+void bench_corpus_wide (bench_doc_t * doc_t);
+void bench_corpus_attributes (bench_doc_t * doc_t);
+void bench_corpus_text (bench_doc_t * doc_t);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+void bench_append (bench_doc_t * doc_t, char * text)
+{
+	long length;
+
+	length = strlen (text);
+	memcpy (doc_t->text + doc_t->length, text, length);
+	doc_t->length = doc_t->length + length;
+}
+
+void bench_record (bench_doc_t * doc_t, int indent)
+{
+	char record [256];
+
+	sprintf (record, "%*s<record id=\"%ld\" type=\"sample\"><name>record %ld</name>"
+			 "<value>%ld</value></record>\n", indent, "", doc_t->records, doc_t->records,
+			 doc_t->records * 7);
+	bench_append (doc_t, record);
+	doc_t->records++;
+}
+
+/*
+ * Records are nested in groups of BENCH_FANOUT so the tree stays balanced and
+ * the depth grows with the logarithm of the size.
+ */
+char * bench_generate (long size, long * length)
+{
+	bench_doc_t doc_t;
+	long capacity;
+	int levels = 0;
+
+	for (capacity = 100; capacity < size; capacity = capacity * BENCH_FANOUT)
+		levels++;
+
+	doc_t.text = (char *) malloc (size + BENCH_CORPUS_SLACK);
+	LIBASSERT_PTR (doc_t.text);
+	doc_t.length = 0;
+	doc_t.target = size;
+	doc_t.records = 0;
+
+	bench_append (&doc_t, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<records>\n");
+	bench_group (&doc_t, levels, 1);
+	bench_append (&doc_t, "</records>\n");
+	doc_t.text [doc_t.length] = '\0';
+
+	*length = doc_t.length;
+	return doc_t.text;
+}
+
+char * bench_corpus (int shape, long size, long * length)
+{
+	bench_doc_t doc_t;
+
+	if (shape == BENCH_SHAPE_RECORDS)
+		return bench_generate (size, length);
+
+	doc_t.text = (char *) malloc (size + BENCH_CORPUS_SLACK);
+	LIBASSERT_PTR (doc_t.text);
+	doc_t.length = 0;
+	doc_t.target = size;
+	doc_t.records = 0;
+
+	bench_append (&doc_t, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<corpus>\n");
+
+	switch (shape)
+	{
+		case BENCH_SHAPE_DEEP:
+			bench_corpus_deep (&doc_t);
+			break;
+		case BENCH_SHAPE_WIDE:
+			bench_corpus_wide (&doc_t);
+			break;
+		case BENCH_SHAPE_ATTRIBUTES:
+			bench_corpus_attributes (&doc_t);
+			break;
+		default:
+			bench_corpus_text (&doc_t);
+			break;
+	}
+
+	bench_append (&doc_t, "</corpus>\n");
+	doc_t.text [doc_t.length] = '\0';
+
+	*length = doc_t.length;
+	return doc_t.text;
+}
+
+char * bench_corpus_name (int shape)
+{
+	if ((shape < 0) || (shape >= BENCH_SHAPES))
+		return "unknown";
+
+	return (char *) bench_shape_names [shape];
+}
+
+int bench_corpus_find (char * name)
+{
+	int shape;
+
+	for (shape = 0; shape < BENCH_SHAPES; shape++)
+		if (strcmp (name, bench_shape_names [shape]) == 0)
+			return shape;
+
+	return -1;
+}
+
+/*********************************************************************************
+ *                                    SHAPES
+ *********************************************************************************/
+
+void bench_group (bench_doc_t * doc_t, int level, int indent)
+{
+	int i;
+
+	for (i = 0; (i < BENCH_FANOUT) && (doc_t->length < doc_t->target); i++)
+	{
+		if (level == 0)
+		{
+			bench_record (doc_t, indent);
+		}
+		else
+		{
+			sprintf (doc_t->text + doc_t->length, "%*s<group level=\"%d\">\n", indent, "", level);
+			doc_t->length = doc_t->length + strlen (doc_t->text + doc_t->length);
+			bench_group (doc_t, level - 1, indent + 1);
+			sprintf (doc_t->text + doc_t->length, "%*s</group>\n", indent, "");
+			doc_t->length = doc_t->length + strlen (doc_t->text + doc_t->length);
+		}
+	}
+}
+
+/*
+ * Chains are not indented, which would make the blanks grow with the square of
+ * the depth.
+ */
+void bench_corpus_deep (bench_doc_t * doc_t)
+{
+	char leaf [64];
+	long levels;
+	long level;
+
+	while (doc_t->length < doc_t->target)
+	{
+		levels = (doc_t->target - doc_t->length) / BENCH_DEEP_BYTES + 1;
+		if (levels > BENCH_DEEP_LEVELS)
+			levels = BENCH_DEEP_LEVELS;
+
+		for (level = 0; level < levels; level++)
+			bench_append (doc_t, "<node>");
+
+		snprintf (leaf, sizeof (leaf), "<leaf>%ld</leaf>", doc_t->records);
+		bench_append (doc_t, leaf);
+
+		for (level = 0; level < levels; level++)
+			bench_append (doc_t, "</node>");
+
+		bench_append (doc_t, "\n");
+		doc_t->records++;
+	}
+}
+
+void bench_corpus_wide (bench_doc_t * doc_t)
+{
+	char item [64];
+
+	while (doc_t->length < doc_t->target)
+	{
+		snprintf (item, sizeof (item), " <item>%ld</item>\n", doc_t->records);
+		bench_append (doc_t, item);
+		doc_t->records++;
+	}
+}
+
+void bench_corpus_attributes (bench_doc_t * doc_t)
+{
+	char attribute [64];
+	int i;
+
+	while (doc_t->length < doc_t->target)
+	{
+		bench_append (doc_t, " <item");
+
+		for (i = 0; i < BENCH_ATTRIBUTES; i++)
+		{
+			snprintf (attribute, sizeof (attribute), " a%d=\"%ld\"", i, doc_t->records * BENCH_ATTRIBUTES + i);
+			bench_append (doc_t, attribute);
+		}
+
+		bench_append (doc_t, "/>\n");
+		doc_t->records++;
+	}
+}
+
+/*
+ * Each paragraph starts at a different word, and has an entity in the middle so
+ * its value is decoded.
+ */
+void bench_corpus_text (bench_doc_t * doc_t)
+{
+	char head [64];
+	long words = sizeof (bench_words) - 1;
+	long offset;
+	long i;
+
+	while (doc_t->length < doc_t->target)
+	{
+		snprintf (head, sizeof (head), " <p id=\"%ld\">", doc_t->records);
+		bench_append (doc_t, head);
+
+		offset = (doc_t->records * 7) % words;
+		for (i = 0; i < BENCH_TEXT_LENGTH; i++)
+		{
+			if (i == BENCH_TEXT_LENGTH / 2)
+				bench_append (doc_t, " &amp; ");
+
+			doc_t->text [doc_t->length] = bench_words [(offset + i) % words];
+			doc_t->length++;
+		}
+
+		bench_append (doc_t, "</p>\n");
+		doc_t->records++;
+	}
+}
@@ -0,0 +1,106 @@
+/**
+ * @file libjxml_corpus.h
+ *
+ * @brief Generator of the XML documents measured by the benchmark.
+ *
+ * Each shape stresses a different part of the parser: balanced groups of small
+ * records, long chains of nested tags, many siblings of the same parent, tags
+ * full of attributes, and paragraphs of long text. Documents of any size are
+ * generated in memory, and the same size and shape always give the same text,
+ * so runs on different machines or versions can be compared.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_CORPUS_H
+#define _LIBJXML_CORPUS_H
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define BENCH_SHAPE_RECORDS    0 /**< Records nested in balanced groups */
+#define BENCH_SHAPE_DEEP       1 /**< Chains of BENCH_DEEP_LEVELS nested tags */
+#define BENCH_SHAPE_WIDE       2 /**< Small tags, all of them nested in the root */
+#define BENCH_SHAPE_ATTRIBUTES 3 /**< Empty tags with BENCH_ATTRIBUTES attributes each */
+#define BENCH_SHAPE_TEXT       4 /**< Paragraphs of BENCH_TEXT_LENGTH bytes with an entity each */
+#define BENCH_SHAPES           5 /**< Number of shapes */
+
+#define BENCH_FANOUT       16   /**< Tags nested on each group of records */
+#define BENCH_DEEP_LEVELS  1024 /**< Depth of each chain of nested tags */
+#define BENCH_ATTRIBUTES   16   /**< Attributes of each tag of the attribute shape */
+#define BENCH_TEXT_LENGTH  1024 /**< Length of each paragraph of the text shape */
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Buffer where the generated document is written.
+ */
+typedef struct bench_doc_t
+{
+	char * text;     /**< Generated text */
+	long   length;   /**< Used length */
+	long   target;   /**< Length to be reached */
+	long   records;  /**< Number of records written */
+}bench_doc_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Append a null ended text to a document.
+ *
+ * @param[in] doc_t Document being generated, with room for the text.
+ * @param[in] text Text to be appended.
+ */
+void bench_append (bench_doc_t * doc_t, char * text);
+
+/**
+ * @brief Append a record to a document, with its id, type, name and value.
+ *
+ * @param[in] doc_t Document being generated, with room for the record.
+ * @param[in] indent Number of blanks before the record.
+ */
+void bench_record (bench_doc_t * doc_t, int indent);
+
+/**
+ * @brief Generate a document of records nested in balanced groups.
+ *
+ * @param[in] size Length of the document, exceeded by less than a record.
+ * @param[out] length Length of the generated text.
+ * @return Null ended text, to be freed with free().
+ */
+char * bench_generate (long size, long * length);
+
+/**
+ * @brief Generate a document of a shape.
+ *
+ * @param[in] shape BENCH_SHAPE_* kind of document.
+ * @param[in] size Length of the document, exceeded by less than a tag, or a chain
+ * of tags for BENCH_SHAPE_DEEP.
+ * @param[out] length Length of the generated text.
+ * @return Null ended text, to be freed with free().
+ */
+char * bench_corpus (int shape, long size, long * length);
+
+/**
+ * @brief Get the name of a shape.
+ *
+ * @param[in] shape BENCH_SHAPE_* kind of document.
+ * @return Name of the shape.
+ */
+char * bench_corpus_name (int shape);
+
+/**
+ * @brief Find a shape by its name.
+ *
+ * @param[in] name Name of the shape.
+ * @return BENCH_SHAPE_* kind of document, -1 if there is none with that name.
+ */
+int bench_corpus_find (char * name);
+
+#endif //_LIBJXML_CORPUS_H
@@ -0,0 +1,137 @@
+/**
+ * @file libarena.h
+ *
+ * @brief Library to work with memory arenas.
+ *
+ * An arena serves many small allocations from a few big chunks of memory. The
+ * allocations are never freed one by one; the whole arena is released or reset
+ * at once, so the chunks can be reused without calling malloc again.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBARENA_H
+#define _LIBARENA_H
+
+#include <stdbool.h>
+
+/*********************************************************************************
+ *                                   DEFINITIONS
+ *********************************************************************************/
+
+#define LIBARENA_CHUNK_SIZE (64L*1024L)       /**< Default size of the first chunk */
+#define LIBARENA_CHUNK_MAX  (8L*1024L*1024L)  /**< Maximum size of a growing chunk */
+#define LIBARENA_ALIGN      sizeof (void *)   /**< Alignment of libarena_alloc() */
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+typedef struct Arena_t Arena_t;
+typedef struct AChunk_t AChunk_t;
+
+struct AChunk_t
+{
+	AChunk_t * next; /**< pointer to the next chunk of the arena */
+	long       size; /**< usable bytes of the chunk */
+	long       used; /**< bytes already served from the chunk */
+};
+
+struct Arena_t
+{
+	AChunk_t * first;      /**< pointer to the first chunk of the arena */
+	AChunk_t * current;    /**< pointer to the chunk serving allocations */
+	long       chunk_size; /**< size for the next chunk to be created */
+	long       allocated;  /**< number of allocations served since the last reset */
+};
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Creates an empty arena.
+ *
+ * @param[in] chunk_size Size of the first chunk, LIBARENA_CHUNK_SIZE if 0 or less.
+ *
+ * @return Pointer to the arena.
+ */
+Arena_t * libarena_create (long chunk_size);
+
+/**
+ * @brief Frees an arena with all its chunks.
+ *
+ * @param[in] arena Pointer to the arena.
+ *
+ * @return The number of chunks freed.
+ */
+long libarena_delete (Arena_t * arena);
+
+/**
+ * @brief Forgets every allocation but keeps the chunks for reuse.
+ *
+ * @param[in] arena Pointer to the arena.
+ *
+ * @return The number of chunks kept.
+ */
+long libarena_reset (Arena_t * arena);
+
+/**
+ * @brief Allocates memory aligned to LIBARENA_ALIGN.
+ *
+ * @param[in] arena Pointer to the arena.
+ * @param[in] size Number of bytes to allocate.
+ *
+ * @return Pointer to the allocated memory.
+ */
+void * libarena_alloc (Arena_t * arena, long size);
+
+/**
+ * @brief Copies a text in the arena adding the null character.
+ *
+ * The copy is not aligned, so no space is lost between consecutive strings.
+ *
+ * @param[in] arena Pointer to the arena.
+ * @param[in] text Text to be copied.
+ * @param[in] length Number of characters to copy.
+ *
+ * @return Pointer to the copied string.
+ */
+char * libarena_copy (Arena_t * arena, char * text, long length);
+
+/**
+ * @brief Moves every chunk of an arena to another one.
+ *
+ * The allocations of 'other' stay valid and are released with 'arena', which
+ * does not serve new allocations from the moved chunks until it is reset.
+ * 'other' is left empty.
+ *
+ * @param[in] arena Pointer to the arena receiving the chunks.
+ * @param[in] other Pointer to the arena giving the chunks.
+ *
+ * @return The number of chunks moved.
+ */
+long libarena_adopt (Arena_t * arena, Arena_t * other);
+
+/**
+ * @brief Returns the number of bytes reserved by the chunks of an arena.
+ *
+ * @param[in] arena Pointer to the arena.
+ *
+ * @return The size of all the chunks.
+ */
+long libarena_size (Arena_t * arena);
+
+/**
+ * @brief Checks whether a pointer was served by an arena.
+ *
+ * Every chunk is looked at, so it costs as many steps as chunks has the arena.
+ *
+ * @param[in] arena Pointer to the arena.
+ * @param[in] pointer Pointer to be checked.
+ *
+ * @return true if the pointer is inside the used part of a chunk of the arena.
+ */
+bool libarena_owns (Arena_t * arena, void * pointer);
+
+#endif //_LIBARENA_H
@@ -16,6 +16,28 @@
 #include <stdio.h>
 #include <stdbool.h>
 
+#include "libarena.h"
+#include "libjxml_sink.h"
+#include "libjxml_names.h"
+#include "libjxml_stats.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_MODE_MALLOC    0x00 /**< Each node and string is allocated apart */
+#define LIBJXML_MODE_ARENA     0x01 /**< Nodes and strings are allocated in the document arena */
+#define LIBJXML_MODE_SLICE     0x02 /**< Values point to the parsed text, not null ended */
+#define LIBJXML_MODE_TERMINATE 0x04 /**< Slices are null ended writing on the parsed text */
+#define LIBJXML_MODE_INSITU    (LIBJXML_MODE_SLICE | LIBJXML_MODE_TERMINATE)
+
+#define LIBJXML_FORMAT_INDENT  0x00 /**< Each tag in its own line, indented with tabs */
+#define LIBJXML_FORMAT_COMPACT 0x01 /**< No line breaks nor indentation between tags */
+
+#define LIBJXML_WALK_PRE       0x01 /**< Iterators return each tag before its nested tags */
+#define LIBJXML_WALK_POST      0x02 /**< Iterators return each tag after its nested tags */
+#define LIBJXML_WALK_CHILDREN  0x04 /**< Iterators return only the tags nested in the given one */
+
 /*********************************************************************************
  *                                    STRUCTS
  *********************************************************************************/
@@ -27,6 +49,19 @@ typedef struct xml_t
 {
 	struct xml_attribute_t * instruction_t; /**< Pointer to the XML instruction */
 	struct xml_tag_t       * content_t;     /**< Pointer to the first XML tag in the list */
+	Arena_t                * arena_t;       /**< Arena holding the document, NULL if not used */
+	int                      mode;          /**< LIBJXML_MODE_* flags used to build the document */
+	long                     nodes;         /**< Number of tags and attributes of the document */
+	char                   * source;        /**< Parsed text owned by the document, NULL if not owned */
+	long                     source_length; /**< Length of the owned text */
+	bool                     source_mapped; /**< The owned text is a file mapped in memory */
+	xml_names_t            * names_t;       /**< Table of the names of tags and attributes */
+	long                     generation;    /**< Changed each time tags or attributes are added or removed */
+	long                     revision;      /**< Changed each time a value of a tag or attribute is set */
+	Arena_t                * decoded_t;     /**< Values stored out of a sliced text without arena, NULL if none */
+#ifdef LIBJXML_STATS
+	xml_stats_t              stats_t;       /**< Allocations and time of the document */
+#endif
 }xml_t;
 
 /**
@@ -34,8 +69,10 @@ typedef struct xml_t
  */
 typedef struct xml_attribute_t
 {
-	char * name;                                /**< The name of the attribute */
+	char * name;                                /**< The name of the attribute, interned */
 	char * value;                               /**< The value of the attribute */
+	long   name_length;                         /**< The length of the name */
+	long   value_length;                        /**< The length of the value */
 	struct xml_attribute_t * next_attribute_t;  /**< Pointer to the next attribute in the list */
 }xml_attribute_t;
 
@@ -44,13 +81,40 @@ typedef struct xml_attribute_t
  */
 typedef struct xml_tag_t
 {
-	char * name;                            /**< The name of the tag */
+	char * name;                            /**< The name of the tag, interned */
 	char * value;                           /**< The value of the tag */
+	long   name_length;                     /**< The length of the name */
+	long   value_length;                    /**< The length of the value */
 	struct xml_attribute_t * attribute_t;   /**< Pointer to the first attribute in the list */
 	struct xml_tag_t       * nested_tag_t;  /**< Pointer to the first nested tag in the list */
 	struct xml_tag_t       * sibling_tag_t; /**< Pointer to the next sibling tag */
 }xml_tag_t;
 
+/**
+ * @brief State of a walk through the tags of a document.
+ *
+ * Tags are walked in a loop, keeping the ancestors of the current tag in a stack
+ * allocated on the heap, so the program stack does not grow with the size of the
+ * document.
+ */
+typedef struct xml_iterator_t
+{
+	xml_tag_t  * first_t;  /**< First tag to be walked, NULL once started */
+	xml_tag_t  * tag_t;    /**< Last tag returned */
+	xml_tag_t ** stack;    /**< Ancestors of the last tag returned */
+	long         depth;    /**< Number of ancestors of the last tag returned */
+	long         capacity; /**< Number of ancestors allocated for the stack */
+	int          order;    /**< LIBJXML_WALK_* flags */
+	bool         leaving;  /**< The last tag returned is being left, after its nested tags */
+	bool         siblings; /**< The siblings of the first tag are walked too */
+	bool         skip;     /**< The nested tags of the last tag returned are not walked */
+}xml_iterator_t;
+
+/**
+ * @brief State of a document being built from chunks of text, private to the library.
+ */
+typedef struct xml_builder_t xml_builder_t;
+
 /*********************************************************************************
  *                                      API
  *********************************************************************************/
@@ -59,7 +123,8 @@ typedef struct xml_tag_t
  * @brief Free memory allocated to an xml_t structure.
  *
  * This function frees the memory allocated to an xml_t structure, 
- * including the memory allocated to its attributes and content.
+ * including the memory allocated to its attributes and content. In arena
+ * mode the chunks are released at once without walking the tree.
  *
  * @param xml_mem_t Pointer to the xml_t structure whose memory will be freed.
  *
@@ -67,6 +132,116 @@ typedef struct xml_tag_t
  */
 int libjxml_free_xml_mem (xml_t * xml_mem_t);
 
+/**
+ * @brief Create an empty xml_t structure.
+ *
+ * The structure can be filled with libjxml_parse_xml_mem(). With LIBJXML_MODE_ARENA
+ * every node and string is stored in a few big chunks, so the whole document is
+ * freed at once and the chunks can be reused with libjxml_reset_xml_mem().
+ *
+ * @param[in] mode LIBJXML_MODE_* flags that define how the document is stored.
+ * @return A pointer to the empty xml_t structure.
+ *
+ * @note The returned xml_t structure must be freed using libjxml_free_xml_mem() 
+ * when it is no longer needed.
+ */
+xml_t * libjxml_create_xml_mem (int mode);
+
+/**
+ * @brief Create an empty xml_t structure using a table of names shared with other
+ * documents.
+ *
+ * Names found in any of the documents sharing the table are stored once, and
+ * they can be compared by pointer between documents. The table is not locked, so
+ * documents sharing it must not be parsed at the same time from different threads.
+ *
+ * @param[in] mode LIBJXML_MODE_* flags that define how the document is stored.
+ * @param[in] names_t Table of names, created with libjxml_names_create(). The
+ * document takes its own reference, so the caller keeps its own. NULL to use a
+ * table of its own, like libjxml_create_xml_mem().
+ * @return A pointer to the empty xml_t structure.
+ */
+xml_t * libjxml_create_xml_names (int mode, xml_names_t * names_t);
+
+/**
+ * @brief Remove the content of an xml_t structure so it can be filled again.
+ *
+ * In arena mode the chunks are kept, so parsing document after document into
+ * the same structure does not allocate memory once the chunks are big enough.
+ * The table of names is kept too, so names already seen are not stored again.
+ *
+ * @param[in] xml_mem_t Pointer to the xml_t structure to be emptied.
+ * @return The same xml_t structure, empty.
+ */
+xml_t * libjxml_reset_xml_mem (xml_t * xml_mem_t);
+
+/**
+ * @brief Parse an XML text into an empty xml_t structure.
+ *
+ * @param[in] xml_mem_t Pointer to an empty xml_t structure.
+ * @param[in] xml_txt The XML text to be parsed.
+ * @param[in] length The length of the XML text.
+ * @return The same xml_t structure, or NULL if the text could not be parsed. On 
+ * error the structure is left empty.
+ *
+ * The entities of values are decoded, except inside CDATA sections, and they are
+ * escaped again when the document is written.
+ *
+ * @note With LIBJXML_MODE_SLICE the text must be kept until the document is reset
+ * or freed, and with LIBJXML_MODE_TERMINATE it must be writable.
+ */
+xml_t * libjxml_parse_xml_mem (xml_t * xml_mem_t, char * xml_txt, long length);
+
+/**
+ * @brief Parse an XML text taken from a larger document.
+ *
+ * Same as libjxml_parse_xml_mem(), but errors are reported at their position in
+ * the larger document, where the text begins at 'offset'.
+ *
+ * @param[in] xml_mem_t Pointer to an empty xml_t structure.
+ * @param[in] xml_txt The XML text to be parsed.
+ * @param[in] length The length of the XML text.
+ * @param[in] offset Offset of the text in the larger document.
+ * @return The same xml_t structure, or NULL if the text could not be parsed.
+ */
+xml_t * libjxml_parse_xml_offset (xml_t * xml_mem_t, char * xml_txt, long length, long offset);
+
+/**
+ * @brief Start parsing into an empty xml_t structure a text given in chunks.
+ *
+ * The chunks are given with libjxml_feed_xml_mem() as they arrive, for example
+ * from a socket, and the document is completed with libjxml_end_xml_mem(). As the
+ * chunks are not kept, LIBJXML_MODE_SLICE and LIBJXML_MODE_TERMINATE are removed
+ * from the mode of the structure.
+ *
+ * @param[in] xml_mem_t Pointer to an empty xml_t structure.
+ * @return Pointer to the builder to be fed.
+ */
+xml_builder_t * libjxml_begin_xml_mem (xml_t * xml_mem_t);
+
+/**
+ * @brief Parse the next chunk of the text of a document.
+ *
+ * The chunk can end anywhere, even in the middle of a tag, and it can be reused
+ * once the function returns.
+ *
+ * @param[in] builder_t Pointer to the builder returned by libjxml_begin_xml_mem().
+ * @param[in] chunk The next chunk of XML text.
+ * @param[in] length The length of the chunk.
+ * @return true if the chunk was parsed, false on error. Once false is returned,
+ * next chunks are ignored.
+ */
+bool libjxml_feed_xml_mem (xml_builder_t * builder_t, char * chunk, long length);
+
+/**
+ * @brief Finish a document given in chunks, and release the builder.
+ *
+ * @param[in] builder_t Pointer to the builder returned by libjxml_begin_xml_mem().
+ * @return The built xml_t structure, or NULL if the text could not be parsed. On 
+ * error the structure is left empty.
+ */
+xml_t * libjxml_end_xml_mem (xml_builder_t * builder_t);
+
 /**
  * @brief Convert an XML string into an xml_t structure.
  *
@@ -82,6 +257,19 @@ int libjxml_free_xml_mem (xml_t * xml_mem_t);
  */
 xml_t * libjxml_xml_to_mem  (char * xml_txt);
 
+/**
+ * @brief Convert an XML string into an xml_t structure stored as requested.
+ *
+ * Same as libjxml_xml_to_mem() using the LIBJXML_MODE_* flags of 'mode'. With
+ * LIBJXML_MODE_SLICE the string must be kept until the document is freed, and
+ * with LIBJXML_MODE_TERMINATE it must be writable.
+ *
+ * @param[in] xml_txt The XML string to be converted.
+ * @param[in] mode LIBJXML_MODE_* flags that define how the document is stored.
+ * @return A pointer to the xml_t structure that represents the XML document.
+ */
+xml_t * libjxml_xml_to_mem_mode (char * xml_txt, int mode);
+
 /**
  * @brief Read an XML file and convert it to an xml_t structure.
  *
@@ -89,6 +277,9 @@ xml_t * libjxml_xml_to_mem  (char * xml_txt);
  * to an xml_t structure using libjxml_xml_to_mem(). The resulting xml_t * structure
  * contains pointers to the parsed instruction and content of the XML document.
  *
+ * Regular files are mapped in memory and parsed without copying them. Pipes and
+ * other files that cannot be mapped are read into a buffer.
+ *
  * @param[in] xml_name The name of the XML file to be read.
  * @return A pointer to the xml_t structure that represents the XML document.
  *
@@ -97,13 +288,25 @@ xml_t * libjxml_xml_to_mem  (char * xml_txt);
  */
 xml_t * libjxml_file_to_mem (char * xml_name);
 
+/**
+ * @brief Read an XML file and convert it to an xml_t structure stored as requested.
+ *
+ * Same as libjxml_file_to_mem() using the LIBJXML_MODE_* flags of 'mode'. With
+ * LIBJXML_MODE_SLICE the text read from the file is kept by the document.
+ *
+ * @param[in] xml_name The name of the XML file to be read.
+ * @param[in] mode LIBJXML_MODE_* flags that define how the document is stored.
+ * @return A pointer to the xml_t structure that represents the XML document.
+ */
+xml_t * libjxml_file_to_mem_mode (char * xml_name, int mode);
+
 /**
  * @brief Write an xml_t structure to an XML file.
  *
  * This function takes an xml_t structure as input, writes its instruction and
- * content to an XML file using libjxml_write_instruction() and libjxml_write_tag(),
- * respectively, and returns a pointer to the opened file. If the 'close' parameter
- * is set to true, the file will be closed after writing is complete.
+ * content indented to an XML file using libjxml_mem_to_fd(), and returns a pointer
+ * to the opened file. If the 'close' parameter is set to true, the file will be
+ * closed after writing is complete.
  *
  * @param[in] xml_mem_t A pointer to the xml_t structure to be written.
  * @param[in] xml_name The name of the XML file to be created.
@@ -118,21 +321,296 @@ FILE  * libjxml_mem_to_file (xml_t * xml_mem_t,
 							 char * xml_name,
 							 bool close);
 
+/**
+ * @brief Write an xml_t structure to a file descriptor.
+ *
+ * The text is gathered in a buffer and written with a few write() calls.
+ *
+ * @param[in] xml_mem_t A pointer to the xml_t structure to be written.
+ * @param[in] xml_fd File descriptor open for writing. It is not closed.
+ * @param[in] format LIBJXML_FORMAT_INDENT or LIBJXML_FORMAT_COMPACT.
+ * @return true if the whole text was written.
+ */
+bool libjxml_mem_to_fd (xml_t * xml_mem_t, int xml_fd, int format);
+
+/**
+ * @brief Write an xml_t structure to a text in memory.
+ *
+ * @param[in] xml_mem_t A pointer to the xml_t structure to be written.
+ * @param[in] format LIBJXML_FORMAT_INDENT or LIBJXML_FORMAT_COMPACT.
+ * @param[out] length Length of the text, can be NULL.
+ * @return The XML text, null ended.
+ *
+ * @note The text must be freed using free() when it is no longer needed.
+ */
+char * libjxml_mem_to_txt (xml_t * xml_mem_t, int format, long * length);
+
+/**
+ * @brief Write an xml_t structure to a sink.
+ *
+ * @param[in] xml_mem_t A pointer to the xml_t structure to be written.
+ * @param[in] sink_t Sink receiving the text. It is not flushed.
+ * @param[in] format LIBJXML_FORMAT_INDENT or LIBJXML_FORMAT_COMPACT.
+ */
+void libjxml_mem_to_sink (xml_t * xml_mem_t, xml_sink_t * sink_t, int format);
+
 /*********************************************************************************
- *                              ONLY FOR TESTING
+ *                                     NODES
  *********************************************************************************/
 
 /**
- * @brief Tests and prints information about an XML document.
+ * @brief Allocate an empty tag in the storage of a document.
+ *
+ * The tag is not linked to the tree, it is counted in the nodes of the document.
+ *
+ * @param[in] xml_mem_t Document the tag belongs to.
+ * @return Pointer to the tag, freed with the document once linked to it.
+ */
+xml_tag_t * libjxml_new_tag (xml_t * xml_mem_t);
+
+/**
+ * @brief Allocate an empty attribute in the storage of a document.
  *
- * This function prints information about the XML instruction, content,
- * and prompts the user to select an option to navigate through the document.
+ * @param[in] xml_mem_t Document the attribute belongs to.
+ * @return Pointer to the attribute, freed with the document once linked to it.
+ */
+xml_attribute_t * libjxml_new_attribute (xml_t * xml_mem_t);
+
+/**
+ * @brief Store a value in a document, as its values are stored.
+ *
+ * The text is copied, in the arena of the document or apart, except with
+ * LIBJXML_MODE_SLICE where it is kept as given.
+ *
+ * @param[in] xml_mem_t Document the value belongs to.
+ * @param[in] text Text of the value, not null ended.
+ * @param[in] length Length of the text.
+ * @return The stored value.
+ */
+char * libjxml_store_token (xml_t * xml_mem_t, char * text, long length);
+
+/**
+ * @brief Store a copy of a value that is not part of the parsed text.
+ *
+ * Like libjxml_store_token(), but the text is copied in every mode. With
+ * LIBJXML_MODE_SLICE the copy goes to the arena of the document, or to an arena
+ * of its own if the document has none, freed with the document.
+ *
+ * @param[in] xml_mem_t Document the value belongs to.
+ * @param[in] text Text of the value, not null ended. It can be freed afterwards.
+ * @param[in] length Length of the text.
+ * @return The stored value, null ended.
+ */
+char * libjxml_store_copy (xml_t * xml_mem_t, char * text, long length);
+
+/**
+ * @brief Store a value read from an xml text, decoding its entities.
+ *
+ * Values without entities are stored like libjxml_store_token() does. The others
+ * are decoded over the text with LIBJXML_MODE_TERMINATE, as it is writable, and
+ * copied decoded in any other mode, also with LIBJXML_MODE_SLICE.
+ *
+ * @param[in] xml_mem_t Document the value belongs to.
+ * @param[in] text Text of the value as written, not null ended.
+ * @param[in,out] length Length of the text, replaced by the length of the value.
+ * @return The stored value.
+ */
+char * libjxml_store_text (xml_t * xml_mem_t, char * text, long * length);
+
+/*********************************************************************************
+ *                                    EDITION
+ *********************************************************************************/
+
+/*
+ * The next functions change the tree keeping the storage of the document, and
+ * change its generation when tags or attributes are added or removed, and its
+ * revision when values are set, so the structures built from the tree, like
+ * indexes and hashes, know they are out of date.
+ */
+
+/**
+ * @brief Add a tag after the last tag nested in another one.
+ *
+ * @param[in] xml_mem_t Document the tag is added to.
+ * @param[in] parent_t Tag where the new tag is nested, NULL for the first level.
+ * @param[in] name Null ended name of the new tag.
+ * @return Pointer to the new tag, without value nor attributes.
+ */
+xml_tag_t * libjxml_add_tag (xml_t * xml_mem_t, xml_tag_t * parent_t, char * name);
+
+/**
+ * @brief Remove a tag, with its nested tags and attributes.
+ *
+ * In arena mode the memory of the tag is released when the document is reset.
+ *
+ * @param[in] xml_mem_t Document the tag belongs to.
+ * @param[in] parent_t Tag where the tag is nested, NULL for the first level.
+ * @param[in] tag_t Tag to be removed.
+ * @return true if the tag was removed, false if it is not nested in 'parent_t'.
+ */
+bool libjxml_remove_tag (xml_t * xml_mem_t, xml_tag_t * parent_t, xml_tag_t * tag_t);
+
+/**
+ * @brief Set the value of a tag.
+ *
+ * @param[in] xml_mem_t Document the tag belongs to.
+ * @param[in] tag_t Pointer to the tag.
+ * @param[in] value Value copied like libjxml_store_copy() does, NULL to remove it.
+ * @param[in] length Length of the value.
+ */
+void libjxml_set_value (xml_t * xml_mem_t, xml_tag_t * tag_t, char * value, long length);
+
+/**
+ * @brief Set the value of an attribute of a tag, adding it if the tag does not have it.
+ *
+ * @param[in] xml_mem_t Document the tag belongs to.
+ * @param[in] tag_t Pointer to the tag.
+ * @param[in] name Null ended name of the attribute.
+ * @param[in] value Value copied like libjxml_store_copy() does.
+ * @param[in] length Length of the value.
+ * @return Pointer to the attribute.
+ */
+xml_attribute_t * libjxml_set_attribute (xml_t * xml_mem_t, xml_tag_t * tag_t, char * name,
+										 char * value, long length);
+
+/**
+ * @brief Remove an attribute of a tag.
+ *
+ * @param[in] xml_mem_t Document the tag belongs to.
+ * @param[in] tag_t Pointer to the tag.
+ * @param[in] name Null ended name of the attribute.
+ * @return true if the attribute was removed, false if the tag does not have it.
+ */
+bool libjxml_remove_attribute (xml_t * xml_mem_t, xml_tag_t * tag_t, char * name);
+
+/*********************************************************************************
+ *                                   ITERATORS
+ *********************************************************************************/
+
+/**
+ * @brief Start a walk through a tag and its nested tags.
+ *
+ * With LIBJXML_WALK_PRE each tag is returned before its nested tags, and with
+ * LIBJXML_WALK_POST after them. With both flags each tag is returned twice, and
+ * the 'leaving' field tells which time it is. With LIBJXML_WALK_CHILDREN only the
+ * tags directly nested in 'tag_t' are returned.
+ *
+ * @param[out] iterator_t Iterator to be initialized.
+ * @param[in] tag_t Tag to be walked.
+ * @param[in] order LIBJXML_WALK_* flags.
+ *
+ * @note The iterator must be released with libjxml_iterator_free().
+ */
+void libjxml_iterator_init (xml_iterator_t * iterator_t, xml_tag_t * tag_t, int order);
+
+/**
+ * @brief Start a walk through all the tags of a document.
+ *
+ * Same as libjxml_iterator_init() for every tag at the first level of the document.
+ *
+ * @param[out] iterator_t Iterator to be initialized.
+ * @param[in] xml_mem_t Document to be walked.
+ * @param[in] order LIBJXML_WALK_* flags.
+ */
+void libjxml_iterator_xml (xml_iterator_t * iterator_t, xml_t * xml_mem_t, int order);
+
+/**
+ * @brief Get the next tag of a walk.
+ *
+ * The 'depth' field of the iterator gives the number of ancestors of the tag
+ * inside the walk. The tree must not be modified during the walk.
+ *
+ * @param[in] iterator_t Pointer to the iterator.
+ * @return The next tag, or NULL at the end of the walk.
+ */
+xml_tag_t * libjxml_iterator_next (xml_iterator_t * iterator_t);
+
+/**
+ * @brief Do not walk the nested tags of the last tag returned.
+ *
+ * Only useful after a tag returned with LIBJXML_WALK_PRE. With LIBJXML_WALK_POST
+ * too, the tag is still returned once more when left.
+ *
+ * @param[in] iterator_t Pointer to the iterator.
+ */
+void libjxml_iterator_skip (xml_iterator_t * iterator_t);
+
+/**
+ * @brief Release the memory used by an iterator.
+ *
+ * @param[in] iterator_t Pointer to the iterator.
+ */
+void libjxml_iterator_free (xml_iterator_t * iterator_t);
+
+/*********************************************************************************
+ *                                   ACCESSORS
+ *********************************************************************************/
+
+/*
+ * With LIBJXML_MODE_SLICE values are not null ended, so they must be read with
+ * their length. The next functions work the same way in every mode. Values are
+ * given with their entities decoded.
+ *
+ * Names are interned in every mode: they are null ended and the tags and
+ * attributes with the same name point to the same string.
+ */
+
+/**
+ * @brief Get the name of a tag.
+ *
+ * @param[in] tag_t Pointer to the tag.
+ * @param[out] length Length of the name, ignored if NULL.
+ * @return Pointer to the first character of the name.
+ */
+char * libjxml_tag_name (xml_tag_t * tag_t, long * length);
+
+/**
+ * @brief Get the value of a tag.
+ *
+ * @param[in] tag_t Pointer to the tag.
+ * @param[out] length Length of the value, ignored if NULL.
+ * @return Pointer to the first character of the value, NULL if the tag has no value.
+ */
+char * libjxml_tag_value (xml_tag_t * tag_t, long * length);
+
+/**
+ * @brief Get the name of an attribute.
+ *
+ * @param[in] attribute_t Pointer to the attribute.
+ * @param[out] length Length of the name, ignored if NULL.
+ * @return Pointer to the first character of the name.
+ */
+char * libjxml_attribute_name (xml_attribute_t * attribute_t, long * length);
+
+/**
+ * @brief Get the value of an attribute.
+ *
+ * @param[in] attribute_t Pointer to the attribute.
+ * @param[out] length Length of the value, ignored if NULL.
+ * @return Pointer to the first character of the value.
+ */
+char * libjxml_attribute_value (xml_attribute_t * attribute_t, long * length);
+
+/**
+ * @brief Compare a name or value with a null ended string.
+ *
+ * @param[in] token Pointer to the name or value, as returned by the accessors.
+ * @param[in] length Length of the name or value.
+ * @param[in] text Null ended string to compare with.
+ * @return true if both are equal, false otherwise.
+ */
+bool libjxml_token_equal (char * token, long length, char * text);
+
+/**
+ * @brief Get the interned copy of a name used in a document.
  *
- * @param[in] xml_mem_t A pointer to the XML document to be tested.
+ * The result is compared by pointer with the names of the tags and attributes,
+ * without comparing the characters again for each of them.
  *
- * @note Navigation within the XML tree is only allowed in a forward direction.
- *       It is not possible to backtrack to previous nodes.
+ * @param[in] xml_mem_t Pointer to the document.
+ * @param[in] name Null ended name.
+ * @return The interned name, or NULL if no tag nor attribute has that name.
  */
-void libjxml_test (xml_t * xml_mem_t);
+char * libjxml_find_name (xml_t * xml_mem_t, char * name);
 
 #endif //_LIBJXLM_H
@@ -0,0 +1,75 @@
+/**
+ * @file libjxml_batch.h
+ *
+ * @brief Loading of many xml files with a pool of threads.
+ *
+ * Each thread of the pool takes the next file of the list, reads it and parses
+ * it, so the reads of some threads overlap with the parsing of the others and
+ * the parsing is spread between the processors. The documents are the same
+ * built by libjxml_file_to_mem_mode() for each file.
+ *
+ * The library must be linked with -lpthread.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_BATCH_H
+#define _LIBJXML_BATCH_H
+
+#include <stdbool.h>
+
+#include "libjxml.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_BATCH_THREADS 64   /**< Maximum number of threads of a batch */
+#define LIBJXML_BATCH_INVALID -1   /**< Error of a file that could be read but not parsed */
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Result of loading a file of a batch.
+ */
+typedef struct xml_batch_t
+{
+	xml_t * xml_mem_t; /**< Document read, NULL on error */
+	int     error;     /**< 0, the errno of the failed read, or LIBJXML_BATCH_INVALID */
+}xml_batch_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Read and parse a list of XML files with many threads.
+ *
+ * A file that cannot be read or parsed does not stop the others.
+ *
+ * @param[in] xml_names Names of the XML files to be read.
+ * @param[in] count Number of files.
+ * @param[in] mode LIBJXML_MODE_* flags that define how the documents are stored.
+ * @param[in] threads Maximum number of threads, including the calling one. Twice
+ * the number of processors if 0 or less, so threads waiting for a read leave the
+ * processors to the others.
+ * @param[out] results Array of 'count' results, one for each file in the same order.
+ * @return Number of files loaded.
+ *
+ * @note The documents must be freed with libjxml_batch_free() or one by one with
+ * libjxml_free_xml_mem().
+ */
+long libjxml_batch_load (char ** xml_names, long count, int mode, int threads, xml_batch_t * results);
+
+/**
+ * @brief Free the documents of a batch.
+ *
+ * @param[in] results Array of results given to libjxml_batch_load().
+ * @param[in] count Number of results.
+ */
+void libjxml_batch_free (xml_batch_t * results, long count);
+
+#endif //_LIBJXML_BATCH_H
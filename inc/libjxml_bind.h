@@ -0,0 +1,201 @@
+/**
+ * @file libjxml_bind.h
+ *
+ * @brief Binding of xml documents to C structures.
+ *
+ * A binding is a static table telling, for each field of a structure, the name
+ * of the tag or attribute it is read from and its type. Documents are parsed
+ * straight into the structure in a single pass, without building a tree, and
+ * structures are written back as xml with the same table.
+ *
+ * The tables are built with the macros below, like:
+ *
+ *     static const xml_field_t record_fields [] =
+ *     {
+ *         LIBJXML_ATTRIBUTE (record_t, id, "id", LIBJXML_BIND_LONG),
+ *         LIBJXML_ELEMENT (record_t, name, "name", LIBJXML_BIND_STRING),
+ *         LIBJXML_ARRAY (record_t, values, values_count, "value", LIBJXML_BIND_DOUBLE),
+ *     };
+ *     static const xml_binding_t record_binding = LIBJXML_BINDING (record_t, "record", record_fields);
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_BIND_H
+#define _LIBJXML_BIND_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "libjxml.h"
+#include "libjxml_sink.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_BIND_INT    1 /**< int */
+#define LIBJXML_BIND_LONG   2 /**< long */
+#define LIBJXML_BIND_DOUBLE 3 /**< double */
+#define LIBJXML_BIND_BOOL   4 /**< bool, read from "true", "false", "1" or "0" */
+#define LIBJXML_BIND_STRING 5 /**< char *, null ended copy allocated with malloc() */
+#define LIBJXML_BIND_TEXT   6 /**< char [N], null ended and cut to the size of the array */
+#define LIBJXML_BIND_STRUCT 7 /**< Structure described by another binding */
+
+#define LIBJXML_PLACE_ELEMENT   0 /**< The field is read from a nested tag */
+#define LIBJXML_PLACE_ATTRIBUTE 1 /**< The field is read from an attribute */
+#define LIBJXML_PLACE_VALUE     2 /**< The field is read from the value of the tag itself */
+
+/**
+ * @brief Field read from a nested tag with a value.
+ */
+#define LIBJXML_ELEMENT(type, member, name, kind) \
+	{name, sizeof (name) - 1, kind, LIBJXML_PLACE_ELEMENT, offsetof (type, member), \
+	 sizeof (((type *) 0)->member), -1, NULL}
+
+/**
+ * @brief Field read from an attribute of the tag.
+ */
+#define LIBJXML_ATTRIBUTE(type, member, name, kind) \
+	{name, sizeof (name) - 1, kind, LIBJXML_PLACE_ATTRIBUTE, offsetof (type, member), \
+	 sizeof (((type *) 0)->member), -1, NULL}
+
+/**
+ * @brief Field read from the value of the tag, when it has no nested tags.
+ */
+#define LIBJXML_VALUE(type, member, kind) \
+	{"", 0, kind, LIBJXML_PLACE_VALUE, offsetof (type, member), \
+	 sizeof (((type *) 0)->member), -1, NULL}
+
+/**
+ * @brief Structure read from a nested tag, described by another binding.
+ */
+#define LIBJXML_NESTED(type, member, name, binding) \
+	{name, sizeof (name) - 1, LIBJXML_BIND_STRUCT, LIBJXML_PLACE_ELEMENT, offsetof (type, member), \
+	 sizeof (((type *) 0)->member), -1, &(binding)}
+
+/**
+ * @brief Array read from a nested tag repeated many times.
+ *
+ * The member is a pointer to the items, allocated with malloc(), and 'count' a
+ * long member with the number of items.
+ */
+#define LIBJXML_ARRAY(type, member, count, name, kind) \
+	{name, sizeof (name) - 1, kind, LIBJXML_PLACE_ELEMENT, offsetof (type, member), \
+	 sizeof (*((type *) 0)->member), offsetof (type, count), NULL}
+
+/**
+ * @brief Array of structures read from a nested tag repeated many times.
+ */
+#define LIBJXML_ARRAY_NESTED(type, member, count, name, binding) \
+	{name, sizeof (name) - 1, LIBJXML_BIND_STRUCT, LIBJXML_PLACE_ELEMENT, offsetof (type, member), \
+	 sizeof (*((type *) 0)->member), offsetof (type, count), &(binding)}
+
+/**
+ * @brief Binding of a structure to the tag with a name.
+ */
+#define LIBJXML_BINDING(type, name, fields) \
+	{name, sizeof (name) - 1, sizeof (type), fields, sizeof (fields) / sizeof (fields [0])}
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Field of a structure bound to a tag or attribute.
+ */
+typedef struct xml_field_t
+{
+	char                         * name;         /**< Name of the tag or attribute */
+	long                           name_length;  /**< Length of the name */
+	int                            kind;         /**< LIBJXML_BIND_* type of the field */
+	int                            place;        /**< LIBJXML_PLACE_* where the field is read from */
+	long                           offset;       /**< Offset of the field in the structure */
+	long                           size;         /**< Size of the field, or of each item of an array */
+	long                           count_offset; /**< Offset of the number of items of an array, -1 if not an array */
+	const struct xml_binding_t   * binding_t;    /**< Binding of the nested structure, NULL if not a structure */
+}xml_field_t;
+
+/**
+ * @brief Structure bound to a tag.
+ */
+typedef struct xml_binding_t
+{
+	char              * name;        /**< Name of the tag */
+	long                name_length; /**< Length of the name */
+	long                size;        /**< Size of the structure */
+	const xml_field_t * fields;      /**< Fields of the structure */
+	long                count;       /**< Number of fields */
+}xml_binding_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Fill a structure from an XML text.
+ *
+ * The structure is cleared first. Tags and attributes without a field are
+ * skipped, and fields without a tag or attribute are left at 0. Values that are
+ * not valid for the type of their field stop the parse, as do numeric tags
+ * without a value and a second root.
+ *
+ * @param[in] binding_t Binding of the structure to the first tag of the text.
+ * @param[out] object Structure to be filled.
+ * @param[in] xml_txt The XML text.
+ * @param[in] length The length of the XML text.
+ * @return true if the text was parsed. On error the structure is freed with
+ * libjxml_bind_free().
+ *
+ * @note The memory allocated for the structure must be freed with libjxml_bind_free().
+ */
+bool libjxml_bind_parse (const xml_binding_t * binding_t, void * object, char * xml_txt, long length);
+
+/**
+ * @brief Fill a structure from an XML text read from a file descriptor.
+ *
+ * Same as libjxml_bind_parse() reading the text through a buffer.
+ *
+ * @param[in] binding_t Binding of the structure to the first tag of the text.
+ * @param[out] object Structure to be filled.
+ * @param[in] xml_fd File descriptor to read.
+ * @return true if the text was parsed.
+ */
+bool libjxml_bind_fd (const xml_binding_t * binding_t, void * object, int xml_fd);
+
+/**
+ * @brief Write a structure as XML to a sink.
+ *
+ * Fields are written in the order of the binding, attributes first. Strings set
+ * to NULL are not written.
+ *
+ * @param[in] binding_t Binding of the structure.
+ * @param[in] object Structure to be written.
+ * @param[in] sink_t Sink receiving the text. It is not flushed.
+ * @param[in] format LIBJXML_FORMAT_INDENT or LIBJXML_FORMAT_COMPACT.
+ */
+void libjxml_bind_to_sink (const xml_binding_t * binding_t, void * object, xml_sink_t * sink_t, int format);
+
+/**
+ * @brief Write a structure as XML to a text in memory.
+ *
+ * @param[in] binding_t Binding of the structure.
+ * @param[in] object Structure to be written.
+ * @param[in] format LIBJXML_FORMAT_INDENT or LIBJXML_FORMAT_COMPACT.
+ * @param[out] length Length of the text, can be NULL.
+ * @return The XML text, null ended, to be freed with free().
+ */
+char * libjxml_bind_to_txt (const xml_binding_t * binding_t, void * object, int format, long * length);
+
+/**
+ * @brief Free the strings and arrays of a structure, and clear it.
+ *
+ * The structure itself is not freed.
+ *
+ * @param[in] binding_t Binding of the structure.
+ * @param[in] object Structure to be freed.
+ */
+void libjxml_bind_free (const xml_binding_t * binding_t, void * object);
+
+#endif //_LIBJXML_BIND_H
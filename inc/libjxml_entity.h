@@ -0,0 +1,89 @@
+/**
+ * @file libjxml_entity.h
+ *
+ * @brief Decoding and escaping of the entities of xml text.
+ *
+ * Values are decoded when documents are parsed and escaped when they are
+ * written, replacing the predefined entities &amp; &lt; &gt; &quot; &apos; and
+ * the character references &#NNN; and &#xHHH;, which are decoded to UTF-8.
+ *
+ * Most values have nothing to decode or escape, so the text is searched for
+ * the next special character 16 bytes at a time with SSE2, or 8 bytes at a time
+ * in short values, and the clean runs between them are copied at once. Text
+ * without any special character costs about the same as copying it.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_ENTITY_H
+#define _LIBJXML_ENTITY_H
+
+#include <stdbool.h>
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_ENTITY_LONGEST 6 /**< Length of the longest escaped character, &quot; */
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Get the length of the text before the first character to be escaped.
+ *
+ * @param[in] text Text to be searched, not null ended.
+ * @param[in] length Length of the text.
+ * @param[in] attribute '"' is escaped too, as the text is an attribute value.
+ * @return Position of the first '&', '<', '>' (or '"'), 'length' if there is none.
+ */
+long libjxml_entity_clean (const char * text, long length, bool attribute);
+
+/**
+ * @brief Get the length of the text before the first entity or reference.
+ *
+ * @param[in] text Text to be searched, not null ended.
+ * @param[in] length Length of the text.
+ * @return Position of the first '&', 'length' if there is none, so the text has
+ * nothing to be decoded.
+ */
+long libjxml_entity_find (const char * text, long length);
+
+/**
+ * @brief Get the length of a text once escaped.
+ *
+ * @param[in] text Text to be escaped, not null ended.
+ * @param[in] length Length of the text.
+ * @param[in] attribute '"' is escaped too, as the text is an attribute value.
+ * @return Length of the escaped text, 'length' if nothing is escaped.
+ */
+long libjxml_entity_length (const char * text, long length, bool attribute);
+
+/**
+ * @brief Escape a text.
+ *
+ * @param[out] target Buffer of libjxml_entity_length() bytes receiving the escaped text.
+ * @param[in] text Text to be escaped, not null ended.
+ * @param[in] length Length of the text.
+ * @param[in] attribute '"' is escaped too, as the text is an attribute value.
+ * @return End of the text written in 'target'.
+ */
+char * libjxml_entity_escape (char * target, const char * text, long length, bool attribute);
+
+/**
+ * @brief Decode the entities and character references of a text.
+ *
+ * Unknown entities and references to characters that are not valid are kept as
+ * they are written. The decoded text is never longer than the original one.
+ *
+ * @param[out] target Buffer of 'length' bytes receiving the decoded text. It can
+ * be 'text' to decode it in place.
+ * @param[in] text Text to be decoded, not null ended.
+ * @param[in] length Length of the text.
+ * @return Length of the decoded text.
+ */
+long libjxml_entity_decode (char * target, const char * text, long length);
+
+#endif //_LIBJXML_ENTITY_H
@@ -0,0 +1,195 @@
+/**
+ * @file libjxml_flat.h
+ *
+ * @brief Compact storage of xml documents in arrays.
+ *
+ * The tags of a document are stored in document order in a few arrays, one for
+ * each field, instead of a tree of structs linked by pointers. The nested tags of
+ * a tag follow it, so walking the whole document is a loop over the arrays, and
+ * links between tags are 32 bit indexes. Names are kept as ids of a table of
+ * names and values are gathered in a single text.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_FLAT_H
+#define _LIBJXML_FLAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libjxml.h"
+#include "libjxml_names.h"
+#include "libjxml_sink.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_FLAT_NONE  UINT32_MAX /**< Index of a missing tag */
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Document stored in arrays.
+ *
+ * Tag i has the nested tags i + 1 to end [i] - 1 and its attributes are the ones
+ * from attribute [i] to attribute [i + 1] - 1. The attributes of the xml
+ * instruction are stored first, before attribute [0].
+ */
+typedef struct xml_flat_t
+{
+	long          tags;             /**< Number of tags */
+	long          attributes;       /**< Number of attributes, with the instruction ones */
+	uint32_t    * name;             /**< Name id of each tag in names_t */
+	uint32_t    * parent;           /**< Parent of each tag, LIBJXML_FLAT_NONE at the first level */
+	uint32_t    * end;              /**< Index after the last tag nested in each tag */
+	uint32_t    * attribute;        /**< First attribute of each tag, tags + 1 entries */
+	long        * value;            /**< Offset of the value of each tag in text, -1 without value */
+	uint32_t    * value_length;     /**< Length of the value of each tag */
+	uint32_t    * attribute_name;   /**< Name id of each attribute in names_t */
+	long        * attribute_value;  /**< Offset of the value of each attribute in text */
+	uint32_t    * attribute_length; /**< Length of the value of each attribute */
+	char        * text;             /**< Values of tags and attributes, each one null ended */
+	long          text_length;      /**< Used length of text */
+	xml_names_t * names_t;          /**< Table of the names, shared with the converted document */
+	char        * image;            /**< Mapped snapshot holding the arrays, NULL if they are allocated */
+	long          image_length;     /**< Length of the mapped snapshot */
+}xml_flat_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Convert a document to arrays.
+ *
+ * The flat document shares the table of names of 'xml_mem_t' and copies every
+ * value, so both can be freed in any order.
+ *
+ * @param[in] xml_mem_t Document to be converted.
+ * @return Pointer to the flat document, or NULL if it has more tags or attributes
+ * than 32 bit indexes can hold.
+ *
+ * @note The flat document must be freed with libjxml_flat_free().
+ */
+xml_flat_t * libjxml_mem_to_flat (xml_t * xml_mem_t);
+
+/**
+ * @brief Convert a flat document to a tree.
+ *
+ * The values are copied, so LIBJXML_MODE_SLICE and LIBJXML_MODE_TERMINATE are
+ * removed from the mode. The tree shares the table of names of 'flat_t'.
+ *
+ * @param[in] flat_t Flat document to be converted.
+ * @param[in] mode LIBJXML_MODE_* flags that define how the tree is stored.
+ * @return Pointer to the tree, freed with libjxml_free_xml_mem().
+ */
+xml_t * libjxml_flat_to_mem (xml_flat_t * flat_t, int mode);
+
+/**
+ * @brief Free a flat document.
+ *
+ * A flat document loaded from a snapshot is unmapped.
+ *
+ * @param[in] flat_t Pointer to the flat document.
+ */
+void libjxml_flat_free (xml_flat_t * flat_t);
+
+/**
+ * @brief Write a flat document to a sink.
+ *
+ * The text is the same written by libjxml_mem_to_sink() for the tree.
+ *
+ * @param[in] flat_t Flat document to be written.
+ * @param[in] sink_t Sink receiving the text. It is not flushed.
+ * @param[in] format LIBJXML_FORMAT_INDENT or LIBJXML_FORMAT_COMPACT.
+ */
+void libjxml_flat_to_sink (xml_flat_t * flat_t, xml_sink_t * sink_t, int format);
+
+/**
+ * @brief Write a flat document to a file descriptor.
+ *
+ * @param[in] flat_t Flat document to be written.
+ * @param[in] xml_fd File descriptor open for writing. It is not closed.
+ * @param[in] format LIBJXML_FORMAT_INDENT or LIBJXML_FORMAT_COMPACT.
+ * @return true if the whole text was written.
+ */
+bool libjxml_flat_to_fd (xml_flat_t * flat_t, int xml_fd, int format);
+
+/**
+ * @brief Write a flat document to a text in memory.
+ *
+ * @param[in] flat_t Flat document to be written.
+ * @param[in] format LIBJXML_FORMAT_INDENT or LIBJXML_FORMAT_COMPACT.
+ * @param[out] length Length of the text, can be NULL.
+ * @return The XML text, null ended, to be freed using free().
+ */
+char * libjxml_flat_to_txt (xml_flat_t * flat_t, int format, long * length);
+
+/*********************************************************************************
+ *                                   ACCESSORS
+ *********************************************************************************/
+
+/**
+ * @brief Get the name of a tag.
+ *
+ * @param[in] flat_t Pointer to the flat document.
+ * @param[in] tag Index of the tag.
+ * @param[out] length Length of the name, ignored if NULL.
+ * @return The interned name, null ended.
+ */
+char * libjxml_flat_name (xml_flat_t * flat_t, long tag, long * length);
+
+/**
+ * @brief Get the value of a tag.
+ *
+ * @param[in] flat_t Pointer to the flat document.
+ * @param[in] tag Index of the tag.
+ * @param[out] length Length of the value, ignored if NULL.
+ * @return The value, null ended, or NULL if the tag has no value.
+ */
+char * libjxml_flat_value (xml_flat_t * flat_t, long tag, long * length);
+
+/**
+ * @brief Get the first tag nested in a tag.
+ *
+ * @param[in] flat_t Pointer to the flat document.
+ * @param[in] tag Index of the tag.
+ * @return Index of the nested tag, LIBJXML_FLAT_NONE if there is none.
+ */
+long libjxml_flat_nested (xml_flat_t * flat_t, long tag);
+
+/**
+ * @brief Get the next sibling of a tag.
+ *
+ * @param[in] flat_t Pointer to the flat document.
+ * @param[in] tag Index of the tag.
+ * @return Index of the sibling, LIBJXML_FLAT_NONE if there is none.
+ */
+long libjxml_flat_sibling (xml_flat_t * flat_t, long tag);
+
+/**
+ * @brief Get the name of an attribute.
+ *
+ * @param[in] flat_t Pointer to the flat document.
+ * @param[in] attribute Index of the attribute.
+ * @param[out] length Length of the name, ignored if NULL.
+ * @return The interned name, null ended.
+ */
+char * libjxml_flat_attribute_name (xml_flat_t * flat_t, long attribute, long * length);
+
+/**
+ * @brief Get the value of an attribute.
+ *
+ * @param[in] flat_t Pointer to the flat document.
+ * @param[in] attribute Index of the attribute.
+ * @param[out] length Length of the value, ignored if NULL.
+ * @return The value, null ended.
+ */
+char * libjxml_flat_attribute_value (xml_flat_t * flat_t, long attribute, long * length);
+
+#endif //_LIBJXML_FLAT_H
@@ -0,0 +1,130 @@
+/**
+ * @file libjxml_hash.h
+ *
+ * @brief Hashes of the tags of xml documents, and differences between documents.
+ *
+ * The hash of a tag covers its name, value, attributes and every tag nested in
+ * it, so two tags with the same hash have the same content with a very high
+ * probability. The order of the attributes is ignored, and the order of the
+ * nested tags is not.
+ *
+ * The hashes of a document are computed at once, in a single walk, and kept
+ * apart from the tree like the indexes, so documents that are never compared do
+ * not pay for them. They are computed again when the document is changed with
+ * the edition functions, like libjxml_set_value(), but not when values are
+ * written directly in the tree, which needs a call to libjxml_hash_refresh().
+ *
+ * Comparing two documents skips every pair of tags with the same hash without
+ * walking them, so the cost grows with the size of the differences and not with
+ * the size of the documents.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_HASH_H
+#define _LIBJXML_HASH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "libjxml.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_DIFF_ADDED   1 /**< A tag of the new document is not in the old one */
+#define LIBJXML_DIFF_REMOVED 2 /**< A tag of the old document is not in the new one */
+#define LIBJXML_DIFF_CHANGED 3 /**< The value or attributes of a tag are different */
+#define LIBJXML_DIFF_MOVED   4 /**< A tag is in another place among the tags nested in its parent */
+
+/**
+ * @brief Callback receiving a difference between two documents.
+ *
+ * @param[in] context Pointer given to libjxml_diff().
+ * @param[in] change LIBJXML_DIFF_* kind of the difference.
+ * @param[in] old_t Tag of the old document, NULL for added tags.
+ * @param[in] new_t Tag of the new document, NULL for removed tags.
+ * @return false to stop comparing, true to continue.
+ */
+typedef bool (* xml_diff_cb) (void * context, int change, xml_tag_t * old_t, xml_tag_t * new_t);
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Hashes of the tags of a document, private to the library.
+ */
+typedef struct xml_hashes_t xml_hashes_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Compute the hashes of every tag of a document.
+ *
+ * @param[in] xml_mem_t Document to be hashed. It must be kept until the hashes are freed.
+ * @return Pointer to the hashes.
+ *
+ * @note The hashes must be freed with libjxml_hash_free().
+ */
+xml_hashes_t * libjxml_hash_create (xml_t * xml_mem_t);
+
+/**
+ * @brief Free the hashes of a document.
+ *
+ * @param[in] hashes_t Pointer to the hashes.
+ */
+void libjxml_hash_free (xml_hashes_t * hashes_t);
+
+/**
+ * @brief Compute again the hashes of a document after writing its values in the tree.
+ *
+ * @param[in] hashes_t Pointer to the hashes.
+ */
+void libjxml_hash_refresh (xml_hashes_t * hashes_t);
+
+/**
+ * @brief Get the hash of the whole document.
+ *
+ * @param[in] hashes_t Pointer to the hashes.
+ * @return Hash of the instruction and every tag of the document.
+ */
+uint64_t libjxml_hash_document (xml_hashes_t * hashes_t);
+
+/**
+ * @brief Get the hash of a tag and everything nested in it.
+ *
+ * The first call builds a table to find the tags, so the next calls take a
+ * constant time.
+ *
+ * @param[in] hashes_t Pointer to the hashes.
+ * @param[in] tag_t Tag of the document.
+ * @return Hash of the tag, 0 if the tag is not in the document.
+ */
+uint64_t libjxml_hash_tag (xml_hashes_t * hashes_t, xml_tag_t * tag_t);
+
+/**
+ * @brief Report the differences between two documents.
+ *
+ * Tags are paired level by level: first tags with the same hash, which are
+ * skipped, and then tags with the same name in the same order, which are
+ * compared. The tags left are reported as added or removed, once for the whole
+ * tag and not for each tag nested in it. The pairs found out of order are
+ * reported as moved, as few as possible, keeping in place the longest list of
+ * pairs in the same order in both documents. A moved tag with a different
+ * content is reported as changed too. Parents are reported before the tags
+ * nested in them. Differences in the xml instruction are not reported.
+ *
+ * @param[in] old_t Hashes of the old document.
+ * @param[in] new_t Hashes of the new document.
+ * @param[in] callback Function receiving each difference.
+ * @param[in] context Pointer given to the callback.
+ * @return Number of differences reported, 0 if the tags of the documents are the same.
+ */
+long libjxml_diff (xml_hashes_t * old_t, xml_hashes_t * new_t, xml_diff_cb callback, void * context);
+
+#endif //_LIBJXML_HASH_H
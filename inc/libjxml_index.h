@@ -0,0 +1,83 @@
+/**
+ * @file libjxml_index.h
+ *
+ * @brief Index of the nested tags and attributes of xml documents by name.
+ *
+ * An index finds the tags nested in a tag, or the attribute of a tag, with a
+ * given name in constant time, without walking the lists of the tree. It is
+ * built from a parsed document and rebuilt by the first lookup after the tree is
+ * changed through the functions of libjxml.h.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_INDEX_H
+#define _LIBJXML_INDEX_H
+
+#include "libjxml.h"
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Index of a document, private to the library.
+ */
+typedef struct xml_index_t xml_index_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Build the index of a document.
+ *
+ * @param[in] xml_mem_t Document to be indexed. It must be kept until the index is freed.
+ * @return Pointer to the index.
+ *
+ * @note The index must be freed with libjxml_index_free().
+ */
+xml_index_t * libjxml_index_create (xml_t * xml_mem_t);
+
+/**
+ * @brief Free an index.
+ *
+ * @param[in] index_t Pointer to the index.
+ */
+void libjxml_index_free (xml_index_t * index_t);
+
+/**
+ * @brief Get the first tag with a name nested in a tag.
+ *
+ * @param[in] index_t Pointer to the index.
+ * @param[in] parent_t Tag where the tag is nested, NULL for the first level.
+ * @param[in] name Null ended name of the tag.
+ * @return Pointer to the tag, NULL if there is none.
+ */
+xml_tag_t * libjxml_index_child (xml_index_t * index_t, xml_tag_t * parent_t, char * name);
+
+/**
+ * @brief Get all the tags with a name nested in a tag.
+ *
+ * @param[in] index_t Pointer to the index.
+ * @param[in] parent_t Tag where the tags are nested, NULL for the first level.
+ * @param[in] name Null ended name of the tags.
+ * @param[out] count Number of tags found.
+ * @return Array of the tags in document order, NULL if there is none. It is kept
+ * by the index and valid until the next lookup after a change of the tree.
+ */
+xml_tag_t ** libjxml_index_children (xml_index_t * index_t, xml_tag_t * parent_t, char * name,
+									 long * count);
+
+/**
+ * @brief Get the attribute of a tag with a name.
+ *
+ * @param[in] index_t Pointer to the index.
+ * @param[in] tag_t Pointer to the tag.
+ * @param[in] name Null ended name of the attribute.
+ * @return Pointer to the first attribute with that name, NULL if there is none.
+ */
+xml_attribute_t * libjxml_index_attribute (xml_index_t * index_t, xml_tag_t * tag_t, char * name);
+
+#endif //_LIBJXML_INDEX_H
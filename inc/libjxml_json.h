@@ -0,0 +1,129 @@
+/**
+ * @file libjxml_json.h
+ *
+ * @brief Conversion of xml documents to JSON and back.
+ *
+ * Each tag becomes a key of the object of its parent tag, and the document the
+ * object holding the root tag. A tag is written as:
+ *
+ * - null, if it has no attributes, nested tags nor text.
+ * - A string with its text, if it has no attributes nor nested tags.
+ * - An object otherwise, with a key for each attribute, its name after a
+ *   prefix, "@" by default, and a key for each nested tag, or its text under a
+ *   key, "#text" by default, if it has no nested tags.
+ *
+ * The tags named in the arrays option are written in an array, holding the tag
+ * and the next ones with its name, even if it is alone. Other tags are written
+ * as a single value. Without the option every tag but the root is written in an
+ * array. A tag written as a single value can not be repeated in its parent, and
+ * the tags of an array must follow each other, as their key would be written
+ * twice otherwise, so the conversion fails on them. As in the tree built by the
+ * parser, only the first text of a tag that is not blank is taken, and only if
+ * the tag has no nested tags. Values are always strings.
+ *
+ * Texts and documents follow the same rules, so they give the same JSON, which
+ * does not depend on the size of the text. Texts are converted while they are
+ * parsed, without building a tree, so files of any size are converted in
+ * bounded memory.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_JSON_H
+#define _LIBJXML_JSON_H
+
+#include <stdbool.h>
+
+#include "libjxml.h"
+#include "libjxml_sink.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_JSON_PREFIX "@"                 /**< Default prefix of the keys of the attributes */
+#define LIBJXML_JSON_TEXT   "#text"             /**< Default key of the text of a tag written as an object */
+#define LIBJXML_JSON_BUFFER (64L*1024L)         /**< Output written between two flushes to the sink */
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Keys used for attributes and texts, and names of the tags written as
+ * arrays, NULL for their defaults.
+ */
+typedef struct xml_json_options_t
+{
+	char  * prefix;   /**< Written before the names of the attributes */
+	char  * text_key; /**< Key of the text of the tags written as objects */
+	char ** arrays;   /**< Names of the tags written as arrays, NULL ended, NULL for all but the root */
+}xml_json_options_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Convert an xml text held in memory to JSON.
+ *
+ * @param[in] xml_txt The XML text to be converted.
+ * @param[in] length The length of the XML text.
+ * @param[in] sink_t Sink receiving the JSON text.
+ * @param[in] options_t Options of the conversion, NULL for the defaults.
+ * @return true if the whole text was converted, false if it is not valid or a
+ * key would be repeated. On error the sink gets the JSON written until then,
+ * which is not complete.
+ */
+bool libjxml_xml_to_json (char * xml_txt, long length, xml_sink_t * sink_t, xml_json_options_t * options_t);
+
+/**
+ * @brief Convert an xml text read from a file descriptor to JSON.
+ *
+ * The text is read through the buffer of libjxml_sax_fd(), so any size is
+ * converted with the same memory.
+ *
+ * @param[in] xml_fd File descriptor to read.
+ * @param[in] sink_t Sink receiving the JSON text.
+ * @param[in] options_t Options of the conversion, NULL for the defaults.
+ * @return true if the whole text was converted.
+ */
+bool libjxml_fd_to_json (int xml_fd, xml_sink_t * sink_t, xml_json_options_t * options_t);
+
+/**
+ * @brief Convert a document to JSON.
+ *
+ * The tree is written as its text would be converted.
+ *
+ * @param[in] xml_mem_t Document to be converted.
+ * @param[in] sink_t Sink receiving the JSON text.
+ * @param[in] options_t Options of the conversion, NULL for the defaults.
+ * @return true if the whole document was converted, false if a key would be
+ * repeated. On error the sink gets the JSON written until then.
+ */
+bool libjxml_mem_to_json (xml_t * xml_mem_t, xml_sink_t * sink_t, xml_json_options_t * options_t);
+
+/**
+ * @brief Build a document from a JSON text.
+ *
+ * The text must be an object with a single key, the root tag, whose value is
+ * not an array. Each key becomes a tag, or an attribute if it starts with the
+ * prefix, and must be an XML name. The text key becomes the value of its tag,
+ * unless the tag has nested tags. Arrays become a tag for each of their items,
+ * all with the key of the array as their name. Strings, numbers and true or
+ * false become values as written, and null a tag without value. Strings with
+ * characters not allowed in XML, like U+0000, are not valid.
+ *
+ * @param[in] json_txt The JSON text.
+ * @param[in] length The length of the JSON text.
+ * @param[in] mode LIBJXML_MODE_MALLOC or LIBJXML_MODE_ARENA. Values are always
+ * copied, as their escapes are decoded, so slices are not used.
+ * @param[in] options_t Options of the conversion, NULL for the defaults.
+ * @return Pointer to the document, or NULL if the text is not valid.
+ *
+ * @note The document must be freed with libjxml_free_xml_mem().
+ */
+xml_t * libjxml_json_to_mem (char * json_txt, long length, int mode, xml_json_options_t * options_t);
+
+#endif //_LIBJXML_JSON_H
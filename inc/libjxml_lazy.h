@@ -0,0 +1,156 @@
+/**
+ * @file libjxml_lazy.h
+ *
+ * @brief Xml documents whose tags are built the first time they are read.
+ *
+ * A lazy document is built with a single pass over the text that only keeps an
+ * outline of it, with the offset of each tag, and the tags of the first level
+ * without attributes, value nor nested tags. Those are built the first time the
+ * tag is read through the functions of this library, parsing only the open tag
+ * of the tag, or its value when it has no nested tags. Once built they stay in
+ * the tree, so the nodes built grow with the tags read and not with the size of
+ * the text.
+ *
+ * The tree of a lazy document is a normal xml_t structure, so once a tag is
+ * loaded with libjxml_lazy_load() the rest of the library can be used on it.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_LAZY_H
+#define _LIBJXML_LAZY_H
+
+#include <stdbool.h>
+
+#include "libjxml.h"
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Lazy document, private to the library.
+ */
+typedef struct xml_lazy_t xml_lazy_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Build a lazy document from an XML text.
+ *
+ * The whole text is checked, so the tags built later never fail.
+ *
+ * @param[in] xml_txt The XML text. It must be kept until the document is freed.
+ * @param[in] length The length of the XML text.
+ * @param[in] mode LIBJXML_MODE_* flags that define how the tags are stored.
+ * LIBJXML_MODE_TERMINATE is ignored, as the text is read again later, and the
+ * tags are always stored in the arena of the document.
+ * @return Pointer to the lazy document, or NULL if the text could not be parsed.
+ *
+ * @note The document must be freed with libjxml_lazy_free().
+ */
+xml_lazy_t * libjxml_lazy_create (char * xml_txt, long length, int mode);
+
+/**
+ * @brief Read an XML file as a lazy document.
+ *
+ * Regular files are mapped in memory and kept mapped by the document, so only
+ * the pages of the tags read are loaded after the first pass.
+ *
+ * @param[in] xml_name The name of the XML file to be read.
+ * @param[in] mode LIBJXML_MODE_* flags that define how the tags are stored.
+ * @return Pointer to the lazy document, or NULL if the file could not be parsed.
+ */
+xml_lazy_t * libjxml_file_to_lazy (char * xml_name, int mode);
+
+/**
+ * @brief Free a lazy document, with its tree and the text it owns.
+ *
+ * @param[in] lazy_t Pointer to the lazy document.
+ */
+void libjxml_lazy_free (xml_lazy_t * lazy_t);
+
+/**
+ * @brief Get the tree of a lazy document.
+ *
+ * The tags not read yet have a name and no attributes nor nested tags. Their
+ * value points to their text with a length of 0, so they must be read with the
+ * functions of this library, or loaded, before using them.
+ *
+ * @param[in] lazy_t Pointer to the lazy document.
+ * @return The xml_t structure, freed with the lazy document.
+ */
+xml_t * libjxml_lazy_xml (xml_lazy_t * lazy_t);
+
+/**
+ * @brief Build the attributes, value and nested tags of a tag if not built yet.
+ *
+ * @param[in] lazy_t Pointer to the lazy document.
+ * @param[in] tag_t Tag of the document.
+ * @return The same tag.
+ */
+xml_tag_t * libjxml_lazy_expand (xml_lazy_t * lazy_t, xml_tag_t * tag_t);
+
+/**
+ * @brief Check whether a tag is still waiting to be built.
+ *
+ * @param[in] lazy_t Pointer to the lazy document.
+ * @param[in] tag_t Tag of the document.
+ * @return true if its attributes, value and nested tags are not built yet.
+ */
+bool libjxml_lazy_pending (xml_lazy_t * lazy_t, xml_tag_t * tag_t);
+
+/**
+ * @brief Build a tag and every tag nested in it.
+ *
+ * @param[in] lazy_t Pointer to the lazy document.
+ * @param[in] tag_t Tag of the document, NULL for the whole document.
+ */
+void libjxml_lazy_load (xml_lazy_t * lazy_t, xml_tag_t * tag_t);
+
+/**
+ * @brief Get the first tag nested in a tag, building the tag if needed.
+ *
+ * @param[in] lazy_t Pointer to the lazy document.
+ * @param[in] tag_t Tag of the document, NULL for the first level.
+ * @return The first nested tag, NULL if there is none. Its siblings are linked.
+ */
+xml_tag_t * libjxml_lazy_nested (xml_lazy_t * lazy_t, xml_tag_t * tag_t);
+
+/**
+ * @brief Get the first tag with a name nested in a tag, building the tag if needed.
+ *
+ * Only the tag where the search is done is built, not the tags compared.
+ *
+ * @param[in] lazy_t Pointer to the lazy document.
+ * @param[in] parent_t Tag where the tag is nested, NULL for the first level.
+ * @param[in] name Null ended name of the tag.
+ * @return Pointer to the tag, NULL if there is none.
+ */
+xml_tag_t * libjxml_lazy_child (xml_lazy_t * lazy_t, xml_tag_t * parent_t, char * name);
+
+/**
+ * @brief Get the attributes of a tag, building the tag if needed.
+ *
+ * @param[in] lazy_t Pointer to the lazy document.
+ * @param[in] tag_t Tag of the document.
+ * @return The first attribute, NULL if the tag has none.
+ */
+xml_attribute_t * libjxml_lazy_attributes (xml_lazy_t * lazy_t, xml_tag_t * tag_t);
+
+/**
+ * @brief Get the value of a tag, building the tag if needed.
+ *
+ * Same as libjxml_tag_value().
+ *
+ * @param[in] lazy_t Pointer to the lazy document.
+ * @param[in] tag_t Tag of the document.
+ * @param[out] length Length of the value, ignored if NULL.
+ * @return Pointer to the first character of the value, NULL if the tag has no value.
+ */
+char * libjxml_lazy_value (xml_lazy_t * lazy_t, xml_tag_t * tag_t, long * length);
+
+#endif //_LIBJXML_LAZY_H
@@ -0,0 +1,135 @@
+/**
+ * @file libjxml_names.h
+ *
+ * @brief Table of the tag and attribute names of xml documents.
+ *
+ * Each distinct name is stored once and every tag or attribute with that name
+ * points to the same string, so two names are equal if and only if they are the
+ * same pointer. A table can be shared by many documents with the same names.
+ *
+ * Names also get consecutive ids in the order they are stored, to be kept where
+ * a pointer is too big or cannot be saved, like in compact or saved documents.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_NAMES_H
+#define _LIBJXML_NAMES_H
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_NAMES_SLOTS 256 /**< Default number of slots of a table */
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Table of interned names, private to the library.
+ */
+typedef struct xml_names_t xml_names_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Create an empty table of names.
+ *
+ * @param[in] slots Expected number of distinct names, LIBJXML_NAMES_SLOTS if 0 or less.
+ * The table grows as needed.
+ * @return Pointer to the table.
+ *
+ * @note The table must be released with libjxml_names_free().
+ */
+xml_names_t * libjxml_names_create (long slots);
+
+/**
+ * @brief Create an empty table stacked over another one.
+ *
+ * Names are looked up in 'base_t' first, and only the names missing there are
+ * stored in the new table, with ids following the ones of the base. The base is
+ * only read, so many tables stacked over it can be used from different threads
+ * as long as the base itself does not change meanwhile. The base can be a
+ * stacked table too.
+ *
+ * @param[in] base_t Table looked up first. The new table takes its own reference.
+ * @param[in] slots Expected number of names missing in the base, LIBJXML_NAMES_SLOTS if 0 or less.
+ * @return Pointer to the table.
+ *
+ * @note The table must be released with libjxml_names_free().
+ */
+xml_names_t * libjxml_names_stack (xml_names_t * base_t, long slots);
+
+/**
+ * @brief Take a new reference to a table, to be shared by another document.
+ *
+ * References are counted atomically, so they can be taken and released from
+ * different threads.
+ *
+ * @param[in] names_t Pointer to the table.
+ * @return The same table.
+ *
+ * @note Each reference must be released with libjxml_names_free().
+ */
+xml_names_t * libjxml_names_share (xml_names_t * names_t);
+
+/**
+ * @brief Release a reference to a table, freeing it with its names after the last one.
+ *
+ * @param[in] names_t Pointer to the table.
+ */
+void libjxml_names_free (xml_names_t * names_t);
+
+/**
+ * @brief Get the stored copy of a name, storing it the first time.
+ *
+ * @param[in] names_t Pointer to the table.
+ * @param[in] name The name, not null ended.
+ * @param[in] length The length of the name.
+ * @return The stored name, null ended, valid until the table is freed.
+ */
+char * libjxml_names_intern (xml_names_t * names_t, char * name, long length);
+
+/**
+ * @brief Get the stored copy of a name without storing it.
+ *
+ * @param[in] names_t Pointer to the table.
+ * @param[in] name The name, not null ended.
+ * @param[in] length The length of the name.
+ * @return The stored name, or NULL if it is not in the table.
+ */
+char * libjxml_names_find (xml_names_t * names_t, char * name, long length);
+
+/**
+ * @brief Get the id of a name, storing it the first time.
+ *
+ * @param[in] names_t Pointer to the table.
+ * @param[in] name The name, not null ended.
+ * @param[in] length The length of the name.
+ * @return The id of the name, from 0 to the number of names minus 1.
+ */
+long libjxml_names_id (xml_names_t * names_t, char * name, long length);
+
+/**
+ * @brief Get a name by its id.
+ *
+ * @param[in] names_t Pointer to the table.
+ * @param[in] id Id of the name, lower than libjxml_names_count().
+ * @param[out] length Length of the name, ignored if NULL.
+ * @return The stored name, null ended.
+ */
+char * libjxml_names_get (xml_names_t * names_t, long id, long * length);
+
+/**
+ * @brief Get the number of distinct names of a table.
+ *
+ * @param[in] names_t Pointer to the table.
+ * @return The number of names stored.
+ */
+long libjxml_names_count (xml_names_t * names_t);
+
+#endif //_LIBJXML_NAMES_H
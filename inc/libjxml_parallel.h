@@ -0,0 +1,78 @@
+/**
+ * @file libjxml_parallel.h
+ *
+ * @brief Parsing of big xml documents with many threads.
+ *
+ * Documents made of many records under a single root tag are split between the
+ * nested tags of the root. A first pass over the text only follows the markup to
+ * find where each nested tag starts, and then each thread parses its part of the
+ * text into its own tags. The parts are joined in order, so the tree is the same
+ * built by libjxml_parse_xml_mem() whatever the number of threads.
+ *
+ * Texts too small to be split, or with another shape, are parsed in the calling
+ * thread.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_PARALLEL_H
+#define _LIBJXML_PARALLEL_H
+
+#include <stdbool.h>
+
+#include "libjxml.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_PARALLEL_THREADS 64               /**< Maximum number of threads of a parse */
+#define LIBJXML_PARALLEL_SHARE   (512L*1024L)     /**< Minimum bytes of text parsed by each thread */
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Parse an XML text into an empty xml_t structure with many threads.
+ *
+ * Same as libjxml_parse_xml_mem(). The table of names of the document is only
+ * used by the calling thread.
+ *
+ * @param[in] xml_mem_t Pointer to an empty xml_t structure.
+ * @param[in] xml_txt The XML text to be parsed.
+ * @param[in] length The length of the XML text.
+ * @param[in] threads Number of threads, including the calling one. The number
+ * of processors if 0 or less.
+ * @return The same xml_t structure, or NULL if the text could not be parsed. On
+ * error the structure is left empty.
+ */
+xml_t * libjxml_parse_parallel (xml_t * xml_mem_t, char * xml_txt, long length, int threads);
+
+/**
+ * @brief Convert an XML string into an xml_t structure with many threads.
+ *
+ * Same as libjxml_xml_to_mem_mode() parsing with libjxml_parse_parallel().
+ *
+ * @param[in] xml_txt The XML string to be converted.
+ * @param[in] mode LIBJXML_MODE_* flags that define how the document is stored.
+ * @param[in] threads Number of threads, the number of processors if 0 or less.
+ * @return A pointer to the xml_t structure, or NULL if the text could not be parsed.
+ */
+xml_t * libjxml_xml_to_mem_parallel (char * xml_txt, int mode, int threads);
+
+/**
+ * @brief Read an XML file and convert it to an xml_t structure with many threads.
+ *
+ * Same as libjxml_file_to_mem_mode() parsing with libjxml_parse_parallel().
+ * Files that cannot be mapped in memory are parsed in the calling thread.
+ *
+ * @param[in] xml_name The name of the XML file to be read.
+ * @param[in] mode LIBJXML_MODE_* flags that define how the document is stored.
+ * @param[in] threads Number of threads, the number of processors if 0 or less.
+ * @return A pointer to the xml_t structure, or NULL if the file could not be parsed.
+ */
+xml_t * libjxml_file_to_mem_parallel (char * xml_name, int mode, int threads);
+
+#endif //_LIBJXML_PARALLEL_H
@@ -0,0 +1,146 @@
+/**
+ * @file libjxml_query.h
+ *
+ * @brief Path queries over xml documents.
+ *
+ * A query selects tags with a path of steps like /config/db/node/host, that is
+ * compiled once and run many times, on trees or on texts without building them.
+ * The syntax is a small part of XPath:
+ *
+ * - /name selects the tags with that name nested in the current ones, and //name
+ *   the ones nested at any depth. A name * selects any tag.
+ * - Predicates between brackets keep the tags with an attribute, [@role], with an
+ *   attribute value, [@role="primary"], or with a value, [.="text"] or
+ *   [text()="text"]. Values can be quoted with " or '. Many predicates must all
+ *   be true.
+ * - A last step /@name selects the attribute with that name of the tags found.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_QUERY_H
+#define _LIBJXML_QUERY_H
+
+#include <stdbool.h>
+
+#include "libjxml.h"
+#include "libjxml_sax.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_QUERY_STEPS      32 /**< Maximum number of steps of a query */
+#define LIBJXML_QUERY_PREDICATES 32 /**< Maximum number of predicates of a query */
+
+/**
+ * @brief Callback receiving each tag found in a tree.
+ *
+ * @param[in] context Pointer given to the run.
+ * @param[in] tag_t Tag found.
+ * @param[in] attribute_t Attribute selected by a last /@name step, NULL without it.
+ * @return false to stop the run, true to continue.
+ */
+typedef bool (* xml_found_cb) (void * context, xml_tag_t * tag_t, xml_attribute_t * attribute_t);
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Compiled query, private to the library.
+ */
+typedef struct xml_query_t xml_query_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Compile a query.
+ *
+ * @param[in] path Null ended path of the query, starting with / or //.
+ * @return Pointer to the query, or NULL if the path is not valid.
+ *
+ * @note The query must be freed with libjxml_query_free().
+ */
+xml_query_t * libjxml_query_compile (char * path);
+
+/**
+ * @brief Free a compiled query.
+ *
+ * @param[in] query_t Pointer to the query.
+ */
+void libjxml_query_free (xml_query_t * query_t);
+
+/**
+ * @brief Find the tags of a document selected by a query.
+ *
+ * The tags are found in document order, walking only the branches of the tree
+ * that can hold them. No memory is allocated once the query has run on a
+ * document as deep. A query must not run from different threads at once.
+ *
+ * @param[in] query_t Pointer to the query.
+ * @param[in] xml_mem_t Document to be searched.
+ * @param[in] found Callback receiving each tag found, can be NULL to count them.
+ * @param[in] context Pointer given to the callback.
+ * @return Number of tags found.
+ */
+long libjxml_query_run (xml_query_t * query_t, xml_t * xml_mem_t, xml_found_cb found, void * context);
+
+/**
+ * @brief Find the first tag of a document selected by a query.
+ *
+ * @param[in] query_t Pointer to the query.
+ * @param[in] xml_mem_t Document to be searched.
+ * @return The first tag found, NULL if there is none. With a last /@name step,
+ * the tag holding the attribute.
+ */
+xml_tag_t * libjxml_query_first (xml_query_t * query_t, xml_t * xml_mem_t);
+
+/**
+ * @brief Get the value of the first tag or attribute of a document selected by a query.
+ *
+ * @param[in] query_t Pointer to the query.
+ * @param[in] xml_mem_t Document to be searched.
+ * @param[out] length Length of the value, ignored if NULL.
+ * @return The value, NULL if nothing is found or the tag has no value.
+ */
+char * libjxml_query_value (xml_query_t * query_t, xml_t * xml_mem_t, long * length);
+
+/**
+ * @brief Find the tags selected by a query while parsing a text, without building a tree.
+ *
+ * The callback receives the name and value of each tag found when it is closed,
+ * or the name and value of the attribute selected by a last /@name step. Tags
+ * without value are given a NULL value. Names and values are only valid during
+ * the call. Predicates on the value of a tag are only allowed on the last step,
+ * as the tags are selected before their value is known.
+ *
+ * @param[in] query_t Pointer to the query.
+ * @param[in] xml_txt The XML text to be parsed.
+ * @param[in] length The length of the XML text.
+ * @param[in] found Callback receiving each tag found.
+ * @param[in] context Pointer given to the callback.
+ * @return true if the whole text was parsed, false on error, if stopped by the
+ * callback, or if the query cannot be run on a text.
+ */
+bool libjxml_query_stream_buffer (xml_query_t * query_t, char * xml_txt, long length,
+								  xml_pair_cb found, void * context);
+
+/**
+ * @brief Find the tags selected by a query in a text read from a file descriptor.
+ *
+ * Same as libjxml_query_stream_buffer() reading the text through the buffer of
+ * libjxml_sax_fd(), so files of any size are searched in constant memory.
+ *
+ * @param[in] query_t Pointer to the query.
+ * @param[in] xml_fd File descriptor to read.
+ * @param[in] found Callback receiving each tag found.
+ * @param[in] context Pointer given to the callback.
+ * @return true if the whole text was parsed, false otherwise.
+ */
+bool libjxml_query_stream_fd (xml_query_t * query_t, int xml_fd, xml_pair_cb found, void * context);
+
+#endif //_LIBJXML_QUERY_H
@@ -0,0 +1,167 @@
+/**
+ * @file libjxml_sax.h
+ *
+ * @brief Event driven parser for xml files.
+ *
+ * The text is read once from left to right and every tag, attribute and text
+ * found is notified to a set of callbacks, without building any tree in memory.
+ * The text can be given in chunks of any size as it arrives, and files are read
+ * through a buffer of fixed size, so documents bigger than the available memory
+ * can be parsed.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_SAX_H
+#define _LIBJXML_SAX_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_SAX_BUFFER (64L*1024L) /**< Default size of the reading buffer */
+
+/**
+ * @brief Callback receiving a tag name or a text.
+ *
+ * @return false to stop parsing, true to continue.
+ */
+typedef bool (* xml_token_cb) (void * context, char * token, long length);
+
+/**
+ * @brief Callback receiving an attribute name and value.
+ *
+ * @return false to stop parsing, true to continue.
+ */
+typedef bool (* xml_pair_cb) (void * context, char * name, long name_length,
+							  char * value, long value_length);
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief State of a parser fed with chunks of text, private to the library.
+ */
+typedef struct xml_push_t xml_push_t;
+
+/**
+ * @brief Callbacks notified while parsing. Any of them can be NULL.
+ *
+ * For each tag, start_tag is called with its name, then attribute is called once
+ * for each of its attributes. Text, comments and nested tags follow, and end_tag
+ * closes the tag. Empty tags like <tag/> also call end_tag.
+ *
+ * Names, values and texts are not null ended and are only valid during the call,
+ * except when the whole text is given with libjxml_sax_buffer(). A token split
+ * between two chunks is notified once, when its last chunk arrives.
+ *
+ * Values and texts are given as written, with their entities, which can be
+ * decoded with libjxml_entity_decode(). CDATA sections are given apart when
+ * cdata is set, as their text has no entities.
+ */
+typedef struct xml_handler_t
+{
+	void         * context;     /**< Pointer given to every callback */
+	xml_token_cb   start_tag;   /**< Called when a tag is opened */
+	xml_pair_cb    attribute;   /**< Called for each attribute of the last opened tag */
+	xml_token_cb   text;        /**< Called for each text inside a tag, and CDATA if cdata is NULL */
+	xml_token_cb   cdata;       /**< Called for each CDATA section inside a tag */
+	xml_token_cb   end_tag;     /**< Called when a tag is closed */
+	xml_pair_cb    instruction; /**< Called for each attribute of the xml instruction */
+	bool           terminate;   /**< Null end the tokens writing over the text delimiters */
+	long           offset;      /**< Offset of the text in a larger document, added to the positions of errors */
+}xml_handler_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Parse an XML text held in memory.
+ *
+ * The tokens given to the callbacks point to the text, so they are valid while
+ * the text is kept. With 'terminate' set on the handler the text must be writable.
+ *
+ * @param[in] xml_txt The XML text to be parsed.
+ * @param[in] length The length of the XML text.
+ * @param[in] handler_t Callbacks to be notified.
+ * @return true if the whole text was parsed, false on error or if stopped by a callback.
+ */
+bool libjxml_sax_buffer (char * xml_txt, long length, xml_handler_t * handler_t);
+
+/**
+ * @brief Parse an XML text read from a file descriptor.
+ *
+ * The text is read through a buffer of 'buffer_size' bytes and fed to a push
+ * parser, so only the tokens split between two reads are copied.
+ *
+ * @param[in] xml_fd File descriptor to read, like a file, pipe or socket.
+ * @param[in] buffer_size Size of the reading buffer, LIBJXML_SAX_BUFFER if 0 or less.
+ * @param[in] handler_t Callbacks to be notified.
+ * @return true if the whole text was parsed, false on error or if stopped by a callback.
+ */
+bool libjxml_sax_fd (int xml_fd, long buffer_size, xml_handler_t * handler_t);
+
+/**
+ * @brief Parse an XML text read from an open file.
+ *
+ * Same as libjxml_sax_fd() reading with fread().
+ *
+ * @param[in] xml_file Open file to read.
+ * @param[in] buffer_size Size of the reading buffer, LIBJXML_SAX_BUFFER if 0 or less.
+ * @param[in] handler_t Callbacks to be notified.
+ * @return true if the whole text was parsed, false on error or if stopped by a callback.
+ */
+bool libjxml_sax_file (FILE * xml_file, long buffer_size, xml_handler_t * handler_t);
+
+/**
+ * @brief Create a parser to be fed with chunks of text.
+ *
+ * @param[in] handler_t Callbacks to be notified. Must be kept until the parser
+ * is finished.
+ * @return Pointer to the parser.
+ *
+ * @note The parser must be released with libjxml_push_finish().
+ */
+xml_push_t * libjxml_push_create (xml_handler_t * handler_t);
+
+/**
+ * @brief Feed the next chunk of text to a parser.
+ *
+ * The chunk can end anywhere, even in the middle of a tag name or attribute
+ * value. Bytes already fed are never parsed again; the beginning of a split
+ * token is copied and completed with the next chunk.
+ *
+ * @param[in] push_t Pointer to the parser.
+ * @param[in] chunk The next chunk of XML text.
+ * @param[in] length The length of the chunk.
+ * @return true if the chunk was parsed, false on error or if stopped by a callback.
+ * Once false is returned, next chunks are ignored.
+ */
+bool libjxml_push_feed (xml_push_t * push_t, char * chunk, long length);
+
+/**
+ * @brief Count a piece of text parsed apart, between two chunks fed to a parser.
+ *
+ * The text is not read; only the positions of the errors in the next chunks
+ * are moved.
+ *
+ * @param[in] push_t Pointer to the parser.
+ * @param[in] length The length of the text parsed apart.
+ */
+void libjxml_push_skip (xml_push_t * push_t, long length);
+
+/**
+ * @brief Finish a parser once all the text has been fed, and release it.
+ *
+ * @param[in] push_t Pointer to the parser.
+ * @return true if the whole text was valid, false otherwise.
+ */
+bool libjxml_push_finish (xml_push_t * push_t);
+
+#endif //_LIBJXML_SAX_H
@@ -0,0 +1,95 @@
+/**
+ * @file libjxml_scan.h
+ *
+ * @brief Vectorised classification of xml text.
+ *
+ * The text is read in blocks of 64 bytes, and each block is turned into a set of
+ * bitmasks with one bit for each byte: one mask for the '<' found, one for each
+ * quote, one for the characters ending a name and one for the non blank bytes.
+ * The parser finds its next delimiter looking for the next bit set instead of
+ * comparing byte by byte.
+ *
+ * SSE2, AVX2 and AVX-512 versions are chosen at runtime depending on the CPU,
+ * with a portable version for any other processor.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_SCAN_H
+#define _LIBJXML_SCAN_H
+
+#include <stdint.h>
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_SCAN_BLOCK     64 /**< Bytes classified in each xml_masks_t */
+
+#define LIBJXML_SCAN_AUTO      0  /**< Best version supported by the CPU */
+#define LIBJXML_SCAN_SCALAR    1  /**< Portable version, byte by byte */
+#define LIBJXML_SCAN_SSE2      2  /**< 16 bytes at a time */
+#define LIBJXML_SCAN_AVX2      3  /**< 32 bytes at a time */
+#define LIBJXML_SCAN_AVX512    4  /**< 64 bytes at a time */
+
+#define LIBJXML_CLASS_OPEN     0  /**< Mask of '<' */
+#define LIBJXML_CLASS_QUOTE    1  /**< Mask of '"' */
+#define LIBJXML_CLASS_APOS     2  /**< Mask of '\'' */
+#define LIBJXML_CLASS_NAME_END 3  /**< Mask of blanks, null and any of "'/<=>? */
+#define LIBJXML_CLASS_TEXT     4  /**< Mask of non blank characters */
+#define LIBJXML_CLASSES        5  /**< Number of masks of each block */
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Classes of the bytes of a block. Bit i of each mask is byte i of the block.
+ */
+typedef struct xml_masks_t
+{
+	uint64_t mask [LIBJXML_CLASSES]; /**< One mask for each LIBJXML_CLASS_* */
+}xml_masks_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Choose the version used to classify the text.
+ *
+ * It can be called from any thread, and parsers running meanwhile switch to the
+ * new version at their next block.
+ *
+ * @param[in] level One of LIBJXML_SCAN_*. Versions not supported by the CPU are
+ * replaced by the best one supported.
+ * @return The version in use.
+ */
+int libjxml_scan_select (int level);
+
+/**
+ * @brief Get the version in use, choosing it if not done yet.
+ *
+ * @return One of LIBJXML_SCAN_*, never LIBJXML_SCAN_AUTO.
+ */
+int libjxml_scan_level ();
+
+/**
+ * @brief Get the name of a version.
+ *
+ * @param[in] level One of LIBJXML_SCAN_*.
+ * @return Null ended name, like "avx2".
+ */
+char * libjxml_scan_name (int level);
+
+/**
+ * @brief Classify consecutive blocks of text.
+ *
+ * @param[in] text Text to be classified, 'blocks' * LIBJXML_SCAN_BLOCK bytes long.
+ * @param[in] blocks Number of blocks.
+ * @param[out] masks_t Array of 'blocks' masks.
+ */
+void libjxml_scan_classify (const char * text, long blocks, xml_masks_t * masks_t);
+
+#endif //_LIBJXML_SCAN_H
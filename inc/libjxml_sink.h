@@ -0,0 +1,166 @@
+/**
+ * @file libjxml_sink.h
+ *
+ * @brief Buffered output for xml files.
+ *
+ * A sink gathers the small pieces of text written by the serializers in a single
+ * buffer. Memory sinks grow the buffer to keep the whole text, and file sinks
+ * write it with a few write() or writev() calls each time it gets full.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_SINK_H
+#define _LIBJXML_SINK_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_SINK_BUFFER (64L*1024L) /**< Default size of the sink buffer */
+#define LIBJXML_SINK_MEM    -1          /**< File descriptor of a memory sink */
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Output buffer, kept in memory or flushed to a file descriptor.
+ */
+typedef struct xml_sink_t
+{
+	char * buffer;   /**< Text written and not flushed yet */
+	long   length;   /**< Used length of the buffer */
+	long   capacity; /**< Allocated length of the buffer */
+	long   written;  /**< Bytes already flushed to the file descriptor */
+	int    fd;       /**< File descriptor to flush to, LIBJXML_SINK_MEM for memory */
+	bool   failed;   /**< A write to the file descriptor failed */
+}xml_sink_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Create a sink keeping the whole text in memory.
+ *
+ * @param[in] capacity Initial size of the buffer, LIBJXML_SINK_BUFFER if 0 or less.
+ * @return Pointer to the sink.
+ *
+ * @note The text is taken with libjxml_sink_release().
+ */
+xml_sink_t * libjxml_sink_mem (long capacity);
+
+/**
+ * @brief Create a sink writing to a file descriptor.
+ *
+ * @param[in] fd File descriptor open for writing. It is not closed by the sink.
+ * @param[in] capacity Size of the buffer, LIBJXML_SINK_BUFFER if 0 or less.
+ * @return Pointer to the sink.
+ *
+ * @note The sink must be finished with libjxml_sink_close().
+ */
+xml_sink_t * libjxml_sink_fd (int fd, long capacity);
+
+/**
+ * @brief Create a sink writing to the file descriptor of an open file.
+ *
+ * The text already written through the file is flushed first. Nothing else must
+ * be written through the file until the sink is closed.
+ *
+ * @param[in] file Open file. It is not closed by the sink.
+ * @param[in] capacity Size of the buffer, LIBJXML_SINK_BUFFER if 0 or less.
+ * @return Pointer to the sink.
+ *
+ * @note The sink must be finished with libjxml_sink_close().
+ */
+xml_sink_t * libjxml_sink_file (FILE * file, long capacity);
+
+/**
+ * @brief Write a text to a sink.
+ *
+ * On file sinks a text that does not fit in the buffer is written directly,
+ * together with the buffer, in a single writev() call.
+ *
+ * @param[in] sink_t Pointer to the sink.
+ * @param[in] text Text to be written, not null ended.
+ * @param[in] length Length of the text.
+ */
+void libjxml_sink_write (xml_sink_t * sink_t, char * text, long length);
+
+/**
+ * @brief Write a null ended string to a sink.
+ *
+ * @param[in] sink_t Pointer to the sink.
+ * @param[in] text Null ended string.
+ */
+void libjxml_sink_string (xml_sink_t * sink_t, char * text);
+
+/**
+ * @brief Write a text to a sink replacing the characters with a meaning in xml.
+ *
+ * '&', '<' and '>' are written as entities, and '"' too inside attribute values.
+ * The parts of the text without any of them are found with libjxml_entity_clean()
+ * and written at once.
+ *
+ * @param[in] sink_t Pointer to the sink.
+ * @param[in] text Text to be written, not null ended.
+ * @param[in] length Length of the text.
+ * @param[in] attribute The text is the value of an attribute.
+ */
+void libjxml_sink_escape (xml_sink_t * sink_t, char * text, long length, bool attribute);
+
+/**
+ * @brief Write a character repeated 'count' times to a sink.
+ *
+ * @param[in] sink_t Pointer to the sink.
+ * @param[in] c Character to be written.
+ * @param[in] count Number of times.
+ */
+void libjxml_sink_fill (xml_sink_t * sink_t, char c, long count);
+
+/**
+ * @brief Take room for a text at the end of the buffer of a sink.
+ *
+ * The text is written by the caller straight in the buffer, saving the calls
+ * of many small writes when its whole length is known in advance.
+ *
+ * @param[in] sink_t Pointer to the sink.
+ * @param[in] length Length of the text, that must be fully written.
+ * @return Pointer to the room taken, or NULL if the text is bigger than the
+ * buffer of a file sink.
+ */
+char * libjxml_sink_reserve (xml_sink_t * sink_t, long length);
+
+/**
+ * @brief Write the buffered text of a file sink.
+ *
+ * @param[in] sink_t Pointer to the sink.
+ * @return true if everything written so far reached the file descriptor.
+ */
+bool libjxml_sink_flush (xml_sink_t * sink_t);
+
+/**
+ * @brief Flush a file sink and free it.
+ *
+ * @param[in] sink_t Pointer to the sink.
+ * @return true if the whole text was written.
+ */
+bool libjxml_sink_close (xml_sink_t * sink_t);
+
+/**
+ * @brief Free a memory sink and return its text.
+ *
+ * @param[in] sink_t Pointer to the sink.
+ * @param[out] length Length of the text, can be NULL.
+ * @return The text written, null ended.
+ *
+ * @note The text must be freed using free() when it is no longer needed.
+ */
+char * libjxml_sink_release (xml_sink_t * sink_t, long * length);
+
+#endif //_LIBJXML_SINK_H
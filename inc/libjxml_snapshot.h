@@ -0,0 +1,107 @@
+/**
+ * @file libjxml_snapshot.h
+ *
+ * @brief Binary snapshots of xml documents, loaded without parsing.
+ *
+ * A snapshot is the image of a flat document in a file: a header, the arrays of
+ * the tags and attributes, the table of names and the text of the values. Links
+ * are indexes and offsets, so the image is mapped in memory and used as it is,
+ * without parsing it nor allocating memory for each node.
+ *
+ * The header keeps a version, a checksum of the image, and the size and the
+ * modification time of the xml file it was made from, to find out when the image
+ * is older than the file. Images are only loaded on machines with the same byte
+ * order and size of long as the one that saved them.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_SNAPSHOT_H
+#define _LIBJXML_SNAPSHOT_H
+
+#include <stdbool.h>
+
+#include "libjxml.h"
+#include "libjxml_flat.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_SNAPSHOT_VERSION 1    /**< Version of the format of the images */
+#define LIBJXML_SNAPSHOT_VERIFY  0x01 /**< Check the checksum of an image when loading it */
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Save a flat document in a snapshot.
+ *
+ * The image is written to a temporary file renamed at the end, so a process
+ * loading the snapshot at the same time never sees it half written.
+ *
+ * @param[in] flat_t Flat document to be saved.
+ * @param[in] image_name Name of the snapshot file.
+ * @param[in] xml_name Name of the xml file the document was read from, NULL if none.
+ * @return true if the snapshot was saved.
+ */
+bool libjxml_flat_to_snapshot (xml_flat_t * flat_t, char * image_name, char * xml_name);
+
+/**
+ * @brief Save a document in a snapshot.
+ *
+ * Same as libjxml_flat_to_snapshot() for the flat version of the tree.
+ *
+ * @param[in] xml_mem_t Document to be saved.
+ * @param[in] image_name Name of the snapshot file.
+ * @param[in] xml_name Name of the xml file the document was read from, NULL if none.
+ * @return true if the snapshot was saved.
+ */
+bool libjxml_mem_to_snapshot (xml_t * xml_mem_t, char * image_name, char * xml_name);
+
+/**
+ * @brief Load a snapshot as a read-only flat document.
+ *
+ * The file is mapped in memory and its arrays are used without copying them. The
+ * header and every link are always checked to point inside the image, so damaged
+ * files are rejected instead of read out of their bounds. With
+ * LIBJXML_SNAPSHOT_VERIFY the whole image is read to check its checksum too,
+ * which also finds damaged values.
+ *
+ * @param[in] image_name Name of the snapshot file.
+ * @param[in] flags LIBJXML_SNAPSHOT_* flags.
+ * @return Pointer to the flat document, or NULL if the image is not valid.
+ *
+ * @note The document must be freed with libjxml_flat_free(), and its arrays must
+ * not be written.
+ */
+xml_flat_t * libjxml_snapshot_to_flat (char * image_name, int flags);
+
+/**
+ * @brief Check whether a snapshot is older than the xml file it was made from.
+ *
+ * @param[in] image_name Name of the snapshot file.
+ * @param[in] xml_name Name of the xml file.
+ * @return true if the snapshot is missing, not valid, or made from another
+ * version of the file.
+ */
+bool libjxml_snapshot_stale (char * image_name, char * xml_name);
+
+/**
+ * @brief Read an xml file through its snapshot.
+ *
+ * The snapshot is loaded if it is up to date. Otherwise the file is parsed and a
+ * new snapshot is saved for the next time.
+ *
+ * @param[in] xml_name Name of the xml file.
+ * @param[in] image_name Name of the snapshot file.
+ * @param[in] flags LIBJXML_SNAPSHOT_* flags used to load the snapshot.
+ * @return Pointer to the flat document, or NULL if the file could not be read.
+ *
+ * @note The document must be freed with libjxml_flat_free().
+ */
+xml_flat_t * libjxml_file_to_flat (char * xml_name, char * image_name, int flags);
+
+#endif //_LIBJXML_SNAPSHOT_H
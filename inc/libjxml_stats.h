@@ -0,0 +1,140 @@
+/**
+ * @file libjxml_stats.h
+ *
+ * @brief Counters of the allocations and time spent by each xml document.
+ *
+ * Defining LIBJXML_STATS, here or when compiling, makes every document count
+ * the blocks and bytes allocated for it and time each phase of its life with a
+ * monotonic clock: reading its file, tokenizing its text, building its tree and
+ * writing it. Without LIBJXML_STATS the counters are not in the documents and the
+ * instrumentation is compiled out, so it costs nothing. The library and its
+ * users must be compiled with the same definition.
+ *
+ * The build phase is timed in each call made by the parser to the tree builder,
+ * and its time is taken out of the tokenize phase, so both are comparable but an
+ * instrumented parse is slower than a normal one. Files mapped in memory are read
+ * when their pages are first touched, so the read phase only covers the mapping
+ * and the page faults are part of the tokenize phase.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_STATS_H
+#define _LIBJXML_STATS_H
+
+#include <stdbool.h>
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+//#define LIBJXML_STATS
+
+#define LIBJXML_PHASE_READ     0 /**< Reading or mapping the file of the document */
+#define LIBJXML_PHASE_TOKENIZE 1 /**< Finding the tags, attributes and values of the text */
+#define LIBJXML_PHASE_BUILD    2 /**< Allocating and linking the nodes of the tree */
+#define LIBJXML_PHASE_WRITE    3 /**< Writing the tree as text */
+#define LIBJXML_PHASES         4 /**< Number of phases */
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Counters of a document since it was created.
+ */
+typedef struct xml_stats_t
+{
+	long   allocations;               /**< Blocks allocated for the document, arena chunks included */
+	long   bytes;                     /**< Bytes allocated for the document */
+	long   runs [LIBJXML_PHASES];     /**< Times each phase was timed, once per parser event for the build phase */
+	double seconds [LIBJXML_PHASES];  /**< Seconds spent in each phase */
+}xml_stats_t;
+
+/**
+ * @brief Start of a phase being timed.
+ */
+typedef struct xml_clock_t
+{
+	double start;  /**< Clock when the phase started */
+	double nested; /**< Seconds of every phase when the phase started */
+}xml_clock_t;
+
+struct xml_t;
+
+/*********************************************************************************
+ *                                INSTRUMENTATION
+ *********************************************************************************/
+
+#ifdef LIBJXML_STATS
+#define LIBJXML_STATS_INIT(xml_mem_t)                 memset (&(xml_mem_t)->stats_t, 0, sizeof (xml_stats_t))
+#define LIBJXML_STATS_ALLOC(xml_mem_t, size)          libjxml_stats_alloc (&(xml_mem_t)->stats_t, (size))
+#define LIBJXML_STATS_START(xml_mem_t, start_t)       xml_clock_t start_t = libjxml_stats_start (&(xml_mem_t)->stats_t)
+#define LIBJXML_STATS_STOP(xml_mem_t, start_t, phase) libjxml_stats_stop (&(xml_mem_t)->stats_t, &(start_t), (phase))
+#define LIBJXML_STATS_MERGE(xml_mem_t, part_mem_t)    libjxml_stats_merge (&(xml_mem_t)->stats_t, &(part_mem_t)->stats_t)
+#else
+#define LIBJXML_STATS_INIT(xml_mem_t)                 ((void) 0)
+#define LIBJXML_STATS_ALLOC(xml_mem_t, size)          ((void) 0)
+#define LIBJXML_STATS_START(xml_mem_t, start_t)
+#define LIBJXML_STATS_STOP(xml_mem_t, start_t, phase) ((void) 0)
+#define LIBJXML_STATS_MERGE(xml_mem_t, part_mem_t)    ((void) 0)
+#endif
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Get the counters of a document.
+ *
+ * @param[in] xml_mem_t Pointer to the document.
+ * @param[out] stats_t Counters of the document, all of them 0 without LIBJXML_STATS.
+ * @return true if the library counts, false if it was compiled without LIBJXML_STATS.
+ */
+bool libjxml_stats_get (struct xml_t * xml_mem_t, xml_stats_t * stats_t);
+
+/**
+ * @brief Get the name of a phase.
+ *
+ * @param[in] phase LIBJXML_PHASE_* phase.
+ * @return Name of the phase.
+ */
+char * libjxml_stats_phase (int phase);
+
+/**
+ * @brief Count a block allocated for a document.
+ *
+ * @param[in] stats_t Counters of the document.
+ * @param[in] size Bytes of the block.
+ */
+void libjxml_stats_alloc (xml_stats_t * stats_t, long size);
+
+/**
+ * @brief Start timing a phase.
+ *
+ * @param[in] stats_t Counters of the document.
+ * @return Start of the phase, to be given to libjxml_stats_stop().
+ */
+xml_clock_t libjxml_stats_start (xml_stats_t * stats_t);
+
+/**
+ * @brief Stop timing a phase and add its time to the document.
+ *
+ * The time of the phases timed while this one was running is not added again.
+ *
+ * @param[in] stats_t Counters of the document.
+ * @param[in] start_t Start of the phase.
+ * @param[in] phase LIBJXML_PHASE_* phase.
+ */
+void libjxml_stats_stop (xml_stats_t * stats_t, xml_clock_t * start_t, int phase);
+
+/**
+ * @brief Add the counters of a part built apart to its document.
+ *
+ * @param[in] stats_t Counters of the document.
+ * @param[in] part_t Counters of the part, set to 0.
+ */
+void libjxml_stats_merge (xml_stats_t * stats_t, xml_stats_t * part_t);
+
+#endif //_LIBJXML_STATS_H
@@ -0,0 +1,233 @@
+/**
+ * @file libjxml_version.h
+ *
+ * @brief Versions of a document shared by many reader threads while it changes.
+ *
+ * A shared document keeps its current version, that readers take without locking
+ * and keep as long as they need it, even after newer versions are made. Versions
+ * are never changed once committed. A writer changes a draft of the next version,
+ * which only copies the tags it changes, with their ancestors and the tags before
+ * them in their lists, and shares every other tag with the version it was made
+ * from. Each version is released when its last reader drops it, and the tags it
+ * does not share with newer versions are freed then.
+ *
+ * Tags are found by a path of steps like /config/db[2]/host, where each step is
+ * the name of a tag nested in the previous one, and an index between brackets,
+ * counted from 1, selects a tag among the ones with the same name.
+ *
+ * The cost of a change grows with the depth of the tag and with the number of
+ * tags before it and its ancestors in their lists, not with the size of the
+ * document. Copies pile up as versions are committed, so once the tags and
+ * attributes no longer reachable outnumber the ones of the version, the commit
+ * copies the whole tree, which keeps the memory bounded at a cost spread over
+ * many commits. The tree is copied too after LIBJXML_VERSION_TABLES versions add
+ * names never used before, as their names are looked up through a table each.
+ *
+ * The library must be linked with -lpthread.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_VERSION_H
+#define _LIBJXML_VERSION_H
+
+#include <stdbool.h>
+
+#include "libjxml.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_VERSION_STEPS    64   /**< Maximum number of steps of a path */
+#define LIBJXML_VERSION_TABLES   16   /**< Versions adding names before a commit copies the tree */
+#define LIBJXML_VERSION_CHUNK    4096 /**< Size of the first chunk of the arena of each version */
+#define LIBJXML_VERSION_NAMES    16   /**< Expected number of new names of each version */
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Document shared by many threads, private to the library.
+ */
+typedef struct xml_shared_t xml_shared_t;
+
+/**
+ * @brief Version of a shared document, private to the library.
+ */
+typedef struct xml_version_t xml_version_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Share a document between threads.
+ *
+ * The document becomes the first version, and is freed when no version shares
+ * its tags anymore. It must not be changed nor freed by the caller afterwards.
+ *
+ * @param[in] xml_mem_t Document to be shared, in any mode.
+ * @return Pointer to the shared document.
+ *
+ * @note The shared document must be freed with libjxml_shared_free().
+ */
+xml_shared_t * libjxml_shared_create (xml_t * xml_mem_t);
+
+/**
+ * @brief Free a shared document.
+ *
+ * The current version is released. Versions still taken by readers stay valid
+ * until they are released. No thread may take a version or edit the document
+ * meanwhile.
+ *
+ * @param[in] shared_t Pointer to the shared document.
+ */
+void libjxml_shared_free (xml_shared_t * shared_t);
+
+/**
+ * @brief Take the current version of a shared document.
+ *
+ * Readers never lock nor wait for the writer, and the version never changes
+ * while they hold it.
+ *
+ * @param[in] shared_t Pointer to the shared document.
+ * @return Pointer to the version.
+ *
+ * @note The version must be released with libjxml_version_release().
+ */
+xml_version_t * libjxml_shared_acquire (xml_shared_t * shared_t);
+
+/**
+ * @brief Start a draft of the next version of a shared document.
+ *
+ * Writers are serialized: the draft is made from the current version, and other
+ * writers wait until it is committed or aborted.
+ *
+ * @param[in] shared_t Pointer to the shared document.
+ * @return Pointer to the draft, changed with the libjxml_version_* functions.
+ *
+ * @note The draft must be given to libjxml_shared_commit() or libjxml_shared_abort().
+ */
+xml_version_t * libjxml_shared_edit (xml_shared_t * shared_t);
+
+/**
+ * @brief Make a draft the current version of a shared document.
+ *
+ * Readers taking a version from now on get the draft. The version it was made
+ * from is released once no reader holds it.
+ *
+ * @param[in] shared_t Pointer to the shared document.
+ * @param[in] draft_t Draft given by libjxml_shared_edit(), not to be changed anymore.
+ */
+void libjxml_shared_commit (xml_shared_t * shared_t, xml_version_t * draft_t);
+
+/**
+ * @brief Discard a draft, keeping the current version of a shared document.
+ *
+ * @param[in] shared_t Pointer to the shared document.
+ * @param[in] draft_t Draft given by libjxml_shared_edit().
+ */
+void libjxml_shared_abort (xml_shared_t * shared_t, xml_version_t * draft_t);
+
+/**
+ * @brief Release a version taken by a reader.
+ *
+ * @param[in] version_t Pointer to the version.
+ */
+void libjxml_version_release (xml_version_t * version_t);
+
+/**
+ * @brief Get the document of a version.
+ *
+ * The document is read like any other, but it must not be changed nor freed.
+ *
+ * @param[in] version_t Pointer to the version or draft.
+ * @return Pointer to the document, valid while the version is held.
+ */
+xml_t * libjxml_version_xml (xml_version_t * version_t);
+
+/**
+ * @brief Get the number of a version.
+ *
+ * @param[in] version_t Pointer to the version or draft.
+ * @return Number of versions committed before it, 0 for the shared document.
+ */
+long libjxml_version_number (xml_version_t * version_t);
+
+/**
+ * @brief Find a tag of a version by its path.
+ *
+ * @param[in] version_t Pointer to the version or draft.
+ * @param[in] path Null ended path of the tag, like /config/db[2]/host.
+ * @return Pointer to the tag, NULL if it is not found or the path is not valid.
+ */
+xml_tag_t * libjxml_version_tag (xml_version_t * version_t, char * path);
+
+/*********************************************************************************
+ *                                    EDITION
+ *********************************************************************************/
+
+/*
+ * The next functions change a draft, copying the tags on the path to the changed
+ * tag, and return false when the path is not found.
+ */
+
+/**
+ * @brief Add a tag after the last tag nested in another one.
+ *
+ * Every tag of the list is copied, as the last one is linked to the new tag.
+ *
+ * @param[in] draft_t Pointer to the draft.
+ * @param[in] path Path of the tag where the new tag is nested, NULL for the first level.
+ * @param[in] name Null ended name of the new tag.
+ * @return true if the tag was added.
+ */
+bool libjxml_version_add_tag (xml_version_t * draft_t, char * path, char * name);
+
+/**
+ * @brief Remove a tag, with its nested tags and attributes.
+ *
+ * @param[in] draft_t Pointer to the draft.
+ * @param[in] path Path of the tag to be removed.
+ * @return true if the tag was removed.
+ */
+bool libjxml_version_remove_tag (xml_version_t * draft_t, char * path);
+
+/**
+ * @brief Set the value of a tag.
+ *
+ * @param[in] draft_t Pointer to the draft.
+ * @param[in] path Path of the tag.
+ * @param[in] value Value copied to the draft, NULL to remove it.
+ * @param[in] length Length of the value.
+ * @return true if the value was set.
+ */
+bool libjxml_version_set_value (xml_version_t * draft_t, char * path, char * value, long length);
+
+/**
+ * @brief Set the value of an attribute of a tag, adding it if the tag does not have it.
+ *
+ * @param[in] draft_t Pointer to the draft.
+ * @param[in] path Path of the tag.
+ * @param[in] name Null ended name of the attribute.
+ * @param[in] value Value copied to the draft.
+ * @param[in] length Length of the value.
+ * @return true if the value was set.
+ */
+bool libjxml_version_set_attribute (xml_version_t * draft_t, char * path, char * name,
+									char * value, long length);
+
+/**
+ * @brief Remove an attribute of a tag.
+ *
+ * @param[in] draft_t Pointer to the draft.
+ * @param[in] path Path of the tag.
+ * @param[in] name Null ended name of the attribute.
+ * @return true if the attribute was removed, false if the tag or the attribute is not found.
+ */
+bool libjxml_version_remove_attribute (xml_version_t * draft_t, char * path, char * name);
+
+#endif //_LIBJXML_VERSION_H
@@ -0,0 +1,132 @@
+/**
+ * @file libjxml_writer.h
+ *
+ * @brief Streaming writer of xml documents.
+ *
+ * Documents are written tag by tag through a sink, without building any tree,
+ * so writing to a file descriptor takes the same memory whatever the size of the
+ * document: the buffer of the sink and the names of the open tags. Values and
+ * texts are escaped as they are written.
+ *
+ * A document is written like:
+ *
+ *     writer_t = libjxml_writer_create (sink_t, LIBJXML_FORMAT_INDENT);
+ *     libjxml_writer_declaration (writer_t, "1.0", "UTF-8");
+ *     libjxml_writer_begin (writer_t, "record");
+ *     libjxml_writer_attribute (writer_t, "id", "7");
+ *     libjxml_writer_element (writer_t, "name", "first", 5);
+ *     libjxml_writer_end (writer_t);
+ *     libjxml_writer_finish (writer_t);
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_WRITER_H
+#define _LIBJXML_WRITER_H
+
+#include <stdbool.h>
+
+#include "libjxml.h"
+#include "libjxml_sink.h"
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief State of a streaming writer, private to the library.
+ */
+typedef struct xml_writer_t xml_writer_t;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/**
+ * @brief Create a writer on a sink.
+ *
+ * @param[in] sink_t Sink receiving the text, created with libjxml_sink_mem(),
+ * libjxml_sink_fd() or libjxml_sink_file(). It must be kept until the writer is
+ * finished, and is not closed by the writer.
+ * @param[in] format LIBJXML_FORMAT_INDENT or LIBJXML_FORMAT_COMPACT.
+ * @return Pointer to the writer.
+ *
+ * @note The writer must be released with libjxml_writer_finish().
+ */
+xml_writer_t * libjxml_writer_create (xml_sink_t * sink_t, int format);
+
+/**
+ * @brief Write the xml declaration. Must be written before any tag.
+ *
+ * @param[in] writer_t Pointer to the writer.
+ * @param[in] version Null ended version, "1.0" if NULL.
+ * @param[in] encoding Null ended encoding, not written if NULL.
+ * @return true if written, false if a tag was already written or the sink failed.
+ */
+bool libjxml_writer_declaration (xml_writer_t * writer_t, char * version, char * encoding);
+
+/**
+ * @brief Open a tag nested in the last open one.
+ *
+ * @param[in] writer_t Pointer to the writer.
+ * @param[in] name Null ended name of the tag.
+ * @return true if written, false if the sink failed.
+ */
+bool libjxml_writer_begin (xml_writer_t * writer_t, char * name);
+
+/**
+ * @brief Add an attribute to the tag just opened.
+ *
+ * @param[in] writer_t Pointer to the writer.
+ * @param[in] name Null ended name of the attribute.
+ * @param[in] value Null ended value of the attribute, escaped when written.
+ * @return true if written, false if the tag already has text or nested tags, or
+ * the sink failed.
+ */
+bool libjxml_writer_attribute (xml_writer_t * writer_t, char * name, char * value);
+
+/**
+ * @brief Write a text inside the last open tag.
+ *
+ * @param[in] writer_t Pointer to the writer.
+ * @param[in] text Text, not null ended, escaped when written.
+ * @param[in] length Length of the text.
+ * @return true if written, false if there is no open tag or the sink failed.
+ */
+bool libjxml_writer_text (xml_writer_t * writer_t, char * text, long length);
+
+/**
+ * @brief Close the last open tag.
+ *
+ * Tags without text nor nested tags are written as empty tags, like <tag/>.
+ *
+ * @param[in] writer_t Pointer to the writer.
+ * @return true if written, false if there is no open tag or the sink failed.
+ */
+bool libjxml_writer_end (xml_writer_t * writer_t);
+
+/**
+ * @brief Write a tag with a text and no attributes nor nested tags.
+ *
+ * Same as libjxml_writer_begin(), libjxml_writer_text() and libjxml_writer_end().
+ *
+ * @param[in] writer_t Pointer to the writer.
+ * @param[in] name Null ended name of the tag.
+ * @param[in] text Text, not null ended, escaped when written.
+ * @param[in] length Length of the text.
+ * @return true if written, false if the sink failed.
+ */
+bool libjxml_writer_element (xml_writer_t * writer_t, char * name, char * text, long length);
+
+/**
+ * @brief Close the tags still open and release a writer.
+ *
+ * The sink is not flushed nor closed.
+ *
+ * @param[in] writer_t Pointer to the writer.
+ * @return true if every call succeeded and every tag was closed by the caller.
+ */
+bool libjxml_writer_finish (xml_writer_t * writer_t);
+
+#endif //_LIBJXML_WRITER_H
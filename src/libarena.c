@@ -0,0 +1,236 @@
+/**
+ * @file libarena.c
+ *
+ * @brief Library to work with memory arenas.
+ *
+ * An arena serves many small allocations from a few big chunks of memory. The
+ * allocations are never freed one by one; the whole arena is released or reset
+ * at once, so the chunks can be reused without calling malloc again.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libarena.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                 DECLARATIONS
+ *********************************************************************************/
+
+AChunk_t * libarena_create_chunk (long size);
+void * libarena_reserve (Arena_t * arena, long size, long align);
+
+/*********************************************************************************
+ *                                   API - ARENA
+ *********************************************************************************/
+
+Arena_t * libarena_create (long chunk_size)
+{
+	Arena_t * arena;
+	arena = (Arena_t *) malloc (sizeof (Arena_t));
+	LIBASSERT_PTR (arena);
+
+	if (chunk_size <= 0)
+		chunk_size = LIBARENA_CHUNK_SIZE;
+
+	arena->first = NULL;
+	arena->current = NULL;
+	arena->chunk_size = chunk_size;
+	arena->allocated = 0;
+
+	return arena;
+}
+
+long libarena_delete (Arena_t * arena)
+{
+	AChunk_t * rm_chunk;
+
+	long counter = 0;
+
+	while (arena->first != NULL)
+	{
+		rm_chunk = arena->first;
+		arena->first = arena->first->next;
+		free (rm_chunk);
+		counter++;
+	}
+
+	free (arena);
+
+	return counter;
+}
+
+long libarena_reset (Arena_t * arena)
+{
+	AChunk_t * aux_chunk;
+
+	long counter = 0;
+
+	for (aux_chunk = arena->first; aux_chunk != NULL; aux_chunk = aux_chunk->next)
+	{
+		aux_chunk->used = 0;
+		counter++;
+	}
+
+	arena->current = arena->first;
+	arena->allocated = 0;
+
+	return counter;
+}
+
+long libarena_adopt (Arena_t * arena, Arena_t * other)
+{
+	AChunk_t * aux_chunk;
+
+	long counter = 0;
+
+	if (other->first == NULL)
+		return 0;
+
+	/* Placed before the current chunk, where allocations never look for room */
+	for (aux_chunk = other->first; aux_chunk->next != NULL; aux_chunk = aux_chunk->next)
+		counter++;
+
+	aux_chunk->next = arena->first;
+	arena->first = other->first;
+
+	/* An arena without chunks would link its first new chunk over them */
+	if (arena->current == NULL)
+		arena->current = aux_chunk;
+	arena->allocated = arena->allocated + other->allocated;
+
+	other->first = NULL;
+	other->current = NULL;
+	other->allocated = 0;
+
+	return counter + 1;
+}
+
+long libarena_size (Arena_t * arena)
+{
+	AChunk_t * aux_chunk;
+
+	long size = 0;
+
+	for (aux_chunk = arena->first; aux_chunk != NULL; aux_chunk = aux_chunk->next)
+		size = size + aux_chunk->size;
+
+	return size;
+}
+
+bool libarena_owns (Arena_t * arena, void * pointer)
+{
+	AChunk_t * aux_chunk;
+	char * data;
+
+	for (aux_chunk = arena->first; aux_chunk != NULL; aux_chunk = aux_chunk->next)
+	{
+		data = (char *) (aux_chunk + 1);
+
+		if (((char *) pointer >= data) && ((char *) pointer < data + aux_chunk->used))
+			return true;
+	}
+
+	return false;
+}
+
+/*********************************************************************************
+ *                                API - ALLOCATION
+ *********************************************************************************/
+
+void * libarena_alloc (Arena_t * arena, long size)
+{
+	return libarena_reserve (arena, size, LIBARENA_ALIGN);
+}
+
+char * libarena_copy (Arena_t * arena, char * text, long length)
+{
+	char * copy;
+
+	copy = (char *) libarena_reserve (arena, length + 1, 1);
+	memcpy (copy, text, length);
+	copy [length] = '\0';
+
+	return copy;
+}
+
+/*********************************************************************************
+ *                                    CHUNKS
+ *********************************************************************************/
+
+AChunk_t * libarena_create_chunk (long size)
+{
+	AChunk_t * chunk;
+
+	/*
+	 * Data is placed after the header, whose size is a multiple of LIBARENA_ALIGN,
+	 * so offsets rounded up to LIBARENA_ALIGN give pointers aligned to it. Wider
+	 * types, like long double, may get less than the alignment of malloc.
+	 */
+	chunk = (AChunk_t *) malloc (sizeof (AChunk_t) + size);
+	LIBASSERT_PTR (chunk);
+
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+
+	return chunk;
+}
+
+void * libarena_reserve (Arena_t * arena, long size, long align)
+{
+	AChunk_t * chunk = arena->current;
+	AChunk_t * new_chunk;
+	long offset;
+
+	/* Look for room in the current chunk or in the chunks kept by a reset */
+	while (chunk != NULL)
+	{
+		offset = (chunk->used + align - 1) & ~(align - 1);
+
+		if (offset + size <= chunk->size)
+		{
+			chunk->used = offset + size;
+			arena->current = chunk;
+			arena->allocated++;
+			return (char *) (chunk + 1) + offset;
+		}
+
+		/* Chunks with free space are only skipped for allocations bigger than them */
+		if ((chunk->next == NULL) || (size > chunk->next->size))
+			break;
+
+		chunk = chunk->next;
+	}
+
+	if (size > arena->chunk_size)
+	{
+		new_chunk = libarena_create_chunk (size);
+	}
+	else
+	{
+		new_chunk = libarena_create_chunk (arena->chunk_size);
+		if (arena->chunk_size < LIBARENA_CHUNK_MAX)
+			arena->chunk_size = arena->chunk_size * 2;
+	}
+
+	if (chunk == NULL)
+	{
+		arena->first = new_chunk;
+	}
+	else
+	{
+		new_chunk->next = chunk->next;
+		chunk->next = new_chunk;
+	}
+
+	new_chunk->used = size;
+	arena->current = new_chunk;
+	arena->allocated++;
+
+	return (char *) (new_chunk + 1);
+}
@@ -11,70 +11,161 @@
  */
 
 #include <stdlib.h>
-#include <limits.h>
 #include <stdio.h>
-#include <ctype.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "libjxml.h"
+#include "libjxml_sax.h"
+#include "libjxml_entity.h"
+#include "libjxml_stats.h"
 #include "libstring.h"
 #include "libassert.h"
 
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_STACK_SIZE 32          /**< Initial depth of the open tag stack */
+#define LIBJXML_READ_SIZE  (64L*1024L) /**< Initial buffer to read files of unknown size */
+
+#define LIBJXML_IS_SPACE(c) (((c) == ' ')  || ((c) == '\n') || ((c) == '\t') || \
+							 ((c) == '\v') || ((c) == '\f') || ((c) == '\r'))
+
+/**
+ * @brief Tag opened but still not closed while building the tree.
+ */
+typedef struct xml_frame_t
+{
+	xml_tag_t * tag_t;  /**< The open tag */
+	xml_tag_t * last_t; /**< Last nested tag linked to the open tag */
+}xml_frame_t;
+
+/**
+ * @brief State of the tree builder fed by the parser events.
+ */
+struct xml_builder_t
+{
+	xml_t           * xml_mem_t;   /**< Document being built */
+	xml_frame_t     * stack;       /**< Stack of open tags */
+	long              depth;       /**< Number of open tags */
+	long              capacity;    /**< Number of frames allocated for the stack */
+	xml_tag_t       * last_t;      /**< Last tag linked at the first level */
+	xml_attribute_t * attribute_t; /**< Last attribute linked to the last opened tag */
+	xml_handler_t     handler_t;   /**< Callbacks given to the parser */
+	xml_push_t      * push_t;      /**< Parser fed with chunks, NULL if the text is given at once */
+};
+
 /*********************************************************************************
  *                                 DECLARATIONS
  *********************************************************************************/
 
-int libjxml_free_attribute (xml_attribute_t * attribute_t);
-int libjxml_free_tag (xml_tag_t * tag_t);
+void libjxml_free_token (xml_t * xml_mem_t, char * token);
+
+int libjxml_free_attribute (xml_t * xml_mem_t, xml_attribute_t * attribute_t);
+int libjxml_free_tag (xml_t * xml_mem_t, xml_tag_t * tag_t);
+int libjxml_free_content (xml_t * xml_mem_t);
+
+void libjxml_write_attribute (xml_sink_t * sink_t, xml_attribute_t * attribute_t);
+void libjxml_write_instruction (xml_sink_t * sink_t, xml_attribute_t * instruction_t);
+void libjxml_write_tag (xml_sink_t * sink_t, xml_iterator_t * iterator_t, int format);
 
-void libjxml_write_attribute (FILE * xml_file, xml_attribute_t * attribute_t);
-void libjxml_write_instruction (FILE * xml_file, xml_attribute_t * instruction_t);
-void libjxml_write_tag (FILE * xml_file, xml_tag_t * tag_t, int indent);
+bool libjxml_iterator_step (xml_iterator_t * iterator_t);
 
 FILE * libjxml_create (char * xml_name);
-FILE * libjxml_open (char * xml_name);
 FILE * libjxml_close (FILE * xml_file);
-long libjxml_length (FILE * xml_file);
-char * libjxml_read (FILE * xml_file, long xml_length);
-
-long libjxml_advance_spaces (char * text, long position);
-long libjxml_search_space (char * text, long position);
-char * libjxml_check_empty (char * element);
-char * libjxml_read_instruction (char * xml_txt);
-char * libjxml_read_content (char * xml_txt);
-long libjxml_find_next_tag (char * content_txt, long position);
-char * libjxml_create_close_tag (char * name);
-char * libjxml_parse_tag_name (char * content_txt, long position);
-char * libjxml_parse_tag_value (char * content_txt, long position, char * name);
-xml_tag_t * libjxml_parse_tag_nested (char * content_txt, long position, char * name);
-xml_tag_t * libjxml_parse_tag_sibling (char * content_txt, long position, char * name);
-xml_attribute_t * libjxml_parse_tag_attribute (char * content_txt, long position, char * name);
-void libjxml_parse_tag (char * content_txt, long position, xml_tag_t * tag_t);
-xml_tag_t * libjxml_parse_content (char * xml_txt);
-xml_attribute_t * libjxml_parse_instruction (char * xml_txt);
-xml_t * libjxml_init_xml_mem ();
-
-/* Only for testing */
-void libjxml_test_attribute (xml_attribute_t * attribute_t);
-void libjxml_test_tag (xml_tag_t * tag_t);
+char * libjxml_load (char * xml_name, bool writable, long * xml_length, bool * mapped);
+void libjxml_unload (char * xml_txt, long xml_length, bool mapped);
+char * libjxml_read (int xml_fd, long size_hint, long * xml_length);
+
+void libjxml_init_builder (xml_builder_t * builder_t, xml_t * xml_mem_t);
+bool libjxml_build_start (void * context, char * name, long length);
+bool libjxml_build_attribute (void * context, char * name, long name_length, char * value, long value_length);
+bool libjxml_build_text (void * context, char * text, long length);
+bool libjxml_build_cdata (void * context, char * text, long length);
+bool libjxml_build_value (xml_builder_t * builder_t, char * text, long length, bool decode);
+bool libjxml_build_end (void * context, char * name, long length);
+bool libjxml_build_instruction (void * context, char * name, long name_length, char * value, long value_length);
 
 
 /*********************************************************************************
  *                                   API
  *********************************************************************************/
 
+xml_t * libjxml_create_xml_mem (int mode)
+{
+	return libjxml_create_xml_names (mode, NULL);
+}
+
+xml_t * libjxml_create_xml_names (int mode, xml_names_t * names_t)
+{
+	xml_t * xml_mem_t;
+	xml_mem_t = (xml_t *) malloc (sizeof (xml_t));
+	LIBASSERT_PTR (xml_mem_t);
+
+	xml_mem_t->instruction_t = NULL;
+	xml_mem_t->content_t = NULL;
+	xml_mem_t->arena_t = NULL;
+	xml_mem_t->mode = mode;
+	xml_mem_t->nodes = 0;
+	xml_mem_t->source = NULL;
+	xml_mem_t->source_length = 0;
+	xml_mem_t->source_mapped = false;
+	xml_mem_t->generation = 0;
+	xml_mem_t->revision = 0;
+	xml_mem_t->decoded_t = NULL;
+
+	LIBJXML_STATS_INIT (xml_mem_t);
+	LIBJXML_STATS_ALLOC (xml_mem_t, sizeof (xml_t));
+
+	/* A document alone holds the only reference to its own table */
+	if (names_t != NULL)
+		xml_mem_t->names_t = libjxml_names_share (names_t);
+	else
+		xml_mem_t->names_t = libjxml_names_create (0);
+
+	if (mode & LIBJXML_MODE_ARENA)
+		xml_mem_t->arena_t = libarena_create (0);
+
+	return xml_mem_t;
+}
+
 int libjxml_free_xml_mem (xml_t * xml_mem_t)
 {
-	int attributes = 0;
-	int content = 0;
+	int quantity = 0;
 
 	if (xml_mem_t != NULL)
 	{
-		attributes = libjxml_free_attribute (xml_mem_t->instruction_t);
-		content = libjxml_free_tag (xml_mem_t->content_t);
+		quantity = libjxml_free_content (xml_mem_t);
+
+		if (xml_mem_t->arena_t != NULL)
+			libarena_delete (xml_mem_t->arena_t);
+
+		if (xml_mem_t->decoded_t != NULL)
+			libarena_delete (xml_mem_t->decoded_t);
+
+		libjxml_names_free (xml_mem_t->names_t);
 		free (xml_mem_t);
 	}
 
-	return attributes + content;
+	return quantity;
+}
+
+xml_t * libjxml_reset_xml_mem (xml_t * xml_mem_t)
+{
+	libjxml_free_content (xml_mem_t);
+
+	if (xml_mem_t->arena_t != NULL)
+		libarena_reset (xml_mem_t->arena_t);
+
+	if (xml_mem_t->decoded_t != NULL)
+		libarena_reset (xml_mem_t->decoded_t);
+
+	return xml_mem_t;
 }
 
 FILE  * libjxml_mem_to_file (xml_t * xml_mem_t, char * xml_name, bool close)
@@ -82,8 +173,11 @@ FILE  * libjxml_mem_to_file (xml_t * xml_mem_t, char * xml_name, bool close)
 	FILE * xml_file;
 
 	xml_file = libjxml_create (xml_name);
-	libjxml_write_instruction (xml_file, xml_mem_t->instruction_t);
-	libjxml_write_tag (xml_file, xml_mem_t->content_t, 0);
+	if (xml_file == NULL)
+		return NULL;
+
+	/* Nothing is written through the FILE buffer, so the descriptor is used directly */
+	libjxml_mem_to_fd (xml_mem_t, fileno (xml_file), LIBJXML_FORMAT_INDENT);
 
 	if (close)
 		libjxml_close (xml_file);
@@ -91,831 +185,1150 @@ FILE  * libjxml_mem_to_file (xml_t * xml_mem_t, char * xml_name, bool close)
 	return xml_file;
 }
 
-xml_t * libjxml_xml_to_mem (char * xml_txt)
+bool libjxml_mem_to_fd (xml_t * xml_mem_t, int xml_fd, int format)
 {
-	xml_t * xml_mem_t;
+	xml_sink_t * sink_t;
 
-	xml_mem_t = libjxml_init_xml_mem ();
-	xml_mem_t->instruction_t = libjxml_parse_instruction (xml_txt);
-	xml_mem_t->content_t = libjxml_parse_content (xml_txt);
+	sink_t = libjxml_sink_fd (xml_fd, LIBJXML_SINK_BUFFER);
+	libjxml_mem_to_sink (xml_mem_t, sink_t, format);
 
-	return xml_mem_t;
+	return libjxml_sink_close (sink_t);
 }
 
-xml_t * libjxml_file_to_mem (char * xml_name)
+char * libjxml_mem_to_txt (xml_t * xml_mem_t, int format, long * length)
 {
-	char * xml_txt;
-	FILE * xml_file;
-	xml_t * xml_mem_t;
+	xml_sink_t * sink_t;
 
-	xml_file = libjxml_open (xml_name);
-	xml_txt = libjxml_read (xml_file, -1);
-	xml_file = libjxml_close (xml_file);
-	
-	xml_mem_t = libjxml_xml_to_mem (xml_txt);
+	sink_t = libjxml_sink_mem (LIBJXML_SINK_BUFFER);
+	libjxml_mem_to_sink (xml_mem_t, sink_t, format);
 
-	free (xml_txt);
-	return xml_mem_t;
+	return libjxml_sink_release (sink_t, length);
 }
 
-/*********************************************************************************
- *                                  FREE MEMORY
- *********************************************************************************/
-
-int libjxml_free_attribute (xml_attribute_t * attribute_t)
+void libjxml_mem_to_sink (xml_t * xml_mem_t, xml_sink_t * sink_t, int format)
 {
-	int quantity = 0;
+	xml_iterator_t iterator_t;
 
-	if (attribute_t != NULL)
-	{
-		free (attribute_t->name);
-		free (attribute_t->value);
-		quantity = libjxml_free_attribute (attribute_t->next_attribute_t);
-		
-		free (attribute_t);
-		quantity++;
-	}
+	LIBJXML_STATS_START (xml_mem_t, start_t);
 
-	return quantity;
+	libjxml_write_instruction (sink_t, xml_mem_t->instruction_t);
+
+	libjxml_iterator_xml (&iterator_t, xml_mem_t, LIBJXML_WALK_PRE | LIBJXML_WALK_POST);
+
+	while (libjxml_iterator_next (&iterator_t) != NULL)
+		libjxml_write_tag (sink_t, &iterator_t, format);
+
+	libjxml_iterator_free (&iterator_t);
+
+	LIBJXML_STATS_STOP (xml_mem_t, start_t, LIBJXML_PHASE_WRITE);
 }
 
-int libjxml_free_tag (xml_tag_t * tag_t)
+xml_t * libjxml_xml_to_mem (char * xml_txt)
 {
-	int quantity = 0;
-	int attributes;
-	int tags;
+	return libjxml_xml_to_mem_mode (xml_txt, LIBJXML_MODE_MALLOC);
+}
 
-	if (tag_t != NULL)
-	{
-		free (tag_t->name);
-		free (tag_t->value);
+xml_t * libjxml_xml_to_mem_mode (char * xml_txt, int mode)
+{
+	xml_t * xml_mem_t;
 
-		attributes = libjxml_free_attribute (tag_t->attribute_t);
-		tags = libjxml_free_tag (tag_t->nested_tag_t);
-		quantity = attributes + tags;
-		tags = libjxml_free_tag (tag_t->sibling_tag_t);
-		quantity = quantity + tags;
-		
-		free (tag_t);
-		quantity++;
+	xml_mem_t = libjxml_create_xml_mem (mode);
+
+	if (libjxml_parse_xml_mem (xml_mem_t, xml_txt, strlen (xml_txt)) == NULL)
+	{
+		libjxml_free_xml_mem (xml_mem_t);
+		return NULL;
 	}
 
-	return quantity;
+	return xml_mem_t;
 }
 
-/*********************************************************************************
- *                             MEM TO FILE FUNCTIONS
- *********************************************************************************/
+xml_t * libjxml_file_to_mem (char * xml_name)
+{
+	return libjxml_file_to_mem_mode (xml_name, LIBJXML_MODE_MALLOC);
+}
 
-void libjxml_write_attribute (FILE * xml_file, xml_attribute_t * attribute_t)
+xml_t * libjxml_file_to_mem_mode (char * xml_name, int mode)
 {
-	if (attribute_t != NULL)
+	char * xml_txt;
+	xml_t * xml_mem_t;
+	long xml_length;
+	bool mapped;
+
+	/* The document is created first, so reading the file is counted in it */
+	xml_mem_t = libjxml_create_xml_mem (mode);
+
+	LIBJXML_STATS_START (xml_mem_t, start_t);
+	xml_txt = libjxml_load (xml_name, (mode & LIBJXML_MODE_TERMINATE) != 0, &xml_length, &mapped);
+	LIBJXML_STATS_STOP (xml_mem_t, start_t, LIBJXML_PHASE_READ);
+
+	if (xml_txt == NULL)
+	{
+		libjxml_free_xml_mem (xml_mem_t);
+		return NULL;
+	}
+
+	if (mapped == false)
+		LIBJXML_STATS_ALLOC (xml_mem_t, xml_length + 1);
+
+	if (libjxml_parse_xml_mem (xml_mem_t, xml_txt, xml_length) == NULL)
 	{
-		fprintf (xml_file, " %s=\"%s\"", attribute_t->name, attribute_t->value);
+		libjxml_free_xml_mem (xml_mem_t);
+		libjxml_unload (xml_txt, xml_length, mapped);
+		return NULL;
+	}
 
-		libjxml_write_attribute (xml_file, attribute_t->next_attribute_t);
+	/* Slices point to the text, so the document keeps it until it is freed */
+	if (mode & LIBJXML_MODE_SLICE)
+	{
+		xml_mem_t->source = xml_txt;
+		xml_mem_t->source_length = xml_length;
+		xml_mem_t->source_mapped = mapped;
 	}
+	else
+	{
+		libjxml_unload (xml_txt, xml_length, mapped);
+	}
+
+	return xml_mem_t;
 }
 
-void libjxml_write_instruction (FILE * xml_file, xml_attribute_t * instruction_t)
+char * libjxml_tag_name (xml_tag_t * tag_t, long * length)
 {
-	fprintf (xml_file, "<?xml");
-
-	libjxml_write_attribute (xml_file, instruction_t);
+	if (length != NULL)
+		*length = tag_t->name_length;
 
-	fprintf (xml_file, "?>");
+	return tag_t->name;
 }
 
-void libjxml_write_tag (FILE * xml_file, xml_tag_t * tag_t, int indent)
+char * libjxml_tag_value (xml_tag_t * tag_t, long * length)
 {
-	fprintf (xml_file, "\n");
+	if (length != NULL)
+		*length = tag_t->value_length;
 
-	int i;
-	for (i=0; i<indent; i++)
-		fprintf (xml_file, "\t");
-
-	fprintf (xml_file, "<%s", tag_t->name);
+	return tag_t->value;
+}
 
-	libjxml_write_attribute (xml_file, tag_t->attribute_t);
+char * libjxml_attribute_name (xml_attribute_t * attribute_t, long * length)
+{
+	if (length != NULL)
+		*length = attribute_t->name_length;
 
-	if ((tag_t->value == NULL) && (tag_t->nested_tag_t == NULL))
-		fprintf (xml_file, "/>");
-	else
-		fprintf (xml_file, ">");
+	return attribute_t->name;
+}
 
-	if ((tag_t->value == NULL) && (tag_t->nested_tag_t != NULL))
-	{
-		libjxml_write_tag (xml_file, tag_t->nested_tag_t, indent + 1);
-		fprintf (xml_file, "\n");
-		for (i=0; i<indent; i++)
-			fprintf (xml_file, "\t");
-	}
+char * libjxml_attribute_value (xml_attribute_t * attribute_t, long * length)
+{
+	if (length != NULL)
+		*length = attribute_t->value_length;
 
-	if ((tag_t->value != NULL) && (tag_t->nested_tag_t == NULL))
-		fprintf (xml_file, "%s", tag_t->value);
+	return attribute_t->value;
+}
 
-	if ((tag_t->value != NULL) && (tag_t->nested_tag_t != NULL))
-		printf ("\nLibXML: Error writing tag with value and nested_tag");
+bool libjxml_token_equal (char * token, long length, char * text)
+{
+	long i;
 
-	if ((tag_t->value != NULL) || (tag_t->nested_tag_t != NULL))
-		fprintf (xml_file, "</%s>", tag_t->name);
+	for (i = 0; i < length; i++)
+		if (token [i] != text [i])
+			return false;
 
-	if (tag_t->sibling_tag_t != NULL)
-		libjxml_write_tag (xml_file, tag_t->sibling_tag_t, indent);
+	return text [length] == '\0';
 }
 
+char * libjxml_find_name (xml_t * xml_mem_t, char * name)
+{
+	return libjxml_names_find (xml_mem_t->names_t, name, libstring_length (name));
+}
 
 /*********************************************************************************
- *                                 FILE FUNCTIONS
+ *                                  ALLOCATION
  *********************************************************************************/
 
-FILE * libjxml_create (char * xml_name)
+xml_tag_t * libjxml_new_tag (xml_t * xml_mem_t)
 {
-	FILE * xml_file;
+	xml_tag_t * tag_t;
 
-    xml_file = fopen (xml_name, "w");
-	if (xml_file == NULL)
+	if (xml_mem_t->arena_t != NULL)
+		tag_t = (xml_tag_t *) libarena_alloc (xml_mem_t->arena_t, sizeof (xml_tag_t));
+	else
 	{
-        printf ("\nLibXML: Error creating file");
-        return NULL;
-    }
+		tag_t = (xml_tag_t *) malloc (sizeof (xml_tag_t));
+		LIBJXML_STATS_ALLOC (xml_mem_t, sizeof (xml_tag_t));
+	}
+	LIBASSERT_PTR (tag_t);
 
-	return xml_file;
+	tag_t->name = NULL;
+	tag_t->value = NULL;
+	tag_t->name_length = 0;
+	tag_t->value_length = 0;
+	tag_t->attribute_t = NULL;
+	tag_t->nested_tag_t = NULL;
+	tag_t->sibling_tag_t = NULL;
+
+	xml_mem_t->nodes++;
+
+	return tag_t;
 }
 
-FILE * libjxml_open (char * xml_name)
+xml_attribute_t * libjxml_new_attribute (xml_t * xml_mem_t)
 {
-	FILE * xml_file;
+	xml_attribute_t * attribute_t;
 
-    xml_file = fopen (xml_name, "r");
-	if (xml_file == NULL)
+	if (xml_mem_t->arena_t != NULL)
+		attribute_t = (xml_attribute_t *) libarena_alloc (xml_mem_t->arena_t, sizeof (xml_attribute_t));
+	else
 	{
-        printf ("\nLibXML: Error opening file");
-        return NULL;
-    }
+		attribute_t = (xml_attribute_t *) malloc (sizeof (xml_attribute_t));
+		LIBJXML_STATS_ALLOC (xml_mem_t, sizeof (xml_attribute_t));
+	}
+	LIBASSERT_PTR (attribute_t);
 
-	return xml_file;
+	attribute_t->name = NULL;
+	attribute_t->value = NULL;
+	attribute_t->name_length = 0;
+	attribute_t->value_length = 0;
+	attribute_t->next_attribute_t = NULL;
+
+	xml_mem_t->nodes++;
+
+	return attribute_t;
 }
 
-FILE * libjxml_close (FILE * xml_file)
+char * libjxml_store_token (xml_t * xml_mem_t, char * text, long length)
 {
-	fclose (xml_file);
+	char * token;
 
-	return xml_file;
+	/* Slices point to the parsed text, that must be kept alive by the caller */
+	if (xml_mem_t->mode & LIBJXML_MODE_SLICE)
+		return text;
+
+	if (xml_mem_t->arena_t != NULL)
+		return libarena_copy (xml_mem_t->arena_t, text, length);
+
+	token = (char *) malloc ((length + 1) * sizeof (char));
+	LIBASSERT_PTR (token);
+	LIBJXML_STATS_ALLOC (xml_mem_t, length + 1);
+	memcpy (token, text, length);
+	token [length] = '\0';
+
+	return token;
 }
 
-long libjxml_length (FILE * xml_file)
+char * libjxml_store_copy (xml_t * xml_mem_t, char * text, long length)
 {
-	long xml_length;
+	Arena_t * arena_t = xml_mem_t->arena_t;
 
-    fseek (xml_file, 0, SEEK_END);
-    xml_length = ftell(xml_file);
+	if (!(xml_mem_t->mode & LIBJXML_MODE_SLICE))
+		return libjxml_store_token (xml_mem_t, text, length);
 
-    fseek (xml_file, 0, SEEK_SET);
+	/* Slices are never freed one by one, so copies go to an arena too */
+	if (arena_t == NULL)
+	{
+		if (xml_mem_t->decoded_t == NULL)
+			xml_mem_t->decoded_t = libarena_create (0);
+		arena_t = xml_mem_t->decoded_t;
+	}
 
-	return xml_length;
+	return libarena_copy (arena_t, text, length);
 }
 
-char * libjxml_read (FILE * xml_file, long xml_length)
+char * libjxml_store_text (xml_t * xml_mem_t, char * text, long * length)
 {
-	long read_len;
-		
-	if (xml_length < 0)
+	Arena_t * arena_t = xml_mem_t->arena_t;
+	char * value;
+
+	if (libjxml_entity_find (text, *length) == *length)
+		return libjxml_store_token (xml_mem_t, text, *length);
+
+	/* A decoded value is never longer, so a writable text is decoded over itself */
+	if (xml_mem_t->mode & LIBJXML_MODE_TERMINATE)
 	{
-		xml_length = libjxml_length (xml_file);
+		*length = libjxml_entity_decode (text, text, *length);
+		text [*length] = '\0';
+
+		return libjxml_store_token (xml_mem_t, text, *length);
 	}
 
-	char * xml;
-	xml = (char *) malloc (xml_length * sizeof (char));
-	LIBASSERT_PTR (xml);
-	read_len = fread (xml, sizeof (char), xml_length, xml_file);
-	
-	if (read_len == xml_length)
+	/* Slices of a text that is not writable are decoded in an arena of their own */
+	if ((xml_mem_t->mode & LIBJXML_MODE_SLICE) && (arena_t == NULL))
 	{
-		return xml;
+		if (xml_mem_t->decoded_t == NULL)
+			xml_mem_t->decoded_t = libarena_create (0);
+		arena_t = xml_mem_t->decoded_t;
+	}
+
+	if (arena_t != NULL)
+	{
+		value = (char *) libarena_alloc (arena_t, (*length + 1) * sizeof (char));
 	}
 	else
 	{
-		printf ("\nLibXML: Error reading file. Expected %ld and received %ld.", xml_length, read_len);
-		free (xml);
-		return NULL;
+		value = (char *) malloc ((*length + 1) * sizeof (char));
+		LIBASSERT_PTR (value);
+		LIBJXML_STATS_ALLOC (xml_mem_t, *length + 1);
 	}
+
+	*length = libjxml_entity_decode (value, text, *length);
+	value [*length] = '\0';
+
+	return value;
+}
+
+void libjxml_free_token (xml_t * xml_mem_t, char * token)
+{
+	/* Tokens stored in the arena are released with the whole arena */
+	if ((xml_mem_t->arena_t == NULL) && !(xml_mem_t->mode & LIBJXML_MODE_SLICE))
+		free (token);
 }
 
 /*********************************************************************************
- *                                PARSE FUNCTIONS
+ *                                    EDITION
  *********************************************************************************/
 
-long libjxml_advance_spaces (char * text, long position)
+xml_tag_t * libjxml_add_tag (xml_t * xml_mem_t, xml_tag_t * parent_t, char * name)
 {
-	while (isspace (text [position]) != 0)
-		position++;
+	xml_tag_t ** link_t;
+	xml_tag_t * tag_t;
+
+	tag_t = libjxml_new_tag (xml_mem_t);
+	tag_t->name_length = libstring_length (name);
+	tag_t->name = libjxml_names_intern (xml_mem_t->names_t, name, tag_t->name_length);
 
-	return position;
+	if (parent_t != NULL)
+		link_t = &parent_t->nested_tag_t;
+	else
+		link_t = &xml_mem_t->content_t;
+
+	while (*link_t != NULL)
+		link_t = &(*link_t)->sibling_tag_t;
+
+	*link_t = tag_t;
+	xml_mem_t->generation++;
+
+	return tag_t;
 }
 
-long libjxml_search_space (char * text, long position)
+bool libjxml_remove_tag (xml_t * xml_mem_t, xml_tag_t * parent_t, xml_tag_t * tag_t)
 {
-	long space;
-	long newline;
-	long tab_horizontal;
-	long tab_vertical;
-	long form_feed;
-	long carriage;
+	xml_tag_t ** link_t;
 
-	long result = LONG_MAX; // Maximum possible value for long
+	if (parent_t != NULL)
+		link_t = &parent_t->nested_tag_t;
+	else
+		link_t = &xml_mem_t->content_t;
 
- 	space          = libstring_search (text, position, " ");
- 	newline        = libstring_search (text, position, "\n");
- 	tab_horizontal = libstring_search (text, position, "\t");
- 	tab_vertical   = libstring_search (text, position, "\v");
- 	form_feed      = libstring_search (text, position, "\f");
- 	carriage       = libstring_search (text, position, "\r");
+	while ((*link_t != NULL) && (*link_t != tag_t))
+		link_t = &(*link_t)->sibling_tag_t;
 
-	if ((space >= 0) && (space < result))
-		result = space;
+	if (*link_t == NULL)
+		return false;
 
-	if ((newline >= 0) && (newline < result))
-		result = newline;
+	*link_t = tag_t->sibling_tag_t;
+	tag_t->sibling_tag_t = NULL;
+	xml_mem_t->generation++;
 
-	if ((tab_horizontal >= 0) && (tab_horizontal < result))
-		result = tab_horizontal;
+	/* Nodes in the arena are counted until it is reset, as their memory is kept */
+	if (xml_mem_t->arena_t == NULL)
+		xml_mem_t->nodes = xml_mem_t->nodes - libjxml_free_tag (xml_mem_t, tag_t);
 
-	if ((tab_vertical >= 0) && (tab_vertical < result))
-		result = tab_vertical;
+	return true;
+}
 
-	if ((form_feed >= 0) && (form_feed < result))
-		result = form_feed;
+void libjxml_set_value (xml_t * xml_mem_t, xml_tag_t * tag_t, char * value, long length)
+{
+	if (tag_t->value != NULL)
+		libjxml_free_token (xml_mem_t, tag_t->value);
 
-	if ((carriage >= 0) && (carriage < result))
-		result = carriage;
+	tag_t->value = NULL;
+	tag_t->value_length = 0;
+	xml_mem_t->revision++;
 
-	if (result == LONG_MAX)
-		result = -1;
+	if (value == NULL)
+		return;
 
-	return result;
+	tag_t->value = libjxml_store_copy (xml_mem_t, value, length);
+	tag_t->value_length = length;
 }
 
-char * libjxml_check_empty (char * element)
+xml_attribute_t * libjxml_set_attribute (xml_t * xml_mem_t, xml_tag_t * tag_t, char * name,
+										 char * value, long length)
 {
-	long length;
-	length = libstring_length (element);
+	xml_attribute_t ** link_t;
+	xml_attribute_t * attribute_t;
+	char * interned;
+	long name_length;
+
+	name_length = libstring_length (name);
+	interned = libjxml_names_intern (xml_mem_t->names_t, name, name_length);
+
+	link_t = &tag_t->attribute_t;
+	while ((*link_t != NULL) && ((*link_t)->name != interned))
+		link_t = &(*link_t)->next_attribute_t;
 
-	while (length > 0)
+	attribute_t = *link_t;
+
+	if (attribute_t != NULL)
 	{
-		if ((element [length - 1] != ' ')  && 
-			(element [length - 1] != '\n') &&
-			(element [length - 1] != '\t') && 
-			(element [length - 1] != '\v') &&
-			(element [length - 1] != '\f') && 
-			(element [length - 1] != '\r'))
-		{
-			length--;
-		}
-		else
-		{
-			free (element);
-			element = NULL;
-			break;
-		}
+		libjxml_free_token (xml_mem_t, attribute_t->value);
+	}
+	else
+	{
+		attribute_t = libjxml_new_attribute (xml_mem_t);
+		attribute_t->name = interned;
+		attribute_t->name_length = name_length;
+
+		*link_t = attribute_t;
+		xml_mem_t->generation++;
 	}
 
-	return element;
+	attribute_t->value = libjxml_store_copy (xml_mem_t, value, length);
+	attribute_t->value_length = length;
+	xml_mem_t->revision++;
+
+	return attribute_t;
 }
 
-char * libjxml_read_instruction (char * xml_txt)
+bool libjxml_remove_attribute (xml_t * xml_mem_t, xml_tag_t * tag_t, char * name)
 {
-	char * instruction;
+	xml_attribute_t ** link_t;
+	xml_attribute_t * attribute_t;
+	char * interned;
 
-	long inst_start;
-	long inst_end;
-	long inst_length;
-	
-	inst_start = libstring_search (xml_txt, 0, "<?");
-	inst_end   = libstring_search (xml_txt, 0, "?>");
+	interned = libjxml_find_name (xml_mem_t, name);
+	if (interned == NULL)
+		return false;
 
-	int bracket_len;
-	bracket_len = libstring_length ("<?");
-	inst_length = inst_end - inst_start + bracket_len;
+	link_t = &tag_t->attribute_t;
+	while ((*link_t != NULL) && ((*link_t)->name != interned))
+		link_t = &(*link_t)->next_attribute_t;
 
-	if (inst_end <= inst_start)
-		return NULL;
-	
-	instruction = (char *) malloc (inst_length * sizeof (char));
-	LIBASSERT_PTR (instruction);
-	libstring_subset (xml_txt, inst_start, inst_length, instruction);
-	
-	return instruction;
+	attribute_t = *link_t;
+	if (attribute_t == NULL)
+		return false;
+
+	*link_t = attribute_t->next_attribute_t;
+	attribute_t->next_attribute_t = NULL;
+	xml_mem_t->generation++;
+
+	if (xml_mem_t->arena_t == NULL)
+		xml_mem_t->nodes = xml_mem_t->nodes - libjxml_free_attribute (xml_mem_t, attribute_t);
+
+	return true;
 }
 
-char * libjxml_read_content (char * xml_txt)
-{
-	long next_inst;
-	long inst_end;
-	long main_start;
+/*********************************************************************************
+ *                                  FREE MEMORY
+ *********************************************************************************/
 
-	inst_end = libstring_search (xml_txt, 0, "?>");
-	inst_end = inst_end + libstring_length ("?>");
+int libjxml_free_content (xml_t * xml_mem_t)
+{
+	int quantity;
 
-	main_start = libstring_search (xml_txt, inst_end, "<");
-	next_inst  = libstring_search (xml_txt, inst_end, "<?");
+	if (xml_mem_t->arena_t != NULL)
+	{
+		quantity = xml_mem_t->nodes;
+	}
+	else
+	{
+		quantity = libjxml_free_attribute (xml_mem_t, xml_mem_t->instruction_t);
+		quantity = quantity + libjxml_free_tag (xml_mem_t, xml_mem_t->content_t);
+	}
 
-	if (next_inst > 0)
+	if (xml_mem_t->source != NULL)
 	{
-		printf ("\nLibXML: Error reading content. Instruction detected.");
-		return NULL;
+		libjxml_unload (xml_mem_t->source, xml_mem_t->source_length, xml_mem_t->source_mapped);
+		xml_mem_t->source = NULL;
+		xml_mem_t->source_length = 0;
+		xml_mem_t->source_mapped = false;
 	}
 
-	return xml_txt + main_start;
+	xml_mem_t->instruction_t = NULL;
+	xml_mem_t->content_t = NULL;
+	xml_mem_t->nodes = 0;
+	xml_mem_t->generation++;
+
+	return quantity;
 }
 
-long libjxml_find_next_tag (char * content_txt, long position)
+int libjxml_free_attribute (xml_t * xml_mem_t, xml_attribute_t * attribute_t)
 {
-	long content_length;
-	content_length = libstring_length (content_txt);
-	
-	while ((content_txt [position] != '<') && (position < content_length))
-		position++;
+	xml_attribute_t * next_t;
+	int quantity = 0;
 
-	if ((position >= 0) && (position < content_length))
-		return position;
-	else
-		return -1;
-}
+	while (attribute_t != NULL)
+	{
+		next_t = attribute_t->next_attribute_t;
 
-char * libjxml_create_close_tag (char * name)
-{
-	long name_length;
-	name_length = libstring_length (name);
-	int bracket_len;
-	bracket_len = libstring_length ("</>");
-	
-	long length;
-	length = name_length + bracket_len;
-	char * close;
-	close = (char *) malloc (length * sizeof (char));
-	LIBASSERT_PTR (close);
+		libjxml_free_token (xml_mem_t, attribute_t->value);
+		free (attribute_t);
+		quantity++;
 
-	close[0] = '<';
-	close[1] = '/';
-	close[2] = '\0';
-	libstring_concat (close, name);
-	libstring_concat (close, ">");
+		attribute_t = next_t;
+	}
 
-	return close;
+	return quantity;
 }
 
-char * libjxml_parse_tag_name (char * content_txt, long position)
+/*
+ * The tags are freed walking the sibling list without using any stack. A tag with
+ * nested tags is rotated below its first nested tag, which takes its place and
+ * gets it as next sibling, until the current tag has no nested tags and can be
+ * freed. Each rotation and each free takes constant time.
+ */
+int libjxml_free_tag (xml_t * xml_mem_t, xml_tag_t * tag_t)
 {
-	char * name = NULL;
+	xml_tag_t * nested_t;
+	xml_tag_t * next_t;
+	int quantity = 0;
 
-	long blank;
-	long bracket;
-	long slash;
-	long small = LONG_MAX;  // Maximum possible value for long
+	while (tag_t != NULL)
+	{
+		if (tag_t->nested_tag_t != NULL)
+		{
+			nested_t = tag_t->nested_tag_t;
+			tag_t->nested_tag_t = nested_t->sibling_tag_t;
+			nested_t->sibling_tag_t = tag_t;
+			tag_t = nested_t;
+			continue;
+		}
 
-	position = position + libstring_length ("<");
+		next_t = tag_t->sibling_tag_t;
 
-	blank   = libjxml_search_space (content_txt, position);
-	bracket = libstring_search (content_txt, position, ">");
-	slash   = libstring_search (content_txt, position, "/>");
+		libjxml_free_token (xml_mem_t, tag_t->value);
+		quantity = quantity + libjxml_free_attribute (xml_mem_t, tag_t->attribute_t);
+		free (tag_t);
+		quantity++;
 
-	if ((blank > 0) && (blank < small))
-        small = blank;
-    
-    if ((bracket > 0) && (bracket < small))
-    	small = bracket;
+		tag_t = next_t;
+	}
 
-	if ((slash > 0) && (slash < small))
-        small = slash;
+	return quantity;
+}
 
-	if ((small > 0) && (small < LONG_MAX))
+/*********************************************************************************
+ *                             MEM TO FILE FUNCTIONS
+ *********************************************************************************/
+
+void libjxml_write_attribute (xml_sink_t * sink_t, xml_attribute_t * attribute_t)
+{
+	while (attribute_t != NULL)
 	{
-		long length;
-		length = small - position;
-		name = (char *) malloc (length * sizeof (char));
-		LIBASSERT_PTR (name);
-		libstring_subset (content_txt, position, length, name);
-	}
-	else
-		printf ("\nLIBXML: Error parsing tag name");
+		libjxml_sink_write (sink_t, " ", 1);
+		libjxml_sink_write (sink_t, attribute_t->name, attribute_t->name_length);
+		libjxml_sink_write (sink_t, "=\"", 2);
+		libjxml_sink_escape (sink_t, attribute_t->value, attribute_t->value_length, true);
+		libjxml_sink_write (sink_t, "\"", 1);
 
-	return name;
+		attribute_t = attribute_t->next_attribute_t;
+	}
 }
 
-char * libjxml_parse_tag_value (char * content_txt, long position, char * name)
+void libjxml_write_instruction (xml_sink_t * sink_t, xml_attribute_t * instruction_t)
 {
-	char * value = NULL;
-	
-	long bracket;
-	long slash;
+	libjxml_sink_string (sink_t, "<?xml");
+
+	libjxml_write_attribute (sink_t, instruction_t);
 
-	bracket = libstring_search (content_txt, position, ">");
-	slash   = libstring_search (content_txt, position, "/>");
+	libjxml_sink_string (sink_t, "?>");
+}
+
+/*
+ * Writes the tag given by the iterator, its beginning when the tag is entered
+ * and its end when it is left.
+ */
+void libjxml_write_tag (xml_sink_t * sink_t, xml_iterator_t * iterator_t, int format)
+{
+	xml_tag_t * tag_t = iterator_t->tag_t;
+	bool compact = (format & LIBJXML_FORMAT_COMPACT) != 0;
 
-	if ((bracket < slash) || (slash < 0))
+	if (iterator_t->leaving == false)
 	{
-		char * close;
-		close = libjxml_create_close_tag (name);
-		
-		long close_pos;
-		long next_tag;
-		long start_pos;
-		long length;
+		if (compact == false)
+		{
+			libjxml_sink_write (sink_t, "\n", 1);
+			libjxml_sink_fill (sink_t, '\t', iterator_t->depth);
+		}
 
-		start_pos = bracket + libstring_length (">");
+		libjxml_sink_write (sink_t, "<", 1);
+		libjxml_sink_write (sink_t, tag_t->name, tag_t->name_length);
+
+		libjxml_write_attribute (sink_t, tag_t->attribute_t);
+
+		if ((tag_t->value == NULL) && (tag_t->nested_tag_t == NULL))
+			libjxml_sink_write (sink_t, "/>", 2);
+		else
+			libjxml_sink_write (sink_t, ">", 1);
 
-		close_pos = libstring_search (content_txt, start_pos, close);
-		next_tag = libjxml_find_next_tag (content_txt, start_pos);
-		
-		length = next_tag - start_pos;
+		if ((tag_t->value != NULL) && (tag_t->nested_tag_t == NULL))
+			libjxml_sink_escape (sink_t, tag_t->value, tag_t->value_length, false);
 
-		if (close_pos == next_tag)
+		if ((tag_t->value != NULL) && (tag_t->nested_tag_t != NULL))
 		{
-			if (length > 0)
-			{
-				value = (char *) malloc (length * sizeof (char));
-				LIBASSERT_PTR (value);
-				libstring_subset (content_txt, start_pos, length, value);
-				value = libjxml_check_empty (value);
-			}
-			else
-			{
-				printf ("\nLibXML: Error reading tag value.");
-			}
+			fprintf (stderr, "\nLibXML: Error writing tag with value and nested_tag");
+			libjxml_iterator_skip (iterator_t);
 		}
-		free (close);
+
+		return;
 	}
-	return value;
+
+	if ((tag_t->value == NULL) && (tag_t->nested_tag_t == NULL))
+		return;
+
+	if ((tag_t->value == NULL) && (compact == false))
+	{
+		libjxml_sink_write (sink_t, "\n", 1);
+		libjxml_sink_fill (sink_t, '\t', iterator_t->depth);
+	}
+
+	libjxml_sink_write (sink_t, "</", 2);
+	libjxml_sink_write (sink_t, tag_t->name, tag_t->name_length);
+	libjxml_sink_write (sink_t, ">", 1);
 }
 
-xml_tag_t * libjxml_parse_tag_nested (char * content_txt, long position, char * name)
+/*********************************************************************************
+ *                                   ITERATORS
+ *********************************************************************************/
+
+/*
+ * The iterator goes through the events of a depth first walk: each tag is
+ * entered, then its nested tags are walked, and then it is left. Only the
+ * ancestors of the current tag are kept, in a stack allocated by the iterator.
+ */
+
+void libjxml_iterator_init (xml_iterator_t * iterator_t, xml_tag_t * tag_t, int order)
 {
-	xml_tag_t * tag_t = NULL;
+	iterator_t->first_t = tag_t;
+	iterator_t->tag_t = NULL;
+	iterator_t->stack = NULL;
+	iterator_t->depth = 0;
+	iterator_t->capacity = 0;
+	iterator_t->order = order;
+	iterator_t->leaving = false;
+	iterator_t->siblings = false;
+	iterator_t->skip = false;
+
+	if ((order & LIBJXML_WALK_CHILDREN) && (tag_t != NULL))
+		iterator_t->first_t = tag_t->nested_tag_t;
+}
 
-	long bracket;
-	long slash;
+void libjxml_iterator_xml (xml_iterator_t * iterator_t, xml_t * xml_mem_t, int order)
+{
+	libjxml_iterator_init (iterator_t, NULL, order);
 
-	bracket = libstring_search (content_txt, position, ">");
-	slash   = libstring_search (content_txt, position, "/>");
+	iterator_t->first_t = xml_mem_t->content_t;
+	iterator_t->siblings = true;
+}
 
-	if ((bracket < slash) || (slash < 0))
+xml_tag_t * libjxml_iterator_next (xml_iterator_t * iterator_t)
+{
+	/* Children are just a list of siblings */
+	if (iterator_t->order & LIBJXML_WALK_CHILDREN)
 	{
-		char * close;
-		close = libjxml_create_close_tag (name);
-
-		long close_pos;
-		long next_tag;
-		long start_pos;
+		if (iterator_t->tag_t == NULL)
+			iterator_t->tag_t = iterator_t->first_t;
+		else
+			iterator_t->tag_t = iterator_t->tag_t->sibling_tag_t;
 
-		start_pos = position + libstring_length (name);
+		iterator_t->first_t = NULL;
 
-		close_pos = libstring_search (content_txt, start_pos, close);
-		next_tag = libjxml_find_next_tag (content_txt, start_pos);
+		return iterator_t->tag_t;
+	}
 
-		if (close_pos > next_tag)
-		{
-			long length;
-			length = position + next_tag;
-			printf ("\n%s has nested on %ld", name, length);
-			tag_t = (xml_tag_t *) malloc (sizeof (xml_tag_t));
-			LIBASSERT_PTR (tag_t);
+	while (libjxml_iterator_step (iterator_t))
+	{
+		if ((iterator_t->leaving) && (iterator_t->order & LIBJXML_WALK_POST))
+			return iterator_t->tag_t;
 
-			libjxml_parse_tag (content_txt, next_tag, tag_t);
-		}
-		free (close);
+		if ((iterator_t->leaving == false) && (iterator_t->order & LIBJXML_WALK_PRE))
+			return iterator_t->tag_t;
 	}
 
-	return tag_t;
+	return NULL;
 }
 
-xml_tag_t * libjxml_parse_tag_sibling (char * content_txt, long position, char * name)
+void libjxml_iterator_skip (xml_iterator_t * iterator_t)
 {
-	xml_tag_t * tag_t = NULL;
+	iterator_t->skip = true;
+}
 
-	long bracket;
-	long slash;
-	long tag_end = 0;
+void libjxml_iterator_free (xml_iterator_t * iterator_t)
+{
+	free (iterator_t->stack);
 
-	bracket = libstring_search (content_txt, position, ">");
-	slash   = libstring_search (content_txt, position, "/>");
+	iterator_t->stack = NULL;
+	iterator_t->capacity = 0;
+	iterator_t->depth = 0;
+}
 
-	long name_length;
-	name_length = libstring_length (name);
+/*
+ * Moves to the next event of the walk. Returns false once the walk is finished.
+ */
+bool libjxml_iterator_step (xml_iterator_t * iterator_t)
+{
+	xml_tag_t * tag_t = iterator_t->tag_t;
+	bool skip = iterator_t->skip;
+
+	iterator_t->skip = false;
 
-	if ((slash > 0) && (slash <= bracket))
+	if (tag_t == NULL)
 	{
-		tag_end = slash + libstring_length ("/>");
+		iterator_t->tag_t = iterator_t->first_t;
+		iterator_t->first_t = NULL;
+		iterator_t->leaving = false;
+
+		return iterator_t->tag_t != NULL;
 	}
-	else if ((bracket < slash) || (slash < 0))
+
+	if (iterator_t->leaving == false)
 	{
-		char * close;
-		close = libjxml_create_close_tag (name);
+		if ((tag_t->nested_tag_t != NULL) && (skip == false))
+		{
+			if (iterator_t->depth == iterator_t->capacity)
+			{
+				if (iterator_t->capacity == 0)
+					iterator_t->capacity = LIBJXML_STACK_SIZE;
+				else
+					iterator_t->capacity = iterator_t->capacity * 2;
+
+				iterator_t->stack = (xml_tag_t **) realloc (iterator_t->stack,
+															iterator_t->capacity * sizeof (xml_tag_t *));
+				LIBASSERT_PTR (iterator_t->stack);
+			}
 
-		long close_pos;
-		close_pos = libstring_search (content_txt, position, close);
-		tag_end = close_pos + libstring_length (close);
+			iterator_t->stack [iterator_t->depth] = tag_t;
+			iterator_t->depth++;
+			iterator_t->tag_t = tag_t->nested_tag_t;
+		}
+		else
+			iterator_t->leaving = true;
 
-		free (close);
+		return true;
 	}
 
-	if (tag_end > 0)
+	if ((tag_t->sibling_tag_t != NULL) && ((iterator_t->depth > 0) || (iterator_t->siblings)))
 	{
-		long next_tag;
-		long next_close;
-		next_tag = libjxml_find_next_tag (content_txt, tag_end);
-		next_close = libstring_search (content_txt, tag_end, "</");
+		iterator_t->tag_t = tag_t->sibling_tag_t;
+		iterator_t->leaving = false;
 
-		if (next_tag < 0)
-			return tag_t;
+		return true;
+	}
 
-		if (next_tag < next_close)
-		{
-			tag_t = (xml_tag_t *) malloc (sizeof (xml_tag_t));
-			LIBASSERT_PTR (tag_t);
-			printf ("\n%s has sibling on %ld", name, next_tag);
-			libjxml_parse_tag (content_txt, next_tag, tag_t);
-			printf("\n\nSibling:%s", content_txt + next_tag);
-		}
+	if (iterator_t->depth == 0)
+	{
+		iterator_t->tag_t = NULL;
+		return false;
 	}
 
-	return tag_t;
+	iterator_t->depth--;
+	iterator_t->tag_t = iterator_t->stack [iterator_t->depth];
+
+	return true;
 }
 
-xml_attribute_t * libjxml_parse_tag_attribute (char * content_txt, long position, char * name)
+/*********************************************************************************
+ *                                 FILE FUNCTIONS
+ *********************************************************************************/
+
+FILE * libjxml_create (char * xml_name)
 {
-	xml_attribute_t * attribute_t = NULL;
-	xml_attribute_t * attribute_last_t = NULL;
+	FILE * xml_file;
 
-	long offset;
-	long offset_aux;
-	long length;
+    xml_file = fopen (xml_name, "w");
+	if (xml_file == NULL)
+	{
+        fprintf (stderr, "\nLibXML: Error creating file");
+        return NULL;
+    }
+
+	return xml_file;
+}
 
-	position = position + libstring_length ("<") + libstring_length (name);
+FILE * libjxml_close (FILE * xml_file)
+{
+	fclose (xml_file);
 
-	while (1)
+	return xml_file;
+}
+
+/*
+ * Regular files are mapped in memory and parsed straight from the mapped pages.
+ * The mapping is private, so writing null characters for LIBJXML_MODE_TERMINATE
+ * never reaches the file. Pipes, sockets and any file that cannot be mapped are
+ * read with buffered reads.
+ */
+char * libjxml_load (char * xml_name, bool writable, long * xml_length, bool * mapped)
+{
+	struct stat xml_stat;
+	char * xml_txt = NULL;
+	int protection = PROT_READ;
+	int xml_fd;
+
+	xml_fd = open (xml_name, O_RDONLY);
+	if (xml_fd < 0)
+	{
+		fprintf (stderr, "\nLibXML: Error opening file");
+		return NULL;
+	}
+
+	if (writable)
+		protection = protection | PROT_WRITE;
+
+	*mapped = false;
+
+	if ((fstat (xml_fd, &xml_stat) == 0) && S_ISREG (xml_stat.st_mode) && (xml_stat.st_size > 0))
 	{
-		position = libjxml_advance_spaces (content_txt, position);
+		xml_txt = (char *) mmap (NULL, xml_stat.st_size, protection, MAP_PRIVATE, xml_fd, 0);
 
-		offset = libstring_search (content_txt, position, "=");
-		offset_aux = libstring_search (content_txt, position, ">");
-		
-		if ((offset_aux <= offset) || (offset < 0))
+		if (xml_txt != MAP_FAILED)
 		{
-			return attribute_t;
+			madvise (xml_txt, xml_stat.st_size, MADV_SEQUENTIAL);
+			*xml_length = xml_stat.st_size;
+			*mapped = true;
 		}
 		else
 		{
-			xml_attribute_t * attribute_aux_t;
-			attribute_aux_t = (xml_attribute_t  *) malloc (sizeof (xml_attribute_t));
-			LIBASSERT_PTR (attribute_aux_t);
-			
-			if (attribute_t == NULL)
-				attribute_t = attribute_aux_t;
-
-			if (attribute_last_t == NULL)
-				attribute_last_t = attribute_aux_t;
-			else
-			{
-				attribute_last_t->next_attribute_t = attribute_aux_t;
-				attribute_last_t = attribute_last_t->next_attribute_t;
-			}
-				
-			length = offset - position;
-			char * name;
-			name = (char *) malloc (length * sizeof (char));
-			LIBASSERT_PTR (name);
-			length = libstring_subset (content_txt, position, length, name);
-
-			position = offset + libstring_length ("=");
-			offset = libstring_search (content_txt, position, "\"");
-			position = offset + libstring_length ("\"");
-			offset = libstring_search (content_txt, position, "\"");
-
-			length = offset - position;
-			char * value;
-			value = (char *) malloc (offset * sizeof (char));
-			LIBASSERT_PTR (value);
-			length = libstring_subset (content_txt, position, length, value);
-			position = offset + libstring_length ("\"");
-
-			attribute_last_t->name = name;
-			attribute_last_t->value = value;
-			attribute_last_t->next_attribute_t = NULL;
+			xml_txt = libjxml_read (xml_fd, xml_stat.st_size, xml_length);
 		}
 	}
+	else
+	{
+		xml_txt = libjxml_read (xml_fd, LIBJXML_READ_SIZE, xml_length);
+	}
 
-	return attribute_t;
+	close (xml_fd);
+
+	return xml_txt;
 }
 
-void libjxml_parse_tag (char * content_txt, long position, xml_tag_t * tag_t)
+void libjxml_unload (char * xml_txt, long xml_length, bool mapped)
 {
-	tag_t->name = libjxml_parse_tag_name (content_txt, position);
-	tag_t->value = libjxml_parse_tag_value (content_txt, position, tag_t->name);
-	tag_t->attribute_t = libjxml_parse_tag_attribute (content_txt, position, tag_t->name);
-	tag_t->nested_tag_t = libjxml_parse_tag_nested (content_txt, position, tag_t->name);
-	tag_t->sibling_tag_t = libjxml_parse_tag_sibling (content_txt, position, tag_t->name);
+	if (mapped)
+		munmap (xml_txt, xml_length);
+	else
+		free (xml_txt);
 }
 
-xml_tag_t * libjxml_parse_content (char * xml_txt)
+char * libjxml_read (int xml_fd, long size_hint, long * xml_length)
 {
-	xml_tag_t * content_t; 
-	char * content_txt;
-	long position = 0;
+	char * xml;
+	long capacity;
+	long length = 0;
+	long read_len;
+
+	capacity = size_hint + 1;
+	xml = (char *) malloc (capacity * sizeof (char));
+	LIBASSERT_PTR (xml);
+
+	while (1)
+	{
+		if (length + 1 == capacity)
+		{
+			capacity = capacity * 2;
+			xml = (char *) realloc (xml, capacity * sizeof (char));
+			LIBASSERT_PTR (xml);
+		}
 
-	content_txt = libjxml_read_content (xml_txt);
-	position = libjxml_find_next_tag (content_txt, position);
-	content_t = (xml_tag_t *) malloc (sizeof (xml_tag_t));
-	LIBASSERT_PTR (content_t);
+		read_len = read (xml_fd, xml + length, capacity - length - 1);
 
-	libjxml_parse_tag (content_txt, position, content_t);
-	
-	return content_t;
+		if (read_len == 0)
+			break;
+
+		if (read_len < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			fprintf (stderr, "\nLibXML: Error reading file. Received %ld.", length);
+			free (xml);
+			return NULL;
+		}
+
+		length = length + read_len;
+	}
+
+	xml [length] = '\0';
+	*xml_length = length;
+
+	return xml;
 }
 
-xml_attribute_t * libjxml_parse_instruction (char * xml_txt)
+/*********************************************************************************
+ *                                 TREE BUILDER
+ *********************************************************************************/
+
+/*
+ * The tree is built from the events of the single pass parser. Open tags are
+ * kept in a stack, so each new tag is linked directly to its parent.
+ */
+
+xml_t * libjxml_parse_xml_mem (xml_t * xml_mem_t, char * xml_txt, long length)
+{
+	return libjxml_parse_xml_offset (xml_mem_t, xml_txt, length, 0);
+}
+
+xml_t * libjxml_parse_xml_offset (xml_t * xml_mem_t, char * xml_txt, long length, long offset)
 {
-	xml_attribute_t * attribute_t = NULL;
-	xml_attribute_t * attribute_last_t = NULL;
+	xml_builder_t builder_t;
+	bool parsed;
 
-	long offset;
-	long offset_aux;
-	long length;
-	long position = 0;
+	libjxml_init_builder (&builder_t, xml_mem_t);
+	builder_t.handler_t.offset = offset;
 
-	char * instruction;
-	instruction = libjxml_read_instruction (xml_txt);
-	
-	offset = libstring_search (instruction, position, "<?");
-	position = position + libstring_length ("<?");
+	LIBJXML_STATS_START (xml_mem_t, start_t);
+	parsed = libjxml_sax_buffer (xml_txt, length, &builder_t.handler_t);
+	LIBJXML_STATS_STOP (xml_mem_t, start_t, LIBJXML_PHASE_TOKENIZE);
 
-	offset = libjxml_search_space (instruction, position);
-	offset_aux = libstring_search (instruction, position, "?>");
-	if (offset_aux <= offset)
+	free (builder_t.stack);
+
+	if (parsed == false)
 	{
-		printf ("\nLibXML: Error parsing instruction. No instructions");
+		libjxml_reset_xml_mem (xml_mem_t);
 		return NULL;
 	}
 
-	offset = libstring_search (instruction, position, "xml");
-	if (offset != libstring_length ("<?"))
+	return xml_mem_t;
+}
+
+xml_builder_t * libjxml_begin_xml_mem (xml_t * xml_mem_t)
+{
+	xml_builder_t * builder_t;
+
+	/* Chunks are not kept by the document, so every token is copied */
+	xml_mem_t->mode = xml_mem_t->mode & ~LIBJXML_MODE_INSITU;
+
+	builder_t = (xml_builder_t *) malloc (sizeof (xml_builder_t));
+	LIBASSERT_PTR (builder_t);
+
+	libjxml_init_builder (builder_t, xml_mem_t);
+	builder_t->push_t = libjxml_push_create (&builder_t->handler_t);
+
+	return builder_t;
+}
+
+bool libjxml_feed_xml_mem (xml_builder_t * builder_t, char * chunk, long length)
+{
+	bool parsed;
+
+	LIBJXML_STATS_START (builder_t->xml_mem_t, start_t);
+	parsed = libjxml_push_feed (builder_t->push_t, chunk, length);
+	LIBJXML_STATS_STOP (builder_t->xml_mem_t, start_t, LIBJXML_PHASE_TOKENIZE);
+
+	return parsed;
+}
+
+xml_t * libjxml_end_xml_mem (xml_builder_t * builder_t)
+{
+	xml_t * xml_mem_t = builder_t->xml_mem_t;
+	bool parsed;
+
+	LIBJXML_STATS_START (xml_mem_t, start_t);
+	parsed = libjxml_push_finish (builder_t->push_t);
+	LIBJXML_STATS_STOP (xml_mem_t, start_t, LIBJXML_PHASE_TOKENIZE);
+
+	free (builder_t->stack);
+	free (builder_t);
+
+	if (parsed == false)
 	{
-		printf ("\nLibXML: Error parsing instruction. No xml begining");
+		libjxml_reset_xml_mem (xml_mem_t);
 		return NULL;
 	}
 
-	position = libstring_length ("<?xml");
+	return xml_mem_t;
+}
 
-	while (1)
+void libjxml_init_builder (xml_builder_t * builder_t, xml_t * xml_mem_t)
+{
+	builder_t->xml_mem_t   = xml_mem_t;
+	builder_t->depth       = 0;
+	builder_t->capacity    = LIBJXML_STACK_SIZE;
+	builder_t->last_t      = NULL;
+	builder_t->attribute_t = NULL;
+	builder_t->push_t      = NULL;
+	builder_t->stack       = (xml_frame_t *) malloc (builder_t->capacity * sizeof (xml_frame_t));
+	LIBASSERT_PTR (builder_t->stack);
+	LIBJXML_STATS_ALLOC (xml_mem_t, builder_t->capacity * sizeof (xml_frame_t));
+
+	builder_t->handler_t.context     = builder_t;
+	builder_t->handler_t.start_tag   = libjxml_build_start;
+	builder_t->handler_t.attribute   = libjxml_build_attribute;
+	builder_t->handler_t.text        = libjxml_build_text;
+	builder_t->handler_t.cdata       = libjxml_build_cdata;
+	builder_t->handler_t.end_tag     = libjxml_build_end;
+	builder_t->handler_t.instruction = libjxml_build_instruction;
+	builder_t->handler_t.terminate   = (xml_mem_t->mode & LIBJXML_MODE_TERMINATE) != 0;
+	builder_t->handler_t.offset      = 0;
+
+	xml_mem_t->generation++;
+}
+
+bool libjxml_build_start (void * context, char * name, long length)
+{
+	xml_builder_t * builder_t = (xml_builder_t *) context;
+	xml_t * xml_mem_t = builder_t->xml_mem_t;
+	xml_frame_t * frame_t;
+	xml_tag_t * tag_t;
+
+	LIBJXML_STATS_START (xml_mem_t, start_t);
+
+	tag_t = libjxml_new_tag (xml_mem_t);
+	tag_t->name = libjxml_names_intern (xml_mem_t->names_t, name, length);
+	tag_t->name_length = length;
+
+	if (builder_t->depth == 0)
 	{
-		position = libjxml_advance_spaces (instruction, position);
+		if (builder_t->last_t == NULL)
+			xml_mem_t->content_t = tag_t;
+		else
+			builder_t->last_t->sibling_tag_t = tag_t;
+		builder_t->last_t = tag_t;
+	}
+	else
+	{
+		frame_t = &builder_t->stack [builder_t->depth - 1];
 
-		offset = libstring_search (instruction, position, "=");
-		offset_aux = libstring_search (instruction, position, "?>");
-		
-		if ((offset_aux <= offset) || (offset < 0))
+		/* A tag with nested tags has no value */
+		if (frame_t->tag_t->value != NULL)
 		{
-			free (instruction);
-			return attribute_t;
+			libjxml_free_token (xml_mem_t, frame_t->tag_t->value);
+			frame_t->tag_t->value = NULL;
+			frame_t->tag_t->value_length = 0;
 		}
+
+		if (frame_t->last_t == NULL)
+			frame_t->tag_t->nested_tag_t = tag_t;
 		else
-		{
-			xml_attribute_t * attribute_aux_t;
-			attribute_aux_t = (xml_attribute_t  *) malloc (sizeof (xml_attribute_t));
-			LIBASSERT_PTR (attribute_aux_t);
-			
-			if (attribute_t == NULL)
-				attribute_t = attribute_aux_t;
-
-			if (attribute_last_t == NULL)
-				attribute_last_t = attribute_aux_t;
-			else
-			{
-				attribute_last_t->next_attribute_t = attribute_aux_t;
-				attribute_last_t = attribute_last_t->next_attribute_t;
-			}			
-			
-			length = offset - position;
-			char * name;
-			name = (char *) malloc (length * sizeof (char));
-			LIBASSERT_PTR (name);
-
-			length = libstring_subset (instruction, position, length, name);
-
-			position = offset + libstring_length ("=");
-			offset = libstring_search (instruction, position, "\"");
-			position = offset + libstring_length ("\"");
-			offset = libstring_search (instruction, position, "\"");
-
-			length = offset - position;
-			char * value;
-			value = (char *) malloc (offset * sizeof (char));
-			LIBASSERT_PTR (value);
-
-			length = libstring_subset (instruction, position, length, value);
-			position = offset + libstring_length ("\"");
-
-			attribute_last_t->name = name;
-			attribute_last_t->value = value;
-			attribute_last_t->next_attribute_t = NULL;
-		}
+			frame_t->last_t->sibling_tag_t = tag_t;
+		frame_t->last_t = tag_t;
 	}
 
-	free (instruction);
-	return attribute_t;
+	if (builder_t->depth == builder_t->capacity)
+	{
+		builder_t->capacity = builder_t->capacity * 2;
+		builder_t->stack = (xml_frame_t *) realloc (builder_t->stack, builder_t->capacity * sizeof (xml_frame_t));
+		LIBASSERT_PTR (builder_t->stack);
+		LIBJXML_STATS_ALLOC (xml_mem_t, builder_t->capacity * sizeof (xml_frame_t));
+	}
+
+	frame_t = &builder_t->stack [builder_t->depth];
+	frame_t->tag_t = tag_t;
+	frame_t->last_t = NULL;
+	builder_t->depth++;
+	builder_t->attribute_t = NULL;
+
+	LIBJXML_STATS_STOP (xml_mem_t, start_t, LIBJXML_PHASE_BUILD);
+
+	return true;
 }
 
-xml_t * libjxml_init_xml_mem (char * xml_txt)
+bool libjxml_build_attribute (void * context, char * name, long name_length, char * value, long value_length)
 {
-	xml_t * xml_mem_t;
-	xml_mem_t = (xml_t *) malloc (sizeof (xml_t));
-	LIBASSERT_PTR (xml_mem_t);
+	xml_builder_t * builder_t = (xml_builder_t *) context;
+	xml_t * xml_mem_t = builder_t->xml_mem_t;
+	xml_attribute_t * attribute_t;
 
-	xml_mem_t->instruction_t = NULL;
-	xml_mem_t->content_t = NULL;
+	LIBJXML_STATS_START (xml_mem_t, start_t);
 
-	return xml_mem_t;
+	attribute_t = libjxml_new_attribute (xml_mem_t);
+	attribute_t->name = libjxml_names_intern (xml_mem_t->names_t, name, name_length);
+	attribute_t->name_length = name_length;
+	attribute_t->value = libjxml_store_text (xml_mem_t, value, &value_length);
+	attribute_t->value_length = value_length;
+
+	if (builder_t->attribute_t == NULL)
+		builder_t->stack [builder_t->depth - 1].tag_t->attribute_t = attribute_t;
+	else
+		builder_t->attribute_t->next_attribute_t = attribute_t;
+	builder_t->attribute_t = attribute_t;
+
+	LIBJXML_STATS_STOP (xml_mem_t, start_t, LIBJXML_PHASE_BUILD);
+
+	return true;
 }
 
-/*********************************************************************************
- *                                  TESTS
- *********************************************************************************/
+bool libjxml_build_text (void * context, char * text, long length)
+{
+	return libjxml_build_value ((xml_builder_t *) context, text, length, true);
+}
 
-void libjxml_test_attribute (xml_attribute_t * attribute_t)
+bool libjxml_build_cdata (void * context, char * text, long length)
 {
-	if (attribute_t != NULL)
-	{
-		printf ("\nAttribute: \"%s\" - \"%s\"", attribute_t->name, attribute_t->value);
-		libjxml_test_attribute (attribute_t->next_attribute_t);
-	}
+	return libjxml_build_value ((xml_builder_t *) context, text, length, false);
 }
 
-void libjxml_test_tag (xml_tag_t * tag_t)
+/*
+ * Stores the first text of a tag that is not blank as its value. The text of
+ * CDATA sections has no entities, so it is stored as it is.
+ */
+bool libjxml_build_value (xml_builder_t * builder_t, char * text, long length, bool decode)
 {
-	if (tag_t != NULL)
-	{
-		int selection = 0;
+	xml_tag_t * tag_t;
+	long i;
+
+	tag_t = builder_t->stack [builder_t->depth - 1].tag_t;
 
-		printf("\n+++++++++++++++++++++++++++++++++++++++++");
-		printf("\nName:  \"%s\"", tag_t->name);
-		printf("\nValue: \"%s\"", tag_t->value);
-		libjxml_test_attribute (tag_t->attribute_t);
-		printf("\nNested on:  %p", tag_t->nested_tag_t);
-		printf("\nSibling on: %p", tag_t->sibling_tag_t);
-		printf("\n-------------------------");
-		printf("\n1.- Close");
-		printf("\n2.- Go to nested");
-		printf("\n3.- Go to sibling");
-		printf("\nSelect: ");
-		scanf("%d", &selection);
+	/* Only text placed directly between the open and close tags is a value */
+	if ((tag_t->nested_tag_t != NULL) || (tag_t->value != NULL))
+		return true;
 
-		if (selection == 2)
-			libjxml_test_tag (tag_t->nested_tag_t);
+	LIBJXML_STATS_START (builder_t->xml_mem_t, start_t);
 
-		if (selection == 3)
-			libjxml_test_tag (tag_t->sibling_tag_t);
+	for (i = 0; i < length; i++)
+	{
+		if (!LIBJXML_IS_SPACE (text [i]))
+		{
+			if (decode == true)
+				tag_t->value = libjxml_store_text (builder_t->xml_mem_t, text, &length);
+			else
+				tag_t->value = libjxml_store_token (builder_t->xml_mem_t, text, length);
+			tag_t->value_length = length;
+			break;
+		}
 	}
-}
 
+	LIBJXML_STATS_STOP (builder_t->xml_mem_t, start_t, LIBJXML_PHASE_BUILD);
+
+	return true;
+}
 
-void libjxml_test (xml_t * xml_mem_t)
+/*
+ * The parser already checked that the name matches the open tag.
+ */
+bool libjxml_build_end (void * context, char * name, long length)
 {
-	int selection = 0;
+	xml_builder_t * builder_t = (xml_builder_t *) context;
 
-	printf("\n+++++++++++++++++++++++++++++++++++++++++");
-	libjxml_test_attribute (xml_mem_t->instruction_t);
-	printf("\nContent on: %p", xml_mem_t->content_t);
-	printf("\n-------------------------");
-	printf("\n1.- Close");
-	printf("\n2.- Go to tag");
-	printf("\nSelect: ");
-	scanf("%d", &selection);
+	(void) name;
+	(void) length;
 
-	if (selection == 2)
-		libjxml_test_tag (xml_mem_t->content_t)		;
+	builder_t->depth--;
 
+	return true;
 }
 
-/*
-int main()
+bool libjxml_build_instruction (void * context, char * name, long name_length, char * value, long value_length)
 {
-	xml_t * xml_mem_t;
-	long quantity;
+	xml_builder_t * builder_t = (xml_builder_t *) context;
+	xml_t * xml_mem_t = builder_t->xml_mem_t;
+	xml_attribute_t * attribute_t;
 
-	do
-	{
-		xml_mem_t = libjxml_file_to_mem (".ignore/example.xml");
-	
-		libjxml_mem_to_file (xml_mem_t, ".ignore/xml_name.xml", true);
+	LIBJXML_STATS_START (xml_mem_t, start_t);
+
+	attribute_t = libjxml_new_attribute (xml_mem_t);
+	attribute_t->name = libjxml_names_intern (xml_mem_t->names_t, name, name_length);
+	attribute_t->name_length = name_length;
+	attribute_t->value = libjxml_store_text (xml_mem_t, value, &value_length);
+	attribute_t->value_length = value_length;
 
-		libjxml_test (xml_mem_t);
-	
-		quantity = libjxml_free_xml_mem (xml_mem_t);
+	/* Instruction attributes are notified before any tag is opened */
+	if (builder_t->attribute_t == NULL)
+		xml_mem_t->instruction_t = attribute_t;
+	else
+		builder_t->attribute_t->next_attribute_t = attribute_t;
+	builder_t->attribute_t = attribute_t;
 
-		printf ("\n\n++++++++++++++++++++++++++++++++++++++++++++++++++++ %ld\n\n", quantity);
-	} while (0);
+	LIBJXML_STATS_STOP (xml_mem_t, start_t, LIBJXML_PHASE_BUILD);
 
-	printf("\n");
-    return 0;
+	return true;
 }
-*/
@@ -0,0 +1,310 @@
+/**
+ * @file libjxml_batch.c
+ *
+ * @brief Loading of many xml files with a pool of threads.
+ *
+ * The threads take the files in order from a shared position protected by a
+ * mutex, so a slow file never leaves the other threads waiting. Files are small
+ * in a batch, so they are read with read() instead of being mapped, which would
+ * cost more in system calls and page faults than the copy. Each thread reuses
+ * its reading buffer for all its files, unless the documents keep slices of
+ * their text.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "libjxml_batch.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_BATCH_READ (64L*1024L) /**< Initial buffer to read files of unknown size */
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Files of a batch shared by its threads.
+ */
+typedef struct xml_loader_t
+{
+	char           ** xml_names; /**< Names of the files */
+	long              count;     /**< Number of files */
+	int               mode;      /**< LIBJXML_MODE_* flags of the documents */
+	xml_batch_t     * results;   /**< Result of each file */
+	long              next;      /**< Next file to be taken */
+	pthread_mutex_t   lock;      /**< Protects 'next' */
+}xml_loader_t;
+
+/**
+ * @brief Thread of a batch.
+ */
+typedef struct xml_worker_t
+{
+	xml_loader_t * loader_t; /**< Files of the batch */
+	char         * buffer;   /**< Reading buffer reused for each file */
+	long           capacity; /**< Allocated length of the buffer */
+	long           loaded;   /**< Number of files loaded by the thread */
+}xml_worker_t;
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+int libjxml_batch_threads (int threads, long count);
+void * libjxml_batch_work (void * context);
+long libjxml_batch_take (xml_loader_t * loader_t);
+void libjxml_batch_file (xml_worker_t * worker_t, char * xml_name, xml_batch_t * result_t);
+int libjxml_batch_read (xml_worker_t * worker_t, int xml_fd, long size_hint, char ** xml_txt, long * xml_length);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+long libjxml_batch_load (char ** xml_names, long count, int mode, int threads, xml_batch_t * results)
+{
+	xml_loader_t loader_t;
+	xml_worker_t workers [LIBJXML_BATCH_THREADS];
+	pthread_t ids [LIBJXML_BATCH_THREADS];
+	bool started [LIBJXML_BATCH_THREADS];
+	long loaded = 0;
+	int i;
+
+	if (count <= 0)
+		return 0;
+
+	loader_t.xml_names = xml_names;
+	loader_t.count = count;
+	loader_t.mode = mode;
+	loader_t.results = results;
+	loader_t.next = 0;
+	pthread_mutex_init (&loader_t.lock, NULL);
+
+	threads = libjxml_batch_threads (threads, count);
+
+	for (i = 0; i < threads; i++)
+	{
+		workers [i].loader_t = &loader_t;
+		workers [i].buffer = NULL;
+		workers [i].capacity = 0;
+		workers [i].loaded = 0;
+	}
+
+	/* The calling thread works too, and alone if no thread can be created */
+	for (i = 1; i < threads; i++)
+		started [i] = (pthread_create (&ids [i], NULL, libjxml_batch_work, &workers [i]) == 0);
+
+	libjxml_batch_work (&workers [0]);
+
+	for (i = 0; i < threads; i++)
+	{
+		if ((i > 0) && started [i])
+			pthread_join (ids [i], NULL);
+
+		free (workers [i].buffer);
+		loaded = loaded + workers [i].loaded;
+	}
+
+	pthread_mutex_destroy (&loader_t.lock);
+
+	return loaded;
+}
+
+void libjxml_batch_free (xml_batch_t * results, long count)
+{
+	long i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (results [i].xml_mem_t != NULL)
+			libjxml_free_xml_mem (results [i].xml_mem_t);
+
+		results [i].xml_mem_t = NULL;
+	}
+}
+
+/*********************************************************************************
+ *                                    WORKERS
+ *********************************************************************************/
+
+int libjxml_batch_threads (int threads, long count)
+{
+	if (threads <= 0)
+		threads = 2 * sysconf (_SC_NPROCESSORS_ONLN);
+
+	if (threads > LIBJXML_BATCH_THREADS)
+		threads = LIBJXML_BATCH_THREADS;
+
+	if (threads > count)
+		threads = count;
+
+	if (threads < 1)
+		threads = 1;
+
+	return threads;
+}
+
+void * libjxml_batch_work (void * context)
+{
+	xml_worker_t * worker_t = (xml_worker_t *) context;
+	xml_loader_t * loader_t = worker_t->loader_t;
+	long index;
+
+	while ((index = libjxml_batch_take (loader_t)) >= 0)
+		libjxml_batch_file (worker_t, loader_t->xml_names [index], &loader_t->results [index]);
+
+	return NULL;
+}
+
+long libjxml_batch_take (xml_loader_t * loader_t)
+{
+	long index = -1;
+
+	pthread_mutex_lock (&loader_t->lock);
+
+	if (loader_t->next < loader_t->count)
+		index = loader_t->next++;
+
+	pthread_mutex_unlock (&loader_t->lock);
+
+	return index;
+}
+
+void libjxml_batch_file (xml_worker_t * worker_t, char * xml_name, xml_batch_t * result_t)
+{
+	struct stat xml_stat;
+	xml_t * xml_mem_t;
+	long size_hint = LIBJXML_BATCH_READ;
+	long xml_length;
+	char * xml_txt;
+	int mode = worker_t->loader_t->mode;
+	int xml_fd;
+
+	result_t->xml_mem_t = NULL;
+	result_t->error = 0;
+
+	xml_fd = open (xml_name, O_RDONLY);
+	if (xml_fd < 0)
+	{
+		result_t->error = errno;
+		fprintf (stderr, "\nLibXML: Error opening file %s", xml_name);
+		return;
+	}
+
+	if ((fstat (xml_fd, &xml_stat) == 0) && S_ISREG (xml_stat.st_mode))
+		size_hint = xml_stat.st_size;
+
+	result_t->error = libjxml_batch_read (worker_t, xml_fd, size_hint, &xml_txt, &xml_length);
+	close (xml_fd);
+
+	if (result_t->error != 0)
+	{
+		fprintf (stderr, "\nLibXML: Error reading file %s", xml_name);
+		return;
+	}
+
+	xml_mem_t = libjxml_create_xml_mem (mode);
+
+	if (libjxml_parse_xml_mem (xml_mem_t, xml_txt, xml_length) == NULL)
+	{
+		libjxml_free_xml_mem (xml_mem_t);
+		result_t->error = LIBJXML_BATCH_INVALID;
+
+		if (mode & LIBJXML_MODE_SLICE)
+			free (xml_txt);
+		return;
+	}
+
+	/* Slices point to the text, so the document keeps it until it is freed */
+	if (mode & LIBJXML_MODE_SLICE)
+	{
+		xml_mem_t->source = xml_txt;
+		xml_mem_t->source_length = xml_length;
+		xml_mem_t->source_mapped = false;
+	}
+
+	result_t->xml_mem_t = xml_mem_t;
+	worker_t->loaded++;
+}
+
+/*
+ * Reads a whole file into the buffer of the thread, or into a new buffer when
+ * the document keeps its text. Returns 0 or the errno of the failed read.
+ */
+int libjxml_batch_read (xml_worker_t * worker_t, int xml_fd, long size_hint, char ** xml_txt, long * xml_length)
+{
+	bool owned = (worker_t->loader_t->mode & LIBJXML_MODE_SLICE) != 0;
+	char * buffer = worker_t->buffer;
+	long capacity = worker_t->capacity;
+	long length = 0;
+	long read_len;
+	int error = 0;
+
+	if (owned || (capacity < size_hint + 1))
+	{
+		if (owned == false)
+			free (buffer);
+
+		capacity = size_hint + 1;
+		buffer = (char *) malloc (capacity * sizeof (char));
+		LIBASSERT_PTR (buffer);
+	}
+
+	while (1)
+	{
+		if (length + 1 == capacity)
+		{
+			capacity = capacity * 2;
+			buffer = (char *) realloc (buffer, capacity * sizeof (char));
+			LIBASSERT_PTR (buffer);
+		}
+
+		read_len = read (xml_fd, buffer + length, capacity - length - 1);
+
+		if (read_len == 0)
+			break;
+
+		if (read_len < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			error = errno;
+			break;
+		}
+
+		length = length + read_len;
+	}
+
+	if (owned == false)
+	{
+		worker_t->buffer = buffer;
+		worker_t->capacity = capacity;
+	}
+
+	if (error != 0)
+	{
+		if (owned)
+			free (buffer);
+		return error;
+	}
+
+	buffer [length] = '\0';
+	*xml_txt = buffer;
+	*xml_length = length;
+
+	return 0;
+}
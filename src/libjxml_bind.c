@@ -0,0 +1,740 @@
+/**
+ * @file libjxml_bind.c
+ *
+ * @brief Binding of xml documents to C structures.
+ *
+ * The parser is a set of callbacks of the event parser keeping a stack with a
+ * frame for each open tag: the structure filled by its nested tags and
+ * attributes, or the field filled by its value, or nothing when the tag has no
+ * field and everything in it is skipped. Values are converted and stored as
+ * soon as they are read, so nothing of the text is kept.
+ *
+ * Arrays keep no capacity: the items are reallocated to twice their number each
+ * time the number reaches a power of two.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#include "libjxml_bind.h"
+#include "libjxml_sax.h"
+#include "libjxml_entity.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_BIND_DEPTH  32 /**< Initial depth of the frame stack */
+#define LIBJXML_BIND_NUMBER 64 /**< Size of the buffer to convert and write numbers */
+
+#define LIBJXML_IS_SPACE(c) (((c) == ' ')  || ((c) == '\n') || ((c) == '\t') || \
+							 ((c) == '\v') || ((c) == '\f') || ((c) == '\r'))
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Open tag of the parse.
+ */
+typedef struct xml_frame_t
+{
+	const xml_binding_t * binding_t; /**< Binding of the structure filled by the tag, NULL if none */
+	const xml_field_t   * field_t;   /**< Field filled by the value of the tag, NULL if none */
+	char                * object;    /**< Structure or field filled by the tag */
+	bool                  filled;    /**< The value of the tag has already been stored */
+}xml_frame_t;
+
+/**
+ * @brief State of the parse.
+ */
+typedef struct xml_filler_t
+{
+	const xml_binding_t * binding_t; /**< Binding of the first tag */
+	char                * object;    /**< Structure filled by the first tag */
+	xml_frame_t         * frames;    /**< Stack of open tags */
+	long                  depth;     /**< Number of open tags */
+	long                  capacity;  /**< Number of frames allocated */
+	bool                  done;      /**< The first tag has been closed */
+}xml_filler_t;
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+void libjxml_bind_init (xml_filler_t * filler_t, xml_handler_t * handler_t,
+						const xml_binding_t * binding_t, void * object);
+bool libjxml_bind_start (void * context, char * name, long length);
+bool libjxml_bind_attribute (void * context, char * name, long name_length, char * value, long value_length);
+bool libjxml_bind_text (void * context, char * text, long length);
+bool libjxml_bind_cdata (void * context, char * text, long length);
+bool libjxml_bind_value (xml_filler_t * filler_t, char * text, long length, bool decode);
+bool libjxml_bind_end (void * context, char * name, long length);
+xml_frame_t * libjxml_bind_push (xml_filler_t * filler_t);
+
+const xml_field_t * libjxml_bind_field (const xml_binding_t * binding_t, int place, char * name, long length);
+char * libjxml_bind_target (const xml_field_t * field_t, char * object);
+bool libjxml_bind_store (const xml_field_t * field_t, char * target, char * text, long length, bool decode);
+bool libjxml_bind_number (const xml_field_t * field_t, char * target, char * text, long length);
+void libjxml_bind_release (const xml_field_t * field_t, char * target);
+
+void libjxml_bind_write_struct (xml_sink_t * sink_t, const xml_binding_t * binding_t, char * object,
+								char * name, long name_length, long depth, bool compact);
+void libjxml_bind_write_field (xml_sink_t * sink_t, const xml_field_t * field_t, char * target,
+							   long depth, bool compact);
+bool libjxml_bind_write_value (xml_sink_t * sink_t, const xml_field_t * field_t, char * target, bool attribute);
+bool libjxml_bind_has_value (const xml_field_t * field_t, char * target);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+bool libjxml_bind_parse (const xml_binding_t * binding_t, void * object, char * xml_txt, long length)
+{
+	xml_filler_t filler_t;
+	xml_handler_t handler_t;
+	bool parsed;
+
+	libjxml_bind_init (&filler_t, &handler_t, binding_t, object);
+
+	parsed = libjxml_sax_buffer (xml_txt, length, &handler_t) && filler_t.done;
+
+	free (filler_t.frames);
+
+	if (parsed == false)
+		libjxml_bind_free (binding_t, object);
+
+	return parsed;
+}
+
+bool libjxml_bind_fd (const xml_binding_t * binding_t, void * object, int xml_fd)
+{
+	xml_filler_t filler_t;
+	xml_handler_t handler_t;
+	bool parsed;
+
+	libjxml_bind_init (&filler_t, &handler_t, binding_t, object);
+
+	parsed = libjxml_sax_fd (xml_fd, 0, &handler_t) && filler_t.done;
+
+	free (filler_t.frames);
+
+	if (parsed == false)
+		libjxml_bind_free (binding_t, object);
+
+	return parsed;
+}
+
+void libjxml_bind_to_sink (const xml_binding_t * binding_t, void * object, xml_sink_t * sink_t, int format)
+{
+	libjxml_sink_string (sink_t, "<?xml version=\"1.0\"?>");
+
+	libjxml_bind_write_struct (sink_t, binding_t, (char *) object, binding_t->name, binding_t->name_length,
+							   0, (format & LIBJXML_FORMAT_COMPACT) != 0);
+}
+
+char * libjxml_bind_to_txt (const xml_binding_t * binding_t, void * object, int format, long * length)
+{
+	xml_sink_t * sink_t;
+
+	sink_t = libjxml_sink_mem (LIBJXML_SINK_BUFFER);
+	libjxml_bind_to_sink (binding_t, object, sink_t, format);
+
+	return libjxml_sink_release (sink_t, length);
+}
+
+void libjxml_bind_free (const xml_binding_t * binding_t, void * object)
+{
+	const xml_field_t * field_t;
+	char * items;
+	long * count;
+	long index;
+
+	for (field_t = binding_t->fields; field_t < binding_t->fields + binding_t->count; field_t++)
+	{
+		if (field_t->count_offset < 0)
+		{
+			libjxml_bind_release (field_t, (char *) object + field_t->offset);
+			continue;
+		}
+
+		items = *(char **) ((char *) object + field_t->offset);
+		count = (long *) ((char *) object + field_t->count_offset);
+
+		for (index = 0; index < *count; index++)
+			libjxml_bind_release (field_t, items + index * field_t->size);
+
+		free (items);
+	}
+
+	memset (object, 0, binding_t->size);
+}
+
+/*********************************************************************************
+ *                                    PARSER
+ *********************************************************************************/
+
+void libjxml_bind_init (xml_filler_t * filler_t, xml_handler_t * handler_t,
+						const xml_binding_t * binding_t, void * object)
+{
+	memset (object, 0, binding_t->size);
+
+	filler_t->binding_t = binding_t;
+	filler_t->object = (char *) object;
+	filler_t->depth = 0;
+	filler_t->capacity = LIBJXML_BIND_DEPTH;
+	filler_t->done = false;
+
+	filler_t->frames = (xml_frame_t *) malloc (filler_t->capacity * sizeof (xml_frame_t));
+	LIBASSERT_PTR (filler_t->frames);
+
+	memset (handler_t, 0, sizeof (xml_handler_t));
+	handler_t->context = filler_t;
+	handler_t->start_tag = libjxml_bind_start;
+	handler_t->attribute = libjxml_bind_attribute;
+	handler_t->text = libjxml_bind_text;
+	handler_t->cdata = libjxml_bind_cdata;
+	handler_t->end_tag = libjxml_bind_end;
+}
+
+xml_frame_t * libjxml_bind_push (xml_filler_t * filler_t)
+{
+	xml_frame_t * frame_t;
+
+	if (filler_t->depth == filler_t->capacity)
+	{
+		filler_t->capacity *= 2;
+		filler_t->frames = (xml_frame_t *) realloc (filler_t->frames, filler_t->capacity * sizeof (xml_frame_t));
+		LIBASSERT_PTR (filler_t->frames);
+	}
+
+	frame_t = &filler_t->frames [filler_t->depth++];
+
+	frame_t->binding_t = NULL;
+	frame_t->field_t = NULL;
+	frame_t->object = NULL;
+	frame_t->filled = false;
+
+	return frame_t;
+}
+
+bool libjxml_bind_start (void * context, char * name, long length)
+{
+	xml_filler_t * filler_t = (xml_filler_t *) context;
+	const xml_field_t * field_t;
+	xml_frame_t * parent_t;
+	xml_frame_t * frame_t;
+	char * target;
+
+	if (filler_t->depth == 0)
+	{
+		if (filler_t->done == true)
+		{
+			fprintf (stderr, "\nLibXML: Error binding tag %.*s, more than one root", (int) length, name);
+			return false;
+		}
+
+		if ((length != filler_t->binding_t->name_length) || (memcmp (name, filler_t->binding_t->name, length) != 0))
+		{
+			fprintf (stderr, "\nLibXML: Error binding tag %.*s to %s", (int) length, name, filler_t->binding_t->name);
+			return false;
+		}
+
+		frame_t = libjxml_bind_push (filler_t);
+		frame_t->binding_t = filler_t->binding_t;
+		frame_t->object = filler_t->object;
+		return true;
+	}
+
+	parent_t = &filler_t->frames [filler_t->depth - 1];
+
+	/* Tags without a field, and everything nested in them, are skipped */
+	field_t = NULL;
+	if (parent_t->binding_t != NULL)
+		field_t = libjxml_bind_field (parent_t->binding_t, LIBJXML_PLACE_ELEMENT, name, length);
+
+	frame_t = libjxml_bind_push (filler_t);
+	if (field_t == NULL)
+		return true;
+
+	/* The parent frame may have moved with the stack */
+	parent_t = &filler_t->frames [filler_t->depth - 2];
+	target = libjxml_bind_target (field_t, parent_t->object);
+
+	if (field_t->kind == LIBJXML_BIND_STRUCT)
+		frame_t->binding_t = field_t->binding_t;
+	else
+		frame_t->field_t = field_t;
+
+	frame_t->object = target;
+
+	return true;
+}
+
+bool libjxml_bind_attribute (void * context, char * name, long name_length, char * value, long value_length)
+{
+	xml_filler_t * filler_t = (xml_filler_t *) context;
+	xml_frame_t * frame_t = &filler_t->frames [filler_t->depth - 1];
+	const xml_field_t * field_t;
+
+	if (frame_t->binding_t == NULL)
+		return true;
+
+	field_t = libjxml_bind_field (frame_t->binding_t, LIBJXML_PLACE_ATTRIBUTE, name, name_length);
+	if (field_t == NULL)
+		return true;
+
+	return libjxml_bind_store (field_t, frame_t->object + field_t->offset, value, value_length, true);
+}
+
+bool libjxml_bind_text (void * context, char * text, long length)
+{
+	return libjxml_bind_value ((xml_filler_t *) context, text, length, true);
+}
+
+bool libjxml_bind_cdata (void * context, char * text, long length)
+{
+	return libjxml_bind_value ((xml_filler_t *) context, text, length, false);
+}
+
+bool libjxml_bind_value (xml_filler_t * filler_t, char * text, long length, bool decode)
+{
+	xml_frame_t * frame_t = &filler_t->frames [filler_t->depth - 1];
+	const xml_field_t * field_t;
+	char * target;
+	long index;
+
+	if (frame_t->filled == true)
+		return true;
+
+	/* Same as the tree, the value is the first text that is not blank */
+	for (index = 0; index < length; index++)
+		if (!LIBJXML_IS_SPACE (text [index]))
+			break;
+
+	if (index == length)
+		return true;
+
+	if (frame_t->field_t != NULL)
+	{
+		field_t = frame_t->field_t;
+		target = frame_t->object;
+	}
+	else if (frame_t->binding_t != NULL)
+	{
+		field_t = libjxml_bind_field (frame_t->binding_t, LIBJXML_PLACE_VALUE, NULL, 0);
+		if (field_t == NULL)
+			return true;
+
+		target = frame_t->object + field_t->offset;
+	}
+	else
+		return true;
+
+	frame_t->filled = true;
+
+	return libjxml_bind_store (field_t, target, text, length, decode);
+}
+
+bool libjxml_bind_end (void * context, char * name, long length)
+{
+	xml_filler_t * filler_t = (xml_filler_t *) context;
+	xml_frame_t * frame_t = &filler_t->frames [filler_t->depth - 1];
+
+	/* Texts can be empty, numbers can not */
+	if ((frame_t->field_t != NULL) && (frame_t->filled == false) &&
+		(frame_t->field_t->kind != LIBJXML_BIND_STRING) && (frame_t->field_t->kind != LIBJXML_BIND_TEXT))
+	{
+		fprintf (stderr, "\nLibXML: Error binding %.*s, empty value", (int) length, name);
+		return false;
+	}
+
+	filler_t->depth--;
+
+	if (filler_t->depth == 0)
+		filler_t->done = true;
+
+	return true;
+}
+
+/*********************************************************************************
+ *                                    FIELDS
+ *********************************************************************************/
+
+const xml_field_t * libjxml_bind_field (const xml_binding_t * binding_t, int place, char * name, long length)
+{
+	const xml_field_t * field_t;
+
+	for (field_t = binding_t->fields; field_t < binding_t->fields + binding_t->count; field_t++)
+	{
+		if (field_t->place != place)
+			continue;
+
+		if (place == LIBJXML_PLACE_VALUE)
+			return field_t;
+
+		if ((field_t->name_length == length) && (memcmp (field_t->name, name, length) == 0))
+			return field_t;
+	}
+
+	return NULL;
+}
+
+/*
+ * Returns the address filled by a field of a structure: the field itself, or a
+ * new item at the end of its array.
+ */
+char * libjxml_bind_target (const xml_field_t * field_t, char * object)
+{
+	char ** items;
+	long * count;
+	char * item;
+
+	if (field_t->count_offset < 0)
+		return object + field_t->offset;
+
+	items = (char **) (object + field_t->offset);
+	count = (long *) (object + field_t->count_offset);
+
+	/* The capacity is the next power of two of the count, so it is full on each power of two */
+	if ((*count & (*count - 1)) == 0)
+	{
+		*items = (char *) realloc (*items, (*count == 0 ? 1 : *count * 2) * field_t->size);
+		LIBASSERT_PTR (*items);
+	}
+
+	item = *items + (*count)++ * field_t->size;
+	memset (item, 0, field_t->size);
+
+	return item;
+}
+
+/*
+ * Strings are decoded once copied, as the decoded text is never longer. Texts
+ * may be shorter than the value, so they are decoded before being cut.
+ */
+bool libjxml_bind_store (const xml_field_t * field_t, char * target, char * text, long length, bool decode)
+{
+	char ** string;
+	char * decoded;
+	long size;
+
+	switch (field_t->kind)
+	{
+		case LIBJXML_BIND_STRING:
+			string = (char **) target;
+			free (*string);
+
+			*string = (char *) malloc (length + 1);
+			LIBASSERT_PTR (*string);
+
+			memcpy (*string, text, length);
+			if (decode == true)
+				length = libjxml_entity_decode (*string, *string, length);
+			(*string) [length] = '\0';
+			return true;
+
+		case LIBJXML_BIND_TEXT:
+			decoded = NULL;
+			if ((decode == true) && (libjxml_entity_find (text, length) < length))
+			{
+				decoded = (char *) malloc (length);
+				LIBASSERT_PTR (decoded);
+
+				length = libjxml_entity_decode (decoded, text, length);
+				text = decoded;
+			}
+
+			size = (length < field_t->size) ? length : field_t->size - 1;
+			memcpy (target, text, size);
+			target [size] = '\0';
+
+			free (decoded);
+			return true;
+
+		case LIBJXML_BIND_STRUCT:
+			fprintf (stderr, "\nLibXML: Error binding value %.*s to a structure", (int) field_t->name_length, field_t->name);
+			return false;
+
+		default:
+			return libjxml_bind_number (field_t, target, text, length);
+	}
+}
+
+/*
+ * Converts a number through a buffer on the stack, as the text is not null
+ * ended. Blanks around the number are allowed.
+ */
+bool libjxml_bind_number (const xml_field_t * field_t, char * target, char * text, long length)
+{
+	char buffer [LIBJXML_BIND_NUMBER];
+	char * end;
+	long number = 0;
+	double real = 0;
+
+	while ((length > 0) && LIBJXML_IS_SPACE (text [0]))
+	{
+		text++;
+		length--;
+	}
+
+	while ((length > 0) && LIBJXML_IS_SPACE (text [length - 1]))
+		length--;
+
+	if ((length == 0) || (length >= LIBJXML_BIND_NUMBER))
+	{
+		fprintf (stderr, "\nLibXML: Error binding %.*s, invalid value %.*s",
+				(int) field_t->name_length, field_t->name, (int) length, text);
+		return false;
+	}
+
+	memcpy (buffer, text, length);
+	buffer [length] = '\0';
+	errno = 0;
+
+	switch (field_t->kind)
+	{
+		case LIBJXML_BIND_BOOL:
+			if ((strcmp (buffer, "true") == 0) || (strcmp (buffer, "1") == 0))
+				number = 1;
+			else if ((strcmp (buffer, "false") != 0) && (strcmp (buffer, "0") != 0))
+				errno = EINVAL;
+			end = buffer + length;
+			break;
+
+		case LIBJXML_BIND_DOUBLE:
+			real = strtod (buffer, &end);
+			break;
+
+		default:
+			number = strtol (buffer, &end, 10);
+			break;
+	}
+
+	if ((errno != 0) || (end != buffer + length) ||
+		((field_t->kind == LIBJXML_BIND_INT) && ((number < INT_MIN) || (number > INT_MAX))))
+	{
+		fprintf (stderr, "\nLibXML: Error binding %.*s, invalid value %s",
+				(int) field_t->name_length, field_t->name, buffer);
+		return false;
+	}
+
+	switch (field_t->kind)
+	{
+		case LIBJXML_BIND_INT:
+			*(int *) target = (int) number;
+			break;
+
+		case LIBJXML_BIND_LONG:
+			*(long *) target = number;
+			break;
+
+		case LIBJXML_BIND_BOOL:
+			*(bool *) target = (number != 0);
+			break;
+
+		default:
+			*(double *) target = real;
+			break;
+	}
+
+	return true;
+}
+
+void libjxml_bind_release (const xml_field_t * field_t, char * target)
+{
+	if (field_t->kind == LIBJXML_BIND_STRING)
+		free (*(char **) target);
+	else if (field_t->kind == LIBJXML_BIND_STRUCT)
+		libjxml_bind_free (field_t->binding_t, target);
+}
+
+/*********************************************************************************
+ *                                    WRITER
+ *********************************************************************************/
+
+/*
+ * Writes a structure as a tag: the attribute fields in the open tag, and then
+ * either its value field or its element fields as nested tags, as a tag has
+ * never both.
+ */
+void libjxml_bind_write_struct (xml_sink_t * sink_t, const xml_binding_t * binding_t, char * object,
+								char * name, long name_length, long depth, bool compact)
+{
+	const xml_field_t * field_t;
+	const xml_field_t * value_t = NULL;
+	bool nested = false;
+	char ** items;
+	long * count;
+	long index;
+
+	if (compact == false)
+	{
+		libjxml_sink_write (sink_t, "\n", 1);
+		libjxml_sink_fill (sink_t, '\t', depth);
+	}
+
+	libjxml_sink_write (sink_t, "<", 1);
+	libjxml_sink_write (sink_t, name, name_length);
+
+	for (field_t = binding_t->fields; field_t < binding_t->fields + binding_t->count; field_t++)
+	{
+		if (field_t->place == LIBJXML_PLACE_VALUE)
+		{
+			if (libjxml_bind_has_value (field_t, object + field_t->offset))
+				value_t = field_t;
+			continue;
+		}
+
+		if (field_t->place == LIBJXML_PLACE_ELEMENT)
+		{
+			if ((field_t->count_offset < 0) || (*(long *) (object + field_t->count_offset) > 0))
+				nested = true;
+			continue;
+		}
+
+		if (libjxml_bind_has_value (field_t, object + field_t->offset) == false)
+			continue;
+
+		libjxml_sink_write (sink_t, " ", 1);
+		libjxml_sink_write (sink_t, field_t->name, field_t->name_length);
+		libjxml_sink_write (sink_t, "=\"", 2);
+		libjxml_bind_write_value (sink_t, field_t, object + field_t->offset, true);
+		libjxml_sink_write (sink_t, "\"", 1);
+	}
+
+	if (value_t != NULL)
+	{
+		libjxml_sink_write (sink_t, ">", 1);
+		libjxml_bind_write_value (sink_t, value_t, object + value_t->offset, false);
+	}
+	else if (nested == true)
+	{
+		libjxml_sink_write (sink_t, ">", 1);
+
+		for (field_t = binding_t->fields; field_t < binding_t->fields + binding_t->count; field_t++)
+		{
+			if (field_t->place != LIBJXML_PLACE_ELEMENT)
+				continue;
+
+			if (field_t->count_offset < 0)
+			{
+				libjxml_bind_write_field (sink_t, field_t, object + field_t->offset, depth + 1, compact);
+				continue;
+			}
+
+			items = (char **) (object + field_t->offset);
+			count = (long *) (object + field_t->count_offset);
+
+			for (index = 0; index < *count; index++)
+				libjxml_bind_write_field (sink_t, field_t, *items + index * field_t->size, depth + 1, compact);
+		}
+
+		if (compact == false)
+		{
+			libjxml_sink_write (sink_t, "\n", 1);
+			libjxml_sink_fill (sink_t, '\t', depth);
+		}
+	}
+	else
+	{
+		libjxml_sink_write (sink_t, "/>", 2);
+		return;
+	}
+
+	libjxml_sink_write (sink_t, "</", 2);
+	libjxml_sink_write (sink_t, name, name_length);
+	libjxml_sink_write (sink_t, ">", 1);
+}
+
+void libjxml_bind_write_field (xml_sink_t * sink_t, const xml_field_t * field_t, char * target,
+							   long depth, bool compact)
+{
+	if (field_t->kind == LIBJXML_BIND_STRUCT)
+	{
+		libjxml_bind_write_struct (sink_t, field_t->binding_t, target, field_t->name, field_t->name_length,
+								   depth, compact);
+		return;
+	}
+
+	if (libjxml_bind_has_value (field_t, target) == false)
+		return;
+
+	if (compact == false)
+	{
+		libjxml_sink_write (sink_t, "\n", 1);
+		libjxml_sink_fill (sink_t, '\t', depth);
+	}
+
+	libjxml_sink_write (sink_t, "<", 1);
+	libjxml_sink_write (sink_t, field_t->name, field_t->name_length);
+	libjxml_sink_write (sink_t, ">", 1);
+
+	libjxml_bind_write_value (sink_t, field_t, target, false);
+
+	libjxml_sink_write (sink_t, "</", 2);
+	libjxml_sink_write (sink_t, field_t->name, field_t->name_length);
+	libjxml_sink_write (sink_t, ">", 1);
+}
+
+bool libjxml_bind_write_value (xml_sink_t * sink_t, const xml_field_t * field_t, char * target, bool attribute)
+{
+	char buffer [LIBJXML_BIND_NUMBER];
+	int length;
+
+	switch (field_t->kind)
+	{
+		case LIBJXML_BIND_INT:
+			length = snprintf (buffer, sizeof (buffer), "%d", *(int *) target);
+			break;
+
+		case LIBJXML_BIND_LONG:
+			length = snprintf (buffer, sizeof (buffer), "%ld", *(long *) target);
+			break;
+
+		case LIBJXML_BIND_DOUBLE:
+			length = snprintf (buffer, sizeof (buffer), "%.17g", *(double *) target);
+			break;
+
+		case LIBJXML_BIND_BOOL:
+			libjxml_sink_string (sink_t, *(bool *) target ? "true" : "false");
+			return true;
+
+		case LIBJXML_BIND_STRING:
+			libjxml_sink_escape (sink_t, *(char **) target, strlen (*(char **) target), attribute);
+			return true;
+
+		case LIBJXML_BIND_TEXT:
+			libjxml_sink_escape (sink_t, target, strlen (target), attribute);
+			return true;
+
+		default:
+			return false;
+	}
+
+	libjxml_sink_write (sink_t, buffer, length);
+
+	return true;
+}
+
+/*
+ * Strings set to NULL and empty texts are not written, as they would be read
+ * back the same way.
+ */
+bool libjxml_bind_has_value (const xml_field_t * field_t, char * target)
+{
+	if (field_t->kind == LIBJXML_BIND_STRING)
+		return *(char **) target != NULL;
+
+	if (field_t->kind == LIBJXML_BIND_TEXT)
+		return target [0] != '\0';
+
+	return true;
+}
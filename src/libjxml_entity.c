@@ -0,0 +1,463 @@
+/**
+ * @file libjxml_entity.c
+ *
+ * @brief Decoding and escaping of the entities of xml text.
+ *
+ * The next special character is looked for comparing 16 bytes at once with
+ * SSE2, which every x86-64 processor has, so no dispatch is needed. Most values
+ * are shorter than 16 bytes, so they are read in words of 8 bytes instead, with
+ * the bytes of each word compared at once with integer operations. The last
+ * block or word of a text is read ending at its last byte, overlapping the bytes
+ * already read, so no byte is left to be read alone.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "libjxml_entity.h"
+
+#if defined (__SSE2__)
+#define LIBJXML_ENTITY_SSE2
+#include <emmintrin.h>
+#endif
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_ENTITY_DIGITS 8  /**< Longest number of a character reference, leading zeros included */
+#define LIBJXML_ENTITY_LONG   64 /**< Length from which memchr() is faster looking for '&' */
+
+#define LIBJXML_ENTITY_ONES  0x0101010101010101ULL /**< Byte 1 in every byte of a word */
+#define LIBJXML_ENTITY_HIGHS 0x8080808080808080ULL /**< High bit of every byte of a word */
+
+/* High bit set in the first byte of the word equal to c, and maybe in later bytes */
+#define LIBJXML_ENTITY_BYTE(word, c) ((((word) ^ (LIBJXML_ENTITY_ONES * (c))) - LIBJXML_ENTITY_ONES) & \
+									  ~((word) ^ (LIBJXML_ENTITY_ONES * (c))) & LIBJXML_ENTITY_HIGHS)
+
+/* Characters looked for: the four of a set, repeated when the set has less */
+static const char libjxml_entity_reference_set [4] = {'&', '&', '&', '&'};
+static const char libjxml_entity_text_set [4] = {'&', '<', '>', '&'};
+static const char libjxml_entity_attribute_set [4] = {'&', '<', '>', '"'};
+
+static const char * libjxml_entity_escaped [256] =
+{
+	['&'] = "&amp;",
+	['<'] = "&lt;",
+	['>'] = "&gt;",
+	['"'] = "&quot;",
+};
+
+static const char libjxml_entity_lengths [256] =
+{
+	['&'] = 5,
+	['<'] = 4,
+	['>'] = 4,
+	['"'] = 6,
+	['\''] = 6,
+};
+
+/* The predefined entities, &apos; is decoded but never written */
+static const char * libjxml_entity_names [] = {"&amp;", "&lt;", "&gt;", "&quot;", "&apos;", NULL};
+static const char libjxml_entity_codes [] = {'&', '<', '>', '"', '\''};
+
+/*********************************************************************************
+ *                                 DECLARATIONS
+ *********************************************************************************/
+
+long libjxml_entity_search (const char * text, long length, const char * set);
+long libjxml_entity_words (const char * text, long length, const char * set);
+bool libjxml_entity_short (const char * text, long length, const char * set);
+uint64_t libjxml_entity_word (const char * text, const char * set);
+uint64_t libjxml_entity_match (uint64_t word, const char * set);
+
+#ifdef LIBJXML_ENTITY_SSE2
+long libjxml_entity_blocks (const char * text, long length, const char * set);
+int libjxml_entity_block (const char * text, const char * set);
+#endif
+
+long libjxml_entity_reference (const char * text, long length, char * utf8, long * written);
+long libjxml_entity_number (const char * text, long length, long * code);
+long libjxml_entity_utf8 (long code, char * utf8);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+long libjxml_entity_clean (const char * text, long length, bool attribute)
+{
+	if (attribute == true)
+		return libjxml_entity_search (text, length, libjxml_entity_attribute_set);
+
+	return libjxml_entity_search (text, length, libjxml_entity_text_set);
+}
+
+long libjxml_entity_find (const char * text, long length)
+{
+	const char * found;
+
+	if (length < LIBJXML_ENTITY_LONG)
+		return libjxml_entity_search (text, length, libjxml_entity_reference_set);
+
+	found = (const char *) memchr (text, '&', length);
+
+	return (found != NULL) ? found - text : length;
+}
+
+long libjxml_entity_length (const char * text, long length, bool attribute)
+{
+	long escaped = length;
+	long index = 0;
+
+	while (1)
+	{
+		index = index + libjxml_entity_clean (text + index, length - index, attribute);
+		if (index == length)
+			break;
+
+		escaped = escaped + libjxml_entity_lengths [(unsigned char) text [index]] - 1;
+		index++;
+	}
+
+	return escaped;
+}
+
+char * libjxml_entity_escape (char * target, const char * text, long length, bool attribute)
+{
+	unsigned char c;
+	long index = 0;
+	long clean;
+
+	while (1)
+	{
+		clean = libjxml_entity_clean (text + index, length - index, attribute);
+		memcpy (target, text + index, clean);
+		target = target + clean;
+		index = index + clean;
+
+		if (index == length)
+			break;
+
+		c = (unsigned char) text [index];
+		memcpy (target, libjxml_entity_escaped [c], libjxml_entity_lengths [c]);
+		target = target + libjxml_entity_lengths [c];
+		index++;
+	}
+
+	return target;
+}
+
+long libjxml_entity_decode (char * target, const char * text, long length)
+{
+	char utf8 [4];
+	long decoded = 0;
+	long index = 0;
+	long written;
+	long clean;
+	long used;
+
+	while (index < length)
+	{
+		clean = libjxml_entity_find (text + index, length - index);
+
+		/* Decoding in place, the text is only moved once something has been decoded */
+		if (target + decoded != text + index)
+			memmove (target + decoded, text + index, clean);
+
+		decoded = decoded + clean;
+		index = index + clean;
+
+		if (index == length)
+			break;
+
+		used = libjxml_entity_reference (text + index, length - index, utf8, &written);
+
+		if (used == 0)
+		{
+			target [decoded++] = '&';
+			index++;
+			continue;
+		}
+
+		memcpy (target + decoded, utf8, written);
+		decoded = decoded + written;
+		index = index + used;
+	}
+
+	return decoded;
+}
+
+/*********************************************************************************
+ *                                    SEARCH
+ *********************************************************************************/
+
+/*
+ * Returns the position of the first character of the set in the text, or the
+ * length of the text if there is none.
+ */
+long libjxml_entity_search (const char * text, long length, const char * set)
+{
+	long index;
+
+#ifdef LIBJXML_ENTITY_SSE2
+	if (length >= 16)
+		return libjxml_entity_blocks (text, length, set);
+#endif
+
+	if (length >= 8)
+		return libjxml_entity_words (text, length, set);
+
+	if (libjxml_entity_short (text, length, set) == false)
+		return length;
+
+	for (index = 0; index < length; index++)
+		if ((text [index] == set [0]) || (text [index] == set [1]) ||
+			(text [index] == set [2]) || (text [index] == set [3]))
+			break;
+
+	return index;
+}
+
+/*
+ * Searches texts of at least 8 bytes. The last word may start before the end of
+ * the previous one, whose bytes are known not to be in the set.
+ */
+long libjxml_entity_words (const char * text, long length, const char * set)
+{
+	uint64_t found;
+	long index = 0;
+
+	while (1)
+	{
+		if (index + 8 > length)
+			index = length - 8;
+
+		found = libjxml_entity_word (text + index, set);
+		if (found != 0)
+			return index + __builtin_ctzll (found) / 8;
+
+		index = index + 8;
+		if (index == length)
+			return length;
+	}
+}
+
+/*
+ * Tells whether a text shorter than 8 bytes has any character of the set,
+ * without a loop: its bytes are gathered in a word with two 4 byte reads that
+ * may overlap, or one by one when it is shorter, and the word is checked at once.
+ */
+bool libjxml_entity_short (const char * text, long length, const char * set)
+{
+	uint32_t first;
+	uint32_t last;
+	uint64_t word;
+
+	if (length >= 4)
+	{
+		memcpy (&first, text, 4);
+		memcpy (&last, text + length - 4, 4);
+		word = first | ((uint64_t) last << 32);
+	}
+	else if (length > 0)
+	{
+		/* The bytes left at 0 are never in the set */
+		word = (unsigned char) text [0] | ((unsigned char) text [length / 2] << 8) |
+			   ((unsigned char) text [length - 1] << 16);
+	}
+	else
+		return false;
+
+	return libjxml_entity_match (word, set) != 0;
+}
+
+/*
+ * Returns the high bits of the bytes of the word, read in little endian order,
+ * that may be in the set. The first bit set is always exact.
+ */
+uint64_t libjxml_entity_word (const char * text, const char * set)
+{
+	uint64_t word;
+
+	memcpy (&word, text, 8);
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	word = __builtin_bswap64 (word);
+#endif
+
+	return libjxml_entity_match (word, set);
+}
+
+uint64_t libjxml_entity_match (uint64_t word, const char * set)
+{
+	return LIBJXML_ENTITY_BYTE (word, (unsigned char) set [0]) | LIBJXML_ENTITY_BYTE (word, (unsigned char) set [1]) |
+		   LIBJXML_ENTITY_BYTE (word, (unsigned char) set [2]) | LIBJXML_ENTITY_BYTE (word, (unsigned char) set [3]);
+}
+
+#ifdef LIBJXML_ENTITY_SSE2
+
+/*
+ * Searches texts of at least 16 bytes, in blocks of 16 bytes, the last one
+ * ending at the end of the text.
+ */
+long libjxml_entity_blocks (const char * text, long length, const char * set)
+{
+	long index = 0;
+	int found;
+
+	while (1)
+	{
+		if (index + 16 > length)
+			index = length - 16;
+
+		found = libjxml_entity_block (text + index, set);
+		if (found != 0)
+			return index + __builtin_ctz (found);
+
+		index = index + 16;
+		if (index == length)
+			return length;
+	}
+}
+
+int libjxml_entity_block (const char * text, const char * set)
+{
+	__m128i c;
+	__m128i found;
+
+	c = _mm_loadu_si128 ((const __m128i *) text);
+
+	found = _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (c, _mm_set1_epi8 (set [0])),
+										_mm_cmpeq_epi8 (c, _mm_set1_epi8 (set [1]))),
+						  _mm_or_si128 (_mm_cmpeq_epi8 (c, _mm_set1_epi8 (set [2])),
+										_mm_cmpeq_epi8 (c, _mm_set1_epi8 (set [3]))));
+
+	return _mm_movemask_epi8 (found);
+}
+
+#endif
+
+/*********************************************************************************
+ *                                   DECODING
+ *********************************************************************************/
+
+/*
+ * Decodes the entity or character reference starting the text, returning its
+ * length, or 0 if it is not a valid one.
+ */
+long libjxml_entity_reference (const char * text, long length, char * utf8, long * written)
+{
+	long code = 0;
+	long used = 0;
+	long size;
+	int i;
+
+	if ((length >= 2) && (text [1] == '#'))
+		used = libjxml_entity_number (text, length, &code);
+
+	for (i = 0; (used == 0) && (libjxml_entity_names [i] != NULL); i++)
+	{
+		size = libjxml_entity_lengths [(unsigned char) libjxml_entity_codes [i]];
+
+		if ((length >= size) && (memcmp (text, libjxml_entity_names [i], size) == 0))
+		{
+			code = libjxml_entity_codes [i];
+			used = size;
+		}
+	}
+
+	if (used == 0)
+		return 0;
+
+	*written = libjxml_entity_utf8 (code, utf8);
+
+	return (*written > 0) ? used : 0;
+}
+
+/*
+ * Reads the number of a reference &#NNN; or &#xHHH;, returning the length of
+ * the reference, or 0 if it is not well written.
+ */
+long libjxml_entity_number (const char * text, long length, long * code)
+{
+	long index = 2;
+	long start;
+	int base = 10;
+	int digit;
+	char c;
+
+	if ((index < length) && (text [index] == 'x'))
+	{
+		base = 16;
+		index++;
+	}
+
+	start = index;
+	*code = 0;
+
+	while ((index < length) && (text [index] != ';'))
+	{
+		c = text [index];
+
+		if ((c >= '0') && (c <= '9'))
+			digit = c - '0';
+		else if ((base == 16) && (c >= 'a') && (c <= 'f'))
+			digit = c - 'a' + 10;
+		else if ((base == 16) && (c >= 'A') && (c <= 'F'))
+			digit = c - 'A' + 10;
+		else
+			return 0;
+
+		if (index - start == LIBJXML_ENTITY_DIGITS)
+			return 0;
+
+		*code = *code * base + digit;
+		index++;
+	}
+
+	if ((index == length) || (index == start))
+		return 0;
+
+	return index + 1;
+}
+
+/*
+ * Writes a character as UTF-8, returning its length, or 0 if the character is
+ * not allowed in xml text.
+ */
+long libjxml_entity_utf8 (long code, char * utf8)
+{
+	if ((code <= 0) || (code > 0x10FFFF) || ((code >= 0xD800) && (code <= 0xDFFF)))
+		return 0;
+
+	if (code < 0x80)
+	{
+		utf8 [0] = (char) code;
+		return 1;
+	}
+
+	if (code < 0x800)
+	{
+		utf8 [0] = (char) (0xC0 | (code >> 6));
+		utf8 [1] = (char) (0x80 | (code & 0x3F));
+		return 2;
+	}
+
+	if (code < 0x10000)
+	{
+		utf8 [0] = (char) (0xE0 | (code >> 12));
+		utf8 [1] = (char) (0x80 | ((code >> 6) & 0x3F));
+		utf8 [2] = (char) (0x80 | (code & 0x3F));
+		return 3;
+	}
+
+	utf8 [0] = (char) (0xF0 | (code >> 18));
+	utf8 [1] = (char) (0x80 | ((code >> 12) & 0x3F));
+	utf8 [2] = (char) (0x80 | ((code >> 6) & 0x3F));
+	utf8 [3] = (char) (0x80 | (code & 0x3F));
+	return 4;
+}
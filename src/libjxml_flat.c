@@ -0,0 +1,646 @@
+/**
+ * @file libjxml_flat.c
+ *
+ * @brief Compact storage of xml documents in arrays.
+ *
+ * The tags of a document are stored in document order in a few arrays, one for
+ * each field, instead of a tree of structs linked by pointers. The nested tags of
+ * a tag follow it, so walking the whole document is a loop over the arrays, and
+ * links between tags are 32 bit indexes. Names are kept as ids of a table of
+ * names and values are gathered in a single text.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "libjxml_flat.h"
+#include "libjxml_entity.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+/**
+ * @brief State of the writer of a flat document.
+ */
+typedef struct xml_flat_writer_t
+{
+	xml_sink_t * sink_t;  /**< Sink receiving the text */
+	xml_flat_t * flat_t;  /**< Document being written */
+	char      ** names;   /**< Names by id, copied from the table to save the calls */
+	long       * lengths; /**< Length of the names by id */
+	bool         compact; /**< No line breaks nor indentation between tags */
+}xml_flat_writer_t;
+
+/*********************************************************************************
+ *                                 DECLARATIONS
+ *********************************************************************************/
+
+xml_flat_t * libjxml_flat_create (long tags, long attributes, long text_length);
+long libjxml_flat_store (xml_flat_t * flat_t, char * value, long length);
+void libjxml_flat_attributes (xml_flat_t * flat_t, xml_attribute_t * attribute_t);
+xml_attribute_t * libjxml_flat_link_attributes (xml_t * xml_mem_t, xml_flat_t * flat_t, long first, long last);
+
+char * libjxml_flat_room (xml_flat_writer_t * writer_t, long length);
+void libjxml_flat_commit (xml_flat_writer_t * writer_t, char * text, long length);
+long libjxml_flat_attributes_length (xml_flat_writer_t * writer_t, long first, long last);
+char * libjxml_flat_write_attributes (xml_flat_writer_t * writer_t, char * text, long first, long last);
+void libjxml_flat_write_open (xml_flat_writer_t * writer_t, long tag, long depth);
+void libjxml_flat_write_close (xml_flat_writer_t * writer_t, long tag, long depth);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/*
+ * The tree is walked twice: first to size the arrays and the text, so each one
+ * is allocated once, and then to fill them. Tags get their index when entered
+ * and their end when left.
+ */
+xml_flat_t * libjxml_mem_to_flat (xml_t * xml_mem_t)
+{
+	xml_iterator_t iterator_t;
+	xml_attribute_t * attribute_t;
+	xml_flat_t * flat_t;
+	xml_tag_t * tag_t;
+	long tags = 0;
+	long attributes = 0;
+	long text_length = 0;
+	long current = LIBJXML_FLAT_NONE;
+	long tag;
+
+	for (attribute_t = xml_mem_t->instruction_t; attribute_t != NULL; attribute_t = attribute_t->next_attribute_t)
+	{
+		attributes++;
+		text_length = text_length + attribute_t->value_length + 1;
+	}
+
+	libjxml_iterator_xml (&iterator_t, xml_mem_t, LIBJXML_WALK_PRE);
+
+	while ((tag_t = libjxml_iterator_next (&iterator_t)) != NULL)
+	{
+		tags++;
+
+		if (tag_t->value != NULL)
+			text_length = text_length + tag_t->value_length + 1;
+
+		for (attribute_t = tag_t->attribute_t; attribute_t != NULL; attribute_t = attribute_t->next_attribute_t)
+		{
+			attributes++;
+			text_length = text_length + attribute_t->value_length + 1;
+		}
+	}
+
+	libjxml_iterator_free (&iterator_t);
+
+	if ((tags >= LIBJXML_FLAT_NONE) || (attributes >= LIBJXML_FLAT_NONE))
+	{
+		fprintf (stderr, "\nLibXML: Error too many nodes for a flat document");
+		return NULL;
+	}
+
+	flat_t = libjxml_flat_create (tags, attributes, text_length);
+	flat_t->names_t = libjxml_names_share (xml_mem_t->names_t);
+
+	libjxml_flat_attributes (flat_t, xml_mem_t->instruction_t);
+
+	libjxml_iterator_xml (&iterator_t, xml_mem_t, LIBJXML_WALK_PRE | LIBJXML_WALK_POST);
+
+	while ((tag_t = libjxml_iterator_next (&iterator_t)) != NULL)
+	{
+		if (iterator_t.leaving)
+		{
+			flat_t->end [current] = flat_t->tags;
+			current = flat_t->parent [current];
+			continue;
+		}
+
+		tag = flat_t->tags;
+		flat_t->tags++;
+
+		flat_t->name [tag] = libjxml_names_id (flat_t->names_t, tag_t->name, tag_t->name_length);
+		flat_t->parent [tag] = current;
+		flat_t->attribute [tag] = flat_t->attributes;
+		flat_t->value_length [tag] = tag_t->value_length;
+
+		if (tag_t->value != NULL)
+			flat_t->value [tag] = libjxml_flat_store (flat_t, tag_t->value, tag_t->value_length);
+		else
+			flat_t->value [tag] = -1;
+
+		libjxml_flat_attributes (flat_t, tag_t->attribute_t);
+
+		current = tag;
+	}
+
+	flat_t->attribute [flat_t->tags] = flat_t->attributes;
+
+	libjxml_iterator_free (&iterator_t);
+
+	return flat_t;
+}
+
+/*
+ * Tags are created in document order and linked once all of them exist, using
+ * the nested and sibling indexes.
+ */
+xml_t * libjxml_flat_to_mem (xml_flat_t * flat_t, int mode)
+{
+	xml_t * xml_mem_t;
+	xml_tag_t ** tags;
+	xml_tag_t * tag_t;
+	long sibling;
+	long tag;
+
+	xml_mem_t = libjxml_create_xml_names (mode & ~LIBJXML_MODE_INSITU, flat_t->names_t);
+
+	xml_mem_t->instruction_t = libjxml_flat_link_attributes (xml_mem_t, flat_t, 0, flat_t->attribute [0]);
+
+	if (flat_t->tags == 0)
+		return xml_mem_t;
+
+	tags = (xml_tag_t **) malloc (flat_t->tags * sizeof (xml_tag_t *));
+	LIBASSERT_PTR (tags);
+
+	for (tag = 0; tag < flat_t->tags; tag++)
+	{
+		tag_t = libjxml_new_tag (xml_mem_t);
+		tag_t->name = libjxml_flat_name (flat_t, tag, &tag_t->name_length);
+		tag_t->attribute_t = libjxml_flat_link_attributes (xml_mem_t, flat_t, flat_t->attribute [tag],
+														   flat_t->attribute [tag + 1]);
+
+		if (flat_t->value [tag] >= 0)
+		{
+			tag_t->value = libjxml_store_token (xml_mem_t, flat_t->text + flat_t->value [tag],
+												flat_t->value_length [tag]);
+			tag_t->value_length = flat_t->value_length [tag];
+		}
+
+		tags [tag] = tag_t;
+	}
+
+	for (tag = 0; tag < flat_t->tags; tag++)
+	{
+		if (flat_t->end [tag] > tag + 1)
+			tags [tag]->nested_tag_t = tags [tag + 1];
+
+		sibling = libjxml_flat_sibling (flat_t, tag);
+		if (sibling != LIBJXML_FLAT_NONE)
+			tags [tag]->sibling_tag_t = tags [sibling];
+	}
+
+	xml_mem_t->content_t = tags [0];
+
+	free (tags);
+
+	return xml_mem_t;
+}
+
+void libjxml_flat_free (xml_flat_t * flat_t)
+{
+	if (flat_t == NULL)
+		return;
+
+	if (flat_t->image != NULL)
+	{
+		munmap (flat_t->image, flat_t->image_length);
+		libjxml_names_free (flat_t->names_t);
+		free (flat_t);
+		return;
+	}
+
+	free (flat_t->name);
+	free (flat_t->parent);
+	free (flat_t->end);
+	free (flat_t->attribute);
+	free (flat_t->value);
+	free (flat_t->value_length);
+	free (flat_t->attribute_name);
+	free (flat_t->attribute_value);
+	free (flat_t->attribute_length);
+	free (flat_t->text);
+
+	if (flat_t->names_t != NULL)
+		libjxml_names_free (flat_t->names_t);
+
+	free (flat_t);
+}
+
+/*
+ * Tags are written in a single loop over the arrays. After a tag without nested
+ * tags, every ancestor ending with it is closed going up through the parents,
+ * so no stack is needed. Each tag is written at once, in room taken from the
+ * buffer of the sink for its whole length.
+ */
+void libjxml_flat_to_sink (xml_flat_t * flat_t, xml_sink_t * sink_t, int format)
+{
+	xml_flat_writer_t writer_t;
+	char * text;
+	long depth = 0;
+	long length;
+	long parent;
+	long next;
+	long tag;
+	long id;
+
+	writer_t.sink_t = sink_t;
+	writer_t.flat_t = flat_t;
+	writer_t.compact = (format & LIBJXML_FORMAT_COMPACT) != 0;
+
+	length = libjxml_names_count (flat_t->names_t);
+
+	writer_t.names = (char **) malloc ((length + 1) * sizeof (char *));
+	LIBASSERT_PTR (writer_t.names);
+
+	writer_t.lengths = (long *) malloc ((length + 1) * sizeof (long));
+	LIBASSERT_PTR (writer_t.lengths);
+
+	for (id = 0; id < length; id++)
+		writer_t.names [id] = libjxml_names_get (flat_t->names_t, id, &writer_t.lengths [id]);
+
+	length = 7 + libjxml_flat_attributes_length (&writer_t, 0, flat_t->attribute [0]);
+	text = libjxml_flat_room (&writer_t, length);
+	memcpy (text, "<?xml", 5);
+	libjxml_flat_write_attributes (&writer_t, text + 5, 0, flat_t->attribute [0]);
+	memcpy (text + length - 2, "?>", 2);
+	libjxml_flat_commit (&writer_t, text, length);
+
+	tag = 0;
+	while (tag < flat_t->tags)
+	{
+		libjxml_flat_write_open (&writer_t, tag, depth);
+
+		next = flat_t->end [tag];
+
+		if (next > tag + 1)
+		{
+			if (flat_t->value [tag] < 0)
+			{
+				depth++;
+				tag++;
+				continue;
+			}
+
+			/* A tag with value and nested tags is written without them, like the tree */
+			fprintf (stderr, "\nLibXML: Error writing tag with value and nested_tag");
+		}
+
+		libjxml_flat_write_close (&writer_t, tag, depth);
+
+		parent = flat_t->parent [tag];
+		while ((parent != LIBJXML_FLAT_NONE) && (flat_t->end [parent] == next))
+		{
+			depth--;
+			libjxml_flat_write_close (&writer_t, parent, depth);
+			parent = flat_t->parent [parent];
+		}
+
+		tag = next;
+	}
+
+	free (writer_t.names);
+	free (writer_t.lengths);
+}
+
+bool libjxml_flat_to_fd (xml_flat_t * flat_t, int xml_fd, int format)
+{
+	xml_sink_t * sink_t;
+
+	sink_t = libjxml_sink_fd (xml_fd, LIBJXML_SINK_BUFFER);
+	libjxml_flat_to_sink (flat_t, sink_t, format);
+
+	return libjxml_sink_close (sink_t);
+}
+
+char * libjxml_flat_to_txt (xml_flat_t * flat_t, int format, long * length)
+{
+	xml_sink_t * sink_t;
+
+	sink_t = libjxml_sink_mem (LIBJXML_SINK_BUFFER);
+	libjxml_flat_to_sink (flat_t, sink_t, format);
+
+	return libjxml_sink_release (sink_t, length);
+}
+
+/*********************************************************************************
+ *                                   ACCESSORS
+ *********************************************************************************/
+
+char * libjxml_flat_name (xml_flat_t * flat_t, long tag, long * length)
+{
+	return libjxml_names_get (flat_t->names_t, flat_t->name [tag], length);
+}
+
+char * libjxml_flat_value (xml_flat_t * flat_t, long tag, long * length)
+{
+	if (length != NULL)
+		*length = flat_t->value_length [tag];
+
+	if (flat_t->value [tag] < 0)
+		return NULL;
+
+	return flat_t->text + flat_t->value [tag];
+}
+
+long libjxml_flat_nested (xml_flat_t * flat_t, long tag)
+{
+	if (flat_t->end [tag] > tag + 1)
+		return tag + 1;
+
+	return LIBJXML_FLAT_NONE;
+}
+
+long libjxml_flat_sibling (xml_flat_t * flat_t, long tag)
+{
+	long parent = flat_t->parent [tag];
+	long last = flat_t->tags;
+
+	if (parent != LIBJXML_FLAT_NONE)
+		last = flat_t->end [parent];
+
+	if (flat_t->end [tag] < last)
+		return flat_t->end [tag];
+
+	return LIBJXML_FLAT_NONE;
+}
+
+char * libjxml_flat_attribute_name (xml_flat_t * flat_t, long attribute, long * length)
+{
+	return libjxml_names_get (flat_t->names_t, flat_t->attribute_name [attribute], length);
+}
+
+char * libjxml_flat_attribute_value (xml_flat_t * flat_t, long attribute, long * length)
+{
+	if (length != NULL)
+		*length = flat_t->attribute_length [attribute];
+
+	return flat_t->text + flat_t->attribute_value [attribute];
+}
+
+/*********************************************************************************
+ *                                    STORAGE
+ *********************************************************************************/
+
+xml_flat_t * libjxml_flat_create (long tags, long attributes, long text_length)
+{
+	xml_flat_t * flat_t;
+
+	flat_t = (xml_flat_t *) malloc (sizeof (xml_flat_t));
+	LIBASSERT_PTR (flat_t);
+
+	flat_t->name = (uint32_t *) malloc ((tags + 1) * sizeof (uint32_t));
+	LIBASSERT_PTR (flat_t->name);
+	flat_t->parent = (uint32_t *) malloc ((tags + 1) * sizeof (uint32_t));
+	LIBASSERT_PTR (flat_t->parent);
+	flat_t->end = (uint32_t *) malloc ((tags + 1) * sizeof (uint32_t));
+	LIBASSERT_PTR (flat_t->end);
+	flat_t->attribute = (uint32_t *) malloc ((tags + 1) * sizeof (uint32_t));
+	LIBASSERT_PTR (flat_t->attribute);
+	flat_t->value = (long *) malloc ((tags + 1) * sizeof (long));
+	LIBASSERT_PTR (flat_t->value);
+	flat_t->value_length = (uint32_t *) malloc ((tags + 1) * sizeof (uint32_t));
+	LIBASSERT_PTR (flat_t->value_length);
+
+	flat_t->attribute_name = (uint32_t *) malloc ((attributes + 1) * sizeof (uint32_t));
+	LIBASSERT_PTR (flat_t->attribute_name);
+	flat_t->attribute_value = (long *) malloc ((attributes + 1) * sizeof (long));
+	LIBASSERT_PTR (flat_t->attribute_value);
+	flat_t->attribute_length = (uint32_t *) malloc ((attributes + 1) * sizeof (uint32_t));
+	LIBASSERT_PTR (flat_t->attribute_length);
+
+	flat_t->text = (char *) malloc ((text_length + 1) * sizeof (char));
+	LIBASSERT_PTR (flat_t->text);
+
+	flat_t->tags = 0;
+	flat_t->attributes = 0;
+	flat_t->text_length = 0;
+	flat_t->names_t = NULL;
+	flat_t->image = NULL;
+	flat_t->image_length = 0;
+	flat_t->attribute [0] = 0;
+
+	return flat_t;
+}
+
+long libjxml_flat_store (xml_flat_t * flat_t, char * value, long length)
+{
+	long offset = flat_t->text_length;
+
+	memcpy (flat_t->text + offset, value, length);
+	flat_t->text [offset + length] = '\0';
+	flat_t->text_length = offset + length + 1;
+
+	return offset;
+}
+
+void libjxml_flat_attributes (xml_flat_t * flat_t, xml_attribute_t * attribute_t)
+{
+	long attribute;
+
+	while (attribute_t != NULL)
+	{
+		attribute = flat_t->attributes;
+		flat_t->attributes++;
+
+		flat_t->attribute_name [attribute] = libjxml_names_id (flat_t->names_t, attribute_t->name,
+															   attribute_t->name_length);
+		flat_t->attribute_value [attribute] = libjxml_flat_store (flat_t, attribute_t->value,
+																  attribute_t->value_length);
+		flat_t->attribute_length [attribute] = attribute_t->value_length;
+
+		attribute_t = attribute_t->next_attribute_t;
+	}
+}
+
+xml_attribute_t * libjxml_flat_link_attributes (xml_t * xml_mem_t, xml_flat_t * flat_t, long first, long last)
+{
+	xml_attribute_t * first_t = NULL;
+	xml_attribute_t * last_t = NULL;
+	xml_attribute_t * attribute_t;
+	long attribute;
+
+	for (attribute = first; attribute < last; attribute++)
+	{
+		attribute_t = libjxml_new_attribute (xml_mem_t);
+		attribute_t->name = libjxml_flat_attribute_name (flat_t, attribute, &attribute_t->name_length);
+		attribute_t->value = libjxml_store_token (xml_mem_t, flat_t->text + flat_t->attribute_value [attribute],
+												  flat_t->attribute_length [attribute]);
+		attribute_t->value_length = flat_t->attribute_length [attribute];
+
+		if (last_t == NULL)
+			first_t = attribute_t;
+		else
+			last_t->next_attribute_t = attribute_t;
+		last_t = attribute_t;
+	}
+
+	return first_t;
+}
+
+/*********************************************************************************
+ *                                    WRITER
+ *********************************************************************************/
+
+/*
+ * Returns room for a text of 'length' bytes, in the sink buffer when it fits or
+ * in memory of its own otherwise, to be passed to libjxml_flat_commit().
+ */
+char * libjxml_flat_room (xml_flat_writer_t * writer_t, long length)
+{
+	char * text;
+
+	text = libjxml_sink_reserve (writer_t->sink_t, length);
+	if (text != NULL)
+		return text;
+
+	text = (char *) malloc (length * sizeof (char));
+	LIBASSERT_PTR (text);
+
+	return text;
+}
+
+void libjxml_flat_commit (xml_flat_writer_t * writer_t, char * text, long length)
+{
+	xml_sink_t * sink_t = writer_t->sink_t;
+
+	if ((text >= sink_t->buffer) && (text < sink_t->buffer + sink_t->capacity))
+		return;
+
+	libjxml_sink_write (sink_t, text, length);
+	free (text);
+}
+
+long libjxml_flat_attributes_length (xml_flat_writer_t * writer_t, long first, long last)
+{
+	xml_flat_t * flat_t = writer_t->flat_t;
+	long length = 0;
+	long attribute;
+
+	for (attribute = first; attribute < last; attribute++)
+		length = length + 4 + writer_t->lengths [flat_t->attribute_name [attribute]] +
+				 libjxml_entity_length (flat_t->text + flat_t->attribute_value [attribute],
+										flat_t->attribute_length [attribute], true);
+
+	return length;
+}
+
+/*
+ * Writes the attributes from 'first' to 'last' - 1 in 'text', returning the end
+ * of the text written.
+ */
+char * libjxml_flat_write_attributes (xml_flat_writer_t * writer_t, char * text, long first, long last)
+{
+	xml_flat_t * flat_t = writer_t->flat_t;
+	uint32_t id;
+	long length;
+	long attribute;
+
+	for (attribute = first; attribute < last; attribute++)
+	{
+		id = flat_t->attribute_name [attribute];
+		length = flat_t->attribute_length [attribute];
+
+		*text++ = ' ';
+		memcpy (text, writer_t->names [id], writer_t->lengths [id]);
+		text = text + writer_t->lengths [id];
+		*text++ = '=';
+		*text++ = '"';
+		text = libjxml_entity_escape (text, flat_t->text + flat_t->attribute_value [attribute], length, true);
+		*text++ = '"';
+	}
+
+	return text;
+}
+
+void libjxml_flat_write_open (xml_flat_writer_t * writer_t, long tag, long depth)
+{
+	xml_flat_t * flat_t = writer_t->flat_t;
+	bool nested = flat_t->end [tag] > tag + 1;
+	bool value = (flat_t->value [tag] >= 0) && (nested == false);
+	bool empty = (flat_t->value [tag] < 0) && (nested == false);
+	uint32_t id = flat_t->name [tag];
+	long indent = 0;
+	long length;
+	char * start;
+	char * text;
+
+	if (writer_t->compact == false)
+		indent = 1 + depth;
+
+	length = indent + 2 + writer_t->lengths [id] +
+			 libjxml_flat_attributes_length (writer_t, flat_t->attribute [tag], flat_t->attribute [tag + 1]);
+
+	if (empty == true)
+		length++;
+
+	if (value == true)
+		length = length + libjxml_entity_length (flat_t->text + flat_t->value [tag], flat_t->value_length [tag], false);
+
+	start = libjxml_flat_room (writer_t, length);
+	text = start;
+
+	if (indent > 0)
+	{
+		*text = '\n';
+		memset (text + 1, '\t', depth);
+		text = text + indent;
+	}
+
+	*text++ = '<';
+	memcpy (text, writer_t->names [id], writer_t->lengths [id]);
+	text = text + writer_t->lengths [id];
+
+	text = libjxml_flat_write_attributes (writer_t, text, flat_t->attribute [tag], flat_t->attribute [tag + 1]);
+
+	if (empty == true)
+		*text++ = '/';
+	*text++ = '>';
+
+	if (value == true)
+		libjxml_entity_escape (text, flat_t->text + flat_t->value [tag], flat_t->value_length [tag], false);
+
+	libjxml_flat_commit (writer_t, start, length);
+}
+
+void libjxml_flat_write_close (xml_flat_writer_t * writer_t, long tag, long depth)
+{
+	xml_flat_t * flat_t = writer_t->flat_t;
+	bool nested = flat_t->end [tag] > tag + 1;
+	uint32_t id = flat_t->name [tag];
+	long indent = 0;
+	long length;
+	char * start;
+	char * text;
+
+	if ((flat_t->value [tag] < 0) && (nested == false))
+		return;
+
+	if ((flat_t->value [tag] < 0) && (writer_t->compact == false))
+		indent = 1 + depth;
+
+	length = indent + 3 + writer_t->lengths [id];
+
+	start = libjxml_flat_room (writer_t, length);
+	text = start;
+
+	if (indent > 0)
+	{
+		*text = '\n';
+		memset (text + 1, '\t', depth);
+		text = text + indent;
+	}
+
+	*text++ = '<';
+	*text++ = '/';
+	memcpy (text, writer_t->names [id], writer_t->lengths [id]);
+	text = text + writer_t->lengths [id];
+	*text = '>';
+
+	libjxml_flat_commit (writer_t, start, length);
+}
@@ -0,0 +1,793 @@
+/**
+ * @file libjxml_hash.c
+ *
+ * @brief Hashes of the tags of xml documents, and differences between documents.
+ *
+ * The hashes are kept in an array with a node for each tag in document order,
+ * holding the hash of the tag, the hash of its nested tags alone and the number
+ * of tags of its subtree. Walking two documents at once, the node of the first
+ * nested tag of a tag comes right after the node of the tag, and the node of
+ * the next sibling comes after the whole subtree, so no table is needed to find
+ * the hash of the tags compared, and identical subtrees are jumped over.
+ *
+ * Nested tags are compared as two lists. The tags at the beginning and at the
+ * end with the same hash are skipped first, and the tags left in the middle are
+ * paired through a hash table: by hash first, and then by name in order. The
+ * pairs out of order are found with the longest increasing sequence of their
+ * positions in the new list.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "libjxml_hash.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_HASH_PRIME  0x9E3779B97F4A7C15UL /**< Odd multiplier mixing the hashes */
+#define LIBJXML_HASH_NAME   0x51AFD7ED558CCD1DUL /**< Seed of the hashes of names */
+#define LIBJXML_HASH_VALUE  0xC4CEB9FE1A85EC53UL /**< Seed of the hashes of values */
+#define LIBJXML_HASH_EMPTY  0x2545F4914F6CDD1DUL /**< Hash of a missing value */
+#define LIBJXML_HASH_LIST   0x27D4EB2F165667C5UL /**< Seed of the hashes of lists of tags */
+#define LIBJXML_HASH_NODES  64                   /**< Minimum number of nodes allocated */
+#define LIBJXML_HASH_DEPTH  32                   /**< Initial depth of the stacks of a walk */
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Hashes of a tag.
+ */
+typedef struct xml_node_t
+{
+	uint64_t hash;   /**< Hash of the tag and its subtree */
+	uint64_t nested; /**< Hash of the nested tags alone */
+	long     size;   /**< Number of tags of the subtree, the tag included */
+}xml_node_t;
+
+/**
+ * @brief Slot of the table finding the node of a tag.
+ */
+typedef struct xml_slot_t
+{
+	xml_tag_t * tag_t;    /**< Tag, NULL if the slot is empty */
+	long        position; /**< Position of its node */
+}xml_slot_t;
+
+struct xml_hashes_t
+{
+	xml_t      * xml_mem_t;      /**< Hashed document */
+	long         generation;     /**< Generation of the document when it was hashed */
+	long         revision;       /**< Revision of the document when it was hashed */
+	xml_node_t * nodes;          /**< Node of each tag in document order */
+	long         count;          /**< Number of nodes */
+	long         capacity;       /**< Number of nodes allocated */
+	uint64_t     hash;           /**< Hash of the document */
+	xml_slot_t * slots;          /**< Table finding the node of a tag, NULL until needed */
+	long         slots_capacity; /**< Number of slots, a power of two */
+};
+
+/**
+ * @brief Tag of a list being compared.
+ */
+typedef struct xml_item_t
+{
+	xml_tag_t * tag_t;    /**< Tag */
+	long        position; /**< Position of its node */
+	long        partner;  /**< Item of the other list paired with it, -1 if none */
+	long        next;     /**< Next item of the other list with the same key, -1 if none */
+}xml_item_t;
+
+/**
+ * @brief Key of the table pairing the tags of two lists.
+ */
+typedef struct xml_key_t
+{
+	uint64_t   hash;   /**< Hash of the tag, or of its name */
+	char     * name;   /**< Name of the tag when paired by name, NULL when paired by hash */
+	long       length; /**< Length of the name */
+	long       head;   /**< First item of the new list not paired yet, -1 if the slot is empty */
+	long       tail;   /**< Last item of the new list with the key */
+}xml_key_t;
+
+/**
+ * @brief Pair of tags with different hashes waiting to be compared.
+ */
+typedef struct xml_pair_t
+{
+	xml_tag_t * old_t;        /**< Tag of the old document */
+	xml_tag_t * new_t;        /**< Tag of the new document */
+	long        old_position; /**< Position of the node of the old tag */
+	long        new_position; /**< Position of the node of the new tag */
+}xml_pair_t;
+
+/**
+ * @brief State of a comparison.
+ */
+typedef struct xml_differ_t
+{
+	xml_hashes_t * old_t;          /**< Hashes of the old document */
+	xml_hashes_t * new_t;          /**< Hashes of the new document */
+	xml_diff_cb    callback;       /**< Function receiving each difference */
+	void         * context;        /**< Pointer given to the callback */
+	long           changes;        /**< Differences reported */
+	bool           stopped;        /**< The callback asked to stop */
+	xml_pair_t   * pairs;          /**< Stack of pairs waiting to be compared */
+	long           depth;          /**< Number of pairs waiting */
+	long           pairs_capacity; /**< Number of pairs allocated */
+	xml_item_t   * olds;           /**< Tags of the old list being compared */
+	xml_item_t   * news;           /**< Tags of the new list being compared */
+	long           items_capacity; /**< Number of items allocated for each list */
+	xml_key_t    * keys;           /**< Table pairing the tags of the lists */
+	long           keys_capacity;  /**< Number of keys allocated */
+	long         * tails;          /**< Last item of the increasing sequences of each length */
+	long           tails_capacity; /**< Number of tails allocated */
+}xml_differ_t;
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+void libjxml_hash_build (xml_hashes_t * hashes_t);
+void libjxml_hash_check (xml_hashes_t * hashes_t);
+uint64_t libjxml_hash_mix (uint64_t hash);
+uint64_t libjxml_hash_bytes (char * text, long length, uint64_t seed);
+uint64_t libjxml_hash_attributes (xml_attribute_t * attribute_t);
+uint64_t libjxml_hash_self (xml_tag_t * tag_t);
+void libjxml_hash_slots (xml_hashes_t * hashes_t);
+
+void libjxml_diff_list (xml_differ_t * differ_t, xml_tag_t * old_first_t, long old_position,
+						xml_tag_t * new_first_t, long new_position);
+long libjxml_diff_gather (xml_differ_t * differ_t, xml_item_t ** items, xml_hashes_t * hashes_t,
+						  xml_tag_t * first_t, long position);
+void libjxml_diff_pair (xml_differ_t * differ_t, xml_item_t * olds, long old_count, xml_item_t * news,
+						long new_count, bool by_name);
+xml_key_t * libjxml_diff_key (xml_differ_t * differ_t, long capacity, xml_tag_t * tag_t, uint64_t hash,
+							  bool by_name);
+void libjxml_diff_moved (xml_differ_t * differ_t, xml_item_t * olds, long old_count);
+void libjxml_diff_push (xml_differ_t * differ_t, xml_item_t * old_item_t, xml_item_t * new_item_t);
+bool libjxml_diff_same (xml_tag_t * old_t, xml_tag_t * new_t);
+void libjxml_diff_report (xml_differ_t * differ_t, int change, xml_tag_t * old_t, xml_tag_t * new_t);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+xml_hashes_t * libjxml_hash_create (xml_t * xml_mem_t)
+{
+	xml_hashes_t * hashes_t;
+
+	hashes_t = (xml_hashes_t *) malloc (sizeof (xml_hashes_t));
+	LIBASSERT_PTR (hashes_t);
+
+	hashes_t->xml_mem_t = xml_mem_t;
+	hashes_t->nodes = NULL;
+	hashes_t->count = 0;
+	hashes_t->capacity = 0;
+	hashes_t->slots = NULL;
+	hashes_t->slots_capacity = 0;
+
+	libjxml_hash_build (hashes_t);
+
+	return hashes_t;
+}
+
+void libjxml_hash_free (xml_hashes_t * hashes_t)
+{
+	free (hashes_t->nodes);
+	free (hashes_t->slots);
+	free (hashes_t);
+}
+
+void libjxml_hash_refresh (xml_hashes_t * hashes_t)
+{
+	libjxml_hash_build (hashes_t);
+}
+
+uint64_t libjxml_hash_document (xml_hashes_t * hashes_t)
+{
+	libjxml_hash_check (hashes_t);
+
+	return hashes_t->hash;
+}
+
+uint64_t libjxml_hash_tag (xml_hashes_t * hashes_t, xml_tag_t * tag_t)
+{
+	uint64_t mask;
+	uint64_t slot;
+
+	libjxml_hash_check (hashes_t);
+
+	if (hashes_t->slots == NULL)
+		libjxml_hash_slots (hashes_t);
+
+	mask = hashes_t->slots_capacity - 1;
+	slot = libjxml_hash_mix ((uint64_t) (uintptr_t) tag_t) & mask;
+
+	while (hashes_t->slots [slot].tag_t != NULL)
+	{
+		if (hashes_t->slots [slot].tag_t == tag_t)
+			return hashes_t->nodes [hashes_t->slots [slot].position].hash;
+
+		slot = (slot + 1) & mask;
+	}
+
+	return 0;
+}
+
+long libjxml_diff (xml_hashes_t * old_t, xml_hashes_t * new_t, xml_diff_cb callback, void * context)
+{
+	xml_differ_t differ_t;
+	xml_pair_t pair_t;
+
+	libjxml_hash_check (old_t);
+	libjxml_hash_check (new_t);
+
+	if (old_t->hash == new_t->hash)
+		return 0;
+
+	memset (&differ_t, 0, sizeof (xml_differ_t));
+	differ_t.old_t = old_t;
+	differ_t.new_t = new_t;
+	differ_t.callback = callback;
+	differ_t.context = context;
+
+	libjxml_diff_list (&differ_t, old_t->xml_mem_t->content_t, 0, new_t->xml_mem_t->content_t, 0);
+
+	/* Pairs are taken from the top of the stack, where the first pair of a list is */
+	while ((differ_t.depth > 0) && (differ_t.stopped == false))
+	{
+		pair_t = differ_t.pairs [--differ_t.depth];
+
+		if (libjxml_diff_same (pair_t.old_t, pair_t.new_t) == false)
+			libjxml_diff_report (&differ_t, LIBJXML_DIFF_CHANGED, pair_t.old_t, pair_t.new_t);
+
+		if (old_t->nodes [pair_t.old_position].nested != new_t->nodes [pair_t.new_position].nested)
+			libjxml_diff_list (&differ_t, pair_t.old_t->nested_tag_t, pair_t.old_position + 1,
+							   pair_t.new_t->nested_tag_t, pair_t.new_position + 1);
+	}
+
+	free (differ_t.pairs);
+	free (differ_t.olds);
+	free (differ_t.news);
+	free (differ_t.keys);
+	free (differ_t.tails);
+
+	return differ_t.changes;
+}
+
+/*********************************************************************************
+ *                                    HASHES
+ *********************************************************************************/
+
+/*
+ * Walks the tree once, giving each tag its position when entered and its hash
+ * when left, once the hashes of its nested tags have been combined in order.
+ */
+void libjxml_hash_build (xml_hashes_t * hashes_t)
+{
+	xml_iterator_t iterator_t;
+	xml_tag_t * tag_t;
+	xml_node_t * node_t;
+	long * positions;
+	uint64_t * lists;
+	long capacity = LIBJXML_HASH_DEPTH;
+	long depth;
+
+	free (hashes_t->slots);
+	hashes_t->slots = NULL;
+	hashes_t->slots_capacity = 0;
+
+	hashes_t->generation = hashes_t->xml_mem_t->generation;
+	hashes_t->revision = hashes_t->xml_mem_t->revision;
+	hashes_t->count = 0;
+
+	/* Tags are less than the nodes of the document, which counts attributes too */
+	if (hashes_t->capacity < hashes_t->xml_mem_t->nodes)
+	{
+		hashes_t->capacity = hashes_t->xml_mem_t->nodes;
+		if (hashes_t->capacity < LIBJXML_HASH_NODES)
+			hashes_t->capacity = LIBJXML_HASH_NODES;
+
+		free (hashes_t->nodes);
+		hashes_t->nodes = (xml_node_t *) malloc (hashes_t->capacity * sizeof (xml_node_t));
+		LIBASSERT_PTR (hashes_t->nodes);
+	}
+
+	positions = (long *) malloc (capacity * sizeof (long));
+	LIBASSERT_PTR (positions);
+	lists = (uint64_t *) malloc ((capacity + 1) * sizeof (uint64_t));
+	LIBASSERT_PTR (lists);
+
+	lists [0] = LIBJXML_HASH_LIST;
+
+	libjxml_iterator_xml (&iterator_t, hashes_t->xml_mem_t, LIBJXML_WALK_PRE | LIBJXML_WALK_POST);
+
+	while ((tag_t = libjxml_iterator_next (&iterator_t)) != NULL)
+	{
+		depth = iterator_t.depth;
+
+		if (iterator_t.leaving == false)
+		{
+			if (depth == capacity)
+			{
+				capacity = capacity * 2;
+				positions = (long *) realloc (positions, capacity * sizeof (long));
+				LIBASSERT_PTR (positions);
+				lists = (uint64_t *) realloc (lists, (capacity + 1) * sizeof (uint64_t));
+				LIBASSERT_PTR (lists);
+			}
+
+			if (hashes_t->count == hashes_t->capacity)
+			{
+				hashes_t->capacity = hashes_t->capacity * 2;
+				hashes_t->nodes = (xml_node_t *) realloc (hashes_t->nodes, hashes_t->capacity * sizeof (xml_node_t));
+				LIBASSERT_PTR (hashes_t->nodes);
+			}
+
+			positions [depth] = hashes_t->count++;
+			lists [depth + 1] = LIBJXML_HASH_LIST;
+			continue;
+		}
+
+		node_t = &hashes_t->nodes [positions [depth]];
+		node_t->nested = libjxml_hash_mix (lists [depth + 1]);
+		node_t->hash = libjxml_hash_mix (libjxml_hash_self (tag_t) ^ node_t->nested);
+		node_t->size = hashes_t->count - positions [depth];
+
+		lists [depth] = libjxml_hash_mix (lists [depth] * LIBJXML_HASH_PRIME + node_t->hash);
+	}
+
+	libjxml_iterator_free (&iterator_t);
+
+	hashes_t->hash = libjxml_hash_mix (libjxml_hash_mix (lists [0]) ^
+									   libjxml_hash_attributes (hashes_t->xml_mem_t->instruction_t));
+
+	free (positions);
+	free (lists);
+}
+
+void libjxml_hash_check (xml_hashes_t * hashes_t)
+{
+	if ((hashes_t->generation != hashes_t->xml_mem_t->generation) ||
+		(hashes_t->revision != hashes_t->xml_mem_t->revision))
+		libjxml_hash_build (hashes_t);
+}
+
+/*
+ * Final mix of MurmurHash3, spreading each bit of the input over the output.
+ */
+uint64_t libjxml_hash_mix (uint64_t hash)
+{
+	hash = hash ^ (hash >> 33);
+	hash = hash * 0xFF51AFD7ED558CCDUL;
+	hash = hash ^ (hash >> 33);
+	hash = hash * 0xC4CEB9FE1A85EC53UL;
+	hash = hash ^ (hash >> 33);
+
+	return hash;
+}
+
+/*
+ * Reads the text 8 bytes at a time, the last ones padded with zeros, which the
+ * length mixed in the seed tells apart.
+ */
+uint64_t libjxml_hash_bytes (char * text, long length, uint64_t seed)
+{
+	uint64_t hash = seed ^ ((uint64_t) length * LIBJXML_HASH_PRIME);
+	uint64_t word;
+
+	while (length >= 8)
+	{
+		memcpy (&word, text, 8);
+		hash = (hash ^ word) * LIBJXML_HASH_PRIME;
+		hash = hash ^ (hash >> 29);
+		text = text + 8;
+		length = length - 8;
+	}
+
+	if (length > 0)
+	{
+		word = 0;
+		memcpy (&word, text, length);
+		hash = (hash ^ word) * LIBJXML_HASH_PRIME;
+	}
+
+	return libjxml_hash_mix (hash);
+}
+
+/*
+ * The hashes of the attributes are added, so their order does not matter.
+ */
+uint64_t libjxml_hash_attributes (xml_attribute_t * attribute_t)
+{
+	uint64_t hash = 0;
+
+	while (attribute_t != NULL)
+	{
+		hash = hash + libjxml_hash_mix (libjxml_hash_bytes (attribute_t->name, attribute_t->name_length,
+															LIBJXML_HASH_NAME) * LIBJXML_HASH_PRIME +
+										libjxml_hash_bytes (attribute_t->value, attribute_t->value_length,
+															LIBJXML_HASH_VALUE));
+		attribute_t = attribute_t->next_attribute_t;
+	}
+
+	return hash;
+}
+
+uint64_t libjxml_hash_self (xml_tag_t * tag_t)
+{
+	uint64_t hash;
+
+	hash = libjxml_hash_bytes (tag_t->name, tag_t->name_length, LIBJXML_HASH_NAME);
+
+	if (tag_t->value != NULL)
+		hash = hash * LIBJXML_HASH_PRIME + libjxml_hash_bytes (tag_t->value, tag_t->value_length, LIBJXML_HASH_VALUE);
+	else
+		hash = hash * LIBJXML_HASH_PRIME + LIBJXML_HASH_EMPTY;
+
+	return libjxml_hash_mix (hash + libjxml_hash_attributes (tag_t->attribute_t));
+}
+
+/*
+ * Builds the open addressing table from each tag to its node, walking the tree
+ * in the same order the nodes were numbered.
+ */
+void libjxml_hash_slots (xml_hashes_t * hashes_t)
+{
+	xml_iterator_t iterator_t;
+	xml_tag_t * tag_t;
+	uint64_t mask;
+	uint64_t slot;
+	long position = 0;
+
+	hashes_t->slots_capacity = LIBJXML_HASH_NODES;
+	while (hashes_t->slots_capacity < 2 * hashes_t->count)
+		hashes_t->slots_capacity = hashes_t->slots_capacity * 2;
+
+	hashes_t->slots = (xml_slot_t *) calloc (hashes_t->slots_capacity, sizeof (xml_slot_t));
+	LIBASSERT_PTR (hashes_t->slots);
+
+	mask = hashes_t->slots_capacity - 1;
+
+	libjxml_iterator_xml (&iterator_t, hashes_t->xml_mem_t, LIBJXML_WALK_PRE);
+
+	while ((tag_t = libjxml_iterator_next (&iterator_t)) != NULL)
+	{
+		slot = libjxml_hash_mix ((uint64_t) (uintptr_t) tag_t) & mask;
+		while (hashes_t->slots [slot].tag_t != NULL)
+			slot = (slot + 1) & mask;
+
+		hashes_t->slots [slot].tag_t = tag_t;
+		hashes_t->slots [slot].position = position++;
+	}
+
+	libjxml_iterator_free (&iterator_t);
+}
+
+/*********************************************************************************
+ *                                     DIFF
+ *********************************************************************************/
+
+/*
+ * Compares two lists of sibling tags, reporting the tags added and removed and
+ * pushing the pairs of tags with different hashes.
+ */
+void libjxml_diff_list (xml_differ_t * differ_t, xml_tag_t * old_first_t, long old_position,
+						xml_tag_t * new_first_t, long new_position)
+{
+	xml_item_t * olds;
+	xml_item_t * news;
+	long old_count;
+	long new_count;
+	long first = 0;
+	long old_last;
+	long new_last;
+	long i;
+
+	old_count = libjxml_diff_gather (differ_t, &differ_t->olds, differ_t->old_t, old_first_t, old_position);
+	new_count = libjxml_diff_gather (differ_t, &differ_t->news, differ_t->new_t, new_first_t, new_position);
+	olds = differ_t->olds;
+	news = differ_t->news;
+
+	while ((first < old_count) && (first < new_count) &&
+		   (differ_t->old_t->nodes [olds [first].position].hash == differ_t->new_t->nodes [news [first].position].hash))
+		first++;
+
+	old_last = old_count;
+	new_last = new_count;
+	while ((old_last > first) && (new_last > first) &&
+		   (differ_t->old_t->nodes [olds [old_last - 1].position].hash ==
+			differ_t->new_t->nodes [news [new_last - 1].position].hash))
+	{
+		old_last--;
+		new_last--;
+	}
+
+	olds = olds + first;
+	news = news + first;
+	old_count = old_last - first;
+	new_count = new_last - first;
+
+	if ((old_count > 0) && (new_count > 0))
+	{
+		libjxml_diff_pair (differ_t, olds, old_count, news, new_count, false);
+		libjxml_diff_pair (differ_t, olds, old_count, news, new_count, true);
+	}
+
+	for (i = 0; i < old_count; i++)
+		if (olds [i].partner < 0)
+			libjxml_diff_report (differ_t, LIBJXML_DIFF_REMOVED, olds [i].tag_t, NULL);
+
+	for (i = 0; i < new_count; i++)
+		if (news [i].partner < 0)
+			libjxml_diff_report (differ_t, LIBJXML_DIFF_ADDED, NULL, news [i].tag_t);
+
+	libjxml_diff_moved (differ_t, olds, old_count);
+
+	for (i = 0; i < old_count; i++)
+		if ((olds [i].partner >= 0) && (olds [i].next != -2))
+			libjxml_diff_report (differ_t, LIBJXML_DIFF_MOVED, olds [i].tag_t, news [olds [i].partner].tag_t);
+
+	/* Pairs are pushed in reverse order, so they are compared in document order */
+	for (i = old_count - 1; i >= 0; i--)
+	{
+		if ((olds [i].partner >= 0) &&
+			(differ_t->old_t->nodes [olds [i].position].hash !=
+			 differ_t->new_t->nodes [news [olds [i].partner].position].hash))
+			libjxml_diff_push (differ_t, &olds [i], &news [olds [i].partner]);
+	}
+}
+
+long libjxml_diff_gather (xml_differ_t * differ_t, xml_item_t ** items, xml_hashes_t * hashes_t,
+						  xml_tag_t * first_t, long position)
+{
+	xml_tag_t * tag_t;
+	long count = 0;
+
+	for (tag_t = first_t; tag_t != NULL; tag_t = tag_t->sibling_tag_t)
+	{
+		if (count == differ_t->items_capacity)
+		{
+			differ_t->items_capacity = (differ_t->items_capacity == 0) ? LIBJXML_HASH_NODES
+																	   : differ_t->items_capacity * 2;
+			differ_t->olds = (xml_item_t *) realloc (differ_t->olds, differ_t->items_capacity * sizeof (xml_item_t));
+			LIBASSERT_PTR (differ_t->olds);
+			differ_t->news = (xml_item_t *) realloc (differ_t->news, differ_t->items_capacity * sizeof (xml_item_t));
+			LIBASSERT_PTR (differ_t->news);
+		}
+
+		(*items) [count].tag_t = tag_t;
+		(*items) [count].position = position;
+		(*items) [count].partner = -1;
+		(*items) [count].next = -1;
+		count++;
+
+		position = position + hashes_t->nodes [position].size;
+	}
+
+	return count;
+}
+
+/*
+ * Pairs the tags of the old list with the first tag of the new list with the
+ * same key not paired yet. The new tags with each key are chained in order, and
+ * the head of the chain only moves forward, so each tag is looked at once.
+ */
+void libjxml_diff_pair (xml_differ_t * differ_t, xml_item_t * olds, long old_count, xml_item_t * news,
+						long new_count, bool by_name)
+{
+	xml_key_t * key_t;
+	uint64_t hash;
+	long capacity = LIBJXML_HASH_NODES;
+	long i;
+
+	while (capacity < 2 * new_count)
+		capacity = capacity * 2;
+
+	if (capacity > differ_t->keys_capacity)
+	{
+		free (differ_t->keys);
+		differ_t->keys = (xml_key_t *) malloc (capacity * sizeof (xml_key_t));
+		LIBASSERT_PTR (differ_t->keys);
+		differ_t->keys_capacity = capacity;
+	}
+
+	for (i = 0; i < capacity; i++)
+		differ_t->keys [i].head = -1;
+
+	for (i = 0; i < new_count; i++)
+	{
+		if (news [i].partner >= 0)
+			continue;
+
+		if (by_name)
+			hash = libjxml_hash_bytes (news [i].tag_t->name, news [i].tag_t->name_length, LIBJXML_HASH_NAME);
+		else
+			hash = differ_t->new_t->nodes [news [i].position].hash;
+
+		key_t = libjxml_diff_key (differ_t, capacity, news [i].tag_t, hash, by_name);
+
+		news [i].next = -1;
+		if (key_t->head < 0)
+			key_t->head = i;
+		else
+			news [key_t->tail].next = i;
+		key_t->tail = i;
+	}
+
+	for (i = 0; i < old_count; i++)
+	{
+		if (olds [i].partner >= 0)
+			continue;
+
+		if (by_name)
+			hash = libjxml_hash_bytes (olds [i].tag_t->name, olds [i].tag_t->name_length, LIBJXML_HASH_NAME);
+		else
+			hash = differ_t->old_t->nodes [olds [i].position].hash;
+
+		key_t = libjxml_diff_key (differ_t, capacity, olds [i].tag_t, hash, by_name);
+		if (key_t->head < 0)
+			continue;
+
+		olds [i].partner = key_t->head;
+		news [key_t->head].partner = i;
+		key_t->head = news [key_t->head].next;
+	}
+}
+
+/*
+ * Finds the slot of a key in the table, taking an empty one if it is not there.
+ */
+xml_key_t * libjxml_diff_key (xml_differ_t * differ_t, long capacity, xml_tag_t * tag_t, uint64_t hash,
+							  bool by_name)
+{
+	xml_key_t * key_t;
+	uint64_t mask = capacity - 1;
+	uint64_t slot = hash & mask;
+
+	while (1)
+	{
+		key_t = &differ_t->keys [slot];
+
+		if (key_t->head < 0)
+			break;
+
+		if ((key_t->hash == hash) &&
+			((by_name == false) ||
+			 ((key_t->length == tag_t->name_length) && (memcmp (key_t->name, tag_t->name, key_t->length) == 0))))
+			return key_t;
+
+		slot = (slot + 1) & mask;
+	}
+
+	/* A new key is only taken by the new list, the old one only looks for them */
+	key_t->hash = hash;
+	key_t->name = tag_t->name;
+	key_t->length = tag_t->name_length;
+
+	return key_t;
+}
+
+/*
+ * Marks with 'next' -2 the paired old tags that stay in place: the longest list
+ * of them whose partners are in increasing order, found by patience sorting. The
+ * 'next' field of the old items is free, as only the new ones are chained, and
+ * keeps the previous item of each sequence.
+ */
+void libjxml_diff_moved (xml_differ_t * differ_t, xml_item_t * olds, long old_count)
+{
+	long length = 0;
+	long low, high, middle;
+	long i, previous;
+
+	if (old_count > differ_t->tails_capacity)
+	{
+		differ_t->tails_capacity = old_count;
+		differ_t->tails = (long *) realloc (differ_t->tails, differ_t->tails_capacity * sizeof (long));
+		LIBASSERT_PTR (differ_t->tails);
+	}
+
+	for (i = 0; i < old_count; i++)
+	{
+		if (olds [i].partner < 0)
+			continue;
+
+		low = 0;
+		high = length;
+		while (low < high)
+		{
+			middle = (low + high) / 2;
+			if (olds [differ_t->tails [middle]].partner < olds [i].partner)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+
+		olds [i].next = (low > 0) ? differ_t->tails [low - 1] : -1;
+		differ_t->tails [low] = i;
+		if (low == length)
+			length++;
+	}
+
+	for (i = (length > 0) ? differ_t->tails [length - 1] : -1; i >= 0; i = previous)
+	{
+		previous = olds [i].next;
+		olds [i].next = -2;
+	}
+}
+
+void libjxml_diff_push (xml_differ_t * differ_t, xml_item_t * old_item_t, xml_item_t * new_item_t)
+{
+	xml_pair_t * pair_t;
+
+	if (differ_t->depth == differ_t->pairs_capacity)
+	{
+		differ_t->pairs_capacity = (differ_t->pairs_capacity == 0) ? LIBJXML_HASH_DEPTH
+																   : differ_t->pairs_capacity * 2;
+		differ_t->pairs = (xml_pair_t *) realloc (differ_t->pairs, differ_t->pairs_capacity * sizeof (xml_pair_t));
+		LIBASSERT_PTR (differ_t->pairs);
+	}
+
+	pair_t = &differ_t->pairs [differ_t->depth++];
+	pair_t->old_t = old_item_t->tag_t;
+	pair_t->new_t = new_item_t->tag_t;
+	pair_t->old_position = old_item_t->position;
+	pair_t->new_position = new_item_t->position;
+}
+
+/*
+ * Compares the value and attributes of two tags, in any order.
+ */
+bool libjxml_diff_same (xml_tag_t * old_t, xml_tag_t * new_t)
+{
+	xml_attribute_t * old_attribute_t;
+	xml_attribute_t * new_attribute_t;
+	long old_count = 0;
+	long new_count = 0;
+
+	if ((old_t->value == NULL) != (new_t->value == NULL))
+		return false;
+
+	if ((old_t->value != NULL) && ((old_t->value_length != new_t->value_length) ||
+								   (memcmp (old_t->value, new_t->value, old_t->value_length) != 0)))
+		return false;
+
+	for (old_attribute_t = old_t->attribute_t; old_attribute_t != NULL; old_attribute_t = old_attribute_t->next_attribute_t)
+	{
+		old_count++;
+
+		for (new_attribute_t = new_t->attribute_t; new_attribute_t != NULL; new_attribute_t = new_attribute_t->next_attribute_t)
+			if ((new_attribute_t->name_length == old_attribute_t->name_length) &&
+				(memcmp (new_attribute_t->name, old_attribute_t->name, old_attribute_t->name_length) == 0))
+				break;
+
+		if ((new_attribute_t == NULL) || (new_attribute_t->value_length != old_attribute_t->value_length) ||
+			(memcmp (new_attribute_t->value, old_attribute_t->value, old_attribute_t->value_length) != 0))
+			return false;
+	}
+
+	for (new_attribute_t = new_t->attribute_t; new_attribute_t != NULL; new_attribute_t = new_attribute_t->next_attribute_t)
+		new_count++;
+
+	return old_count == new_count;
+}
+
+void libjxml_diff_report (xml_differ_t * differ_t, int change, xml_tag_t * old_t, xml_tag_t * new_t)
+{
+	if (differ_t->stopped)
+		return;
+
+	differ_t->changes++;
+
+	if ((differ_t->callback != NULL) && (differ_t->callback (differ_t->context, change, old_t, new_t) == false))
+		differ_t->stopped = true;
+}
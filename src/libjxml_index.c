@@ -0,0 +1,334 @@
+/**
+ * @file libjxml_index.c
+ *
+ * @brief Index of the nested tags and attributes of xml documents by name.
+ *
+ * Names are interned, so the key of each entry is a pair of pointers: the tag
+ * and the name. The entries are kept in open addressing hash tables, one for
+ * nested tags and another one for attributes. The nested tags with the same key
+ * are stored together in a single array, filled in a second walk of the tree
+ * once the number of tags of each entry is known.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "libjxml_index.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_INDEX_SLOTS 16                    /**< Minimum number of slots of a table */
+#define LIBJXML_INDEX_PRIME 0x9E3779B97F4A7C15UL  /**< Odd multiplier mixing the hash */
+
+/**
+ * @brief Entry of a table, empty while its name is NULL.
+ */
+typedef struct xml_entry_t
+{
+	void * owner;  /**< Tag owning the nested tags or attributes, NULL for the first level */
+	char * name;   /**< Interned name */
+	void * first;  /**< First nested tag or attribute with the name */
+	long   offset; /**< Position of the first nested tag in the array of tags */
+	long   count;  /**< Number of nested tags with the name */
+}xml_entry_t;
+
+/**
+ * @brief Open addressing hash table of entries.
+ */
+typedef struct xml_table_t
+{
+	xml_entry_t * entries;  /**< Entries of the table, a power of two */
+	long          capacity; /**< Number of entries */
+}xml_table_t;
+
+struct xml_index_t
+{
+	xml_t       * xml_mem_t;  /**< Indexed document */
+	long          generation; /**< Generation of the document when it was indexed */
+	xml_table_t   children;   /**< Nested tags by tag and name */
+	xml_table_t   attributes; /**< Attributes by tag and name */
+	xml_tag_t  ** tags;       /**< Nested tags grouped by entry, in document order */
+	long          tags_capacity; /**< Number of tags the array can keep */
+};
+
+/*********************************************************************************
+ *                                 DECLARATIONS
+ *********************************************************************************/
+
+void libjxml_index_build (xml_index_t * index_t);
+void libjxml_index_clear (xml_table_t * table_t, long keys);
+void libjxml_index_count (xml_index_t * index_t, xml_tag_t * parent_t, xml_tag_t * tag_t);
+void libjxml_index_fill (xml_index_t * index_t, xml_tag_t * parent_t, xml_tag_t * tag_t);
+xml_entry_t * libjxml_index_slot (xml_table_t * table_t, void * owner, char * name);
+xml_entry_t * libjxml_index_lookup (xml_index_t * index_t, xml_table_t * table_t, void * owner, char * name);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+xml_index_t * libjxml_index_create (xml_t * xml_mem_t)
+{
+	xml_index_t * index_t;
+
+	index_t = (xml_index_t *) malloc (sizeof (xml_index_t));
+	LIBASSERT_PTR (index_t);
+
+	index_t->xml_mem_t = xml_mem_t;
+	index_t->children.entries = NULL;
+	index_t->children.capacity = 0;
+	index_t->attributes.entries = NULL;
+	index_t->attributes.capacity = 0;
+	index_t->tags = NULL;
+	index_t->tags_capacity = 0;
+
+	libjxml_index_build (index_t);
+
+	return index_t;
+}
+
+void libjxml_index_free (xml_index_t * index_t)
+{
+	free (index_t->children.entries);
+	free (index_t->attributes.entries);
+	free (index_t->tags);
+	free (index_t);
+}
+
+xml_tag_t * libjxml_index_child (xml_index_t * index_t, xml_tag_t * parent_t, char * name)
+{
+	xml_entry_t * entry_t;
+
+	entry_t = libjxml_index_lookup (index_t, &index_t->children, parent_t, name);
+	if (entry_t == NULL)
+		return NULL;
+
+	return (xml_tag_t *) entry_t->first;
+}
+
+xml_tag_t ** libjxml_index_children (xml_index_t * index_t, xml_tag_t * parent_t, char * name,
+									 long * count)
+{
+	xml_entry_t * entry_t;
+
+	*count = 0;
+
+	entry_t = libjxml_index_lookup (index_t, &index_t->children, parent_t, name);
+	if (entry_t == NULL)
+		return NULL;
+
+	*count = entry_t->count;
+
+	return index_t->tags + entry_t->offset;
+}
+
+xml_attribute_t * libjxml_index_attribute (xml_index_t * index_t, xml_tag_t * tag_t, char * name)
+{
+	xml_entry_t * entry_t;
+
+	entry_t = libjxml_index_lookup (index_t, &index_t->attributes, tag_t, name);
+	if (entry_t == NULL)
+		return NULL;
+
+	return (xml_attribute_t *) entry_t->first;
+}
+
+/*********************************************************************************
+ *                                     BUILD
+ *********************************************************************************/
+
+/*
+ * The tree is walked twice. The first walk creates the entries and counts the
+ * nested tags of each one, so each entry gets its part of the array of tags,
+ * and the second walk fills the array.
+ */
+void libjxml_index_build (xml_index_t * index_t)
+{
+	xml_t * xml_mem_t = index_t->xml_mem_t;
+	xml_iterator_t iterator_t;
+	xml_attribute_t * attribute_t;
+	xml_tag_t * tag_t;
+	xml_entry_t * entry_t;
+	long attributes = 0;
+	long tags = 0;
+	long offset = 0;
+	long i;
+
+	libjxml_iterator_xml (&iterator_t, xml_mem_t, LIBJXML_WALK_PRE);
+	while ((tag_t = libjxml_iterator_next (&iterator_t)) != NULL)
+	{
+		tags++;
+		for (attribute_t = tag_t->attribute_t; attribute_t != NULL; attribute_t = attribute_t->next_attribute_t)
+			attributes++;
+	}
+	libjxml_iterator_free (&iterator_t);
+
+	libjxml_index_clear (&index_t->children, tags);
+	libjxml_index_clear (&index_t->attributes, attributes);
+
+	if (tags > index_t->tags_capacity)
+	{
+		free (index_t->tags);
+		index_t->tags = (xml_tag_t **) malloc (tags * sizeof (xml_tag_t *));
+		LIBASSERT_PTR (index_t->tags);
+		index_t->tags_capacity = tags;
+	}
+
+	libjxml_index_count (index_t, NULL, xml_mem_t->content_t);
+
+	libjxml_iterator_xml (&iterator_t, xml_mem_t, LIBJXML_WALK_PRE);
+	while ((tag_t = libjxml_iterator_next (&iterator_t)) != NULL)
+	{
+		libjxml_index_count (index_t, tag_t, tag_t->nested_tag_t);
+
+		/* Only the first attribute with a name is found, like walking the list */
+		for (attribute_t = tag_t->attribute_t; attribute_t != NULL; attribute_t = attribute_t->next_attribute_t)
+		{
+			entry_t = libjxml_index_slot (&index_t->attributes, tag_t, attribute_t->name);
+			if (entry_t->name == NULL)
+			{
+				entry_t->owner = tag_t;
+				entry_t->name = attribute_t->name;
+				entry_t->first = attribute_t;
+			}
+		}
+	}
+	libjxml_iterator_free (&iterator_t);
+
+	for (i = 0; i < index_t->children.capacity; i++)
+	{
+		entry_t = &index_t->children.entries [i];
+		if (entry_t->name == NULL)
+			continue;
+
+		entry_t->offset = offset;
+		offset = offset + entry_t->count;
+		entry_t->count = 0;
+	}
+
+	libjxml_index_fill (index_t, NULL, xml_mem_t->content_t);
+
+	libjxml_iterator_xml (&iterator_t, xml_mem_t, LIBJXML_WALK_PRE);
+	while ((tag_t = libjxml_iterator_next (&iterator_t)) != NULL)
+		libjxml_index_fill (index_t, tag_t, tag_t->nested_tag_t);
+	libjxml_iterator_free (&iterator_t);
+
+	index_t->generation = xml_mem_t->generation;
+}
+
+/*
+ * Empties a table, making it big enough to keep 'keys' entries at most half full.
+ */
+void libjxml_index_clear (xml_table_t * table_t, long keys)
+{
+	long capacity = LIBJXML_INDEX_SLOTS;
+
+	while (capacity < keys * 2)
+		capacity = capacity * 2;
+
+	if (capacity != table_t->capacity)
+	{
+		free (table_t->entries);
+		table_t->entries = (xml_entry_t *) malloc (capacity * sizeof (xml_entry_t));
+		LIBASSERT_PTR (table_t->entries);
+		table_t->capacity = capacity;
+	}
+
+	memset (table_t->entries, 0, capacity * sizeof (xml_entry_t));
+}
+
+/*
+ * Creates the entries of the tags of a list and counts the tags of each one.
+ */
+void libjxml_index_count (xml_index_t * index_t, xml_tag_t * parent_t, xml_tag_t * tag_t)
+{
+	xml_entry_t * entry_t;
+
+	for (; tag_t != NULL; tag_t = tag_t->sibling_tag_t)
+	{
+		if (tag_t->name == NULL)
+			continue;
+
+		entry_t = libjxml_index_slot (&index_t->children, parent_t, tag_t->name);
+		if (entry_t->name == NULL)
+		{
+			entry_t->owner = parent_t;
+			entry_t->name = tag_t->name;
+			entry_t->first = tag_t;
+		}
+
+		entry_t->count++;
+	}
+}
+
+void libjxml_index_fill (xml_index_t * index_t, xml_tag_t * parent_t, xml_tag_t * tag_t)
+{
+	xml_entry_t * entry_t;
+
+	for (; tag_t != NULL; tag_t = tag_t->sibling_tag_t)
+	{
+		if (tag_t->name == NULL)
+			continue;
+
+		entry_t = libjxml_index_slot (&index_t->children, parent_t, tag_t->name);
+		index_t->tags [entry_t->offset + entry_t->count] = tag_t;
+		entry_t->count++;
+	}
+}
+
+/*********************************************************************************
+ *                                    LOOKUP
+ *********************************************************************************/
+
+/*
+ * Returns the entry with the key, or the empty entry where it would be stored.
+ */
+xml_entry_t * libjxml_index_slot (xml_table_t * table_t, void * owner, char * name)
+{
+	xml_entry_t * entry_t;
+	unsigned long hash;
+	long mask = table_t->capacity - 1;
+	long i;
+
+	hash = ((uintptr_t) owner ^ ((uintptr_t) name * LIBJXML_INDEX_PRIME)) * LIBJXML_INDEX_PRIME;
+	i = (hash ^ (hash >> 32)) & mask;
+
+	while (1)
+	{
+		entry_t = &table_t->entries [i];
+
+		if ((entry_t->name == NULL) || ((entry_t->name == name) && (entry_t->owner == owner)))
+			return entry_t;
+
+		i = (i + 1) & mask;
+	}
+}
+
+/*
+ * The index is rebuilt here, and not when the tree changes, so many changes in
+ * a row cost a single build.
+ */
+xml_entry_t * libjxml_index_lookup (xml_index_t * index_t, xml_table_t * table_t, void * owner, char * name)
+{
+	xml_entry_t * entry_t;
+	char * interned;
+
+	if (index_t->generation != index_t->xml_mem_t->generation)
+		libjxml_index_build (index_t);
+
+	interned = libjxml_find_name (index_t->xml_mem_t, name);
+	if (interned == NULL)
+		return NULL;
+
+	entry_t = libjxml_index_slot (table_t, owner, interned);
+	if (entry_t->name == NULL)
+		return NULL;
+
+	return entry_t;
+}
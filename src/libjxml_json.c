@@ -0,0 +1,1457 @@
+/**
+ * @file libjxml_json.c
+ *
+ * @brief Conversion of xml documents to JSON and back.
+ *
+ * The converter is a SAX handler writing to a buffer of its own, given to the
+ * sink each time it fills. Whether a tag is written in an array is known from
+ * its name, so its key is written as soon as the tag is opened, with a '[' when
+ * it starts an array, ended with ']' when another tag or the end of the parent
+ * is found. The keys written in each open tag are kept one after the other,
+ * null ended, so a key written twice is found before the output is wrong. They
+ * are looked up walking the keys of the tag, which are few as they are only
+ * kept once for each run of tags.
+ *
+ * The text of a tag is kept until its end, as it is dropped if a nested tag is
+ * found, like the parser does. Tokens given by libjxml_sax_buffer()
+ * stay valid, so the text is kept as a pointer, and copied otherwise.
+ *
+ * Documents are written with the same rules, finding the keys written twice in
+ * the tags nested in each tag through a table of their names.
+ *
+ * JSON texts are read in a loop with a stack of the objects and arrays open, so
+ * the program stack does not grow with their depth.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libjxml_json.h"
+#include "libjxml_sax.h"
+#include "libjxml_entity.h"
+#include "libjxml_names.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_JSON_DEPTH   32  /**< Initial depth of the stacks of open tags */
+#define LIBJXML_JSON_NAMES   512 /**< Initial size of the buffer of names of the last nested tags */
+#define LIBJXML_JSON_SCRATCH 256 /**< Initial size of the buffers of decoded texts */
+
+/* Byte written after '\' for each character escaped, 'u' for \u00XX */
+static const char libjxml_json_escapes [256] =
+{
+	[0x00] = 'u', [0x01] = 'u', [0x02] = 'u', [0x03] = 'u', [0x04] = 'u', [0x05] = 'u', [0x06] = 'u', [0x07] = 'u',
+	[0x08] = 'b', [0x09] = 't', [0x0A] = 'n', [0x0B] = 'u', [0x0C] = 'f', [0x0D] = 'r', [0x0E] = 'u', [0x0F] = 'u',
+	[0x10] = 'u', [0x11] = 'u', [0x12] = 'u', [0x13] = 'u', [0x14] = 'u', [0x15] = 'u', [0x16] = 'u', [0x17] = 'u',
+	[0x18] = 'u', [0x19] = 'u', [0x1A] = 'u', [0x1B] = 'u', [0x1C] = 'u', [0x1D] = 'u', [0x1E] = 'u', [0x1F] = 'u',
+	['"'] = '"',
+	['\\'] = '\\',
+};
+
+static const char libjxml_json_hex [16] = "0123456789abcdef";
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Tag open while converting to JSON.
+ */
+typedef struct xml_json_frame_t
+{
+	long base;    /**< Offset in the names of the keys of the nested tags */
+	long last;    /**< Offset in the names of the key of the last nested tag, -1 if none */
+	long members; /**< Keys written in the object of the tag */
+	bool object;  /**< The object of the tag is open */
+	bool array;   /**< The last nested tag is in an array still open */
+	bool valued;  /**< The text of the tag or a nested tag was found, so no text is taken anymore */
+}xml_json_frame_t;
+
+/**
+ * @brief State of a conversion to JSON.
+ */
+typedef struct xml_json_t
+{
+	xml_sink_t       * sink_t;           /**< Sink receiving the JSON text */
+	char             * output;           /**< JSON text not given to the sink yet */
+	long               length;           /**< Used length of the output */
+	long               capacity;         /**< Allocated length of the output */
+	xml_json_frame_t * frames;           /**< Open tags, the document first */
+	long               depth;            /**< Number of frames used */
+	long               frames_capacity;  /**< Number of frames allocated */
+	char             * names;            /**< Keys of the nested tags of each open tag, null ended, one after the other */
+	long               names_length;     /**< Used length of the names */
+	long               names_capacity;   /**< Allocated length of the names */
+	char             * text;             /**< Text of the last open tag waiting to be written, NULL if none */
+	long               text_length;      /**< Length of the waiting text */
+	bool               decode;           /**< The waiting text has entities to be decoded */
+	bool               stable;           /**< Tokens stay valid after their callback */
+	char             * pending;          /**< Copy of the waiting text when tokens are not stable */
+	long               pending_capacity; /**< Allocated length of the copy */
+	char             * scratch;          /**< Decoded texts */
+	long               scratch_capacity; /**< Allocated length of the decoded texts */
+	char             * prefix;           /**< Prefix of the keys of the attributes */
+	long               prefix_length;    /**< Length of the prefix */
+	char             * text_key;         /**< Key of the texts of the objects */
+	long               text_key_length;  /**< Length of the text key */
+	char            ** arrays;           /**< Names of the tags written as arrays, NULL for all but the root */
+}xml_json_t;
+
+/**
+ * @brief Tag nested in a tag of a document written to JSON.
+ */
+typedef struct xml_json_item_t
+{
+	xml_tag_t * tag_t; /**< The tag */
+	long        rank;  /**< Position of the tag in the run of tags with its name */
+	bool        last;  /**< The tag ends its run */
+	bool        array; /**< The run is written as an array */
+}xml_json_item_t;
+
+/**
+ * @brief Tag of a document whose nested tags are being written to JSON.
+ */
+typedef struct xml_json_branch_t
+{
+	long first;   /**< First item of the nested tags */
+	long count;   /**< Number of nested tags */
+	long next;    /**< Next item to be written */
+	long members; /**< Keys written in the object of the tag */
+}xml_json_branch_t;
+
+/**
+ * @brief Slot of the table of the names of a list of tags.
+ */
+typedef struct xml_json_group_t
+{
+	char * name;   /**< Name of the tags, NULL if the slot is empty */
+	long   length; /**< Length of the name */
+}xml_json_group_t;
+
+/**
+ * @brief State of a document being written to JSON.
+ */
+typedef struct xml_json_tree_t
+{
+	xml_json_t        * json_t;            /**< Output of the conversion */
+	xml_json_item_t   * items;             /**< Nested tags of the open branches */
+	long                items_length;      /**< Number of items used */
+	long                items_capacity;    /**< Number of items allocated */
+	xml_json_branch_t * branches;          /**< Tags whose nested tags are being written, the document first */
+	long                depth;             /**< Number of branches used */
+	long                branches_capacity; /**< Number of branches allocated */
+	xml_json_group_t  * groups;            /**< Table of the names of the list being pushed */
+	long                groups_capacity;   /**< Number of slots allocated */
+}xml_json_tree_t;
+
+/**
+ * @brief Object or array open while reading a JSON text.
+ */
+typedef struct xml_json_level_t
+{
+	xml_tag_t       * tag_t;       /**< Tag of the object, NULL for the document and arrays */
+	xml_tag_t       * last_t;      /**< Last tag nested in the tag or the document */
+	xml_attribute_t * attribute_t; /**< Last attribute of the tag */
+	char            * name;        /**< Interned name of the tags of an array, NULL for objects */
+	long              name_length; /**< Length of the name */
+	long              count;       /**< Members or items read */
+}xml_json_level_t;
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+void libjxml_json_init (xml_json_t * json_t, xml_sink_t * sink_t, xml_json_options_t * options_t, bool stable);
+void libjxml_json_release (xml_json_t * json_t);
+void libjxml_json_handler (xml_handler_t * handler_t, xml_json_t * json_t);
+void libjxml_json_flush (xml_json_t * json_t, bool all);
+void libjxml_json_reserve (xml_json_t * json_t, long size);
+void libjxml_json_put (xml_json_t * json_t, const char * text, long length);
+char * libjxml_json_decoded (xml_json_t * json_t, char * text, long * length);
+void libjxml_json_string (xml_json_t * json_t, char * text, long length, bool decode);
+void libjxml_json_key (xml_json_t * json_t, long * members, char * prefix, long prefix_length,
+					   char * name, long length);
+void libjxml_json_open (xml_json_t * json_t, xml_json_frame_t * frame_t);
+void libjxml_json_close_run (xml_json_t * json_t, xml_json_frame_t * frame_t);
+bool libjxml_json_array (xml_json_t * json_t, char * name, long length);
+bool libjxml_json_repeated (char * name, long length);
+bool libjxml_json_start (xml_json_t * json_t, char * name, long length);
+void libjxml_json_attribute (xml_json_t * json_t, char * name, long name_length,
+							 char * value, long value_length, bool decode);
+void libjxml_json_text (xml_json_t * json_t, char * text, long length, bool decode);
+void libjxml_json_end (xml_json_t * json_t);
+void libjxml_json_finish (xml_json_t * json_t);
+
+bool libjxml_json_tree_push (xml_json_tree_t * tree_t, xml_tag_t * first_t, long members);
+unsigned long libjxml_json_tree_hash (char * name, long length);
+bool libjxml_json_tree_tag (xml_json_tree_t * tree_t, xml_tag_t * tag_t);
+void libjxml_json_tree_close (xml_json_tree_t * tree_t);
+
+bool libjxml_json_sax_start (void * context, char * name, long length);
+bool libjxml_json_sax_attribute (void * context, char * name, long name_length, char * value, long value_length);
+bool libjxml_json_sax_text (void * context, char * text, long length);
+bool libjxml_json_sax_cdata (void * context, char * text, long length);
+bool libjxml_json_sax_end (void * context, char * name, long length);
+
+long libjxml_json_space (char * json_txt, long position, long length);
+char * libjxml_json_read_string (char * json_txt, long * position, long length, char ** scratch, long * capacity,
+								 long * decoded);
+long libjxml_json_utf8 (char * target, unsigned long code);
+long libjxml_json_hex4 (char * text);
+bool libjxml_json_name (char * name, long length);
+char * libjxml_json_read_scalar (char * json_txt, long * position, long length, char ** scratch, long * capacity,
+								 long * value_length, bool * null);
+void libjxml_json_link (xml_t * xml_mem_t, xml_json_level_t * owner_t, xml_tag_t * tag_t);
+xml_t * libjxml_json_error (xml_t * xml_mem_t, xml_json_level_t * levels, char ** buffers, long position, char * message);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+bool libjxml_xml_to_json (char * xml_txt, long length, xml_sink_t * sink_t, xml_json_options_t * options_t)
+{
+	xml_handler_t handler_t;
+	xml_json_t json_t;
+	bool result;
+
+	libjxml_json_init (&json_t, sink_t, options_t, true);
+	libjxml_json_handler (&handler_t, &json_t);
+
+	result = libjxml_sax_buffer (xml_txt, length, &handler_t);
+
+	if (result == true)
+		libjxml_json_finish (&json_t);
+
+	libjxml_json_release (&json_t);
+
+	return result;
+}
+
+bool libjxml_fd_to_json (int xml_fd, xml_sink_t * sink_t, xml_json_options_t * options_t)
+{
+	xml_handler_t handler_t;
+	xml_json_t json_t;
+	bool result;
+
+	libjxml_json_init (&json_t, sink_t, options_t, false);
+	libjxml_json_handler (&handler_t, &json_t);
+
+	result = libjxml_sax_fd (xml_fd, 0, &handler_t);
+
+	if (result == true)
+		libjxml_json_finish (&json_t);
+
+	libjxml_json_release (&json_t);
+
+	return result;
+}
+
+/*
+ * The tree is walked in a loop, with a branch for each tag whose nested tags
+ * are being written.
+ */
+bool libjxml_mem_to_json (xml_t * xml_mem_t, xml_sink_t * sink_t, xml_json_options_t * options_t)
+{
+	xml_json_branch_t * branch_t;
+	xml_json_item_t * item_t;
+	xml_json_tree_t tree_t;
+	xml_json_t json_t;
+	bool result;
+
+	libjxml_json_init (&json_t, sink_t, options_t, true);
+
+	memset (&tree_t, 0, sizeof (xml_json_tree_t));
+	tree_t.json_t = &json_t;
+
+	result = libjxml_json_tree_push (&tree_t, xml_mem_t->content_t, 0);
+
+	while ((result == true) && (tree_t.depth > 0))
+	{
+		branch_t = &tree_t.branches [tree_t.depth - 1];
+
+		if (branch_t->next == branch_t->first + branch_t->count)
+		{
+			tree_t.items_length = branch_t->first;
+			tree_t.depth--;
+
+			/* The object of the tag of the branch is ended, the document by libjxml_json_finish() */
+			if (tree_t.depth > 0)
+			{
+				libjxml_json_put (&json_t, "}", 1);
+				libjxml_json_tree_close (&tree_t);
+			}
+			continue;
+		}
+
+		item_t = &tree_t.items [branch_t->next++];
+
+		if (item_t->rank == 0)
+		{
+			libjxml_json_key (&json_t, &branch_t->members, "", 0, item_t->tag_t->name, item_t->tag_t->name_length);
+
+			if (item_t->array == true)
+				libjxml_json_put (&json_t, "[", 1);
+		}
+		else
+			libjxml_json_put (&json_t, ",", 1);
+
+		result = libjxml_json_tree_tag (&tree_t, item_t->tag_t);
+
+		libjxml_json_flush (&json_t, false);
+	}
+
+	if (result == true)
+		libjxml_json_finish (&json_t);
+
+	libjxml_json_release (&json_t);
+
+	free (tree_t.items);
+	free (tree_t.branches);
+	free (tree_t.groups);
+
+	return result;
+}
+
+/*
+ * Each level keeps the last tag nested in it and its last attribute, so every
+ * node is linked in constant time, and the items of an array are nested in the
+ * level below it.
+ */
+xml_t * libjxml_json_to_mem (char * json_txt, long length, int mode, xml_json_options_t * options_t)
+{
+	xml_json_level_t * levels;
+	xml_json_level_t * level_t;
+	xml_json_level_t * owner_t;
+	xml_attribute_t * attribute_t;
+	xml_tag_t * tag_t;
+	xml_t * xml_mem_t;
+	char * buffers [2] = {NULL, NULL};
+	long capacities [2] = {0, 0};
+	char * prefix = LIBJXML_JSON_PREFIX;
+	char * text_key = LIBJXML_JSON_TEXT;
+	char * name;
+	char * value;
+	long prefix_length, text_key_length;
+	long name_length, value_length;
+	long depth, capacity, position;
+	bool null;
+	char c;
+
+	if ((options_t != NULL) && (options_t->prefix != NULL))
+		prefix = options_t->prefix;
+
+	if ((options_t != NULL) && (options_t->text_key != NULL))
+		text_key = options_t->text_key;
+
+	prefix_length = strlen (prefix);
+	text_key_length = strlen (text_key);
+
+	xml_mem_t = libjxml_create_xml_mem (mode & LIBJXML_MODE_ARENA);
+
+	capacity = LIBJXML_JSON_DEPTH;
+	levels = (xml_json_level_t *) malloc (capacity * sizeof (xml_json_level_t));
+	LIBASSERT_PTR (levels);
+
+	position = libjxml_json_space (json_txt, 0, length);
+
+	if ((position == length) || (json_txt [position] != '{'))
+		return libjxml_json_error (xml_mem_t, levels, buffers, position, "The text is not an object");
+
+	memset (&levels [0], 0, sizeof (xml_json_level_t));
+	depth = 1;
+	position++;
+
+	while (depth > 0)
+	{
+		level_t = &levels [depth - 1];
+		position = libjxml_json_space (json_txt, position, length);
+
+		if (position == length)
+			return libjxml_json_error (xml_mem_t, levels, buffers, position, "Unexpected end");
+
+		c = json_txt [position];
+
+		if (c == ((level_t->name != NULL) ? ']' : '}'))
+		{
+			/* The document holds a single root tag */
+			if ((depth == 1) && (level_t->count != 1))
+				return libjxml_json_error (xml_mem_t, levels, buffers, position, "The object must have a single key");
+
+			depth--;
+			position++;
+			continue;
+		}
+
+		if (level_t->count > 0)
+		{
+			if (c != ',')
+				return libjxml_json_error (xml_mem_t, levels, buffers, position, "Expected ','");
+
+			position = libjxml_json_space (json_txt, position + 1, length);
+		}
+
+		level_t->count++;
+
+		/* Items of arrays take the name of the array and are nested in its owner */
+		if (level_t->name != NULL)
+		{
+			name = level_t->name;
+			name_length = level_t->name_length;
+			owner_t = &levels [depth - 2];
+		}
+		else
+		{
+			name = libjxml_json_read_string (json_txt, &position, length, &buffers [0], &capacities [0], &name_length);
+			if (name == NULL)
+				return libjxml_json_error (xml_mem_t, levels, buffers, position, "Expected a key");
+
+			position = libjxml_json_space (json_txt, position, length);
+			if ((position == length) || (json_txt [position] != ':'))
+				return libjxml_json_error (xml_mem_t, levels, buffers, position, "Expected ':'");
+
+			position = libjxml_json_space (json_txt, position + 1, length);
+			owner_t = level_t;
+
+			/* Keys of attributes and texts only belong to tags, not to the document */
+			if ((level_t->tag_t != NULL) && (name_length > prefix_length) &&
+				(memcmp (name, prefix, prefix_length) == 0))
+			{
+				if (libjxml_json_name (name + prefix_length, name_length - prefix_length) == false)
+					return libjxml_json_error (xml_mem_t, levels, buffers, position, "Keys must be XML names");
+
+				value = libjxml_json_read_scalar (json_txt, &position, length, &buffers [1], &capacities [1],
+												  &value_length, &null);
+				if (value == NULL)
+					return libjxml_json_error (xml_mem_t, levels, buffers, position, "Attributes must be scalars");
+
+				attribute_t = libjxml_new_attribute (xml_mem_t);
+				attribute_t->name = libjxml_names_intern (xml_mem_t->names_t, name + prefix_length,
+														  name_length - prefix_length);
+				attribute_t->name_length = name_length - prefix_length;
+				attribute_t->value = libjxml_store_token (xml_mem_t, value, value_length);
+				attribute_t->value_length = value_length;
+
+				if (level_t->attribute_t != NULL)
+					level_t->attribute_t->next_attribute_t = attribute_t;
+				else
+					level_t->tag_t->attribute_t = attribute_t;
+
+				level_t->attribute_t = attribute_t;
+				continue;
+			}
+
+			if ((level_t->tag_t != NULL) && (name_length == text_key_length) &&
+				(memcmp (name, text_key, text_key_length) == 0))
+			{
+				value = libjxml_json_read_scalar (json_txt, &position, length, &buffers [1], &capacities [1],
+												  &value_length, &null);
+				if (value == NULL)
+					return libjxml_json_error (xml_mem_t, levels, buffers, position, "Texts must be scalars");
+
+				if ((null == false) && (level_t->tag_t->nested_tag_t == NULL))
+					libjxml_set_value (xml_mem_t, level_t->tag_t, value, value_length);
+				continue;
+			}
+
+			if (libjxml_json_name (name, name_length) == false)
+				return libjxml_json_error (xml_mem_t, levels, buffers, position, "Keys must be XML names");
+
+			name = libjxml_names_intern (xml_mem_t->names_t, name, name_length);
+		}
+
+		if (position == length)
+			return libjxml_json_error (xml_mem_t, levels, buffers, position, "Unexpected end");
+
+		c = json_txt [position];
+
+		if (c == '[')
+		{
+			if (level_t->name != NULL)
+				return libjxml_json_error (xml_mem_t, levels, buffers, position, "Arrays can not be nested in arrays");
+
+			if (depth == 1)
+				return libjxml_json_error (xml_mem_t, levels, buffers, position, "The root can not be an array");
+
+			position++;
+			tag_t = NULL;
+		}
+		else
+		{
+			tag_t = libjxml_new_tag (xml_mem_t);
+			tag_t->name = name;
+			tag_t->name_length = name_length;
+			libjxml_json_link (xml_mem_t, owner_t, tag_t);
+
+			if (c == '{')
+				position++;
+			else
+			{
+				value = libjxml_json_read_scalar (json_txt, &position, length, &buffers [1], &capacities [1],
+												  &value_length, &null);
+				if (value == NULL)
+					return libjxml_json_error (xml_mem_t, levels, buffers, position, "Expected a value");
+
+				if (null == false)
+				{
+					tag_t->value = libjxml_store_token (xml_mem_t, value, value_length);
+					tag_t->value_length = value_length;
+				}
+				continue;
+			}
+		}
+
+		/* An object or an array is opened, so 'level_t' may move with the stack */
+		if (depth == capacity)
+		{
+			capacity = capacity * 2;
+			levels = (xml_json_level_t *) realloc (levels, capacity * sizeof (xml_json_level_t));
+			LIBASSERT_PTR (levels);
+		}
+
+		level_t = &levels [depth];
+		memset (level_t, 0, sizeof (xml_json_level_t));
+		depth++;
+
+		if (tag_t != NULL)
+			level_t->tag_t = tag_t;
+		else
+		{
+			level_t->name = name;
+			level_t->name_length = name_length;
+		}
+	}
+
+	if (libjxml_json_space (json_txt, position, length) != length)
+		return libjxml_json_error (xml_mem_t, levels, buffers, position, "Text after the object");
+
+	free (levels);
+	free (buffers [0]);
+	free (buffers [1]);
+
+	return xml_mem_t;
+}
+
+/*********************************************************************************
+ *                                    OUTPUT
+ *********************************************************************************/
+
+void libjxml_json_init (xml_json_t * json_t, xml_sink_t * sink_t, xml_json_options_t * options_t, bool stable)
+{
+	memset (json_t, 0, sizeof (xml_json_t));
+
+	json_t->sink_t = sink_t;
+	json_t->stable = stable;
+
+	json_t->prefix = LIBJXML_JSON_PREFIX;
+	json_t->text_key = LIBJXML_JSON_TEXT;
+
+	if ((options_t != NULL) && (options_t->prefix != NULL))
+		json_t->prefix = options_t->prefix;
+
+	if ((options_t != NULL) && (options_t->text_key != NULL))
+		json_t->text_key = options_t->text_key;
+
+	json_t->prefix_length = strlen (json_t->prefix);
+	json_t->text_key_length = strlen (json_t->text_key);
+
+	if (options_t != NULL)
+		json_t->arrays = options_t->arrays;
+
+	json_t->capacity = LIBJXML_JSON_BUFFER;
+	json_t->output = (char *) malloc (json_t->capacity * sizeof (char));
+	LIBASSERT_PTR (json_t->output);
+
+	json_t->frames_capacity = LIBJXML_JSON_DEPTH;
+	json_t->frames = (xml_json_frame_t *) malloc (json_t->frames_capacity * sizeof (xml_json_frame_t));
+	LIBASSERT_PTR (json_t->frames);
+
+	json_t->names_capacity = LIBJXML_JSON_NAMES;
+	json_t->names = (char *) malloc (json_t->names_capacity * sizeof (char));
+	LIBASSERT_PTR (json_t->names);
+
+	/* The document is the object holding the root tag */
+	memset (&json_t->frames [0], 0, sizeof (xml_json_frame_t));
+	json_t->frames [0].last = -1;
+	json_t->frames [0].object = true;
+	json_t->frames [0].valued = true;
+	json_t->depth = 1;
+
+	libjxml_json_put (json_t, "{", 1);
+}
+
+/*
+ * Whatever is still in the output is given to the sink, also after an error.
+ */
+void libjxml_json_release (xml_json_t * json_t)
+{
+	libjxml_json_flush (json_t, true);
+
+	free (json_t->output);
+	free (json_t->frames);
+	free (json_t->names);
+	free (json_t->pending);
+	free (json_t->scratch);
+}
+
+void libjxml_json_handler (xml_handler_t * handler_t, xml_json_t * json_t)
+{
+	memset (handler_t, 0, sizeof (xml_handler_t));
+
+	handler_t->context = json_t;
+	handler_t->start_tag = libjxml_json_sax_start;
+	handler_t->attribute = libjxml_json_sax_attribute;
+	handler_t->text = libjxml_json_sax_text;
+	handler_t->cdata = libjxml_json_sax_cdata;
+	handler_t->end_tag = libjxml_json_sax_end;
+	handler_t->terminate = false;
+}
+
+/*
+ * Gives the output to the sink once it holds LIBJXML_JSON_BUFFER bytes, or
+ * whatever it holds with 'all'.
+ */
+void libjxml_json_flush (xml_json_t * json_t, bool all)
+{
+	if ((all == false) && (json_t->length < LIBJXML_JSON_BUFFER))
+		return;
+
+	if (json_t->length > 0)
+		libjxml_sink_write (json_t->sink_t, json_t->output, json_t->length);
+
+	json_t->length = 0;
+}
+
+void libjxml_json_reserve (xml_json_t * json_t, long size)
+{
+	if (json_t->length + size <= json_t->capacity)
+		return;
+
+	while (json_t->length + size > json_t->capacity)
+		json_t->capacity = json_t->capacity * 2;
+
+	json_t->output = (char *) realloc (json_t->output, json_t->capacity * sizeof (char));
+	LIBASSERT_PTR (json_t->output);
+}
+
+void libjxml_json_put (xml_json_t * json_t, const char * text, long length)
+{
+	libjxml_json_reserve (json_t, length);
+
+	memcpy (json_t->output + json_t->length, text, length);
+	json_t->length = json_t->length + length;
+}
+
+/*
+ * Texts without entities are used as they are, the others are decoded in the
+ * scratch buffer, which is never longer than the text.
+ */
+char * libjxml_json_decoded (xml_json_t * json_t, char * text, long * length)
+{
+	if (libjxml_entity_find (text, *length) == *length)
+		return text;
+
+	if (*length > json_t->scratch_capacity)
+	{
+		json_t->scratch_capacity = (*length > LIBJXML_JSON_SCRATCH) ? *length : LIBJXML_JSON_SCRATCH;
+		json_t->scratch = (char *) realloc (json_t->scratch, json_t->scratch_capacity * sizeof (char));
+		LIBASSERT_PTR (json_t->scratch);
+	}
+
+	*length = libjxml_entity_decode (json_t->scratch, text, *length);
+
+	return json_t->scratch;
+}
+
+/*
+ * The room of the longest escaped string is reserved at once, six bytes for each
+ * character, so the runs of characters not escaped are copied without checks.
+ */
+void libjxml_json_string (xml_json_t * json_t, char * text, long length, bool decode)
+{
+	char * target;
+	long start = 0;
+	long index;
+	char escape;
+
+	if (decode == true)
+		text = libjxml_json_decoded (json_t, text, &length);
+
+	libjxml_json_reserve (json_t, length * 6 + 2);
+	target = json_t->output + json_t->length;
+
+	*target++ = '"';
+
+	for (index = 0; index < length; index++)
+	{
+		escape = libjxml_json_escapes [(unsigned char) text [index]];
+
+		if (escape == 0)
+			continue;
+
+		memcpy (target, text + start, index - start);
+		target = target + (index - start);
+		start = index + 1;
+
+		*target++ = '\\';
+		*target++ = escape;
+
+		if (escape == 'u')
+		{
+			*target++ = '0';
+			*target++ = '0';
+			*target++ = libjxml_json_hex [(unsigned char) text [index] >> 4];
+			*target++ = libjxml_json_hex [(unsigned char) text [index] & 0x0F];
+		}
+	}
+
+	memcpy (target, text + start, length - start);
+	target = target + (length - start);
+
+	*target++ = '"';
+
+	json_t->length = target - json_t->output;
+}
+
+/* Names of tags and attributes have no characters to be escaped */
+void libjxml_json_key (xml_json_t * json_t, long * members, char * prefix, long prefix_length,
+					   char * name, long length)
+{
+	char * target;
+
+	libjxml_json_reserve (json_t, prefix_length + length + 4);
+	target = json_t->output + json_t->length;
+
+	if (*members > 0)
+		*target++ = ',';
+
+	*target++ = '"';
+	memcpy (target, prefix, prefix_length);
+	target = target + prefix_length;
+	memcpy (target, name, length);
+	target = target + length;
+	*target++ = '"';
+	*target++ = ':';
+
+	json_t->length = target - json_t->output;
+	(*members)++;
+}
+
+void libjxml_json_open (xml_json_t * json_t, xml_json_frame_t * frame_t)
+{
+	if (frame_t->object == true)
+		return;
+
+	libjxml_json_put (json_t, "{", 1);
+	frame_t->object = true;
+}
+
+void libjxml_json_close_run (xml_json_t * json_t, xml_json_frame_t * frame_t)
+{
+	if (frame_t->array == true)
+		libjxml_json_put (json_t, "]", 1);
+
+	frame_t->array = false;
+}
+
+bool libjxml_json_array (xml_json_t * json_t, char * name, long length)
+{
+	char ** array;
+
+	if (json_t->arrays == NULL)
+		return true;
+
+	for (array = json_t->arrays; *array != NULL; array++)
+		if ((strncmp (*array, name, length) == 0) && ((*array) [length] == '\0'))
+			return true;
+
+	return false;
+}
+
+bool libjxml_json_repeated (char * name, long length)
+{
+	fprintf (stderr, "\nLibXML: Error converting to JSON, key %.*s repeated", (int) length, name);
+
+	return false;
+}
+
+/*********************************************************************************
+ *                                    EVENTS
+ *********************************************************************************/
+
+/*
+ * A tag with the name of the last one nested in its parent is the next item of
+ * its array. Any other one ends the run and starts a new one, with its name
+ * kept after the keys of the parent, unless it is already one of them.
+ */
+bool libjxml_json_start (xml_json_t * json_t, char * name, long length)
+{
+	xml_json_frame_t * frame_t;
+	char * key;
+
+	frame_t = &json_t->frames [json_t->depth - 1];
+
+	/* A tag with nested tags has no value */
+	libjxml_json_open (json_t, frame_t);
+	frame_t->valued = true;
+	json_t->text = NULL;
+
+	key = (frame_t->last >= 0) ? json_t->names + frame_t->last : NULL;
+
+	if ((key != NULL) && (strncmp (key, name, length) == 0) && (key [length] == '\0'))
+	{
+		if (frame_t->array == false)
+			return libjxml_json_repeated (name, length);
+
+		libjxml_json_put (json_t, ",", 1);
+	}
+	else
+	{
+		for (key = json_t->names + frame_t->base; key < json_t->names + json_t->names_length; key += strlen (key) + 1)
+			if ((strncmp (key, name, length) == 0) && (key [length] == '\0'))
+				return libjxml_json_repeated (name, length);
+
+		libjxml_json_close_run (json_t, frame_t);
+
+		if (json_t->names_length + length + 1 > json_t->names_capacity)
+		{
+			while (json_t->names_length + length + 1 > json_t->names_capacity)
+				json_t->names_capacity = json_t->names_capacity * 2;
+
+			json_t->names = (char *) realloc (json_t->names, json_t->names_capacity * sizeof (char));
+			LIBASSERT_PTR (json_t->names);
+		}
+
+		frame_t->last = json_t->names_length;
+		memcpy (json_t->names + json_t->names_length, name, length);
+		json_t->names [json_t->names_length + length] = '\0';
+		json_t->names_length = json_t->names_length + length + 1;
+
+		libjxml_json_key (json_t, &frame_t->members, "", 0, name, length);
+
+		/* The root is never in an array */
+		if ((json_t->depth > 1) && (libjxml_json_array (json_t, name, length) == true))
+		{
+			libjxml_json_put (json_t, "[", 1);
+			frame_t->array = true;
+		}
+	}
+
+	if (json_t->depth == json_t->frames_capacity)
+	{
+		json_t->frames_capacity = json_t->frames_capacity * 2;
+		json_t->frames = (xml_json_frame_t *) realloc (json_t->frames,
+													   json_t->frames_capacity * sizeof (xml_json_frame_t));
+		LIBASSERT_PTR (json_t->frames);
+	}
+
+	frame_t = &json_t->frames [json_t->depth];
+	memset (frame_t, 0, sizeof (xml_json_frame_t));
+	frame_t->base = json_t->names_length;
+	frame_t->last = -1;
+	json_t->depth++;
+
+	return true;
+}
+
+void libjxml_json_attribute (xml_json_t * json_t, char * name, long name_length,
+							 char * value, long value_length, bool decode)
+{
+	xml_json_frame_t * frame_t;
+
+	frame_t = &json_t->frames [json_t->depth - 1];
+
+	libjxml_json_open (json_t, frame_t);
+	libjxml_json_key (json_t, &frame_t->members, json_t->prefix, json_t->prefix_length, name, name_length);
+	libjxml_json_string (json_t, value, value_length, decode);
+}
+
+/*
+ * Only the first text that is not blank is taken, and dropped if a nested tag
+ * follows, as it is the value of the tag in its tree.
+ */
+void libjxml_json_text (xml_json_t * json_t, char * text, long length, bool decode)
+{
+	xml_json_frame_t * frame_t;
+	long index;
+
+	frame_t = &json_t->frames [json_t->depth - 1];
+
+	if (frame_t->valued == true)
+		return;
+
+	for (index = 0; index < length; index++)
+		if ((text [index] != ' ') && (text [index] != '\t') && (text [index] != '\n') && (text [index] != '\r'))
+			break;
+
+	if (index == length)
+		return;
+
+	frame_t->valued = true;
+
+	if ((json_t->stable == false) && (length > json_t->pending_capacity))
+	{
+		json_t->pending_capacity = (length > LIBJXML_JSON_SCRATCH) ? length : LIBJXML_JSON_SCRATCH;
+		json_t->pending = (char *) realloc (json_t->pending, json_t->pending_capacity * sizeof (char));
+		LIBASSERT_PTR (json_t->pending);
+	}
+
+	if (json_t->stable == false)
+	{
+		memcpy (json_t->pending, text, length);
+		text = json_t->pending;
+	}
+
+	json_t->text = text;
+	json_t->text_length = length;
+	json_t->decode = decode;
+}
+
+void libjxml_json_end (xml_json_t * json_t)
+{
+	xml_json_frame_t * frame_t;
+
+	frame_t = &json_t->frames [json_t->depth - 1];
+
+	if ((frame_t->object == true) && (json_t->text != NULL))
+	{
+		libjxml_json_key (json_t, &frame_t->members, "", 0, json_t->text_key, json_t->text_key_length);
+		libjxml_json_string (json_t, json_t->text, json_t->text_length, json_t->decode);
+		libjxml_json_put (json_t, "}", 1);
+		json_t->text = NULL;
+	}
+	else if (frame_t->object == true)
+	{
+		libjxml_json_close_run (json_t, frame_t);
+		libjxml_json_put (json_t, "}", 1);
+	}
+	else if (json_t->text != NULL)
+	{
+		libjxml_json_string (json_t, json_t->text, json_t->text_length, json_t->decode);
+		json_t->text = NULL;
+	}
+	else
+		libjxml_json_put (json_t, "null", 4);
+
+	json_t->depth--;
+	json_t->names_length = frame_t->base;
+
+	libjxml_json_flush (json_t, false);
+}
+
+void libjxml_json_finish (xml_json_t * json_t)
+{
+	libjxml_json_close_run (json_t, &json_t->frames [0]);
+	libjxml_json_put (json_t, "}", 1);
+}
+
+/*********************************************************************************
+ *                                     TREES
+ *********************************************************************************/
+
+/*
+ * Appends the items of a list of tags, each run of tags with the same name
+ * after the other. The names of the runs are kept in an open addressing table,
+ * where a run with the name of an earlier one is found. Tags of the document
+ * list, the root, are never in an array.
+ */
+bool libjxml_json_tree_push (xml_json_tree_t * tree_t, xml_tag_t * first_t, long members)
+{
+	xml_json_branch_t * branch_t;
+	xml_json_group_t * group_t;
+	xml_json_item_t * item_t;
+	xml_json_item_t * previous_t;
+	xml_tag_t * tag_t;
+	unsigned long mask;
+	unsigned long slot;
+	long capacity = LIBJXML_JSON_DEPTH;
+	long count = 0;
+
+	for (tag_t = first_t; tag_t != NULL; tag_t = tag_t->sibling_tag_t)
+		count++;
+
+	while (capacity < 2 * count)
+		capacity = capacity * 2;
+
+	if (capacity > tree_t->groups_capacity)
+	{
+		tree_t->groups_capacity = capacity;
+		free (tree_t->groups);
+		tree_t->groups = (xml_json_group_t *) malloc (tree_t->groups_capacity * sizeof (xml_json_group_t));
+		LIBASSERT_PTR (tree_t->groups);
+	}
+
+	memset (tree_t->groups, 0, capacity * sizeof (xml_json_group_t));
+	mask = capacity - 1;
+
+	if (tree_t->items_length + count > tree_t->items_capacity)
+	{
+		while (tree_t->items_length + count > tree_t->items_capacity)
+			tree_t->items_capacity = (tree_t->items_capacity == 0) ? LIBJXML_JSON_NAMES : tree_t->items_capacity * 2;
+
+		tree_t->items = (xml_json_item_t *) realloc (tree_t->items, tree_t->items_capacity * sizeof (xml_json_item_t));
+		LIBASSERT_PTR (tree_t->items);
+	}
+
+	item_t = &tree_t->items [tree_t->items_length];
+	previous_t = NULL;
+
+	for (tag_t = first_t; tag_t != NULL; tag_t = tag_t->sibling_tag_t, item_t++)
+	{
+		item_t->tag_t = tag_t;
+		item_t->last = true;
+
+		if ((previous_t != NULL) && (previous_t->tag_t->name_length == tag_t->name_length) &&
+			((previous_t->tag_t->name == tag_t->name) ||
+			 (memcmp (previous_t->tag_t->name, tag_t->name, tag_t->name_length) == 0)))
+		{
+			if (previous_t->array == false)
+				return libjxml_json_repeated (tag_t->name, tag_t->name_length);
+
+			item_t->rank = previous_t->rank + 1;
+			item_t->array = true;
+			previous_t->last = false;
+			previous_t = item_t;
+			continue;
+		}
+
+		slot = libjxml_json_tree_hash (tag_t->name, tag_t->name_length) & mask;
+		group_t = &tree_t->groups [slot];
+
+		while ((group_t->name != NULL) &&
+			   ((group_t->length != tag_t->name_length) ||
+				((group_t->name != tag_t->name) && (memcmp (group_t->name, tag_t->name, group_t->length) != 0))))
+		{
+			slot = (slot + 1) & mask;
+			group_t = &tree_t->groups [slot];
+		}
+
+		if (group_t->name != NULL)
+			return libjxml_json_repeated (tag_t->name, tag_t->name_length);
+
+		group_t->name = tag_t->name;
+		group_t->length = tag_t->name_length;
+
+		item_t->rank = 0;
+		item_t->array = (tree_t->depth > 0) && libjxml_json_array (tree_t->json_t, tag_t->name, tag_t->name_length);
+		previous_t = item_t;
+	}
+
+	if (tree_t->depth == tree_t->branches_capacity)
+	{
+		tree_t->branches_capacity = (tree_t->depth == 0) ? LIBJXML_JSON_DEPTH : tree_t->depth * 2;
+		tree_t->branches = (xml_json_branch_t *) realloc (tree_t->branches,
+														  tree_t->branches_capacity * sizeof (xml_json_branch_t));
+		LIBASSERT_PTR (tree_t->branches);
+	}
+
+	branch_t = &tree_t->branches [tree_t->depth++];
+	branch_t->first = tree_t->items_length;
+	branch_t->count = count;
+	branch_t->next = tree_t->items_length;
+	branch_t->members = members;
+
+	tree_t->items_length = tree_t->items_length + count;
+
+	return true;
+}
+
+/* FNV-1a, names are short */
+unsigned long libjxml_json_tree_hash (char * name, long length)
+{
+	unsigned long hash = 14695981039346656037UL;
+	long index;
+
+	for (index = 0; index < length; index++)
+		hash = (hash ^ (unsigned char) name [index]) * 1099511628211UL;
+
+	return hash;
+}
+
+/*
+ * Writes a tag, or opens its object and pushes a branch for its nested tags, in
+ * which case the tag is ended once the branch is written. Returns false if the
+ * key of a nested tag would be repeated.
+ */
+bool libjxml_json_tree_tag (xml_json_tree_t * tree_t, xml_tag_t * tag_t)
+{
+	xml_json_t * json_t = tree_t->json_t;
+	xml_attribute_t * attribute_t;
+	long members = 0;
+
+	if ((tag_t->attribute_t == NULL) && (tag_t->nested_tag_t == NULL))
+	{
+		if (tag_t->value != NULL)
+			libjxml_json_string (json_t, tag_t->value, tag_t->value_length, false);
+		else
+			libjxml_json_put (json_t, "null", 4);
+
+		libjxml_json_tree_close (tree_t);
+		return true;
+	}
+
+	libjxml_json_put (json_t, "{", 1);
+
+	for (attribute_t = tag_t->attribute_t; attribute_t != NULL; attribute_t = attribute_t->next_attribute_t)
+	{
+		libjxml_json_key (json_t, &members, json_t->prefix, json_t->prefix_length,
+						  attribute_t->name, attribute_t->name_length);
+		libjxml_json_string (json_t, attribute_t->value, attribute_t->value_length, false);
+	}
+
+	/* A tag with nested tags has no value */
+	if (tag_t->nested_tag_t != NULL)
+		return libjxml_json_tree_push (tree_t, tag_t->nested_tag_t, members);
+
+	if (tag_t->value != NULL)
+	{
+		libjxml_json_key (json_t, &members, "", 0, json_t->text_key, json_t->text_key_length);
+		libjxml_json_string (json_t, tag_t->value, tag_t->value_length, false);
+	}
+
+	libjxml_json_put (json_t, "}", 1);
+	libjxml_json_tree_close (tree_t);
+
+	return true;
+}
+
+/*
+ * Ends the array of the last tag written in the top branch, if it ends its run.
+ */
+void libjxml_json_tree_close (xml_json_tree_t * tree_t)
+{
+	xml_json_branch_t * branch_t = &tree_t->branches [tree_t->depth - 1];
+	xml_json_item_t * item_t = &tree_t->items [branch_t->next - 1];
+
+	if ((item_t->array == true) && (item_t->last == true))
+		libjxml_json_put (tree_t->json_t, "]", 1);
+}
+
+/*********************************************************************************
+ *                                      SAX
+ *********************************************************************************/
+
+bool libjxml_json_sax_start (void * context, char * name, long length)
+{
+	return libjxml_json_start ((xml_json_t *) context, name, length);
+}
+
+bool libjxml_json_sax_attribute (void * context, char * name, long name_length, char * value, long value_length)
+{
+	libjxml_json_attribute ((xml_json_t *) context, name, name_length, value, value_length, true);
+
+	return true;
+}
+
+bool libjxml_json_sax_text (void * context, char * text, long length)
+{
+	libjxml_json_text ((xml_json_t *) context, text, length, true);
+
+	return true;
+}
+
+bool libjxml_json_sax_cdata (void * context, char * text, long length)
+{
+	libjxml_json_text ((xml_json_t *) context, text, length, false);
+
+	return true;
+}
+
+bool libjxml_json_sax_end (void * context, char * name, long length)
+{
+	(void) name;
+	(void) length;
+
+	libjxml_json_end ((xml_json_t *) context);
+
+	return true;
+}
+
+/*********************************************************************************
+ *                                     INPUT
+ *********************************************************************************/
+
+long libjxml_json_space (char * json_txt, long position, long length)
+{
+	while ((position < length) && ((json_txt [position] == ' ') || (json_txt [position] == '\t') ||
+								   (json_txt [position] == '\n') || (json_txt [position] == '\r')))
+		position++;
+
+	return position;
+}
+
+/*
+ * Strings without escapes are returned in place. The others are decoded in the
+ * scratch buffer, which is never longer than the string as written. Control
+ * characters are never valid written, and only tabs and line ends escaped, as
+ * the others are not allowed in XML, like U+FFFE and U+FFFF.
+ */
+char * libjxml_json_read_string (char * json_txt, long * position, long length, char ** scratch, long * capacity,
+								 long * decoded)
+{
+	unsigned long code, low;
+	long start, index;
+	char * target;
+
+	if ((*position == length) || (json_txt [*position] != '"'))
+		return NULL;
+
+	start = *position + 1;
+
+	for (index = start; (index < length) && (json_txt [index] != '"') && (json_txt [index] != '\\') &&
+		 ((unsigned char) json_txt [index] >= 0x20); index++);
+
+	if ((index == length) || ((unsigned char) json_txt [index] < 0x20))
+		return NULL;
+
+	if (json_txt [index] == '"')
+	{
+		*position = index + 1;
+		*decoded = index - start;
+		return json_txt + start;
+	}
+
+	if (length - start > *capacity)
+	{
+		*capacity = (length - start > LIBJXML_JSON_SCRATCH) ? length - start : LIBJXML_JSON_SCRATCH;
+		*scratch = (char *) realloc (*scratch, *capacity * sizeof (char));
+		LIBASSERT_PTR (*scratch);
+	}
+
+	memcpy (*scratch, json_txt + start, index - start);
+	target = *scratch + (index - start);
+
+	while ((index < length) && (json_txt [index] != '"'))
+	{
+		if ((unsigned char) json_txt [index] < 0x20)
+			return NULL;
+
+		if (json_txt [index] != '\\')
+		{
+			*target++ = json_txt [index++];
+			continue;
+		}
+
+		if (index + 1 == length)
+			return NULL;
+
+		index = index + 2;
+
+		switch (json_txt [index - 1])
+		{
+			case '"':  *target++ = '"';  break;
+			case '\\': *target++ = '\\'; break;
+			case '/':  *target++ = '/';  break;
+			case 'b':  *target++ = '\b'; break;
+			case 'f':  *target++ = '\f'; break;
+			case 'n':  *target++ = '\n'; break;
+			case 'r':  *target++ = '\r'; break;
+			case 't':  *target++ = '\t'; break;
+			case 'u':
+				if ((length - index < 4) || ((code = libjxml_json_hex4 (json_txt + index)) > 0xFFFF))
+					return NULL;
+
+				index = index + 4;
+
+				/* A high surrogate is only valid followed by a low one */
+				if ((code >= 0xD800) && (code <= 0xDBFF))
+				{
+					if ((length - index < 6) || (json_txt [index] != '\\') || (json_txt [index + 1] != 'u') ||
+						((low = libjxml_json_hex4 (json_txt + index + 2)) < 0xDC00) || (low > 0xDFFF))
+						return NULL;
+
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					index = index + 6;
+				}
+				else if ((code >= 0xDC00) && (code <= 0xDFFF))
+					return NULL;
+				else if (((code < 0x20) && (code != '\t') && (code != '\n') && (code != '\r')) ||
+						 (code == 0xFFFE) || (code == 0xFFFF))
+					return NULL;
+
+				target = target + libjxml_json_utf8 (target, code);
+				break;
+			default:
+				return NULL;
+		}
+	}
+
+	if (index == length)
+		return NULL;
+
+	*position = index + 1;
+	*decoded = target - *scratch;
+
+	return *scratch;
+}
+
+/* Characters take at most 4 bytes in UTF-8, never more than their escape */
+long libjxml_json_utf8 (char * target, unsigned long code)
+{
+	if (code < 0x80)
+	{
+		target [0] = (char) code;
+		return 1;
+	}
+
+	if (code < 0x800)
+	{
+		target [0] = (char) (0xC0 | (code >> 6));
+		target [1] = (char) (0x80 | (code & 0x3F));
+		return 2;
+	}
+
+	if (code < 0x10000)
+	{
+		target [0] = (char) (0xE0 | (code >> 12));
+		target [1] = (char) (0x80 | ((code >> 6) & 0x3F));
+		target [2] = (char) (0x80 | (code & 0x3F));
+		return 3;
+	}
+
+	target [0] = (char) (0xF0 | (code >> 18));
+	target [1] = (char) (0x80 | ((code >> 12) & 0x3F));
+	target [2] = (char) (0x80 | ((code >> 6) & 0x3F));
+	target [3] = (char) (0x80 | (code & 0x3F));
+	return 4;
+}
+
+/* Returns a value over 0xFFFF if any of the 4 characters is not a hex digit */
+long libjxml_json_hex4 (char * text)
+{
+	long code = 0;
+	int index;
+	char c;
+
+	for (index = 0; index < 4; index++)
+	{
+		c = text [index];
+
+		if ((c >= '0') && (c <= '9'))
+			code = (code << 4) | (c - '0');
+		else if ((c >= 'a') && (c <= 'f'))
+			code = (code << 4) | (c - 'a' + 10);
+		else if ((c >= 'A') && (c <= 'F'))
+			code = (code << 4) | (c - 'A' + 10);
+		else
+			return 0x10000;
+	}
+
+	return code;
+}
+
+/*
+ * Names start with a letter, '_' or ':', followed by them, digits, '-' or '.'.
+ * Bytes of UTF-8 sequences are taken as letters, as the parser does.
+ */
+bool libjxml_json_name (char * name, long length)
+{
+	unsigned char c;
+	long index;
+
+	if (length == 0)
+		return false;
+
+	for (index = 0; index < length; index++)
+	{
+		c = (unsigned char) name [index];
+
+		if (((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || (c == '_') || (c == ':') || (c >= 0x80))
+			continue;
+
+		if ((index == 0) || (((c < '0') || (c > '9')) && (c != '-') && (c != '.')))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Numbers, true and false are returned as written. Null gives an empty value
+ * with 'null' set, so attributes get an empty value and tags none.
+ */
+char * libjxml_json_read_scalar (char * json_txt, long * position, long length, char ** scratch, long * capacity,
+								 long * value_length, bool * null)
+{
+	long start = *position;
+	long index;
+
+	*null = false;
+
+	if (start == length)
+		return NULL;
+
+	if (json_txt [start] == '"')
+		return libjxml_json_read_string (json_txt, position, length, scratch, capacity, value_length);
+
+	for (index = start; index < length; index++)
+		if (((json_txt [index] < 'a') || (json_txt [index] > 'z')) &&
+			((json_txt [index] < '0') || (json_txt [index] > '9')) &&
+			(json_txt [index] != '-') && (json_txt [index] != '+') &&
+			(json_txt [index] != '.') && (json_txt [index] != 'E'))
+			break;
+
+	if (index == start)
+		return NULL;
+
+	*position = index;
+	*value_length = index - start;
+
+	if (libjxml_token_equal (json_txt + start, index - start, "null") == true)
+	{
+		*null = true;
+		*value_length = 0;
+		return "";
+	}
+
+	if ((libjxml_token_equal (json_txt + start, index - start, "true") == true) ||
+		(libjxml_token_equal (json_txt + start, index - start, "false") == true))
+		return json_txt + start;
+
+	/* Numbers start with a sign or a digit and have no other letter than the exponent */
+	index = (json_txt [start] == '-') ? start + 1 : start;
+
+	if ((index == *position) || (json_txt [index] < '0') || (json_txt [index] > '9'))
+		return NULL;
+
+	for (index = start; index < *position; index++)
+		if ((json_txt [index] >= 'a') && (json_txt [index] <= 'z') && (json_txt [index] != 'e'))
+			return NULL;
+
+	return json_txt + start;
+}
+
+/* A tag with nested tags has no value, as in the tree built by the parser */
+void libjxml_json_link (xml_t * xml_mem_t, xml_json_level_t * owner_t, xml_tag_t * tag_t)
+{
+	if ((owner_t->tag_t != NULL) && (owner_t->tag_t->value != NULL))
+		libjxml_set_value (xml_mem_t, owner_t->tag_t, NULL, 0);
+
+	if (owner_t->last_t != NULL)
+		owner_t->last_t->sibling_tag_t = tag_t;
+	else if (owner_t->tag_t != NULL)
+		owner_t->tag_t->nested_tag_t = tag_t;
+	else
+		xml_mem_t->content_t = tag_t;
+
+	owner_t->last_t = tag_t;
+}
+
+xml_t * libjxml_json_error (xml_t * xml_mem_t, xml_json_level_t * levels, char ** buffers, long position, char * message)
+{
+	fprintf (stderr, "\nLibXML: Error parsing JSON at %ld. %s.", position, message);
+
+	libjxml_free_xml_mem (xml_mem_t);
+
+	free (levels);
+	free (buffers [0]);
+	free (buffers [1]);
+
+	return NULL;
+}
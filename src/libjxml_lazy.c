@@ -0,0 +1,681 @@
+/**
+ * @file libjxml_lazy.c
+ *
+ * @brief Xml documents whose tags are built the first time they are read.
+ *
+ * The first pass reads the whole text with the event parser, checking it, and
+ * keeps an outline of it: for each tag in document order, the offset of its open
+ * tag and the position in the outline of the first tag after its nested ones. The
+ * tags of the first level are linked to the document with nothing else.
+ *
+ * Building a tag links its nested tags, found by jumping through the outline,
+ * and parses its open tag followed by a made up close tag, so the text of its
+ * nested tags is never read. Tags without nested tags are parsed up to their
+ * close tag, reading their value.
+ *
+ * A tag waiting to be built keeps in its value a pointer to its open tag in the
+ * text, with a length of 0, which no value built from the text has, so nothing
+ * else is stored for it.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libjxml_lazy.h"
+#include "libjxml_sax.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_LAZY_READ  (64L*1024L) /**< Initial buffer to read files that cannot be mapped */
+#define LIBJXML_LAZY_TAGS  1024        /**< Initial number of tags of the outline */
+#define LIBJXML_LAZY_DEPTH 32          /**< Initial depth of the open tag stack of the first pass */
+
+#define LIBJXML_IS_SPACE(c) (((c) == ' ')  || ((c) == '\n') || ((c) == '\t') || \
+							 ((c) == '\v') || ((c) == '\f') || ((c) == '\r'))
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Tag of the outline of the text.
+ */
+typedef struct xml_range_t
+{
+	long start; /**< Offset of the open tag in the text */
+	long next;  /**< Position in the outline of the first tag after the nested ones */
+}xml_range_t;
+
+struct xml_lazy_t
+{
+	xml_t       * xml_mem_t; /**< Tree of the document */
+	char        * text;      /**< Text of the document */
+	long          length;    /**< Length of the text */
+	bool          owned;     /**< The text is freed with the document */
+	bool          mapped;    /**< The owned text is a file mapped in memory */
+	xml_range_t * ranges;    /**< Outline of the text, every tag in document order */
+	long          count;     /**< Number of tags of the outline */
+	long          capacity;  /**< Number of tags allocated for the outline */
+};
+
+/**
+ * @brief State of the first pass.
+ */
+typedef struct xml_outline_t
+{
+	xml_lazy_t      * lazy_t;      /**< Document being read */
+	xml_tag_t       * last_t;      /**< Last tag linked at the first level */
+	xml_attribute_t * attribute_t; /**< Last attribute of the xml instruction */
+	long            * stack;       /**< Positions in the outline of the open tags */
+	long              depth;       /**< Number of open tags */
+	long              capacity;    /**< Number of positions allocated for the stack */
+}xml_outline_t;
+
+/**
+ * @brief State of the parse building a tag.
+ */
+typedef struct xml_expansion_t
+{
+	xml_lazy_t      * lazy_t;      /**< Document of the tag */
+	xml_tag_t       * tag_t;       /**< Tag being built */
+	xml_attribute_t * attribute_t; /**< Last attribute linked to the tag */
+	long              depth;       /**< Number of open tags */
+	bool              closed;      /**< The tag was closed */
+}xml_expansion_t;
+
+/*********************************************************************************
+ *                                 DECLARATIONS
+ *********************************************************************************/
+
+bool libjxml_lazy_open (void * context, char * name, long length);
+bool libjxml_lazy_close (void * context, char * name, long length);
+bool libjxml_lazy_instruction (void * context, char * name, long name_length, char * value, long value_length);
+
+xml_tag_t * libjxml_lazy_stub (xml_lazy_t * lazy_t, long start, char * name, long length);
+long libjxml_lazy_find (xml_lazy_t * lazy_t, long start);
+void libjxml_lazy_link (xml_lazy_t * lazy_t, xml_tag_t * tag_t, long position);
+bool libjxml_lazy_start (void * context, char * name, long length);
+bool libjxml_lazy_attribute (void * context, char * name, long name_length, char * value, long value_length);
+bool libjxml_lazy_text (void * context, char * text, long length);
+bool libjxml_lazy_cdata (void * context, char * text, long length);
+bool libjxml_lazy_store (xml_expansion_t * expansion_t, char * text, long length, bool decode);
+bool libjxml_lazy_end (void * context, char * name, long length);
+
+char * libjxml_lazy_read (int xml_fd, long * xml_length);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+xml_lazy_t * libjxml_lazy_create (char * xml_txt, long length, int mode)
+{
+	xml_outline_t outline_t;
+	xml_handler_t handler_t;
+	xml_lazy_t * lazy_t;
+	bool parsed;
+
+	lazy_t = (xml_lazy_t *) malloc (sizeof (xml_lazy_t));
+	LIBASSERT_PTR (lazy_t);
+
+	/* The text is parsed again later, and values pointing to it must never be freed */
+	lazy_t->xml_mem_t = libjxml_create_xml_mem ((mode & ~LIBJXML_MODE_TERMINATE) | LIBJXML_MODE_ARENA);
+	lazy_t->text = xml_txt;
+	lazy_t->length = length;
+	lazy_t->owned = false;
+	lazy_t->mapped = false;
+	lazy_t->count = 0;
+	lazy_t->capacity = LIBJXML_LAZY_TAGS;
+	lazy_t->ranges = (xml_range_t *) malloc (lazy_t->capacity * sizeof (xml_range_t));
+	LIBASSERT_PTR (lazy_t->ranges);
+
+	outline_t.lazy_t = lazy_t;
+	outline_t.last_t = NULL;
+	outline_t.attribute_t = NULL;
+	outline_t.depth = 0;
+	outline_t.capacity = LIBJXML_LAZY_DEPTH;
+	outline_t.stack = (long *) malloc (outline_t.capacity * sizeof (long));
+	LIBASSERT_PTR (outline_t.stack);
+
+	memset (&handler_t, 0, sizeof (xml_handler_t));
+	handler_t.context = &outline_t;
+	handler_t.start_tag = libjxml_lazy_open;
+	handler_t.end_tag = libjxml_lazy_close;
+	handler_t.instruction = libjxml_lazy_instruction;
+
+	lazy_t->xml_mem_t->generation++;
+
+	parsed = libjxml_sax_buffer (xml_txt, length, &handler_t);
+
+	free (outline_t.stack);
+
+	if (parsed == false)
+	{
+		libjxml_lazy_free (lazy_t);
+		return NULL;
+	}
+
+	return lazy_t;
+}
+
+/*
+ * The text must be kept while the document is used, so it is mapped privately
+ * like libjxml_file_to_mem_mode() does, or read in a buffer owned by the document.
+ */
+xml_lazy_t * libjxml_file_to_lazy (char * xml_name, int mode)
+{
+	struct stat xml_stat;
+	xml_lazy_t * lazy_t;
+	char * xml_txt = NULL;
+	long xml_length = 0;
+	bool mapped = false;
+	int xml_fd;
+
+	xml_fd = open (xml_name, O_RDONLY);
+	if (xml_fd < 0)
+	{
+		fprintf (stderr, "\nLibXML: Error opening file");
+		return NULL;
+	}
+
+	if ((fstat (xml_fd, &xml_stat) == 0) && S_ISREG (xml_stat.st_mode) && (xml_stat.st_size > 0))
+	{
+		xml_txt = (char *) mmap (NULL, xml_stat.st_size, PROT_READ, MAP_PRIVATE, xml_fd, 0);
+
+		if (xml_txt != MAP_FAILED)
+		{
+			xml_length = xml_stat.st_size;
+			mapped = true;
+		}
+		else
+		{
+			xml_txt = NULL;
+		}
+	}
+
+	if (mapped == false)
+		xml_txt = libjxml_lazy_read (xml_fd, &xml_length);
+
+	close (xml_fd);
+
+	if (xml_txt == NULL)
+		return NULL;
+
+	lazy_t = libjxml_lazy_create (xml_txt, xml_length, mode);
+	if (lazy_t == NULL)
+	{
+		if (mapped)
+			munmap (xml_txt, xml_length);
+		else
+			free (xml_txt);
+		return NULL;
+	}
+
+	lazy_t->owned = true;
+	lazy_t->mapped = mapped;
+
+	return lazy_t;
+}
+
+void libjxml_lazy_free (xml_lazy_t * lazy_t)
+{
+	if (lazy_t == NULL)
+		return;
+
+	libjxml_free_xml_mem (lazy_t->xml_mem_t);
+
+	if (lazy_t->owned && lazy_t->mapped)
+		munmap (lazy_t->text, lazy_t->length);
+	else if (lazy_t->owned)
+		free (lazy_t->text);
+
+	free (lazy_t->ranges);
+	free (lazy_t);
+}
+
+xml_t * libjxml_lazy_xml (xml_lazy_t * lazy_t)
+{
+	return lazy_t->xml_mem_t;
+}
+
+/*
+ * A tag with nested tags has no value, so only its open tag is parsed. The made
+ * up close tag ends the parse without reading the rest of the text.
+ */
+xml_tag_t * libjxml_lazy_expand (xml_lazy_t * lazy_t, xml_tag_t * tag_t)
+{
+	xml_expansion_t expansion_t;
+	xml_handler_t handler_t;
+	xml_push_t * push_t;
+	long position;
+	long start;
+	long end;
+
+	if (libjxml_lazy_pending (lazy_t, tag_t) == false)
+		return tag_t;
+
+	start = tag_t->value - lazy_t->text;
+	tag_t->value = NULL;
+
+	position = libjxml_lazy_find (lazy_t, start);
+	libjxml_lazy_link (lazy_t, tag_t, position);
+
+	memset (&handler_t, 0, sizeof (xml_handler_t));
+	handler_t.context = &expansion_t;
+	handler_t.start_tag = libjxml_lazy_start;
+	handler_t.attribute = libjxml_lazy_attribute;
+	handler_t.text = libjxml_lazy_text;
+	handler_t.cdata = libjxml_lazy_cdata;
+	handler_t.end_tag = libjxml_lazy_end;
+
+	expansion_t.lazy_t = lazy_t;
+	expansion_t.tag_t = tag_t;
+	expansion_t.attribute_t = NULL;
+	expansion_t.depth = 0;
+	expansion_t.closed = false;
+
+	lazy_t->xml_mem_t->generation++;
+
+	push_t = libjxml_push_create (&handler_t);
+
+	if (tag_t->nested_tag_t != NULL)
+	{
+		end = lazy_t->ranges [position + 1].start;
+		libjxml_push_feed (push_t, lazy_t->text + start, end - start);
+		libjxml_push_feed (push_t, "</", 2);
+		libjxml_push_feed (push_t, tag_t->name, tag_t->name_length);
+		libjxml_push_feed (push_t, ">", 1);
+	}
+	else
+	{
+		libjxml_push_feed (push_t, lazy_t->text + start, lazy_t->length - start);
+	}
+
+	libjxml_push_finish (push_t);
+
+	if (expansion_t.closed == false)
+		fprintf (stderr, "\nLibXML: Error building tag at %ld.", start);
+
+	return tag_t;
+}
+
+/*
+ * Values of length 0 are only stored through libjxml_set_value(), so the value
+ * must also point to an open tag of the text.
+ */
+bool libjxml_lazy_pending (xml_lazy_t * lazy_t, xml_tag_t * tag_t)
+{
+	uintptr_t value = (uintptr_t) tag_t->value;
+
+	if ((tag_t->value == NULL) || (tag_t->value_length != 0))
+		return false;
+
+	if ((value < (uintptr_t) lazy_t->text) || (value >= (uintptr_t) (lazy_t->text + lazy_t->length)))
+		return false;
+
+	return *tag_t->value == '<';
+}
+
+/*
+ * Each tag is built when the walk returns it, before the walk goes into its
+ * nested tags.
+ */
+void libjxml_lazy_load (xml_lazy_t * lazy_t, xml_tag_t * tag_t)
+{
+	xml_iterator_t iterator_t;
+	xml_tag_t * next_t;
+
+	if (tag_t == NULL)
+	{
+		libjxml_iterator_xml (&iterator_t, lazy_t->xml_mem_t, LIBJXML_WALK_PRE);
+	}
+	else
+	{
+		libjxml_lazy_expand (lazy_t, tag_t);
+		libjxml_iterator_init (&iterator_t, tag_t, LIBJXML_WALK_PRE);
+	}
+
+	while ((next_t = libjxml_iterator_next (&iterator_t)) != NULL)
+		libjxml_lazy_expand (lazy_t, next_t);
+
+	libjxml_iterator_free (&iterator_t);
+}
+
+xml_tag_t * libjxml_lazy_nested (xml_lazy_t * lazy_t, xml_tag_t * tag_t)
+{
+	if (tag_t == NULL)
+		return lazy_t->xml_mem_t->content_t;
+
+	return libjxml_lazy_expand (lazy_t, tag_t)->nested_tag_t;
+}
+
+xml_tag_t * libjxml_lazy_child (xml_lazy_t * lazy_t, xml_tag_t * parent_t, char * name)
+{
+	xml_tag_t * tag_t;
+	char * interned;
+
+	/* Names of the nested tags are interned when the tag is built */
+	tag_t = libjxml_lazy_nested (lazy_t, parent_t);
+
+	interned = libjxml_find_name (lazy_t->xml_mem_t, name);
+	if (interned == NULL)
+		return NULL;
+
+	while ((tag_t != NULL) && (tag_t->name != interned))
+		tag_t = tag_t->sibling_tag_t;
+
+	return tag_t;
+}
+
+xml_attribute_t * libjxml_lazy_attributes (xml_lazy_t * lazy_t, xml_tag_t * tag_t)
+{
+	return libjxml_lazy_expand (lazy_t, tag_t)->attribute_t;
+}
+
+char * libjxml_lazy_value (xml_lazy_t * lazy_t, xml_tag_t * tag_t, long * length)
+{
+	return libjxml_tag_value (libjxml_lazy_expand (lazy_t, tag_t), length);
+}
+
+/*********************************************************************************
+ *                                  FIRST PASS
+ *********************************************************************************/
+
+bool libjxml_lazy_open (void * context, char * name, long length)
+{
+	xml_outline_t * outline_t = (xml_outline_t *) context;
+	xml_lazy_t * lazy_t = outline_t->lazy_t;
+	xml_tag_t * tag_t;
+	long start;
+
+	/* Names point to the text, right after the '<' of the open tag */
+	start = name - 1 - lazy_t->text;
+
+	if (lazy_t->count == lazy_t->capacity)
+	{
+		lazy_t->capacity = lazy_t->capacity * 2;
+		lazy_t->ranges = (xml_range_t *) realloc (lazy_t->ranges, lazy_t->capacity * sizeof (xml_range_t));
+		LIBASSERT_PTR (lazy_t->ranges);
+	}
+
+	lazy_t->ranges [lazy_t->count].start = start;
+	lazy_t->ranges [lazy_t->count].next = lazy_t->count + 1;
+
+	if (outline_t->depth == 0)
+	{
+		tag_t = libjxml_lazy_stub (lazy_t, start, name, length);
+
+		if (outline_t->last_t == NULL)
+			lazy_t->xml_mem_t->content_t = tag_t;
+		else
+			outline_t->last_t->sibling_tag_t = tag_t;
+		outline_t->last_t = tag_t;
+	}
+
+	if (outline_t->depth == outline_t->capacity)
+	{
+		outline_t->capacity = outline_t->capacity * 2;
+		outline_t->stack = (long *) realloc (outline_t->stack, outline_t->capacity * sizeof (long));
+		LIBASSERT_PTR (outline_t->stack);
+	}
+
+	outline_t->stack [outline_t->depth] = lazy_t->count;
+	outline_t->depth++;
+	lazy_t->count++;
+
+	return true;
+}
+
+bool libjxml_lazy_close (void * context, char * name, long length)
+{
+	xml_outline_t * outline_t = (xml_outline_t *) context;
+	xml_lazy_t * lazy_t = outline_t->lazy_t;
+
+	(void) name;
+	(void) length;
+
+	outline_t->depth--;
+	lazy_t->ranges [outline_t->stack [outline_t->depth]].next = lazy_t->count;
+
+	return true;
+}
+
+bool libjxml_lazy_instruction (void * context, char * name, long name_length, char * value, long value_length)
+{
+	xml_outline_t * outline_t = (xml_outline_t *) context;
+	xml_t * xml_mem_t = outline_t->lazy_t->xml_mem_t;
+	xml_attribute_t * attribute_t;
+
+	attribute_t = libjxml_new_attribute (xml_mem_t);
+	attribute_t->name = libjxml_names_intern (xml_mem_t->names_t, name, name_length);
+	attribute_t->name_length = name_length;
+	attribute_t->value = libjxml_store_text (xml_mem_t, value, &value_length);
+	attribute_t->value_length = value_length;
+
+	/* Instruction attributes are notified before any tag is opened */
+	if (outline_t->attribute_t == NULL)
+		xml_mem_t->instruction_t = attribute_t;
+	else
+		outline_t->attribute_t->next_attribute_t = attribute_t;
+	outline_t->attribute_t = attribute_t;
+
+	return true;
+}
+
+/*********************************************************************************
+ *                                     BUILD
+ *********************************************************************************/
+
+xml_tag_t * libjxml_lazy_stub (xml_lazy_t * lazy_t, long start, char * name, long length)
+{
+	xml_t * xml_mem_t = lazy_t->xml_mem_t;
+	xml_tag_t * tag_t;
+
+	tag_t = libjxml_new_tag (xml_mem_t);
+	tag_t->name = libjxml_names_intern (xml_mem_t->names_t, name, length);
+	tag_t->name_length = length;
+	tag_t->value = lazy_t->text + start;
+	tag_t->value_length = 0;
+
+	return tag_t;
+}
+
+/*
+ * Tags are kept in document order, so their offsets grow along the outline.
+ */
+long libjxml_lazy_find (xml_lazy_t * lazy_t, long start)
+{
+	long low = 0;
+	long high = lazy_t->count - 1;
+	long middle;
+
+	while (low < high)
+	{
+		middle = low + (high - low) / 2;
+
+		if (lazy_t->ranges [middle].start < start)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+/*
+ * The nested tags follow the tag in the outline, each one after the tags nested
+ * in the previous one. Their names were checked by the first pass, so they end
+ * at the first blank, '/' or '>'.
+ */
+void libjxml_lazy_link (xml_lazy_t * lazy_t, xml_tag_t * tag_t, long position)
+{
+	xml_tag_t * last_t = NULL;
+	xml_tag_t * nested_t;
+	char * name;
+	long length;
+	long i;
+
+	for (i = position + 1; i < lazy_t->ranges [position].next; i = lazy_t->ranges [i].next)
+	{
+		name = lazy_t->text + lazy_t->ranges [i].start + 1;
+
+		for (length = 0; !LIBJXML_IS_SPACE (name [length]) && (name [length] != '/') &&
+			 (name [length] != '>'); length++);
+
+		nested_t = libjxml_lazy_stub (lazy_t, lazy_t->ranges [i].start, name, length);
+
+		if (last_t == NULL)
+			tag_t->nested_tag_t = nested_t;
+		else
+			last_t->sibling_tag_t = nested_t;
+		last_t = nested_t;
+	}
+}
+
+bool libjxml_lazy_start (void * context, char * name, long length)
+{
+	xml_expansion_t * expansion_t = (xml_expansion_t *) context;
+
+	(void) name;
+	(void) length;
+
+	expansion_t->depth++;
+
+	return true;
+}
+
+bool libjxml_lazy_attribute (void * context, char * name, long name_length, char * value, long value_length)
+{
+	xml_expansion_t * expansion_t = (xml_expansion_t *) context;
+	xml_t * xml_mem_t = expansion_t->lazy_t->xml_mem_t;
+	xml_attribute_t * attribute_t;
+
+	if (expansion_t->depth != 1)
+		return true;
+
+	attribute_t = libjxml_new_attribute (xml_mem_t);
+	attribute_t->name = libjxml_names_intern (xml_mem_t->names_t, name, name_length);
+	attribute_t->name_length = name_length;
+	attribute_t->value = libjxml_store_text (xml_mem_t, value, &value_length);
+	attribute_t->value_length = value_length;
+
+	if (expansion_t->attribute_t == NULL)
+		expansion_t->tag_t->attribute_t = attribute_t;
+	else
+		expansion_t->attribute_t->next_attribute_t = attribute_t;
+	expansion_t->attribute_t = attribute_t;
+
+	return true;
+}
+
+bool libjxml_lazy_text (void * context, char * text, long length)
+{
+	return libjxml_lazy_store ((xml_expansion_t *) context, text, length, true);
+}
+
+bool libjxml_lazy_cdata (void * context, char * text, long length)
+{
+	return libjxml_lazy_store ((xml_expansion_t *) context, text, length, false);
+}
+
+bool libjxml_lazy_store (xml_expansion_t * expansion_t, char * text, long length, bool decode)
+{
+	xml_tag_t * tag_t = expansion_t->tag_t;
+	long i;
+
+	/* Only text placed directly between the open and close tags is a value */
+	if ((expansion_t->depth != 1) || (tag_t->nested_tag_t != NULL) || (tag_t->value != NULL))
+		return true;
+
+	for (i = 0; i < length; i++)
+	{
+		if (!LIBJXML_IS_SPACE (text [i]))
+		{
+			if (decode == true)
+				tag_t->value = libjxml_store_text (expansion_t->lazy_t->xml_mem_t, text, &length);
+			else
+				tag_t->value = libjxml_store_token (expansion_t->lazy_t->xml_mem_t, text, length);
+			tag_t->value_length = length;
+			break;
+		}
+	}
+
+	return true;
+}
+
+bool libjxml_lazy_end (void * context, char * name, long length)
+{
+	xml_expansion_t * expansion_t = (xml_expansion_t *) context;
+
+	(void) name;
+	(void) length;
+
+	expansion_t->depth--;
+
+	/* Stop once the tag is closed */
+	if (expansion_t->depth == 0)
+	{
+		expansion_t->closed = true;
+		return false;
+	}
+
+	return true;
+}
+
+/*********************************************************************************
+ *                                     FILES
+ *********************************************************************************/
+
+char * libjxml_lazy_read (int xml_fd, long * xml_length)
+{
+	char * xml;
+	long capacity = LIBJXML_LAZY_READ;
+	long length = 0;
+	long read_len;
+
+	xml = (char *) malloc (capacity * sizeof (char));
+	LIBASSERT_PTR (xml);
+
+	while (1)
+	{
+		if (length == capacity)
+		{
+			capacity = capacity * 2;
+			xml = (char *) realloc (xml, capacity * sizeof (char));
+			LIBASSERT_PTR (xml);
+		}
+
+		read_len = read (xml_fd, xml + length, capacity - length);
+
+		if (read_len == 0)
+			break;
+
+		if (read_len < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			fprintf (stderr, "\nLibXML: Error reading file. Received %ld.", length);
+			free (xml);
+			return NULL;
+		}
+
+		length = length + read_len;
+	}
+
+	*xml_length = length;
+
+	return xml;
+}
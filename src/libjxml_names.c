@@ -0,0 +1,338 @@
+/**
+ * @file libjxml_names.c
+ *
+ * @brief Table of the tag and attribute names of xml documents.
+ *
+ * The names are kept in an open addressing hash table, probing the next slots
+ * until the name or an empty slot is found. The strings are copied in an arena,
+ * so storing a name never allocates memory on its own.
+ *
+ * A stacked table keeps only the names missing in its base, and numbers them
+ * after the names the base had when it was stacked. Bases can be stacked too, so
+ * a name is looked up down the whole chain of bases.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libjxml_names.h"
+#include "libarena.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_NAMES_OFFSET 14695981039346656037UL /**< Initial value of the hash */
+#define LIBJXML_NAMES_PRIME  0x9E3779B97F4A7C15UL   /**< Odd multiplier mixing the hash */
+
+/**
+ * @brief Slot of the table, empty while its name is NULL.
+ */
+typedef struct xml_slot_t
+{
+	char          * name;   /**< Stored name, null ended */
+	long            length; /**< Length of the name */
+	unsigned long   hash;   /**< Hash of the name */
+	long            id;     /**< Number of names stored before this one */
+}xml_slot_t;
+
+struct xml_names_t
+{
+	xml_slot_t * slots;      /**< Slots of the table, a power of two */
+	long         capacity;   /**< Number of slots */
+	long         count;      /**< Number of names stored */
+	char      ** names;      /**< Stored names by id, one entry for each slot */
+	long       * lengths;    /**< Length of the names by id */
+	long         references; /**< Number of documents using the table */
+	Arena_t    * arena_t;    /**< Arena holding the names */
+	xml_names_t * base_t;    /**< Table looked up first, NULL if none */
+	long         base_count; /**< Number of names of the base when stacked */
+};
+
+/*********************************************************************************
+ *                                 DECLARATIONS
+ *********************************************************************************/
+
+unsigned long libjxml_names_hash (char * name, long length);
+xml_slot_t * libjxml_names_slot (xml_names_t * names_t, char * name, long length, unsigned long hash);
+xml_slot_t * libjxml_names_under (xml_names_t * base_t, char * name, long length, unsigned long hash,
+								  long limit);
+xml_slot_t * libjxml_names_store (xml_names_t * names_t, char * name, long length);
+void libjxml_names_grow (xml_names_t * names_t);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+xml_names_t * libjxml_names_create (long slots)
+{
+	xml_names_t * names_t;
+	long capacity = 1;
+
+	if (slots <= 0)
+		slots = LIBJXML_NAMES_SLOTS;
+
+	/* Kept at most half full, so probing stops soon at an empty slot */
+	while (capacity < slots * 2)
+		capacity = capacity * 2;
+
+	names_t = (xml_names_t *) malloc (sizeof (xml_names_t));
+	LIBASSERT_PTR (names_t);
+
+	names_t->slots = (xml_slot_t *) calloc (capacity, sizeof (xml_slot_t));
+	LIBASSERT_PTR (names_t->slots);
+
+	names_t->names = (char **) malloc (capacity * sizeof (char *));
+	LIBASSERT_PTR (names_t->names);
+
+	names_t->lengths = (long *) malloc (capacity * sizeof (long));
+	LIBASSERT_PTR (names_t->lengths);
+
+	names_t->capacity = capacity;
+	names_t->count = 0;
+	names_t->references = 1;
+	names_t->arena_t = libarena_create (0);
+	names_t->base_t = NULL;
+	names_t->base_count = 0;
+
+	return names_t;
+}
+
+xml_names_t * libjxml_names_stack (xml_names_t * base_t, long slots)
+{
+	xml_names_t * names_t;
+
+	names_t = libjxml_names_create (slots);
+	names_t->base_t = libjxml_names_share (base_t);
+	names_t->base_count = libjxml_names_count (base_t);
+
+	return names_t;
+}
+
+/*
+ * References are counted atomically, as documents sharing a table, like the
+ * versions of a shared document, can be released from different threads.
+ */
+xml_names_t * libjxml_names_share (xml_names_t * names_t)
+{
+	__atomic_add_fetch (&names_t->references, 1, __ATOMIC_RELAXED);
+
+	return names_t;
+}
+
+void libjxml_names_free (xml_names_t * names_t)
+{
+	if (__atomic_sub_fetch (&names_t->references, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
+	if (names_t->base_t != NULL)
+		libjxml_names_free (names_t->base_t);
+
+	libarena_delete (names_t->arena_t);
+	free (names_t->slots);
+	free (names_t->names);
+	free (names_t->lengths);
+	free (names_t);
+}
+
+char * libjxml_names_intern (xml_names_t * names_t, char * name, long length)
+{
+	return libjxml_names_store (names_t, name, length)->name;
+}
+
+long libjxml_names_id (xml_names_t * names_t, char * name, long length)
+{
+	return libjxml_names_store (names_t, name, length)->id;
+}
+
+char * libjxml_names_get (xml_names_t * names_t, long id, long * length)
+{
+	if (id < names_t->base_count)
+		return libjxml_names_get (names_t->base_t, id, length);
+
+	id = id - names_t->base_count;
+
+	if (length != NULL)
+		*length = names_t->lengths [id];
+
+	return names_t->names [id];
+}
+
+char * libjxml_names_find (xml_names_t * names_t, char * name, long length)
+{
+	xml_slot_t * slot_t;
+	unsigned long hash;
+
+	hash = libjxml_names_hash (name, length);
+
+	if (names_t->base_t != NULL)
+	{
+		slot_t = libjxml_names_under (names_t->base_t, name, length, hash, names_t->base_count);
+		if (slot_t != NULL)
+			return slot_t->name;
+	}
+
+	return libjxml_names_slot (names_t, name, length, hash)->name;
+}
+
+long libjxml_names_count (xml_names_t * names_t)
+{
+	return names_t->base_count + names_t->count;
+}
+
+/*********************************************************************************
+ *                                     TABLE
+ *********************************************************************************/
+
+/*
+ * Names are hashed eight bytes at a time, mixing each word with a multiply and
+ * a shift, which is faster than going byte by byte for the usual short names.
+ */
+unsigned long libjxml_names_hash (char * name, long length)
+{
+	unsigned long hash = LIBJXML_NAMES_OFFSET ^ length;
+	unsigned long word;
+	long i;
+
+	for (i = 0; i + 8 <= length; i = i + 8)
+	{
+		memcpy (&word, name + i, 8);
+		hash = (hash ^ word) * LIBJXML_NAMES_PRIME;
+		hash = hash ^ (hash >> 32);
+	}
+
+	if (i < length)
+	{
+		word = 0;
+		for (; i < length; i++)
+			word = (word << 8) | (unsigned char) name [i];
+
+		hash = (hash ^ word) * LIBJXML_NAMES_PRIME;
+		hash = hash ^ (hash >> 32);
+	}
+
+	return hash;
+}
+
+/*
+ * Returns the slot holding the name, storing it first if it is not in the table.
+ */
+xml_slot_t * libjxml_names_store (xml_names_t * names_t, char * name, long length)
+{
+	xml_slot_t * slot_t;
+	unsigned long hash;
+
+	hash = libjxml_names_hash (name, length);
+
+	/* Names stored in the base after stacking are not seen, so ids never collide */
+	if (names_t->base_t != NULL)
+	{
+		slot_t = libjxml_names_under (names_t->base_t, name, length, hash, names_t->base_count);
+		if (slot_t != NULL)
+			return slot_t;
+	}
+
+	slot_t = libjxml_names_slot (names_t, name, length, hash);
+
+	if (slot_t->name != NULL)
+		return slot_t;
+
+	slot_t->name = libarena_copy (names_t->arena_t, name, length);
+	slot_t->length = length;
+	slot_t->hash = hash;
+	slot_t->id = names_t->base_count + names_t->count;
+
+	names_t->names [names_t->count] = slot_t->name;
+	names_t->lengths [names_t->count] = length;
+	names_t->count++;
+
+	if (names_t->count * 2 > names_t->capacity)
+	{
+		libjxml_names_grow (names_t);
+		slot_t = libjxml_names_slot (names_t, name, length, hash);
+	}
+
+	return slot_t;
+}
+
+/*
+ * Returns the slot holding the name, or the empty slot where it would be stored.
+ */
+xml_slot_t * libjxml_names_slot (xml_names_t * names_t, char * name, long length, unsigned long hash)
+{
+	xml_slot_t * slot_t;
+	long mask = names_t->capacity - 1;
+	long i;
+
+	i = hash & mask;
+
+	while (1)
+	{
+		slot_t = &names_t->slots [i];
+
+		if (slot_t->name == NULL)
+			return slot_t;
+
+		if ((slot_t->hash == hash) && (slot_t->length == length) &&
+			(memcmp (slot_t->name, name, length) == 0))
+			return slot_t;
+
+		i = (i + 1) & mask;
+	}
+}
+
+/*
+ * Returns the slot holding the name in a base or in the bases below it, among
+ * the names numbered under 'limit', or NULL if none of them has the name.
+ */
+xml_slot_t * libjxml_names_under (xml_names_t * base_t, char * name, long length, unsigned long hash,
+								  long limit)
+{
+	xml_slot_t * slot_t;
+
+	if (base_t->base_t != NULL)
+	{
+		slot_t = libjxml_names_under (base_t->base_t, name, length, hash, base_t->base_count);
+		if (slot_t != NULL)
+			return slot_t;
+	}
+
+	slot_t = libjxml_names_slot (base_t, name, length, hash);
+	if ((slot_t->name != NULL) && (slot_t->id < limit))
+		return slot_t;
+
+	return NULL;
+}
+
+void libjxml_names_grow (xml_names_t * names_t)
+{
+	xml_slot_t * slots = names_t->slots;
+	xml_slot_t * slot_t;
+	long capacity = names_t->capacity;
+	long i;
+
+	names_t->capacity = capacity * 2;
+	names_t->slots = (xml_slot_t *) calloc (names_t->capacity, sizeof (xml_slot_t));
+	LIBASSERT_PTR (names_t->slots);
+
+	for (i = 0; i < capacity; i++)
+	{
+		if (slots [i].name == NULL)
+			continue;
+
+		slot_t = libjxml_names_slot (names_t, slots [i].name, slots [i].length, slots [i].hash);
+		*slot_t = slots [i];
+	}
+
+	free (slots);
+
+	names_t->names = (char **) realloc (names_t->names, names_t->capacity * sizeof (char *));
+	LIBASSERT_PTR (names_t->names);
+
+	names_t->lengths = (long *) realloc (names_t->lengths, names_t->capacity * sizeof (long));
+	LIBASSERT_PTR (names_t->lengths);
+}
@@ -0,0 +1,926 @@
+/**
+ * @file libjxml_parallel.c
+ *
+ * @brief Parsing of big xml documents with many threads.
+ *
+ * The text is split in three: the head up to the first tag nested in the root,
+ * the parts holding the nested tags of the root, and the tail with the close tag
+ * of the root. The head and the tail are parsed by the calling thread with a push
+ * parser fed twice, and each part is parsed by a thread into a document of its
+ * own, with its own storage.
+ *
+ * Before the parts are parsed, the names of the first nested tag are stored in
+ * the table of the document, and each part gets a table stacked over it, so the
+ * names repeated by every record are shared. Once every part is parsed, the names
+ * only found in a part are stored in the table of the document in the order they
+ * were found, so they get the same ids as in a parse with a single thread, and the
+ * threads replace those names in their tags.
+ * Then the tags of the parts are linked in order under the root and the arenas
+ * of the parts are moved to the document.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libjxml_parallel.h"
+#include "libjxml_sax.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_PARALLEL_PRIME 0x9E3779B97F4A7C15UL /**< Odd multiplier mixing the hash of the names */
+
+#define LIBJXML_MARKUP_OTHER 0 /**< Comment, CDATA, instruction or declaration */
+#define LIBJXML_MARKUP_OPEN  1 /**< Open tag */
+#define LIBJXML_MARKUP_EMPTY 2 /**< Empty tag, like <tag/> */
+#define LIBJXML_MARKUP_CLOSE 3 /**< Close tag */
+
+/**
+ * @brief Places where the text of a document is split.
+ */
+typedef struct xml_split_t
+{
+	long starts [LIBJXML_PARALLEL_THREADS + 1]; /**< Offset of each part, then of the close tag of the root */
+	long seed;                                  /**< Offset after the first tag nested in the root */
+	int  parts;                                 /**< Number of parts */
+}xml_split_t;
+
+/**
+ * @brief Range of the text scanned by a thread to split it.
+ *
+ * Depths are relative to the beginning of the range.
+ */
+typedef struct xml_scan_t
+{
+	char * text;        /**< Whole text */
+	long   length;      /**< Length of the whole text */
+	long   from;        /**< Offset where the scan starts, between two tags */
+	long   to;          /**< Offset after the last markup start scanned */
+	long   stop;        /**< Offset where the scan stopped, after the last markup */
+	long   depth;       /**< Depth at the end of the range */
+	long   open;        /**< First open tag found at the lowest depth, -1 if none */
+	long   open_depth;  /**< Depth before that open tag */
+	long   close;       /**< First close tag reaching the lowest depth, -1 if none */
+	long   close_depth; /**< Depth after that close tag */
+	bool   valid;       /**< Every markup of the range ends */
+}xml_scan_t;
+
+/**
+ * @brief Root and instruction of a document, built from its head.
+ */
+typedef struct xml_skeleton_t
+{
+	xml_t           * xml_mem_t;   /**< Document being built */
+	xml_tag_t       * root_t;      /**< Root tag, NULL until it is opened */
+	xml_attribute_t * attribute_t; /**< Last attribute linked to the root or to the instruction */
+}xml_skeleton_t;
+
+/**
+ * @brief Name of a part and the same name in the table of the document.
+ */
+typedef struct xml_rename_t
+{
+	char * from; /**< Name interned in the table of the part, NULL if the slot is empty */
+	char * to;   /**< Name interned in the table of the document */
+}xml_rename_t;
+
+/**
+ * @brief Part of the text parsed by a thread.
+ */
+typedef struct xml_part_t
+{
+	xml_t        * xml_mem_t; /**< Document holding the tags of the part, with names stacked over the document */
+	char         * text;      /**< Beginning of the part in the text */
+	long           length;    /**< Length of the part */
+	long           offset;    /**< Offset of the part in the text, to report errors */
+	bool           parsed;    /**< The part was parsed without errors */
+	xml_tag_t    * last_t;    /**< Last tag at the first level of the part */
+	long           base;      /**< Number of names of the document when the part was created */
+	xml_rename_t * renames;   /**< Hash table of the names missing in the document, NULL if none */
+	long           capacity;  /**< Number of slots of renames, a power of two */
+}xml_part_t;
+
+/*********************************************************************************
+ *                                 DECLARATIONS
+ *********************************************************************************/
+
+int libjxml_parallel_threads (int threads, long length);
+
+bool libjxml_parallel_split (xml_split_t * split_t, char * text, long length, int parts);
+void * libjxml_parallel_scan (void * context);
+long libjxml_parallel_markup (char * text, long position, long length, int * kind);
+long libjxml_parallel_skip (char * text, long position, long length, char * delimiter);
+long libjxml_parallel_tag_end (char * text, long position, long length);
+long libjxml_parallel_declaration (char * text, long position, long length);
+
+void libjxml_parallel_run (void * items, long size, int count, void * (* work) (void *));
+void * libjxml_parallel_parse_part (void * context);
+void * libjxml_parallel_rename_part (void * context);
+void libjxml_parallel_names (xml_t * xml_mem_t, xml_part_t * part_t);
+char * libjxml_parallel_rename (xml_part_t * part_t, char * name);
+void libjxml_parallel_join (xml_t * xml_mem_t, xml_tag_t * root_t, xml_part_t * parts, int count);
+void libjxml_parallel_release (xml_part_t * parts, int count);
+
+bool libjxml_parallel_start (void * context, char * name, long length);
+bool libjxml_parallel_attribute (void * context, char * name, long name_length, char * value, long value_length);
+bool libjxml_parallel_instruction (void * context, char * name, long name_length, char * value, long value_length);
+void libjxml_parallel_seed (xml_t * xml_mem_t, char * text, long length);
+bool libjxml_parallel_seed_name (void * context, char * name, long length);
+bool libjxml_parallel_seed_pair (void * context, char * name, long name_length, char * value, long value_length);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+xml_t * libjxml_parse_parallel (xml_t * xml_mem_t, char * xml_txt, long length, int threads)
+{
+	xml_handler_t handler_t;
+	xml_skeleton_t skeleton_t;
+	xml_split_t split_t;
+	xml_part_t * parts;
+	xml_push_t * push_t;
+	xml_names_t * names_t;
+	long first;
+	long close;
+	bool parsed;
+	bool joined;
+	int i;
+
+	threads = libjxml_parallel_threads (threads, length);
+
+	if ((threads < 2) || (libjxml_parallel_split (&split_t, xml_txt, length, threads) == false))
+		return libjxml_parse_xml_mem (xml_mem_t, xml_txt, length);
+
+	first = split_t.starts [0];
+	close = split_t.starts [split_t.parts];
+
+	memset (&handler_t, 0, sizeof (xml_handler_t));
+	handler_t.context = &skeleton_t;
+	handler_t.start_tag = libjxml_parallel_start;
+	handler_t.attribute = libjxml_parallel_attribute;
+	handler_t.instruction = libjxml_parallel_instruction;
+	handler_t.terminate = (xml_mem_t->mode & LIBJXML_MODE_TERMINATE) != 0;
+
+	skeleton_t.xml_mem_t = xml_mem_t;
+	skeleton_t.root_t = NULL;
+	skeleton_t.attribute_t = NULL;
+
+	xml_mem_t->generation++;
+
+	/* The head ends right before a tag, so no token of it is kept by the parser */
+	push_t = libjxml_push_create (&handler_t);
+	parsed = libjxml_push_feed (push_t, xml_txt, first);
+
+	/* Parts usually repeat the names of the first nested tag, found then in the base */
+	if (parsed)
+		libjxml_parallel_seed (xml_mem_t, xml_txt + first, split_t.seed - first);
+
+	parts = (xml_part_t *) calloc (split_t.parts, sizeof (xml_part_t));
+	LIBASSERT_PTR (parts);
+
+	for (i = 0; i < split_t.parts; i++)
+	{
+		names_t = libjxml_names_stack (xml_mem_t->names_t, 0);
+		parts [i].xml_mem_t = libjxml_create_xml_names (xml_mem_t->mode, names_t);
+		parts [i].base = libjxml_names_count (names_t);
+		parts [i].text = xml_txt + split_t.starts [i];
+		parts [i].offset = split_t.starts [i];
+		parts [i].length = split_t.starts [i + 1] - split_t.starts [i];
+		libjxml_names_free (names_t);
+	}
+
+	if (parsed)
+		libjxml_parallel_run (parts, sizeof (xml_part_t), split_t.parts, libjxml_parallel_parse_part);
+
+	joined = parsed && (skeleton_t.root_t != NULL);
+
+	for (i = 0; i < split_t.parts; i++)
+		joined = joined && parts [i].parsed;
+
+	if (joined)
+	{
+		for (i = 0; i < split_t.parts; i++)
+			libjxml_parallel_names (xml_mem_t, &parts [i]);
+
+		libjxml_parallel_run (parts, sizeof (xml_part_t), split_t.parts, libjxml_parallel_rename_part);
+		libjxml_parallel_join (xml_mem_t, skeleton_t.root_t, parts, split_t.parts);
+	}
+
+	/* The root is closed even if a part failed, so only the error of the part is reported */
+	libjxml_push_skip (push_t, close - first);
+	parsed = libjxml_push_feed (push_t, xml_txt + close, length - close) && joined;
+	parsed = libjxml_push_finish (push_t) && parsed;
+
+	libjxml_parallel_release (parts, split_t.parts);
+
+	if (parsed == false)
+	{
+		libjxml_reset_xml_mem (xml_mem_t);
+		return NULL;
+	}
+
+	return xml_mem_t;
+}
+
+xml_t * libjxml_xml_to_mem_parallel (char * xml_txt, int mode, int threads)
+{
+	xml_t * xml_mem_t;
+
+	xml_mem_t = libjxml_create_xml_mem (mode);
+
+	if (libjxml_parse_parallel (xml_mem_t, xml_txt, strlen (xml_txt), threads) == NULL)
+	{
+		libjxml_free_xml_mem (xml_mem_t);
+		return NULL;
+	}
+
+	return xml_mem_t;
+}
+
+/*
+ * The file is mapped like libjxml_file_to_mem_mode() does, so the text is never
+ * copied before it is split.
+ */
+xml_t * libjxml_file_to_mem_parallel (char * xml_name, int mode, int threads)
+{
+	struct stat xml_stat;
+	xml_t * xml_mem_t;
+	char * xml_txt;
+	int protection = PROT_READ;
+	int xml_fd;
+
+	xml_fd = open (xml_name, O_RDONLY);
+	if (xml_fd < 0)
+	{
+		fprintf (stderr, "\nLibXML: Error opening file");
+		return NULL;
+	}
+
+	if ((fstat (xml_fd, &xml_stat) != 0) || !S_ISREG (xml_stat.st_mode) || (xml_stat.st_size == 0))
+	{
+		close (xml_fd);
+		return libjxml_file_to_mem_mode (xml_name, mode);
+	}
+
+	if (mode & LIBJXML_MODE_TERMINATE)
+		protection = protection | PROT_WRITE;
+
+	xml_txt = (char *) mmap (NULL, xml_stat.st_size, protection, MAP_PRIVATE, xml_fd, 0);
+	close (xml_fd);
+
+	if (xml_txt == MAP_FAILED)
+		return libjxml_file_to_mem_mode (xml_name, mode);
+
+	xml_mem_t = libjxml_create_xml_mem (mode);
+
+	if (libjxml_parse_parallel (xml_mem_t, xml_txt, xml_stat.st_size, threads) == NULL)
+	{
+		libjxml_free_xml_mem (xml_mem_t);
+		munmap (xml_txt, xml_stat.st_size);
+		return NULL;
+	}
+
+	/* Slices point to the text, so the document keeps it until it is freed */
+	if (mode & LIBJXML_MODE_SLICE)
+	{
+		xml_mem_t->source = xml_txt;
+		xml_mem_t->source_length = xml_stat.st_size;
+		xml_mem_t->source_mapped = true;
+	}
+	else
+	{
+		munmap (xml_txt, xml_stat.st_size);
+	}
+
+	return xml_mem_t;
+}
+
+/*
+ * Each thread gets a share of the text big enough to pay for starting it.
+ */
+int libjxml_parallel_threads (int threads, long length)
+{
+	if (threads <= 0)
+		threads = sysconf (_SC_NPROCESSORS_ONLN);
+
+	if (threads > LIBJXML_PARALLEL_THREADS)
+		threads = LIBJXML_PARALLEL_THREADS;
+
+	if (threads > length / LIBJXML_PARALLEL_SHARE)
+		threads = length / LIBJXML_PARALLEL_SHARE;
+
+	return threads;
+}
+
+/*********************************************************************************
+ *                                     SPLIT
+ *********************************************************************************/
+
+/*
+ * The text is split following its markup, counting the open tags without
+ * reading names nor attributes. The head is followed in the calling thread up to
+ * the end of the first tag nested in the root. The rest is cut in ranges scanned at the
+ * same time, each one guessing that it starts between two tags, right after a
+ * '>'. The ranges are checked in order once scanned: a range is right if the
+ * previous one stopped where it starts, and it is scanned again otherwise. The
+ * depth at the beginning of each range then tells which of its tags are nested
+ * in the root, and the first one of each range starts a part.
+ */
+bool libjxml_parallel_split (xml_split_t * split_t, char * text, long length, int parts)
+{
+	xml_scan_t scans [LIBJXML_PARALLEL_THREADS];
+	char * found;
+	long position = 0;
+	long depth = 0;
+	long first = -1;
+	long close = -1;
+	long from;
+	long end;
+	int roots = 0;
+	int kind;
+	int i;
+
+	split_t->seed = -1;
+
+	while (split_t->seed < 0)
+	{
+		found = (char *) memchr (text + position, '<', length - position);
+		if (found == NULL)
+			return false;
+
+		position = found - text;
+		end = libjxml_parallel_markup (text, position, length, &kind);
+		if (end < 0)
+			return false;
+
+		if ((kind == LIBJXML_MARKUP_OPEN) || (kind == LIBJXML_MARKUP_EMPTY))
+		{
+			if ((depth == 1) && (first < 0))
+				first = position;
+			else if ((depth == 0) && (roots++ > 0))
+				return false;
+		}
+
+		if (kind == LIBJXML_MARKUP_OPEN)
+			depth++;
+		else if ((kind == LIBJXML_MARKUP_CLOSE) && (--depth <= 0))
+			return false;
+
+		position = end;
+
+		if ((first >= 0) && (depth == 1))
+			split_t->seed = position;
+	}
+
+	from = first;
+	for (i = 0; i < parts; i++)
+	{
+		scans [i].text = text;
+		scans [i].length = length;
+		scans [i].from = from;
+		scans [i].to = length;
+
+		if (i + 1 < parts)
+		{
+			found = (char *) memchr (text + first + (length - first) / parts * (i + 1), '>',
+									 length - first - (length - first) / parts * (i + 1));
+			if (found != NULL)
+				scans [i].to = found - text + 1;
+			if (scans [i].to < from)
+				scans [i].to = from;
+		}
+
+		from = scans [i].to;
+	}
+
+	libjxml_parallel_run (scans, sizeof (xml_scan_t), parts, libjxml_parallel_scan);
+
+	split_t->starts [0] = first;
+	split_t->parts = 1;
+	depth = 1;
+	position = first;
+
+	for (i = 0; i < parts; i++)
+	{
+		/* The previous range ended inside markup, so this one guessed wrong */
+		if (scans [i].from != position)
+		{
+			scans [i].from = position;
+			if (scans [i].to < position)
+				scans [i].to = position;
+			libjxml_parallel_scan (&scans [i]);
+		}
+
+		if (scans [i].valid == false)
+			return false;
+
+		/* A tag opened at the first level, or a close tag below it, is not one document */
+		if (((scans [i].open >= 0) && (depth + scans [i].open_depth < 1)) ||
+			((scans [i].close >= 0) && (depth + scans [i].close_depth < 0)))
+			return false;
+
+		if ((scans [i].close >= 0) && (depth + scans [i].close_depth == 0))
+			close = scans [i].close;
+
+		if ((i > 0) && (scans [i].open >= 0) && (depth + scans [i].open_depth == 1) &&
+			((close < 0) || (scans [i].open < close)))
+		{
+			split_t->starts [split_t->parts] = scans [i].open;
+			split_t->parts++;
+		}
+
+		depth = depth + scans [i].depth;
+		position = scans [i].stop;
+	}
+
+	if ((depth != 0) || (close < 0))
+		return false;
+
+	split_t->starts [split_t->parts] = close;
+
+	return split_t->parts > 1;
+}
+
+/*
+ * Follows the markup starting in a range. The markup starting at the end of the
+ * range is followed to its end, where the scan stops.
+ */
+void * libjxml_parallel_scan (void * context)
+{
+	xml_scan_t * scan_t = (xml_scan_t *) context;
+	char * text = scan_t->text;
+	char * found;
+	long position = scan_t->from;
+	long depth = 0;
+	long end;
+	int kind;
+
+	scan_t->open = -1;
+	scan_t->close = -1;
+	scan_t->valid = true;
+
+	while (position < scan_t->to)
+	{
+		found = (char *) memchr (text + position, '<', scan_t->to - position);
+		if (found == NULL)
+		{
+			position = scan_t->to;
+			break;
+		}
+
+		position = found - text;
+		end = libjxml_parallel_markup (text, position, scan_t->length, &kind);
+		if (end < 0)
+		{
+			scan_t->valid = false;
+			break;
+		}
+
+		if ((kind == LIBJXML_MARKUP_OPEN) || (kind == LIBJXML_MARKUP_EMPTY))
+		{
+			if ((scan_t->open < 0) || (depth < scan_t->open_depth))
+			{
+				scan_t->open = position;
+				scan_t->open_depth = depth;
+			}
+
+			if (kind == LIBJXML_MARKUP_OPEN)
+				depth++;
+		}
+		else if (kind == LIBJXML_MARKUP_CLOSE)
+		{
+			depth--;
+
+			if ((scan_t->close < 0) || (depth < scan_t->close_depth))
+			{
+				scan_t->close = position;
+				scan_t->close_depth = depth;
+			}
+		}
+
+		position = end;
+	}
+
+	scan_t->depth = depth;
+	scan_t->stop = position;
+
+	return NULL;
+}
+
+/*
+ * Returns the offset after the markup starting at a '<', -1 if it does not end.
+ */
+long libjxml_parallel_markup (char * text, long position, long length, int * kind)
+{
+	long end;
+	char c;
+
+	*kind = LIBJXML_MARKUP_OTHER;
+
+	if (position + 1 >= length)
+		return -1;
+
+	c = text [position + 1];
+
+	if (c == '?')
+		return libjxml_parallel_skip (text, position + 2, length, "?>");
+
+	if ((c == '!') && (position + 4 <= length) && (memcmp (text + position, "<!--", 4) == 0))
+		return libjxml_parallel_skip (text, position + 4, length, "-->");
+
+	if ((c == '!') && (position + 9 <= length) && (memcmp (text + position, "<![CDATA[", 9) == 0))
+		return libjxml_parallel_skip (text, position + 9, length, "]]>");
+
+	if (c == '!')
+		return libjxml_parallel_declaration (text, position + 2, length);
+
+	if (c == '/')
+	{
+		*kind = LIBJXML_MARKUP_CLOSE;
+		return libjxml_parallel_skip (text, position + 2, length, ">");
+	}
+
+	end = libjxml_parallel_tag_end (text, position + 1, length);
+
+	if ((end > 0) && (text [end - 2] == '/'))
+		*kind = LIBJXML_MARKUP_EMPTY;
+	else
+		*kind = LIBJXML_MARKUP_OPEN;
+
+	return end;
+}
+
+/*
+ * Returns the offset after the next delimiter, -1 if it is not found.
+ */
+long libjxml_parallel_skip (char * text, long position, long length, char * delimiter)
+{
+	long size = strlen (delimiter);
+	char * found;
+
+	while (1)
+	{
+		found = (char *) memchr (text + position, delimiter [0], length - position);
+		if (found == NULL)
+			return -1;
+
+		position = found - text;
+		if (position + size > length)
+			return -1;
+
+		if (memcmp (found, delimiter, size) == 0)
+			return position + size;
+
+		position++;
+	}
+}
+
+/*
+ * Returns the offset after the '>' closing a tag, -1 if it is not found. Tags
+ * are short, so they are read byte by byte, skipping the attribute values as
+ * they can hold '>'.
+ */
+long libjxml_parallel_tag_end (char * text, long position, long length)
+{
+	char * found;
+	char c;
+
+	for (; position < length; position++)
+	{
+		c = text [position];
+
+		if (c == '>')
+			return position + 1;
+
+		if ((c == '"') || (c == '\''))
+		{
+			found = (char *) memchr (text + position + 1, c, length - position - 1);
+			if (found == NULL)
+				return -1;
+
+			position = found - text;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * Declarations like DOCTYPE may hold an internal subset between brackets.
+ */
+long libjxml_parallel_declaration (char * text, long position, long length)
+{
+	long brackets = 0;
+
+	for (; position < length; position++)
+	{
+		if (text [position] == '[')
+			brackets++;
+		else if (text [position] == ']')
+			brackets--;
+		else if ((text [position] == '>') && (brackets <= 0))
+			return position + 1;
+	}
+
+	return -1;
+}
+
+/*********************************************************************************
+ *                                     PARTS
+ *********************************************************************************/
+
+/*
+ * Runs the work of the first item in the calling thread and the others in new
+ * threads, or in the calling thread too if a thread cannot be created.
+ */
+void libjxml_parallel_run (void * items, long size, int count, void * (* work) (void *))
+{
+	pthread_t threads [LIBJXML_PARALLEL_THREADS];
+	bool started [LIBJXML_PARALLEL_THREADS];
+	char * item = (char *) items;
+	int i;
+
+	for (i = 1; i < count; i++)
+		started [i] = (pthread_create (&threads [i], NULL, work, item + i * size) == 0);
+
+	work (item);
+
+	for (i = 1; i < count; i++)
+	{
+		if (started [i])
+			pthread_join (threads [i], NULL);
+		else
+			work (item + i * size);
+	}
+}
+
+void * libjxml_parallel_parse_part (void * context)
+{
+	xml_part_t * part_t = (xml_part_t *) context;
+	xml_tag_t * tag_t;
+
+	part_t->parsed = (libjxml_parse_xml_offset (part_t->xml_mem_t, part_t->text, part_t->length, part_t->offset) != NULL);
+
+	if (part_t->parsed)
+	{
+		for (tag_t = part_t->xml_mem_t->content_t; tag_t->sibling_tag_t != NULL; tag_t = tag_t->sibling_tag_t);
+		part_t->last_t = tag_t;
+	}
+
+	return NULL;
+}
+
+void * libjxml_parallel_rename_part (void * context)
+{
+	xml_part_t * part_t = (xml_part_t *) context;
+	xml_iterator_t iterator_t;
+	xml_attribute_t * attribute_t;
+	xml_tag_t * tag_t;
+
+	if (part_t->renames == NULL)
+		return NULL;
+
+	libjxml_iterator_xml (&iterator_t, part_t->xml_mem_t, LIBJXML_WALK_PRE);
+	while ((tag_t = libjxml_iterator_next (&iterator_t)) != NULL)
+	{
+		tag_t->name = libjxml_parallel_rename (part_t, tag_t->name);
+
+		for (attribute_t = tag_t->attribute_t; attribute_t != NULL; attribute_t = attribute_t->next_attribute_t)
+			attribute_t->name = libjxml_parallel_rename (part_t, attribute_t->name);
+	}
+	libjxml_iterator_free (&iterator_t);
+
+	return NULL;
+}
+
+/*
+ * Stores the names of a part missing in the document in its table, keeping the
+ * pairs in a table hashed by the pointer of the name in the part.
+ */
+void libjxml_parallel_names (xml_t * xml_mem_t, xml_part_t * part_t)
+{
+	xml_rename_t * rename_t;
+	uintptr_t hash;
+	char * name;
+	long count;
+	long length;
+	long id;
+
+	count = libjxml_names_count (part_t->xml_mem_t->names_t);
+	if (count == part_t->base)
+		return;
+
+	part_t->capacity = 16;
+	while (part_t->capacity < (count - part_t->base) * 2)
+		part_t->capacity = part_t->capacity * 2;
+
+	part_t->renames = (xml_rename_t *) calloc (part_t->capacity, sizeof (xml_rename_t));
+	LIBASSERT_PTR (part_t->renames);
+
+	/* The ids of the part follow the names of the document before any part was added */
+	for (id = part_t->base; id < count; id++)
+	{
+		name = libjxml_names_get (part_t->xml_mem_t->names_t, id, &length);
+
+		hash = ((uintptr_t) name * LIBJXML_PARALLEL_PRIME) >> 32;
+		rename_t = &part_t->renames [hash & (part_t->capacity - 1)];
+		while (rename_t->from != NULL)
+		{
+			hash++;
+			rename_t = &part_t->renames [hash & (part_t->capacity - 1)];
+		}
+
+		rename_t->from = name;
+		rename_t->to = libjxml_names_intern (xml_mem_t->names_t, name, length);
+	}
+}
+
+/*
+ * Names found in the document are kept as they are.
+ */
+char * libjxml_parallel_rename (xml_part_t * part_t, char * name)
+{
+	xml_rename_t * rename_t;
+	uintptr_t hash;
+
+	hash = ((uintptr_t) name * LIBJXML_PARALLEL_PRIME) >> 32;
+	rename_t = &part_t->renames [hash & (part_t->capacity - 1)];
+	while ((rename_t->from != name) && (rename_t->from != NULL))
+	{
+		hash++;
+		rename_t = &part_t->renames [hash & (part_t->capacity - 1)];
+	}
+
+	if (rename_t->from == NULL)
+		return name;
+
+	return rename_t->to;
+}
+
+/*
+ * Links the tags of the parts under the root and moves their storage to the
+ * document. The documents of the parts are left empty.
+ */
+void libjxml_parallel_join (xml_t * xml_mem_t, xml_tag_t * root_t, xml_part_t * parts, int count)
+{
+	xml_tag_t * last_t = NULL;
+	xml_t * part_mem_t;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		part_mem_t = parts [i].xml_mem_t;
+
+		if (last_t == NULL)
+			root_t->nested_tag_t = part_mem_t->content_t;
+		else
+			last_t->sibling_tag_t = part_mem_t->content_t;
+		last_t = parts [i].last_t;
+
+		xml_mem_t->nodes = xml_mem_t->nodes + part_mem_t->nodes;
+		LIBJXML_STATS_MERGE (xml_mem_t, part_mem_t);
+
+		if (part_mem_t->arena_t != NULL)
+			libarena_adopt (xml_mem_t->arena_t, part_mem_t->arena_t);
+
+		/* Values decoded out of the slices of the part are kept by the document */
+		if (part_mem_t->decoded_t != NULL)
+		{
+			if (xml_mem_t->decoded_t == NULL)
+				xml_mem_t->decoded_t = libarena_create (0);
+			libarena_adopt (xml_mem_t->decoded_t, part_mem_t->decoded_t);
+		}
+
+		part_mem_t->content_t = NULL;
+		part_mem_t->nodes = 0;
+	}
+}
+
+void libjxml_parallel_release (xml_part_t * parts, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (parts [i].xml_mem_t != NULL)
+			libjxml_free_xml_mem (parts [i].xml_mem_t);
+		free (parts [i].renames);
+	}
+
+	free (parts);
+}
+
+/*********************************************************************************
+ *                                   SKELETON
+ *********************************************************************************/
+
+/*
+ * The head holds the instruction and the root, the only tag opened in it. The
+ * text of the root is not kept, as the root always has nested tags.
+ */
+bool libjxml_parallel_start (void * context, char * name, long length)
+{
+	xml_skeleton_t * skeleton_t = (xml_skeleton_t *) context;
+	xml_t * xml_mem_t = skeleton_t->xml_mem_t;
+	xml_tag_t * tag_t;
+
+	if (skeleton_t->root_t != NULL)
+		return false;
+
+	tag_t = libjxml_new_tag (xml_mem_t);
+	tag_t->name = libjxml_names_intern (xml_mem_t->names_t, name, length);
+	tag_t->name_length = length;
+
+	xml_mem_t->content_t = tag_t;
+	skeleton_t->root_t = tag_t;
+	skeleton_t->attribute_t = NULL;
+
+	return true;
+}
+
+bool libjxml_parallel_attribute (void * context, char * name, long name_length, char * value, long value_length)
+{
+	xml_skeleton_t * skeleton_t = (xml_skeleton_t *) context;
+	xml_t * xml_mem_t = skeleton_t->xml_mem_t;
+	xml_attribute_t * attribute_t;
+
+	attribute_t = libjxml_new_attribute (xml_mem_t);
+	attribute_t->name = libjxml_names_intern (xml_mem_t->names_t, name, name_length);
+	attribute_t->name_length = name_length;
+	attribute_t->value = libjxml_store_text (xml_mem_t, value, &value_length);
+	attribute_t->value_length = value_length;
+
+	if (skeleton_t->attribute_t == NULL)
+		skeleton_t->root_t->attribute_t = attribute_t;
+	else
+		skeleton_t->attribute_t->next_attribute_t = attribute_t;
+	skeleton_t->attribute_t = attribute_t;
+
+	return true;
+}
+
+bool libjxml_parallel_instruction (void * context, char * name, long name_length, char * value, long value_length)
+{
+	xml_skeleton_t * skeleton_t = (xml_skeleton_t *) context;
+	xml_t * xml_mem_t = skeleton_t->xml_mem_t;
+	xml_attribute_t * attribute_t;
+
+	attribute_t = libjxml_new_attribute (xml_mem_t);
+	attribute_t->name = libjxml_names_intern (xml_mem_t->names_t, name, name_length);
+	attribute_t->name_length = name_length;
+	attribute_t->value = libjxml_store_text (xml_mem_t, value, &value_length);
+	attribute_t->value_length = value_length;
+
+	if (skeleton_t->attribute_t == NULL)
+		xml_mem_t->instruction_t = attribute_t;
+	else
+		skeleton_t->attribute_t->next_attribute_t = attribute_t;
+	skeleton_t->attribute_t = attribute_t;
+
+	return true;
+}
+
+/*
+ * The names are stored in the order a parse of the tag would find them, so they
+ * get the same ids.
+ */
+void libjxml_parallel_seed (xml_t * xml_mem_t, char * text, long length)
+{
+	xml_handler_t handler_t;
+
+	memset (&handler_t, 0, sizeof (xml_handler_t));
+	handler_t.context = xml_mem_t->names_t;
+	handler_t.start_tag = libjxml_parallel_seed_name;
+	handler_t.attribute = libjxml_parallel_seed_pair;
+
+	libjxml_sax_buffer (text, length, &handler_t);
+}
+
+bool libjxml_parallel_seed_name (void * context, char * name, long length)
+{
+	libjxml_names_intern ((xml_names_t *) context, name, length);
+
+	return true;
+}
+
+bool libjxml_parallel_seed_pair (void * context, char * name, long name_length, char * value, long value_length)
+{
+	(void) value;
+	(void) value_length;
+
+	libjxml_names_intern ((xml_names_t *) context, name, name_length);
+
+	return true;
+}
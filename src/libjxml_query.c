@@ -0,0 +1,946 @@
+/**
+ * @file libjxml_query.c
+ *
+ * @brief Path queries over xml documents.
+ *
+ * A compiled query is a list of steps, and the tags are matched against it like
+ * an automaton: the steps still to be matched by the tags nested in a tag are
+ * kept as bits of a word, one for each step. A tag matching step k sets bit k + 1
+ * for its nested tags, and a step with // keeps its own bit, so it is matched at
+ * any depth. The same automaton runs over the tags of a tree and over the events
+ * of the parser, so a text can be searched without building its tree.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "libjxml_query.h"
+#include "libjxml_entity.h"
+#include "libstring.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_QUERY_FRAMES 32  /**< Initial depth of the frames of a run */
+#define LIBJXML_QUERY_TEXT   256 /**< Initial size of the text kept by a streaming run */
+
+#define LIBJXML_PREDICATE_ATTRIBUTE 0 /**< The tag has the attribute */
+#define LIBJXML_PREDICATE_EQUAL     1 /**< The attribute of the tag has the value */
+#define LIBJXML_PREDICATE_VALUE     2 /**< The tag has the value */
+
+#define LIBJXML_QUERY_BIT(k) (((uint64_t) 1) << (k))
+
+#define LIBJXML_QUERY_NAME_END(c) (((c) == '\0') || ((c) == '/') || ((c) == '[') || ((c) == ']') || \
+								   ((c) == '=')  || ((c) == '@') || ((c) == '"') || ((c) == '\'') || \
+								   ((c) == ' ')  || ((c) == '\t'))
+
+/**
+ * @brief Condition a tag must meet to match a step.
+ */
+typedef struct xml_predicate_t
+{
+	int    kind;         /**< LIBJXML_PREDICATE_* kind */
+	char * name;         /**< Name of the attribute, pointing to the path of the query */
+	long   name_length;  /**< Length of the name */
+	char * value;        /**< Value compared, pointing to the path of the query */
+	long   value_length; /**< Length of the value */
+	char * interned;     /**< Name interned in the document being searched */
+}xml_predicate_t;
+
+/**
+ * @brief Step of the path of a query.
+ */
+typedef struct xml_step_t
+{
+	char     * name;        /**< Name of the tags, pointing to the path of the query */
+	long       name_length; /**< Length of the name */
+	char     * interned;    /**< Name interned in the document being searched */
+	bool       any;         /**< Any name matches, written as * */
+	bool       descendant;  /**< The tags are nested at any depth, written as // */
+	bool       value;       /**< Some predicate is on the value of the tag */
+	long       first;       /**< First predicate of the step */
+	long       count;       /**< Number of predicates of the step */
+	uint64_t   attributes;  /**< Bits of the predicates on attributes of the step */
+}xml_step_t;
+
+/**
+ * @brief Tag whose nested tags are being walked in a tree.
+ */
+typedef struct xml_walk_t
+{
+	xml_tag_t * tag_t;  /**< The tag */
+	uint64_t    states; /**< Steps to be matched by the tag and its siblings */
+}xml_walk_t;
+
+/**
+ * @brief Tag open while parsing a text.
+ *
+ * Names and values are kept in the text of the query, as offsets, since the
+ * parser only gives them during each call.
+ */
+typedef struct xml_open_t
+{
+	uint64_t parent;           /**< Steps to be matched by the tag */
+	uint64_t candidates;       /**< Steps whose name matches the tag */
+	uint64_t satisfied;        /**< Predicates met by the attributes of the tag */
+	uint64_t states;           /**< Steps to be matched by the nested tags */
+	long     start;            /**< Length of the text of the query when the tag was opened */
+	long     name;             /**< Offset of the name, -1 if not kept */
+	long     name_length;      /**< Length of the name */
+	long     attribute;        /**< Offset of the value of the selected attribute, -1 if not found */
+	long     attribute_length; /**< Length of the value of the attribute */
+	long     value;            /**< Offset of the value, -1 without value */
+	long     value_length;     /**< Length of the value */
+	bool     pending;          /**< Attributes may still come, so the states are not known */
+	bool     matched;          /**< The tag matched the last step */
+	bool     nested;           /**< The tag has nested tags, so it has no value */
+}xml_open_t;
+
+struct xml_query_t
+{
+	char            * path;                                     /**< Copy of the compiled path */
+	xml_step_t        steps [LIBJXML_QUERY_STEPS];              /**< Steps of the path */
+	long              steps_count;                              /**< Number of steps */
+	xml_predicate_t   predicates [LIBJXML_QUERY_PREDICATES];    /**< Predicates of all the steps */
+	long              predicates_count;                         /**< Number of predicates */
+	char            * attribute;                                /**< Name of the last /@name step, NULL without it */
+	long              attribute_length;                         /**< Length of the name */
+	char            * attribute_interned;                       /**< Name interned in the document being searched */
+	bool              streamable;                               /**< Values are only checked on the last step */
+	xml_walk_t      * walk;                                     /**< Frames of the walks of trees */
+	long              walk_capacity;                            /**< Number of frames allocated for trees */
+	xml_open_t      * open;                                     /**< Frames of the tags open while parsing */
+	long              open_capacity;                            /**< Number of frames allocated for texts */
+	long              depth;                                    /**< Number of tags open while parsing */
+	char            * text;                                     /**< Names and values kept while parsing */
+	long              text_length;                              /**< Used length of the text */
+	long              text_capacity;                            /**< Allocated length of the text */
+	char            * scratch;                                  /**< Attribute value decoded while parsing */
+	long              scratch_capacity;                         /**< Allocated length of the decoded value */
+	xml_pair_cb       found;                                    /**< Callback of the streaming run */
+	void            * context;                                  /**< Pointer given to the callback */
+};
+
+/*********************************************************************************
+ *                                 DECLARATIONS
+ *********************************************************************************/
+
+bool libjxml_query_parse (xml_query_t * query_t, char * text);
+long libjxml_query_name (char * text);
+char * libjxml_query_literal (char * text, char ** value, long * length);
+char * libjxml_query_predicate (xml_query_t * query_t, xml_step_t * step_t, char * text);
+
+bool libjxml_query_equal (char * text, long length, char * value, long value_length);
+bool libjxml_query_resolve (xml_query_t * query_t, xml_names_t * names_t);
+bool libjxml_query_test (xml_query_t * query_t, xml_step_t * step_t, xml_tag_t * tag_t);
+uint64_t libjxml_query_match (xml_query_t * query_t, uint64_t states, xml_tag_t * tag_t, bool * matched);
+bool libjxml_query_first_cb (void * context, xml_tag_t * tag_t, xml_attribute_t * attribute_t);
+
+bool libjxml_query_stream (xml_query_t * query_t, xml_handler_t * handler_t, xml_pair_cb found, void * context);
+long libjxml_query_keep (xml_query_t * query_t, char * text, long length);
+void libjxml_query_settle (xml_query_t * query_t, xml_open_t * open_t);
+bool libjxml_query_start (void * context, char * name, long length);
+bool libjxml_query_attribute (void * context, char * name, long name_length, char * value, long value_length);
+bool libjxml_query_text (void * context, char * text, long length);
+bool libjxml_query_cdata (void * context, char * text, long length);
+bool libjxml_query_content (xml_query_t * query_t, char * text, long length, bool decode);
+bool libjxml_query_end (void * context, char * name, long length);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+/*
+ * The path is copied, and the names and values of the steps point to the copy.
+ */
+xml_query_t * libjxml_query_compile (char * path)
+{
+	xml_query_t * query_t;
+	long length;
+	long i;
+
+	query_t = (xml_query_t *) calloc (1, sizeof (xml_query_t));
+	LIBASSERT_PTR (query_t);
+
+	length = libstring_length (path);
+	query_t->path = (char *) malloc ((length + 1) * sizeof (char));
+	LIBASSERT_PTR (query_t->path);
+	memcpy (query_t->path, path, length + 1);
+
+	if (libjxml_query_parse (query_t, query_t->path) == false)
+	{
+		fprintf (stderr, "\nLibXML: Error compiling query '%s'", path);
+		libjxml_query_free (query_t);
+		return NULL;
+	}
+
+	/* Tags are selected while parsing before their value is known */
+	query_t->streamable = true;
+	for (i = 0; i < query_t->steps_count - 1; i++)
+		if (query_t->steps [i].value)
+			query_t->streamable = false;
+
+	return query_t;
+}
+
+void libjxml_query_free (xml_query_t * query_t)
+{
+	free (query_t->path);
+	free (query_t->walk);
+	free (query_t->open);
+	free (query_t->text);
+	free (query_t->scratch);
+	free (query_t);
+}
+
+/*
+ * The tree is walked without a stack of its own: the frames of the query keep
+ * the tags whose nested tags are being walked, so branches where no step can be
+ * matched any more are skipped.
+ */
+long libjxml_query_run (xml_query_t * query_t, xml_t * xml_mem_t, xml_found_cb found, void * context)
+{
+	xml_attribute_t * attribute_t;
+	xml_tag_t * tag_t;
+	uint64_t states = LIBJXML_QUERY_BIT (0);
+	uint64_t nested;
+	long depth = 0;
+	long count = 0;
+	bool matched;
+
+	if (libjxml_query_resolve (query_t, xml_mem_t->names_t) == false)
+		return 0;
+
+	tag_t = xml_mem_t->content_t;
+
+	while (tag_t != NULL)
+	{
+		nested = libjxml_query_match (query_t, states, tag_t, &matched);
+
+		if (matched)
+		{
+			attribute_t = NULL;
+			if (query_t->attribute != NULL)
+			{
+				attribute_t = tag_t->attribute_t;
+				while ((attribute_t != NULL) && (attribute_t->name != query_t->attribute_interned))
+					attribute_t = attribute_t->next_attribute_t;
+			}
+
+			if ((query_t->attribute == NULL) || (attribute_t != NULL))
+			{
+				count++;
+				if ((found != NULL) && (found (context, tag_t, attribute_t) == false))
+					return count;
+			}
+		}
+
+		if ((nested != 0) && (tag_t->nested_tag_t != NULL))
+		{
+			if (depth == query_t->walk_capacity)
+			{
+				query_t->walk_capacity = (depth == 0) ? LIBJXML_QUERY_FRAMES : depth * 2;
+				query_t->walk = (xml_walk_t *) realloc (query_t->walk, query_t->walk_capacity * sizeof (xml_walk_t));
+				LIBASSERT_PTR (query_t->walk);
+			}
+
+			query_t->walk [depth].tag_t = tag_t;
+			query_t->walk [depth].states = states;
+			depth++;
+
+			states = nested;
+			tag_t = tag_t->nested_tag_t;
+			continue;
+		}
+
+		while ((tag_t->sibling_tag_t == NULL) && (depth > 0))
+		{
+			depth--;
+			tag_t = query_t->walk [depth].tag_t;
+			states = query_t->walk [depth].states;
+		}
+
+		tag_t = tag_t->sibling_tag_t;
+	}
+
+	return count;
+}
+
+xml_tag_t * libjxml_query_first (xml_query_t * query_t, xml_t * xml_mem_t)
+{
+	void * first [2] = {NULL, NULL};
+
+	libjxml_query_run (query_t, xml_mem_t, libjxml_query_first_cb, first);
+
+	return (xml_tag_t *) first [0];
+}
+
+char * libjxml_query_value (xml_query_t * query_t, xml_t * xml_mem_t, long * length)
+{
+	void * first [2] = {NULL, NULL};
+	xml_tag_t * tag_t;
+	xml_attribute_t * attribute_t;
+
+	if (length != NULL)
+		*length = 0;
+
+	libjxml_query_run (query_t, xml_mem_t, libjxml_query_first_cb, first);
+
+	tag_t = (xml_tag_t *) first [0];
+	attribute_t = (xml_attribute_t *) first [1];
+
+	if (attribute_t != NULL)
+		return libjxml_attribute_value (attribute_t, length);
+
+	if (tag_t != NULL)
+		return libjxml_tag_value (tag_t, length);
+
+	return NULL;
+}
+
+bool libjxml_query_stream_buffer (xml_query_t * query_t, char * xml_txt, long length,
+								  xml_pair_cb found, void * context)
+{
+	xml_handler_t handler_t;
+
+	if (libjxml_query_stream (query_t, &handler_t, found, context) == false)
+		return false;
+
+	return libjxml_sax_buffer (xml_txt, length, &handler_t);
+}
+
+bool libjxml_query_stream_fd (xml_query_t * query_t, int xml_fd, xml_pair_cb found, void * context)
+{
+	xml_handler_t handler_t;
+
+	if (libjxml_query_stream (query_t, &handler_t, found, context) == false)
+		return false;
+
+	return libjxml_sax_fd (xml_fd, 0, &handler_t);
+}
+
+/*********************************************************************************
+ *                                    COMPILE
+ *********************************************************************************/
+
+bool libjxml_query_parse (xml_query_t * query_t, char * text)
+{
+	xml_step_t * step_t;
+
+	if (*text != '/')
+		return false;
+
+	while (*text == '/')
+	{
+		text++;
+
+		if (*text == '@')
+		{
+			text++;
+			query_t->attribute = text;
+			query_t->attribute_length = libjxml_query_name (text);
+			text = text + query_t->attribute_length;
+
+			if ((query_t->attribute_length == 0) || (query_t->steps_count == 0))
+				return false;
+			break;
+		}
+
+		if (query_t->steps_count == LIBJXML_QUERY_STEPS)
+			return false;
+
+		step_t = &query_t->steps [query_t->steps_count];
+		step_t->first = query_t->predicates_count;
+
+		if (*text == '/')
+		{
+			step_t->descendant = true;
+			text++;
+		}
+
+		if (*text == '*')
+		{
+			step_t->any = true;
+			text++;
+		}
+		else
+		{
+			step_t->name = text;
+			step_t->name_length = libjxml_query_name (text);
+			text = text + step_t->name_length;
+
+			/* Steps like . or .. are not supported */
+			if ((step_t->name_length == 0) || (step_t->name [0] == '.'))
+				return false;
+		}
+
+		while (*text == '[')
+		{
+			text = libjxml_query_predicate (query_t, step_t, text + 1);
+			if (text == NULL)
+				return false;
+		}
+
+		query_t->steps_count++;
+	}
+
+	return *text == '\0';
+}
+
+long libjxml_query_name (char * text)
+{
+	long length = 0;
+
+	while (!LIBJXML_QUERY_NAME_END (text [length]))
+		length++;
+
+	return length;
+}
+
+/*
+ * Reads a quoted value, returning the text after it or NULL if it is not valid.
+ */
+char * libjxml_query_literal (char * text, char ** value, long * length)
+{
+	char quote = *text;
+	char * end;
+
+	if ((quote != '"') && (quote != '\''))
+		return NULL;
+
+	end = strchr (text + 1, quote);
+	if (end == NULL)
+		return NULL;
+
+	*value = text + 1;
+	*length = end - text - 1;
+
+	return end + 1;
+}
+
+/*
+ * Reads a predicate after its opening bracket, returning the text after it or
+ * NULL if it is not valid.
+ */
+char * libjxml_query_predicate (xml_query_t * query_t, xml_step_t * step_t, char * text)
+{
+	xml_predicate_t * predicate_t;
+
+	if (query_t->predicates_count == LIBJXML_QUERY_PREDICATES)
+		return NULL;
+
+	predicate_t = &query_t->predicates [query_t->predicates_count];
+
+	while (*text == ' ')
+		text++;
+
+	if (*text == '@')
+	{
+		text++;
+		predicate_t->kind = LIBJXML_PREDICATE_ATTRIBUTE;
+		predicate_t->name = text;
+		predicate_t->name_length = libjxml_query_name (text);
+		text = text + predicate_t->name_length;
+
+		if (predicate_t->name_length == 0)
+			return NULL;
+	}
+	else if (*text == '.')
+	{
+		text++;
+		predicate_t->kind = LIBJXML_PREDICATE_VALUE;
+	}
+	else if (strncmp (text, "text()", 6) == 0)
+	{
+		text = text + 6;
+		predicate_t->kind = LIBJXML_PREDICATE_VALUE;
+	}
+	else
+		return NULL;
+
+	while (*text == ' ')
+		text++;
+
+	if (*text == '=')
+	{
+		text++;
+		while (*text == ' ')
+			text++;
+
+		text = libjxml_query_literal (text, &predicate_t->value, &predicate_t->value_length);
+		if (text == NULL)
+			return NULL;
+
+		if (predicate_t->kind == LIBJXML_PREDICATE_ATTRIBUTE)
+			predicate_t->kind = LIBJXML_PREDICATE_EQUAL;
+
+		while (*text == ' ')
+			text++;
+	}
+	else if (predicate_t->kind == LIBJXML_PREDICATE_VALUE)
+		return NULL;
+
+	if (*text != ']')
+		return NULL;
+
+	if (predicate_t->kind == LIBJXML_PREDICATE_VALUE)
+		step_t->value = true;
+	else
+		step_t->attributes = step_t->attributes | LIBJXML_QUERY_BIT (query_t->predicates_count);
+
+	step_t->count++;
+	query_t->predicates_count++;
+
+	return text + 1;
+}
+
+/*********************************************************************************
+ *                                     TREES
+ *********************************************************************************/
+
+/*
+ * Compares two tokens, any of them NULL when its length is 0.
+ */
+bool libjxml_query_equal (char * text, long length, char * value, long value_length)
+{
+	if (length != value_length)
+		return false;
+
+	return (length == 0) || (memcmp (text, value, length) == 0);
+}
+
+/*
+ * Finds the names of the query in the table of names of the document, so tags
+ * are matched comparing pointers. Returns false if some name is missing, as no
+ * tag can be found then.
+ */
+bool libjxml_query_resolve (xml_query_t * query_t, xml_names_t * names_t)
+{
+	xml_step_t * step_t;
+	xml_predicate_t * predicate_t;
+	long i;
+
+	for (i = 0; i < query_t->steps_count; i++)
+	{
+		step_t = &query_t->steps [i];
+		if (step_t->any)
+			continue;
+
+		step_t->interned = libjxml_names_find (names_t, step_t->name, step_t->name_length);
+		if (step_t->interned == NULL)
+			return false;
+	}
+
+	for (i = 0; i < query_t->predicates_count; i++)
+	{
+		predicate_t = &query_t->predicates [i];
+		if (predicate_t->kind == LIBJXML_PREDICATE_VALUE)
+			continue;
+
+		predicate_t->interned = libjxml_names_find (names_t, predicate_t->name, predicate_t->name_length);
+		if (predicate_t->interned == NULL)
+			return false;
+	}
+
+	if (query_t->attribute != NULL)
+	{
+		query_t->attribute_interned = libjxml_names_find (names_t, query_t->attribute, query_t->attribute_length);
+		if (query_t->attribute_interned == NULL)
+			return false;
+	}
+
+	return true;
+}
+
+bool libjxml_query_test (xml_query_t * query_t, xml_step_t * step_t, xml_tag_t * tag_t)
+{
+	xml_predicate_t * predicate_t;
+	xml_attribute_t * attribute_t;
+	long i;
+
+	if ((step_t->any == false) && (tag_t->name != step_t->interned))
+		return false;
+
+	for (i = step_t->first; i < step_t->first + step_t->count; i++)
+	{
+		predicate_t = &query_t->predicates [i];
+
+		if (predicate_t->kind == LIBJXML_PREDICATE_VALUE)
+		{
+			if (libjxml_query_equal (tag_t->value, tag_t->value_length,
+									 predicate_t->value, predicate_t->value_length) == false)
+				return false;
+			continue;
+		}
+
+		attribute_t = tag_t->attribute_t;
+		while ((attribute_t != NULL) && (attribute_t->name != predicate_t->interned))
+			attribute_t = attribute_t->next_attribute_t;
+
+		if (attribute_t == NULL)
+			return false;
+
+		if ((predicate_t->kind == LIBJXML_PREDICATE_EQUAL) &&
+			(libjxml_query_equal (attribute_t->value, attribute_t->value_length,
+								  predicate_t->value, predicate_t->value_length) == false))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Returns the steps to be matched by the tags nested in 'tag_t', given the ones
+ * to be matched by the tag itself.
+ */
+uint64_t libjxml_query_match (xml_query_t * query_t, uint64_t states, xml_tag_t * tag_t, bool * matched)
+{
+	xml_step_t * step_t;
+	uint64_t nested = 0;
+	long k;
+
+	*matched = false;
+
+	while (states != 0)
+	{
+		k = __builtin_ctzll (states);
+		states = states & (states - 1);
+		step_t = &query_t->steps [k];
+
+		if (step_t->descendant)
+			nested = nested | LIBJXML_QUERY_BIT (k);
+
+		if (libjxml_query_test (query_t, step_t, tag_t) == false)
+			continue;
+
+		if (k + 1 == query_t->steps_count)
+			*matched = true;
+		else
+			nested = nested | LIBJXML_QUERY_BIT (k + 1);
+	}
+
+	return nested;
+}
+
+bool libjxml_query_first_cb (void * context, xml_tag_t * tag_t, xml_attribute_t * attribute_t)
+{
+	void ** first = (void **) context;
+
+	first [0] = tag_t;
+	first [1] = attribute_t;
+
+	return false;
+}
+
+/*********************************************************************************
+ *                                     TEXTS
+ *********************************************************************************/
+
+/*
+ * Prepares a streaming run, returning false if the query cannot be run on a text.
+ */
+bool libjxml_query_stream (xml_query_t * query_t, xml_handler_t * handler_t, xml_pair_cb found, void * context)
+{
+	if (query_t->streamable == false)
+	{
+		fprintf (stderr, "\nLibXML: Error query with values before the last step run on a text");
+		return false;
+	}
+
+	memset (handler_t, 0, sizeof (xml_handler_t));
+	handler_t->context = query_t;
+	handler_t->start_tag = libjxml_query_start;
+	handler_t->attribute = libjxml_query_attribute;
+	handler_t->text = libjxml_query_text;
+	handler_t->cdata = libjxml_query_cdata;
+	handler_t->end_tag = libjxml_query_end;
+
+	query_t->depth = 0;
+	query_t->text_length = 0;
+	query_t->found = found;
+	query_t->context = context;
+
+	return true;
+}
+
+/*
+ * Copies a token at the end of the text of the query, returning its offset.
+ */
+long libjxml_query_keep (xml_query_t * query_t, char * text, long length)
+{
+	long offset = query_t->text_length;
+
+	if (offset + length > query_t->text_capacity)
+	{
+		if (query_t->text_capacity == 0)
+			query_t->text_capacity = LIBJXML_QUERY_TEXT;
+
+		while (offset + length > query_t->text_capacity)
+			query_t->text_capacity = query_t->text_capacity * 2;
+
+		query_t->text = (char *) realloc (query_t->text, query_t->text_capacity * sizeof (char));
+		LIBASSERT_PTR (query_t->text);
+	}
+
+	memcpy (query_t->text + offset, text, length);
+	query_t->text_length = offset + length;
+
+	return offset;
+}
+
+/*
+ * Once the attributes of a tag are known, finds the steps it matches.
+ */
+void libjxml_query_settle (xml_query_t * query_t, xml_open_t * open_t)
+{
+	xml_step_t * step_t;
+	uint64_t states = open_t->parent;
+	long k;
+
+	if (open_t->pending == false)
+		return;
+
+	open_t->pending = false;
+
+	while (states != 0)
+	{
+		k = __builtin_ctzll (states);
+		states = states & (states - 1);
+		step_t = &query_t->steps [k];
+
+		if (step_t->descendant)
+			open_t->states = open_t->states | LIBJXML_QUERY_BIT (k);
+
+		if (((open_t->candidates & LIBJXML_QUERY_BIT (k)) == 0) ||
+			((step_t->attributes & ~open_t->satisfied) != 0))
+			continue;
+
+		if (k + 1 == query_t->steps_count)
+			open_t->matched = true;
+		else
+			open_t->states = open_t->states | LIBJXML_QUERY_BIT (k + 1);
+	}
+}
+
+bool libjxml_query_start (void * context, char * name, long length)
+{
+	xml_query_t * query_t = (xml_query_t *) context;
+	xml_open_t * open_t;
+	xml_step_t * step_t;
+	uint64_t states = LIBJXML_QUERY_BIT (0);
+	uint64_t candidates = 0;
+	uint64_t parent;
+	long k;
+
+	if (query_t->depth > 0)
+	{
+		open_t = &query_t->open [query_t->depth - 1];
+		libjxml_query_settle (query_t, open_t);
+		open_t->nested = true;
+		states = open_t->states;
+	}
+
+	if (query_t->depth == query_t->open_capacity)
+	{
+		query_t->open_capacity = (query_t->depth == 0) ? LIBJXML_QUERY_FRAMES : query_t->depth * 2;
+		query_t->open = (xml_open_t *) realloc (query_t->open, query_t->open_capacity * sizeof (xml_open_t));
+		LIBASSERT_PTR (query_t->open);
+	}
+
+	for (parent = states; parent != 0; parent = parent & (parent - 1))
+	{
+		k = __builtin_ctzll (parent);
+		step_t = &query_t->steps [k];
+
+		if ((step_t->any) ||
+			(libjxml_query_equal (name, length, step_t->name, step_t->name_length)))
+			candidates = candidates | LIBJXML_QUERY_BIT (k);
+	}
+
+	open_t = &query_t->open [query_t->depth];
+	query_t->depth++;
+
+	open_t->parent = states;
+	open_t->candidates = candidates;
+	open_t->satisfied = 0;
+	open_t->states = 0;
+	open_t->start = query_t->text_length;
+	open_t->name = -1;
+	open_t->name_length = length;
+	open_t->attribute = -1;
+	open_t->attribute_length = 0;
+	open_t->value = -1;
+	open_t->value_length = 0;
+	open_t->pending = true;
+	open_t->matched = false;
+	open_t->nested = false;
+
+	/* Only tags that can match the last step are given to the callback */
+	if (candidates & LIBJXML_QUERY_BIT (query_t->steps_count - 1))
+		open_t->name = libjxml_query_keep (query_t, name, length);
+
+	return true;
+}
+
+bool libjxml_query_attribute (void * context, char * name, long name_length, char * value, long value_length)
+{
+	xml_query_t * query_t = (xml_query_t *) context;
+	xml_open_t * open_t = &query_t->open [query_t->depth - 1];
+	xml_predicate_t * predicate_t;
+	xml_step_t * step_t;
+	uint64_t candidates;
+	long i;
+	long k;
+
+	/* Values are compared and given decoded, as they are in the trees */
+	if (libjxml_entity_find (value, value_length) < value_length)
+	{
+		if (value_length > query_t->scratch_capacity)
+		{
+			query_t->scratch_capacity = (value_length > LIBJXML_QUERY_TEXT) ? value_length : LIBJXML_QUERY_TEXT;
+			query_t->scratch = (char *) realloc (query_t->scratch, query_t->scratch_capacity * sizeof (char));
+			LIBASSERT_PTR (query_t->scratch);
+		}
+
+		value_length = libjxml_entity_decode (query_t->scratch, value, value_length);
+		value = query_t->scratch;
+	}
+
+	for (candidates = open_t->candidates; candidates != 0; candidates = candidates & (candidates - 1))
+	{
+		k = __builtin_ctzll (candidates);
+		step_t = &query_t->steps [k];
+
+		for (i = step_t->first; i < step_t->first + step_t->count; i++)
+		{
+			predicate_t = &query_t->predicates [i];
+
+			if ((predicate_t->kind == LIBJXML_PREDICATE_VALUE) ||
+				(libjxml_query_equal (name, name_length, predicate_t->name, predicate_t->name_length) == false))
+				continue;
+
+			if ((predicate_t->kind == LIBJXML_PREDICATE_EQUAL) &&
+				(libjxml_query_equal (value, value_length, predicate_t->value, predicate_t->value_length) == false))
+				continue;
+
+			open_t->satisfied = open_t->satisfied | LIBJXML_QUERY_BIT (i);
+		}
+	}
+
+	if ((query_t->attribute != NULL) && (open_t->name >= 0) && (open_t->attribute < 0) &&
+		(libjxml_query_equal (name, name_length, query_t->attribute, query_t->attribute_length)))
+	{
+		open_t->attribute = libjxml_query_keep (query_t, value, value_length);
+		open_t->attribute_length = value_length;
+	}
+
+	return true;
+}
+
+bool libjxml_query_text (void * context, char * text, long length)
+{
+	return libjxml_query_content ((xml_query_t *) context, text, length, true);
+}
+
+bool libjxml_query_cdata (void * context, char * text, long length)
+{
+	return libjxml_query_content ((xml_query_t *) context, text, length, false);
+}
+
+/*
+ * Keeps the value of the tags found, which is the first text with some character
+ * other than blanks, like in the trees. It is decoded over its copy, except for
+ * CDATA sections, which have no entities.
+ */
+bool libjxml_query_content (xml_query_t * query_t, char * text, long length, bool decode)
+{
+	xml_open_t * open_t;
+	long i;
+
+	if (query_t->depth == 0)
+		return true;
+
+	open_t = &query_t->open [query_t->depth - 1];
+	libjxml_query_settle (query_t, open_t);
+
+	if ((open_t->matched == false) || (open_t->nested) || (open_t->value >= 0))
+		return true;
+
+	for (i = 0; i < length; i++)
+	{
+		if ((text [i] != ' ') && (text [i] != '\n') && (text [i] != '\t') &&
+			(text [i] != '\r') && (text [i] != '\v') && (text [i] != '\f'))
+		{
+			open_t->value = libjxml_query_keep (query_t, text, length);
+			open_t->value_length = length;
+
+			if (decode)
+			{
+				open_t->value_length = libjxml_entity_decode (query_t->text + open_t->value,
+															  query_t->text + open_t->value, length);
+				query_t->text_length = open_t->value + open_t->value_length;
+			}
+			break;
+		}
+	}
+
+	return true;
+}
+
+bool libjxml_query_end (void * context, char * name, long length)
+{
+	xml_query_t * query_t = (xml_query_t *) context;
+	xml_open_t * open_t = &query_t->open [query_t->depth - 1];
+	xml_step_t * step_t = &query_t->steps [query_t->steps_count - 1];
+	xml_predicate_t * predicate_t;
+	char * value = NULL;
+	long value_length = 0;
+	bool found = true;
+	bool result = true;
+	long i;
+
+	(void) name;
+	(void) length;
+
+	libjxml_query_settle (query_t, open_t);
+
+	if ((open_t->value >= 0) && (open_t->nested == false))
+	{
+		value = query_t->text + open_t->value;
+		value_length = open_t->value_length;
+	}
+
+	if (open_t->matched)
+	{
+		for (i = step_t->first; i < step_t->first + step_t->count; i++)
+		{
+			predicate_t = &query_t->predicates [i];
+
+			if ((predicate_t->kind == LIBJXML_PREDICATE_VALUE) &&
+				(libjxml_query_equal (value, value_length, predicate_t->value, predicate_t->value_length) == false))
+				found = false;
+		}
+
+		if (query_t->attribute != NULL)
+		{
+			if ((found) && (open_t->attribute >= 0))
+				result = query_t->found (query_t->context, query_t->attribute, query_t->attribute_length,
+										 query_t->text + open_t->attribute, open_t->attribute_length);
+		}
+		else if (found)
+			result = query_t->found (query_t->context, query_t->text + open_t->name, open_t->name_length,
+									 value, value_length);
+	}
+
+	query_t->text_length = open_t->start;
+	query_t->depth--;
+
+	return result;
+}
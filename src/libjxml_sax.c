@@ -0,0 +1,1031 @@
+/**
+ * @file libjxml_sax.c
+ *
+ * @brief Event driven parser for xml files.
+ *
+ * The text is read once from left to right and every tag, attribute and text
+ * found is notified to a set of callbacks, without building any tree in memory.
+ * The text can be given in chunks of any size as it arrives, and files are read
+ * through a buffer of fixed size, so documents bigger than the available memory
+ * can be parsed.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "libjxml_sax.h"
+#include "libjxml_scan.h"
+#include "libstring.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_STACK_SIZE 32  /**< Initial depth of the open tag stack */
+#define LIBJXML_NAMES_SIZE 256 /**< Initial size to store the open tag names */
+#define LIBJXML_TOKEN_SIZE 256 /**< Initial size to store a token split between chunks */
+#define LIBJXML_SCAN_WINDOW 4  /**< Blocks of the chunk classified at once */
+#define LIBJXML_SCAN_PROBE  16 /**< Bytes compared one by one before classifying a block */
+
+#define LIBJXML_ERROR      -1  /**< The text is not valid XML */
+#define LIBJXML_STOP       -3  /**< A callback asked to stop parsing */
+
+#define LIBJXML_CHAR_SPACE    0x01 /**< Blank character */
+#define LIBJXML_CHAR_NAME_END 0x02 /**< Character that ends a tag or attribute name */
+
+#define LIBJXML_IS_NAME(c)  ((libjxml_char_class [(unsigned char) (c)] & LIBJXML_CHAR_NAME_END) == 0)
+#define LIBJXML_IN_CLASS(c, class) (((class) == LIBJXML_CLASS_TEXT) ? \
+	((libjxml_char_class [(unsigned char) (c)] & LIBJXML_CHAR_SPACE) == 0) : \
+	((libjxml_char_class [(unsigned char) (c)] & LIBJXML_CHAR_NAME_END) != 0))
+
+/**
+ * @brief Function reading the next block of text from a stream.
+ *
+ * @return Number of bytes read, 0 at the end of the stream, negative on error.
+ */
+typedef long (* xml_read_cb) (void * stream, char * buffer, long size);
+
+/**
+ * @brief Position of the parser inside the markup, kept between chunks.
+ */
+typedef enum xml_state_t
+{
+	LIBJXML_STATE_TEXT,        /**< Text between tags */
+	LIBJXML_STATE_MARKUP,      /**< After '<' */
+	LIBJXML_STATE_OPEN_NAME,   /**< Name of an open tag */
+	LIBJXML_STATE_TAG,         /**< Inside a tag, between attributes */
+	LIBJXML_STATE_ATTR_NAME,   /**< Name of an attribute */
+	LIBJXML_STATE_ATTR_EQUAL,  /**< After an attribute name, waiting for '=' */
+	LIBJXML_STATE_ATTR_QUOTE,  /**< After '=', waiting for the opening quote */
+	LIBJXML_STATE_ATTR_VALUE,  /**< Value of an attribute, until the closing quote */
+	LIBJXML_STATE_EMPTY_END,   /**< After '/' in an open tag, waiting for '>' */
+	LIBJXML_STATE_CLOSE_NAME,  /**< Name of a close tag */
+	LIBJXML_STATE_CLOSE_END,   /**< After the name of a close tag, waiting for '>' */
+	LIBJXML_STATE_BANG,        /**< After '<!', until the kind of markup is known */
+	LIBJXML_STATE_COMMENT,     /**< Comment, until '-->' */
+	LIBJXML_STATE_CDATA,       /**< CDATA section, until ']]>' */
+	LIBJXML_STATE_DECLARATION, /**< Declaration like DOCTYPE, until '>' */
+	LIBJXML_STATE_PI_NAME,     /**< Name of an instruction */
+	LIBJXML_STATE_PI_END       /**< Instruction skipped until '?>' */
+}xml_state_t;
+
+/**
+ * @brief State of the single pass parser, kept between chunks.
+ */
+struct xml_push_t
+{
+	xml_handler_t * handler_t;        /**< Callbacks receiving the events */
+	xml_state_t     state;            /**< Position inside the markup */
+	bool            content;          /**< The first tag has been already found */
+	bool            instruction;      /**< The attributes being read belong to the xml instruction */
+	bool            failed;           /**< An error was found or a callback stopped the parser */
+	char            quote;            /**< Quote closing the attribute value being read */
+	int             match;            /**< Characters of a delimiter or markup start already read */
+	long            brackets;         /**< Open brackets of the declaration being read */
+	char            markup [8];       /**< Characters read after '<!' */
+	long            offset;           /**< Bytes fed in previous chunks */
+	char          * token;            /**< Beginning of a token split between chunks */
+	long            token_length;     /**< Used length of token */
+	long            token_capacity;   /**< Allocated length of token */
+	char          * name;             /**< Attribute name kept until its value is read */
+	long            name_capacity;    /**< Allocated length of name */
+	char          * attribute;        /**< Name of the attribute being read */
+	long            attribute_length; /**< Length of the attribute name */
+	bool            attribute_kept;   /**< The attribute name is stored in name, not in the chunk */
+	char          * tag;              /**< Name of the open tag being read in the chunk, NULL if only on the stack */
+	char          * tag_end;          /**< Delimiter after the tag name to be null ended */
+	char          * attribute_end;    /**< Delimiter after the attribute name to be null ended */
+	char          * names;            /**< Names of the open tags, one after another */
+	long            names_length;     /**< Used length of names */
+	long            names_capacity;   /**< Allocated length of names */
+	long          * offsets;          /**< Offset of each open tag name in names */
+	long            depth;            /**< Number of open tags */
+	long            capacity;         /**< Number of offsets allocated */
+	long            window_start;     /**< Offset in the chunk of the first byte classified */
+	long            window_end;       /**< Offset in the chunk after the last byte classified */
+	xml_masks_t     window [LIBJXML_SCAN_WINDOW]; /**< Classes of the bytes of the chunk being read */
+};
+
+static const unsigned char libjxml_char_class [256] =
+{
+	['\0'] = LIBJXML_CHAR_NAME_END,
+	[' ']  = LIBJXML_CHAR_SPACE | LIBJXML_CHAR_NAME_END,
+	['\n'] = LIBJXML_CHAR_SPACE | LIBJXML_CHAR_NAME_END,
+	['\t'] = LIBJXML_CHAR_SPACE | LIBJXML_CHAR_NAME_END,
+	['\v'] = LIBJXML_CHAR_SPACE | LIBJXML_CHAR_NAME_END,
+	['\f'] = LIBJXML_CHAR_SPACE | LIBJXML_CHAR_NAME_END,
+	['\r'] = LIBJXML_CHAR_SPACE | LIBJXML_CHAR_NAME_END,
+	['<']  = LIBJXML_CHAR_NAME_END,
+	['>']  = LIBJXML_CHAR_NAME_END,
+	['/']  = LIBJXML_CHAR_NAME_END,
+	['=']  = LIBJXML_CHAR_NAME_END,
+	['?']  = LIBJXML_CHAR_NAME_END,
+	['"']  = LIBJXML_CHAR_NAME_END,
+	['\''] = LIBJXML_CHAR_NAME_END,
+};
+
+/*********************************************************************************
+ *                                 DECLARATIONS
+ *********************************************************************************/
+
+void libjxml_push_name (xml_push_t * push_t, char * name, long length);
+bool libjxml_match_name (xml_push_t * push_t, char * name, long length);
+void libjxml_pop_name (xml_push_t * push_t);
+char * libjxml_top_name (xml_push_t * push_t, long * length);
+
+bool libjxml_sax_stream (xml_read_cb reader, void * stream, long buffer_size, xml_handler_t * handler_t);
+long libjxml_read_fd (void * stream, char * buffer, long size);
+long libjxml_read_file (void * stream, char * buffer, long size);
+
+long libjxml_tokenize (xml_push_t * push_t, char * chunk, long length);
+void libjxml_keep_chunk (xml_push_t * push_t, char * chunk, long start, long length);
+long libjxml_parse_error (xml_push_t * push_t, long position, char * message);
+void libjxml_carry (xml_push_t * push_t, char * text, long length);
+char * libjxml_token (xml_push_t * push_t, char * chunk, long start, long end, long * length);
+void libjxml_terminate (char ** delimiter);
+static inline long libjxml_find (xml_push_t * push_t, char * chunk, long position, long length, int class);
+void libjxml_fill_window (xml_push_t * push_t, char * chunk, long position, long length);
+int libjxml_match_markup (xml_push_t * push_t, char * markup);
+bool libjxml_scan_declaration (xml_push_t * push_t, char c);
+bool libjxml_emit_token (xml_push_t * push_t, xml_token_cb callback, char * token, long length);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+bool libjxml_sax_buffer (char * xml_txt, long length, xml_handler_t * handler_t)
+{
+	xml_push_t * push_t;
+
+	/* Given as a single chunk, no token is split and all of them point to the text */
+	push_t = libjxml_push_create (handler_t);
+	libjxml_push_feed (push_t, xml_txt, length);
+
+	return libjxml_push_finish (push_t);
+}
+
+bool libjxml_sax_fd (int xml_fd, long buffer_size, xml_handler_t * handler_t)
+{
+	return libjxml_sax_stream (libjxml_read_fd, &xml_fd, buffer_size, handler_t);
+}
+
+bool libjxml_sax_file (FILE * xml_file, long buffer_size, xml_handler_t * handler_t)
+{
+	return libjxml_sax_stream (libjxml_read_file, xml_file, buffer_size, handler_t);
+}
+
+xml_push_t * libjxml_push_create (xml_handler_t * handler_t)
+{
+	xml_push_t * push_t;
+
+	push_t = (xml_push_t *) malloc (sizeof (xml_push_t));
+	LIBASSERT_PTR (push_t);
+
+	push_t->handler_t = handler_t;
+	push_t->state = LIBJXML_STATE_TEXT;
+	push_t->content = false;
+	push_t->instruction = false;
+	push_t->failed = false;
+	push_t->quote = '"';
+	push_t->match = 0;
+	push_t->brackets = 0;
+	push_t->offset = handler_t->offset;
+	push_t->token_length = 0;
+	push_t->token_capacity = LIBJXML_TOKEN_SIZE;
+	push_t->name_capacity = LIBJXML_TOKEN_SIZE;
+	push_t->attribute = NULL;
+	push_t->attribute_length = 0;
+	push_t->attribute_kept = false;
+	push_t->tag = NULL;
+	push_t->tag_end = NULL;
+	push_t->attribute_end = NULL;
+	push_t->depth = 0;
+	push_t->capacity = LIBJXML_STACK_SIZE;
+	push_t->names_length = 0;
+	push_t->names_capacity = LIBJXML_NAMES_SIZE;
+
+	push_t->token = (char *) malloc (push_t->token_capacity * sizeof (char));
+	LIBASSERT_PTR (push_t->token);
+	push_t->name = (char *) malloc (push_t->name_capacity * sizeof (char));
+	LIBASSERT_PTR (push_t->name);
+	push_t->offsets = (long *) malloc (push_t->capacity * sizeof (long));
+	LIBASSERT_PTR (push_t->offsets);
+	push_t->names = (char *) malloc (push_t->names_capacity * sizeof (char));
+	LIBASSERT_PTR (push_t->names);
+
+	return push_t;
+}
+
+bool libjxml_push_feed (xml_push_t * push_t, char * chunk, long length)
+{
+	if (push_t->failed)
+		return false;
+
+	if (libjxml_tokenize (push_t, chunk, length) < 0)
+	{
+		push_t->failed = true;
+		return false;
+	}
+
+	push_t->offset = push_t->offset + length;
+
+	return true;
+}
+
+void libjxml_push_skip (xml_push_t * push_t, long length)
+{
+	push_t->offset = push_t->offset + length;
+}
+
+bool libjxml_push_finish (xml_push_t * push_t)
+{
+	bool parsed = false;
+
+	if (push_t->failed)
+		parsed = false;
+	else if (push_t->state != LIBJXML_STATE_TEXT)
+		libjxml_parse_error (push_t, 0, "unexpected end of text");
+	else if (push_t->depth > 0)
+		libjxml_parse_error (push_t, 0, "unclosed tag");
+	else if (push_t->content == false)
+		libjxml_parse_error (push_t, 0, "no content");
+	else
+		parsed = true;
+
+	free (push_t->token);
+	free (push_t->name);
+	free (push_t->offsets);
+	free (push_t->names);
+	free (push_t);
+
+	return parsed;
+}
+
+/*********************************************************************************
+ *                                    STREAMS
+ *********************************************************************************/
+
+/*
+ * Each block read is fed to a push parser, so the buffer is reused as it is and
+ * never grows, whatever the size of the tokens.
+ */
+bool libjxml_sax_stream (xml_read_cb reader, void * stream, long buffer_size, xml_handler_t * handler_t)
+{
+	xml_push_t * push_t;
+	char * buffer;
+	long read_len;
+
+	if (buffer_size <= 0)
+		buffer_size = LIBJXML_SAX_BUFFER;
+
+	buffer = (char *) malloc (buffer_size * sizeof (char));
+	LIBASSERT_PTR (buffer);
+
+	push_t = libjxml_push_create (handler_t);
+
+	while (1)
+	{
+		read_len = reader (stream, buffer, buffer_size);
+		if (read_len < 0)
+		{
+			fprintf (stderr, "\nLibXML: Error reading stream.");
+			push_t->failed = true;
+			break;
+		}
+
+		if ((read_len == 0) || (libjxml_push_feed (push_t, buffer, read_len) == false))
+			break;
+	}
+
+	free (buffer);
+
+	return libjxml_push_finish (push_t);
+}
+
+long libjxml_read_fd (void * stream, char * buffer, long size)
+{
+	long read_len;
+
+	do
+	{
+		read_len = read (*(int *) stream, buffer, size);
+	} while ((read_len < 0) && (errno == EINTR));
+
+	return read_len;
+}
+
+long libjxml_read_file (void * stream, char * buffer, long size)
+{
+	long read_len;
+
+	read_len = fread (buffer, sizeof (char), size, (FILE *) stream);
+
+	if ((read_len == 0) && ferror ((FILE *) stream))
+		return -1;
+
+	return read_len;
+}
+
+/*********************************************************************************
+ *                                 PARSER STATE
+ *********************************************************************************/
+
+/*
+ * Names of the open tags are copied, because the chunk they were read from may
+ * have been replaced by the next one when the tag is closed.
+ */
+void libjxml_push_name (xml_push_t * push_t, char * name, long length)
+{
+	if (push_t->depth == push_t->capacity)
+	{
+		push_t->capacity = push_t->capacity * 2;
+		push_t->offsets = (long *) realloc (push_t->offsets, push_t->capacity * sizeof (long));
+		LIBASSERT_PTR (push_t->offsets);
+	}
+
+	while (push_t->names_length + length > push_t->names_capacity)
+	{
+		push_t->names_capacity = push_t->names_capacity * 2;
+		push_t->names = (char *) realloc (push_t->names, push_t->names_capacity * sizeof (char));
+		LIBASSERT_PTR (push_t->names);
+	}
+
+	push_t->offsets [push_t->depth] = push_t->names_length;
+	memcpy (push_t->names + push_t->names_length, name, length);
+	push_t->names_length = push_t->names_length + length;
+	push_t->depth++;
+}
+
+bool libjxml_match_name (xml_push_t * push_t, char * name, long length)
+{
+	long top_length;
+	char * top;
+
+	top = libjxml_top_name (push_t, &top_length);
+
+	return (top_length == length) && (memcmp (top, name, length) == 0);
+}
+
+void libjxml_pop_name (xml_push_t * push_t)
+{
+	push_t->names_length = push_t->offsets [push_t->depth - 1];
+	push_t->depth--;
+}
+
+char * libjxml_top_name (xml_push_t * push_t, long * length)
+{
+	long offset;
+
+	offset = push_t->offsets [push_t->depth - 1];
+	*length = push_t->names_length - offset;
+
+	return push_t->names + offset;
+}
+
+/*********************************************************************************
+ *                                PARSE FUNCTIONS
+ *********************************************************************************/
+
+/*
+ * The parser reads each chunk once from left to right. Every '<' found starts a
+ * markup token (open tag, close tag, instruction, comment...) and every byte
+ * between two tokens is text. The state reached at the end of the chunk is kept,
+ * so the next chunk goes on from the same point of the markup. Tokens are given
+ * pointing to the chunk, and only a token split between two chunks is copied.
+ */
+long libjxml_tokenize (xml_push_t * push_t, char * chunk, long length)
+{
+	xml_handler_t * handler_t = push_t->handler_t;
+	xml_pair_cb callback;
+	char * found;
+	char * token;
+	long token_length;
+	long position = 0;
+	long start = 0;
+	long swap;
+	char c;
+	int i;
+
+	/* Nothing of the previous chunk is classified */
+	push_t->window_start = 0;
+	push_t->window_end = 0;
+
+	while (position < length)
+	{
+		switch (push_t->state)
+		{
+		case LIBJXML_STATE_TEXT:
+			/* Texts are long, memchr() beats classifying them */
+			found = (char *) memchr (chunk + position, '<', length - position);
+			if (found == NULL)
+			{
+				position = length;
+				break;
+			}
+
+			position = found - chunk;
+
+			/* Text outside the tags is ignored */
+			if ((push_t->depth > 0) && ((position > start) || (push_t->token_length > 0)))
+			{
+				token = libjxml_token (push_t, chunk, start, position, &token_length);
+				if (libjxml_emit_token (push_t, handler_t->text, token, token_length) == false)
+					return LIBJXML_STOP;
+
+				if (handler_t->terminate)
+					chunk [position] = '\0';
+			}
+
+			push_t->token_length = 0;
+			push_t->state = LIBJXML_STATE_MARKUP;
+			position++;
+			break;
+
+		case LIBJXML_STATE_MARKUP:
+			c = chunk [position];
+			if (c == '/')
+			{
+				if (push_t->depth == 0)
+					return libjxml_parse_error (push_t, position, "close tag without open tag");
+
+				push_t->state = LIBJXML_STATE_CLOSE_NAME;
+				position++;
+			}
+			else if (c == '?')
+			{
+				push_t->state = LIBJXML_STATE_PI_NAME;
+				position++;
+			}
+			else if (c == '!')
+			{
+				push_t->state = LIBJXML_STATE_BANG;
+				push_t->match = 0;
+				position++;
+			}
+			else
+			{
+				push_t->state = LIBJXML_STATE_OPEN_NAME;
+				push_t->instruction = false;
+			}
+
+			start = position;
+			break;
+
+		case LIBJXML_STATE_OPEN_NAME:
+			position = libjxml_find (push_t, chunk, position, length, LIBJXML_CLASS_NAME_END);
+			if (position == length)
+				break;
+
+			token = libjxml_token (push_t, chunk, start, position, &token_length);
+			if (token_length == 0)
+				return libjxml_parse_error (push_t, position, "tag without name");
+
+			push_t->content = true;
+			libjxml_push_name (push_t, token, token_length);
+
+			/* The name of an empty tag is given again to end_tag */
+			if (token == push_t->token)
+				push_t->tag = NULL;
+			else
+				push_t->tag = token;
+
+			if (handler_t->terminate)
+				push_t->tag_end = chunk + position;
+
+			if (libjxml_emit_token (push_t, handler_t->start_tag, token, token_length) == false)
+				return LIBJXML_STOP;
+
+			push_t->state = LIBJXML_STATE_TAG;
+			break;
+
+		case LIBJXML_STATE_TAG:
+			position = libjxml_find (push_t, chunk, position, length, LIBJXML_CLASS_TEXT);
+			if (position == length)
+				break;
+
+			c = chunk [position];
+			if (LIBJXML_IS_NAME (c))
+			{
+				push_t->state = LIBJXML_STATE_ATTR_NAME;
+				start = position;
+			}
+			else if (push_t->instruction)
+			{
+				/* Anything else ends the attributes of the instruction */
+				push_t->state = LIBJXML_STATE_PI_END;
+				push_t->match = (c == '?');
+				position++;
+			}
+			else if (c == '>')
+			{
+				libjxml_terminate (&push_t->tag_end);
+				push_t->state = LIBJXML_STATE_TEXT;
+				position++;
+				start = position;
+			}
+			else if (c == '/')
+			{
+				push_t->state = LIBJXML_STATE_EMPTY_END;
+				position++;
+			}
+			else
+				return libjxml_parse_error (push_t, position, "unclosed tag");
+			break;
+
+		case LIBJXML_STATE_ATTR_NAME:
+			position = libjxml_find (push_t, chunk, position, length, LIBJXML_CLASS_NAME_END);
+			if (position == length)
+				break;
+
+			token = libjxml_token (push_t, chunk, start, position, &token_length);
+
+			/* A name read from the carried token is moved away, the value may need it */
+			if (token == push_t->token)
+			{
+				push_t->token = push_t->name;
+				push_t->name = token;
+				swap = push_t->token_capacity;
+				push_t->token_capacity = push_t->name_capacity;
+				push_t->name_capacity = swap;
+				push_t->attribute_kept = true;
+			}
+			else
+				push_t->attribute_kept = false;
+
+			push_t->attribute = token;
+			push_t->attribute_length = token_length;
+
+			if (handler_t->terminate)
+				push_t->attribute_end = chunk + position;
+
+			push_t->state = LIBJXML_STATE_ATTR_EQUAL;
+			break;
+
+		case LIBJXML_STATE_ATTR_EQUAL:
+			position = libjxml_find (push_t, chunk, position, length, LIBJXML_CLASS_TEXT);
+			if (position == length)
+				break;
+
+			if (chunk [position] != '=')
+				return libjxml_parse_error (push_t, position, "attribute without '='");
+
+			push_t->state = LIBJXML_STATE_ATTR_QUOTE;
+			position++;
+			break;
+
+		case LIBJXML_STATE_ATTR_QUOTE:
+			position = libjxml_find (push_t, chunk, position, length, LIBJXML_CLASS_TEXT);
+			if (position == length)
+				break;
+
+			if ((chunk [position] != '"') && (chunk [position] != '\''))
+				return libjxml_parse_error (push_t, position, "attribute without quotes");
+
+			push_t->quote = chunk [position];
+			push_t->state = LIBJXML_STATE_ATTR_VALUE;
+			position++;
+			start = position;
+			break;
+
+		case LIBJXML_STATE_ATTR_VALUE:
+			found = (char *) memchr (chunk + position, push_t->quote, length - position);
+			if (found == NULL)
+			{
+				position = length;
+				break;
+			}
+
+			position = found - chunk;
+			token = libjxml_token (push_t, chunk, start, position, &token_length);
+
+			if (push_t->instruction)
+				callback = handler_t->instruction;
+			else
+				callback = handler_t->attribute;
+
+			if ((callback != NULL) &&
+				(callback (handler_t->context, push_t->attribute, push_t->attribute_length,
+						   token, token_length) == false))
+				return LIBJXML_STOP;
+
+			/* Both delimiters have been already read, so they can be overwritten */
+			libjxml_terminate (&push_t->attribute_end);
+			if (handler_t->terminate)
+				chunk [position] = '\0';
+
+			push_t->attribute = NULL;
+			push_t->state = LIBJXML_STATE_TAG;
+			position++;
+			break;
+
+		case LIBJXML_STATE_EMPTY_END:
+			if (chunk [position] != '>')
+				return libjxml_parse_error (push_t, position, "unclosed tag");
+
+			if (push_t->tag == NULL)
+				push_t->tag = libjxml_top_name (push_t, &token_length);
+			else
+				libjxml_top_name (push_t, &token_length);
+
+			if (libjxml_emit_token (push_t, handler_t->end_tag, push_t->tag, token_length) == false)
+				return LIBJXML_STOP;
+
+			libjxml_pop_name (push_t);
+			libjxml_terminate (&push_t->tag_end);
+
+			push_t->state = LIBJXML_STATE_TEXT;
+			position++;
+			start = position;
+			break;
+
+		case LIBJXML_STATE_CLOSE_NAME:
+			position = libjxml_find (push_t, chunk, position, length, LIBJXML_CLASS_NAME_END);
+			if (position == length)
+				break;
+
+			token = libjxml_token (push_t, chunk, start, position, &token_length);
+			if (libjxml_match_name (push_t, token, token_length) == false)
+				return libjxml_parse_error (push_t, position, "close tag does not match open tag");
+
+			if (libjxml_emit_token (push_t, handler_t->end_tag, token, token_length) == false)
+				return LIBJXML_STOP;
+
+			libjxml_pop_name (push_t);
+			push_t->state = LIBJXML_STATE_CLOSE_END;
+			break;
+
+		case LIBJXML_STATE_CLOSE_END:
+			position = libjxml_find (push_t, chunk, position, length, LIBJXML_CLASS_TEXT);
+			if (position == length)
+				break;
+
+			if (chunk [position] != '>')
+				return libjxml_parse_error (push_t, position, "unclosed close tag");
+
+			push_t->state = LIBJXML_STATE_TEXT;
+			position++;
+			start = position;
+			break;
+
+		case LIBJXML_STATE_BANG:
+			push_t->markup [push_t->match] = chunk [position];
+			push_t->match++;
+			position++;
+
+			if (libjxml_match_markup (push_t, "--") > 0)
+			{
+				push_t->state = LIBJXML_STATE_COMMENT;
+				push_t->match = 0;
+			}
+			else if (libjxml_match_markup (push_t, "[CDATA[") > 0)
+			{
+				push_t->state = LIBJXML_STATE_CDATA;
+				push_t->match = 0;
+				start = position;
+			}
+			else if ((libjxml_match_markup (push_t, "--") < 0) &&
+					 (libjxml_match_markup (push_t, "[CDATA[") < 0))
+			{
+				/* Declarations like DOCTYPE may contain an internal subset between brackets */
+				push_t->state = LIBJXML_STATE_DECLARATION;
+				push_t->brackets = 0;
+
+				for (i = 0; i < push_t->match; i++)
+				{
+					if (libjxml_scan_declaration (push_t, push_t->markup [i]))
+					{
+						push_t->state = LIBJXML_STATE_TEXT;
+						start = position;
+						break;
+					}
+				}
+			}
+			break;
+
+		case LIBJXML_STATE_COMMENT:
+			c = chunk [position];
+			position++;
+
+			if (c == '-')
+				push_t->match++;
+			else if ((c == '>') && (push_t->match >= 2))
+			{
+				push_t->state = LIBJXML_STATE_TEXT;
+				start = position;
+			}
+			else
+				push_t->match = 0;
+			break;
+
+		case LIBJXML_STATE_CDATA:
+			if (push_t->match == 0)
+			{
+				found = (char *) memchr (chunk + position, ']', length - position);
+				if (found == NULL)
+				{
+					position = length;
+					break;
+				}
+
+				position = found - chunk;
+			}
+
+			c = chunk [position];
+			if (c == ']')
+				push_t->match++;
+			else if ((c == '>') && (push_t->match >= 2))
+			{
+				/* The token read so far ends with the first two characters of ']]>' */
+				token = libjxml_token (push_t, chunk, start, position, &token_length);
+				token_length = token_length - 2;
+
+				if ((push_t->depth > 0) &&
+					(libjxml_emit_token (push_t, (handler_t->cdata != NULL) ? handler_t->cdata : handler_t->text,
+										 token, token_length) == false))
+					return LIBJXML_STOP;
+
+				if (handler_t->terminate)
+					token [token_length] = '\0';
+
+				push_t->state = LIBJXML_STATE_TEXT;
+				start = position + 1;
+			}
+			else
+				push_t->match = 0;
+
+			position++;
+			break;
+
+		case LIBJXML_STATE_DECLARATION:
+			c = chunk [position];
+			position++;
+
+			if (libjxml_scan_declaration (push_t, c))
+			{
+				push_t->state = LIBJXML_STATE_TEXT;
+				start = position;
+			}
+			break;
+
+		case LIBJXML_STATE_PI_NAME:
+			position = libjxml_find (push_t, chunk, position, length, LIBJXML_CLASS_NAME_END);
+			if (position == length)
+				break;
+
+			token = libjxml_token (push_t, chunk, start, position, &token_length);
+
+			/* Only the attributes of the xml instruction before the content are notified */
+			if ((push_t->content == false) && (token_length == libstring_length ("xml")) &&
+				(memcmp (token, "xml", token_length) == 0))
+			{
+				push_t->state = LIBJXML_STATE_TAG;
+				push_t->instruction = true;
+			}
+			else
+			{
+				push_t->state = LIBJXML_STATE_PI_END;
+				push_t->match = 0;
+			}
+			break;
+
+		case LIBJXML_STATE_PI_END:
+			c = chunk [position];
+			position++;
+
+			if ((c == '>') && (push_t->match))
+			{
+				push_t->state = LIBJXML_STATE_TEXT;
+				start = position;
+			}
+			else
+				push_t->match = (c == '?');
+			break;
+		}
+	}
+
+	libjxml_keep_chunk (push_t, chunk, start, length);
+
+	return length;
+}
+
+/*
+ * Called once the whole chunk has been read. Whatever still points to the chunk
+ * is copied, as the chunk is not valid anymore when the next one is fed.
+ */
+void libjxml_keep_chunk (xml_push_t * push_t, char * chunk, long start, long length)
+{
+	bool in_token;
+
+	switch (push_t->state)
+	{
+	case LIBJXML_STATE_TEXT:
+		in_token = (push_t->depth > 0);
+		break;
+	case LIBJXML_STATE_OPEN_NAME:
+	case LIBJXML_STATE_ATTR_NAME:
+	case LIBJXML_STATE_ATTR_VALUE:
+	case LIBJXML_STATE_CLOSE_NAME:
+	case LIBJXML_STATE_CDATA:
+	case LIBJXML_STATE_PI_NAME:
+		in_token = true;
+		break;
+	default:
+		in_token = false;
+		break;
+	}
+
+	if ((in_token) && (start < length))
+		libjxml_carry (push_t, chunk + start, length - start);
+
+	if ((push_t->attribute_kept == false) && (push_t->attribute != NULL))
+	{
+		if (push_t->attribute_length + 1 > push_t->name_capacity)
+		{
+			push_t->name_capacity = push_t->attribute_length + 1;
+			push_t->name = (char *) realloc (push_t->name, push_t->name_capacity * sizeof (char));
+			LIBASSERT_PTR (push_t->name);
+		}
+
+		memcpy (push_t->name, push_t->attribute, push_t->attribute_length);
+		push_t->attribute = push_t->name;
+		push_t->attribute_kept = true;
+	}
+
+	/* Every byte of the chunk has been read, so the pending delimiters can be overwritten */
+	push_t->tag = NULL;
+	libjxml_terminate (&push_t->tag_end);
+	libjxml_terminate (&push_t->attribute_end);
+}
+
+long libjxml_parse_error (xml_push_t * push_t, long position, char * message)
+{
+	fprintf (stderr, "\nLibXML: Error parsing at %ld. %s.", push_t->offset + position, message);
+
+	return LIBJXML_ERROR;
+}
+
+void libjxml_carry (xml_push_t * push_t, char * text, long length)
+{
+	if (push_t->token_length + length + 1 > push_t->token_capacity)
+	{
+		while (push_t->token_length + length + 1 > push_t->token_capacity)
+			push_t->token_capacity = push_t->token_capacity * 2;
+
+		push_t->token = (char *) realloc (push_t->token, push_t->token_capacity * sizeof (char));
+		LIBASSERT_PTR (push_t->token);
+	}
+
+	memcpy (push_t->token + push_t->token_length, text, length);
+	push_t->token_length = push_t->token_length + length;
+	push_t->token [push_t->token_length] = '\0';
+}
+
+/*
+ * Returns the token ending at 'end'. It points to the chunk if the whole token
+ * is in it, or to the carried beginning completed with the chunk otherwise.
+ */
+char * libjxml_token (xml_push_t * push_t, char * chunk, long start, long end, long * length)
+{
+	if (push_t->token_length == 0)
+	{
+		*length = end - start;
+		return chunk + start;
+	}
+
+	libjxml_carry (push_t, chunk + start, end - start);
+	*length = push_t->token_length;
+	push_t->token_length = 0;
+
+	return push_t->token;
+}
+
+void libjxml_terminate (char ** delimiter)
+{
+	if (*delimiter != NULL)
+	{
+		**delimiter = '\0';
+		*delimiter = NULL;
+	}
+}
+
+/*
+ * Returns the position of the next byte of the chunk in the given class, or the
+ * length of the chunk if there is none. Only LIBJXML_CLASS_NAME_END and
+ * LIBJXML_CLASS_TEXT are searched here, '<' and quotes are left to memchr().
+ *
+ * Most names and blanks are a few bytes long, so the first bytes are compared
+ * one by one. Longer runs are classified a window at a time, and each block is
+ * checked at once looking for its next bit set.
+ */
+static inline long libjxml_find (xml_push_t * push_t, char * chunk, long position, long length, int class)
+{
+	unsigned long offset;
+	uint64_t bits;
+	long probe;
+
+	probe = position + LIBJXML_SCAN_PROBE;
+	if (probe > length)
+		probe = length;
+
+	while ((position < probe) && (LIBJXML_IN_CLASS (chunk [position], class) == false))
+		position++;
+
+	if (position < probe)
+		return position;
+
+	while (position < length)
+	{
+		offset = position - push_t->window_start;
+		if (offset >= (unsigned long) (push_t->window_end - push_t->window_start))
+		{
+			libjxml_fill_window (push_t, chunk, position, length);
+			offset = 0;
+		}
+
+		bits = push_t->window [offset / LIBJXML_SCAN_BLOCK].mask [class] >> (offset % LIBJXML_SCAN_BLOCK);
+
+		if (bits != 0)
+		{
+			position = position + __builtin_ctzll (bits);
+			break;
+		}
+
+		position = position - (offset % LIBJXML_SCAN_BLOCK) + LIBJXML_SCAN_BLOCK;
+	}
+
+	if (position > length)
+		return length;
+
+	return position;
+}
+
+void libjxml_fill_window (xml_push_t * push_t, char * chunk, long position, long length)
+{
+	char last [LIBJXML_SCAN_BLOCK];
+	long blocks;
+	long full;
+
+	blocks = (length - position + LIBJXML_SCAN_BLOCK - 1) / LIBJXML_SCAN_BLOCK;
+	if (blocks > LIBJXML_SCAN_WINDOW)
+		blocks = LIBJXML_SCAN_WINDOW;
+
+	full = (length - position) / LIBJXML_SCAN_BLOCK;
+	if (full > blocks)
+		full = blocks;
+
+	libjxml_scan_classify (chunk + position, full, push_t->window);
+
+	/* The end of the chunk is padded with name characters, found by none of the searches but TEXT */
+	if (full < blocks)
+	{
+		memset (last, 'a', LIBJXML_SCAN_BLOCK);
+		memcpy (last, chunk + position + full * LIBJXML_SCAN_BLOCK, length - position - full * LIBJXML_SCAN_BLOCK);
+		libjxml_scan_classify (last, 1, push_t->window + full);
+	}
+
+	push_t->window_start = position;
+	push_t->window_end = position + blocks * LIBJXML_SCAN_BLOCK;
+}
+
+/*
+ * Compares the characters read after '<!' with the start of a markup. Returns 1
+ * if they are the whole markup, 0 if they are its beginning and -1 otherwise.
+ */
+int libjxml_match_markup (xml_push_t * push_t, char * markup)
+{
+	long length;
+
+	length = libstring_length (markup);
+
+	if ((push_t->match > length) || (memcmp (push_t->markup, markup, push_t->match) != 0))
+		return -1;
+
+	return push_t->match == length;
+}
+
+bool libjxml_scan_declaration (xml_push_t * push_t, char c)
+{
+	if (c == '[')
+		push_t->brackets++;
+	else if (c == ']')
+		push_t->brackets--;
+	else if ((c == '>') && (push_t->brackets <= 0))
+		return true;
+
+	return false;
+}
+
+bool libjxml_emit_token (xml_push_t * push_t, xml_token_cb callback, char * token, long length)
+{
+	if (callback == NULL)
+		return true;
+
+	return callback (push_t->handler_t->context, token, length);
+}
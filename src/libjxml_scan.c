@@ -0,0 +1,385 @@
+/**
+ * @file libjxml_scan.c
+ *
+ * @brief Vectorised classification of xml text.
+ *
+ * The text is read in blocks of 64 bytes, and each block is turned into a set of
+ * bitmasks with one bit for each byte: one mask for the '<' found, one for each
+ * quote, one for the characters ending a name and one for the non blank bytes.
+ * The parser finds its next delimiter looking for the next bit set instead of
+ * comparing byte by byte.
+ *
+ * SSE2, AVX2 and AVX-512 versions are chosen at runtime depending on the CPU,
+ * with a portable version for any other processor. The choice is made once, by
+ * the first classification of any thread, and the chosen version is read and
+ * written atomically, as parsers run in many threads at the same time.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "libjxml_scan.h"
+
+#if defined (__x86_64__) || (defined (__i386__) && defined (__SSE2__))
+#define LIBJXML_SCAN_X86
+#include <immintrin.h>
+#endif
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+/* Bit n of each class is shifted to bit i of mask n by the scalar version */
+#define LIBJXML_BIT_OPEN     0x01 /**< Class bit of '<' */
+#define LIBJXML_BIT_QUOTE    0x02 /**< Class bit of '"' */
+#define LIBJXML_BIT_APOS     0x04 /**< Class bit of '\'' */
+#define LIBJXML_BIT_NAME_END 0x08 /**< Class bit of the characters ending a name */
+#define LIBJXML_BIT_SPACE    0x10 /**< Class bit of blanks */
+
+/**
+ * @brief Function classifying consecutive blocks of text.
+ */
+typedef void (* xml_classify_fn) (const char * text, long blocks, xml_masks_t * masks_t);
+
+static const unsigned char libjxml_scan_class [256] =
+{
+	['\0'] = LIBJXML_BIT_NAME_END,
+	[' ']  = LIBJXML_BIT_SPACE | LIBJXML_BIT_NAME_END,
+	['\n'] = LIBJXML_BIT_SPACE | LIBJXML_BIT_NAME_END,
+	['\t'] = LIBJXML_BIT_SPACE | LIBJXML_BIT_NAME_END,
+	['\v'] = LIBJXML_BIT_SPACE | LIBJXML_BIT_NAME_END,
+	['\f'] = LIBJXML_BIT_SPACE | LIBJXML_BIT_NAME_END,
+	['\r'] = LIBJXML_BIT_SPACE | LIBJXML_BIT_NAME_END,
+	['<']  = LIBJXML_BIT_OPEN | LIBJXML_BIT_NAME_END,
+	['>']  = LIBJXML_BIT_NAME_END,
+	['/']  = LIBJXML_BIT_NAME_END,
+	['=']  = LIBJXML_BIT_NAME_END,
+	['?']  = LIBJXML_BIT_NAME_END,
+	['"']  = LIBJXML_BIT_QUOTE | LIBJXML_BIT_NAME_END,
+	['\''] = LIBJXML_BIT_APOS | LIBJXML_BIT_NAME_END,
+};
+
+static char * libjxml_scan_names [] = {"auto", "scalar", "sse2", "avx2", "avx512"};
+
+/*********************************************************************************
+ *                                 DECLARATIONS
+ *********************************************************************************/
+
+void libjxml_classify_scalar (const char * text, long blocks, xml_masks_t * masks_t);
+void libjxml_classify_auto (const char * text, long blocks, xml_masks_t * masks_t);
+
+#ifdef LIBJXML_SCAN_X86
+void libjxml_classify_sse2 (const char * text, long blocks, xml_masks_t * masks_t);
+void libjxml_classify_avx2 (const char * text, long blocks, xml_masks_t * masks_t);
+void libjxml_classify_avx512 (const char * text, long blocks, xml_masks_t * masks_t);
+#endif
+
+int libjxml_scan_supported (int level);
+void libjxml_scan_init ();
+
+static xml_classify_fn libjxml_classify = libjxml_classify_auto;
+static int libjxml_scan_current = LIBJXML_SCAN_AUTO;
+static pthread_once_t libjxml_scan_once = PTHREAD_ONCE_INIT;
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+int libjxml_scan_select (int level)
+{
+	xml_classify_fn classify;
+
+	if ((level <= LIBJXML_SCAN_AUTO) || (level > LIBJXML_SCAN_AVX512))
+		level = LIBJXML_SCAN_AVX512;
+
+	while (libjxml_scan_supported (level) == false)
+		level--;
+
+	switch (level)
+	{
+#ifdef LIBJXML_SCAN_X86
+	case LIBJXML_SCAN_AVX512:
+		classify = libjxml_classify_avx512;
+		break;
+	case LIBJXML_SCAN_AVX2:
+		classify = libjxml_classify_avx2;
+		break;
+	case LIBJXML_SCAN_SSE2:
+		classify = libjxml_classify_sse2;
+		break;
+#endif
+	default:
+		classify = libjxml_classify_scalar;
+		break;
+	}
+
+	__atomic_store_n (&libjxml_classify, classify, __ATOMIC_RELEASE);
+	__atomic_store_n (&libjxml_scan_current, level, __ATOMIC_RELEASE);
+
+	return level;
+}
+
+int libjxml_scan_level ()
+{
+	if (__atomic_load_n (&libjxml_scan_current, __ATOMIC_ACQUIRE) == LIBJXML_SCAN_AUTO)
+		pthread_once (&libjxml_scan_once, libjxml_scan_init);
+
+	return __atomic_load_n (&libjxml_scan_current, __ATOMIC_ACQUIRE);
+}
+
+char * libjxml_scan_name (int level)
+{
+	if ((level < LIBJXML_SCAN_AUTO) || (level > LIBJXML_SCAN_AVX512))
+		return "unknown";
+
+	return libjxml_scan_names [level];
+}
+
+void libjxml_scan_classify (const char * text, long blocks, xml_masks_t * masks_t)
+{
+	xml_classify_fn classify;
+
+	classify = __atomic_load_n (&libjxml_classify, __ATOMIC_ACQUIRE);
+	classify (text, blocks, masks_t);
+}
+
+/*********************************************************************************
+ *                                   DISPATCH
+ *********************************************************************************/
+
+int libjxml_scan_supported (int level)
+{
+	if (level <= LIBJXML_SCAN_SCALAR)
+		return true;
+
+#ifdef LIBJXML_SCAN_X86
+	__builtin_cpu_init ();
+
+	switch (level)
+	{
+	case LIBJXML_SCAN_SSE2:
+		return __builtin_cpu_supports ("sse2");
+	case LIBJXML_SCAN_AVX2:
+		return __builtin_cpu_supports ("avx2");
+	case LIBJXML_SCAN_AVX512:
+		return __builtin_cpu_supports ("avx512f") && __builtin_cpu_supports ("avx512bw");
+	}
+#endif
+
+	return false;
+}
+
+/*
+ * Run once, unless a version was already selected.
+ */
+void libjxml_scan_init ()
+{
+	if (__atomic_load_n (&libjxml_scan_current, __ATOMIC_ACQUIRE) == LIBJXML_SCAN_AUTO)
+		libjxml_scan_select (LIBJXML_SCAN_AUTO);
+}
+
+/*
+ * Installed until the first classification, which chooses the best version.
+ */
+void libjxml_classify_auto (const char * text, long blocks, xml_masks_t * masks_t)
+{
+	libjxml_scan_level ();
+	libjxml_scan_classify (text, blocks, masks_t);
+}
+
+/*********************************************************************************
+ *                                   VERSIONS
+ *********************************************************************************/
+
+void libjxml_classify_scalar (const char * text, long blocks, xml_masks_t * masks_t)
+{
+	uint64_t bits;
+	uint64_t open;
+	uint64_t quote;
+	uint64_t apos;
+	uint64_t name_end;
+	uint64_t blank;
+	long block;
+	int i;
+
+	for (block = 0; block < blocks; block++)
+	{
+		open = 0;
+		quote = 0;
+		apos = 0;
+		name_end = 0;
+		blank = 0;
+
+		for (i = 0; i < LIBJXML_SCAN_BLOCK; i++)
+		{
+			bits = libjxml_scan_class [(unsigned char) text [i]];
+
+			open |= (bits & 1) << i;
+			quote |= ((bits >> 1) & 1) << i;
+			apos |= ((bits >> 2) & 1) << i;
+			name_end |= ((bits >> 3) & 1) << i;
+			blank |= ((bits >> 4) & 1) << i;
+		}
+
+		masks_t [block].mask [LIBJXML_CLASS_OPEN] = open;
+		masks_t [block].mask [LIBJXML_CLASS_QUOTE] = quote;
+		masks_t [block].mask [LIBJXML_CLASS_APOS] = apos;
+		masks_t [block].mask [LIBJXML_CLASS_NAME_END] = name_end;
+		masks_t [block].mask [LIBJXML_CLASS_TEXT] = ~blank;
+
+		text = text + LIBJXML_SCAN_BLOCK;
+	}
+}
+
+#ifdef LIBJXML_SCAN_X86
+
+/*
+ * Blanks are ' ' and the range '\t'..'\r', and '<', '=', '>' and '?' are the
+ * range 0x3C..0x3F, so each range is checked with a single unsigned comparison:
+ * c - first <= last - first.
+ */
+
+__attribute__ ((target ("sse2")))
+void libjxml_classify_sse2 (const char * text, long blocks, xml_masks_t * masks_t)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	__m128i c;
+	__m128i space;
+	__m128i end;
+	uint64_t open;
+	uint64_t quote;
+	uint64_t apos;
+	uint64_t name_end;
+	uint64_t blank;
+	long block;
+	int i;
+
+	for (block = 0; block < blocks; block++)
+	{
+		open = 0;
+		quote = 0;
+		apos = 0;
+		name_end = 0;
+		blank = 0;
+
+		for (i = 0; i < LIBJXML_SCAN_BLOCK; i = i + 16)
+		{
+			c = _mm_loadu_si128 ((const __m128i *) (text + i));
+
+			space = _mm_or_si128 (_mm_cmpeq_epi8 (c, _mm_set1_epi8 (' ')),
+								  _mm_cmpeq_epi8 (_mm_subs_epu8 (_mm_sub_epi8 (c, _mm_set1_epi8 ('\t')),
+																_mm_set1_epi8 ('\r' - '\t')), zero));
+			end = _mm_or_si128 (space, _mm_cmpeq_epi8 (_mm_subs_epu8 (_mm_sub_epi8 (c, _mm_set1_epi8 ('<')),
+																	  _mm_set1_epi8 ('?' - '<')), zero));
+			end = _mm_or_si128 (end, _mm_cmpeq_epi8 (c, zero));
+			end = _mm_or_si128 (end, _mm_cmpeq_epi8 (c, _mm_set1_epi8 ('/')));
+			end = _mm_or_si128 (end, _mm_cmpeq_epi8 (c, _mm_set1_epi8 ('"')));
+			end = _mm_or_si128 (end, _mm_cmpeq_epi8 (c, _mm_set1_epi8 ('\'')));
+
+			open |= (uint64_t) (uint16_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (c, _mm_set1_epi8 ('<'))) << i;
+			quote |= (uint64_t) (uint16_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (c, _mm_set1_epi8 ('"'))) << i;
+			apos |= (uint64_t) (uint16_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (c, _mm_set1_epi8 ('\''))) << i;
+			name_end |= (uint64_t) (uint16_t) _mm_movemask_epi8 (end) << i;
+			blank |= (uint64_t) (uint16_t) _mm_movemask_epi8 (space) << i;
+		}
+
+		masks_t [block].mask [LIBJXML_CLASS_OPEN] = open;
+		masks_t [block].mask [LIBJXML_CLASS_QUOTE] = quote;
+		masks_t [block].mask [LIBJXML_CLASS_APOS] = apos;
+		masks_t [block].mask [LIBJXML_CLASS_NAME_END] = name_end;
+		masks_t [block].mask [LIBJXML_CLASS_TEXT] = ~blank;
+
+		text = text + LIBJXML_SCAN_BLOCK;
+	}
+}
+
+__attribute__ ((target ("avx2")))
+void libjxml_classify_avx2 (const char * text, long blocks, xml_masks_t * masks_t)
+{
+	const __m256i zero = _mm256_setzero_si256 ();
+	__m256i c;
+	__m256i space;
+	__m256i end;
+	uint64_t open;
+	uint64_t quote;
+	uint64_t apos;
+	uint64_t name_end;
+	uint64_t blank;
+	long block;
+	int i;
+
+	for (block = 0; block < blocks; block++)
+	{
+		open = 0;
+		quote = 0;
+		apos = 0;
+		name_end = 0;
+		blank = 0;
+
+		for (i = 0; i < LIBJXML_SCAN_BLOCK; i = i + 32)
+		{
+			c = _mm256_loadu_si256 ((const __m256i *) (text + i));
+
+			space = _mm256_or_si256 (_mm256_cmpeq_epi8 (c, _mm256_set1_epi8 (' ')),
+									 _mm256_cmpeq_epi8 (_mm256_subs_epu8 (_mm256_sub_epi8 (c, _mm256_set1_epi8 ('\t')),
+																		  _mm256_set1_epi8 ('\r' - '\t')), zero));
+			end = _mm256_or_si256 (space, _mm256_cmpeq_epi8 (_mm256_subs_epu8 (_mm256_sub_epi8 (c, _mm256_set1_epi8 ('<')),
+																			   _mm256_set1_epi8 ('?' - '<')), zero));
+			end = _mm256_or_si256 (end, _mm256_cmpeq_epi8 (c, zero));
+			end = _mm256_or_si256 (end, _mm256_cmpeq_epi8 (c, _mm256_set1_epi8 ('/')));
+			end = _mm256_or_si256 (end, _mm256_cmpeq_epi8 (c, _mm256_set1_epi8 ('"')));
+			end = _mm256_or_si256 (end, _mm256_cmpeq_epi8 (c, _mm256_set1_epi8 ('\'')));
+
+			open |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (c, _mm256_set1_epi8 ('<'))) << i;
+			quote |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (c, _mm256_set1_epi8 ('"'))) << i;
+			apos |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (c, _mm256_set1_epi8 ('\''))) << i;
+			name_end |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (end) << i;
+			blank |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (space) << i;
+		}
+
+		masks_t [block].mask [LIBJXML_CLASS_OPEN] = open;
+		masks_t [block].mask [LIBJXML_CLASS_QUOTE] = quote;
+		masks_t [block].mask [LIBJXML_CLASS_APOS] = apos;
+		masks_t [block].mask [LIBJXML_CLASS_NAME_END] = name_end;
+		masks_t [block].mask [LIBJXML_CLASS_TEXT] = ~blank;
+
+		text = text + LIBJXML_SCAN_BLOCK;
+	}
+}
+
+__attribute__ ((target ("avx512f,avx512bw")))
+void libjxml_classify_avx512 (const char * text, long blocks, xml_masks_t * masks_t)
+{
+	__m512i c;
+	__mmask64 space;
+	__mmask64 end;
+	long block;
+
+	for (block = 0; block < blocks; block++)
+	{
+		c = _mm512_loadu_si512 ((const void *) text);
+
+		space = _mm512_cmpeq_epi8_mask (c, _mm512_set1_epi8 (' ')) |
+				_mm512_cmple_epu8_mask (_mm512_sub_epi8 (c, _mm512_set1_epi8 ('\t')), _mm512_set1_epi8 ('\r' - '\t'));
+		end = space |
+			  _mm512_cmple_epu8_mask (_mm512_sub_epi8 (c, _mm512_set1_epi8 ('<')), _mm512_set1_epi8 ('?' - '<')) |
+			  _mm512_cmpeq_epi8_mask (c, _mm512_setzero_si512 ()) |
+			  _mm512_cmpeq_epi8_mask (c, _mm512_set1_epi8 ('/'));
+
+		masks_t [block].mask [LIBJXML_CLASS_OPEN] = _mm512_cmpeq_epi8_mask (c, _mm512_set1_epi8 ('<'));
+		masks_t [block].mask [LIBJXML_CLASS_QUOTE] = _mm512_cmpeq_epi8_mask (c, _mm512_set1_epi8 ('"'));
+		masks_t [block].mask [LIBJXML_CLASS_APOS] = _mm512_cmpeq_epi8_mask (c, _mm512_set1_epi8 ('\''));
+		masks_t [block].mask [LIBJXML_CLASS_NAME_END] = end | masks_t [block].mask [LIBJXML_CLASS_QUOTE] |
+														masks_t [block].mask [LIBJXML_CLASS_APOS];
+		masks_t [block].mask [LIBJXML_CLASS_TEXT] = ~space;
+
+		text = text + LIBJXML_SCAN_BLOCK;
+	}
+}
+
+#endif
@@ -0,0 +1,264 @@
+/**
+ * @file libjxml_sink.c
+ *
+ * @brief Buffered output for xml files.
+ *
+ * A sink gathers the small pieces of text written by the serializers in a single
+ * buffer. Memory sinks grow the buffer to keep the whole text, and file sinks
+ * write it with a few write() or writev() calls each time it gets full.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "libjxml_sink.h"
+#include "libjxml_entity.h"
+#include "libstring.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                 DECLARATIONS
+ *********************************************************************************/
+
+xml_sink_t * libjxml_sink_create (int fd, long capacity);
+void libjxml_sink_grow (xml_sink_t * sink_t, long length);
+void libjxml_sink_writev (xml_sink_t * sink_t, char * text, long length);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+xml_sink_t * libjxml_sink_mem (long capacity)
+{
+	return libjxml_sink_create (LIBJXML_SINK_MEM, capacity);
+}
+
+xml_sink_t * libjxml_sink_fd (int fd, long capacity)
+{
+	return libjxml_sink_create (fd, capacity);
+}
+
+xml_sink_t * libjxml_sink_file (FILE * file, long capacity)
+{
+	fflush (file);
+
+	return libjxml_sink_create (fileno (file), capacity);
+}
+
+void libjxml_sink_write (xml_sink_t * sink_t, char * text, long length)
+{
+	if (sink_t->length + length > sink_t->capacity)
+	{
+		if (sink_t->fd == LIBJXML_SINK_MEM)
+			libjxml_sink_grow (sink_t, length);
+		else if (length >= sink_t->capacity)
+		{
+			libjxml_sink_writev (sink_t, text, length);
+			return;
+		}
+		else
+			libjxml_sink_flush (sink_t);
+	}
+
+	memcpy (sink_t->buffer + sink_t->length, text, length);
+	sink_t->length = sink_t->length + length;
+}
+
+void libjxml_sink_string (xml_sink_t * sink_t, char * text)
+{
+	libjxml_sink_write (sink_t, text, libstring_length (text));
+}
+
+void libjxml_sink_escape (xml_sink_t * sink_t, char * text, long length, bool attribute)
+{
+	char entity [LIBJXML_ENTITY_LONGEST];
+	char * end;
+	long index = 0;
+	long clean;
+
+	while (1)
+	{
+		clean = libjxml_entity_clean (text + index, length - index, attribute);
+		libjxml_sink_write (sink_t, text + index, clean);
+		index = index + clean;
+
+		if (index == length)
+			break;
+
+		end = libjxml_entity_escape (entity, text + index, 1, attribute);
+		libjxml_sink_write (sink_t, entity, end - entity);
+		index++;
+	}
+}
+
+void libjxml_sink_fill (xml_sink_t * sink_t, char c, long count)
+{
+	long length;
+
+	while (count > 0)
+	{
+		if (sink_t->length == sink_t->capacity)
+		{
+			if (sink_t->fd == LIBJXML_SINK_MEM)
+				libjxml_sink_grow (sink_t, count);
+			else
+				libjxml_sink_flush (sink_t);
+		}
+
+		length = sink_t->capacity - sink_t->length;
+		if (length > count)
+			length = count;
+
+		memset (sink_t->buffer + sink_t->length, c, length);
+		sink_t->length = sink_t->length + length;
+		count = count - length;
+	}
+}
+
+char * libjxml_sink_reserve (xml_sink_t * sink_t, long length)
+{
+	char * text;
+
+	if (sink_t->length + length > sink_t->capacity)
+	{
+		if (sink_t->fd == LIBJXML_SINK_MEM)
+			libjxml_sink_grow (sink_t, length);
+		else if (length > sink_t->capacity)
+			return NULL;
+		else
+			libjxml_sink_flush (sink_t);
+	}
+
+	text = sink_t->buffer + sink_t->length;
+	sink_t->length = sink_t->length + length;
+
+	return text;
+}
+
+bool libjxml_sink_flush (xml_sink_t * sink_t)
+{
+	if (sink_t->fd != LIBJXML_SINK_MEM)
+		libjxml_sink_writev (sink_t, NULL, 0);
+
+	return sink_t->failed == false;
+}
+
+bool libjxml_sink_close (xml_sink_t * sink_t)
+{
+	bool written;
+
+	written = libjxml_sink_flush (sink_t);
+
+	free (sink_t->buffer);
+	free (sink_t);
+
+	return written;
+}
+
+char * libjxml_sink_release (xml_sink_t * sink_t, long * length)
+{
+	char * text;
+
+	/* The buffer always keeps a byte for the null character */
+	text = sink_t->buffer;
+	text [sink_t->length] = '\0';
+
+	if (length != NULL)
+		*length = sink_t->length;
+
+	free (sink_t);
+
+	return text;
+}
+
+/*********************************************************************************
+ *                                    BUFFER
+ *********************************************************************************/
+
+xml_sink_t * libjxml_sink_create (int fd, long capacity)
+{
+	xml_sink_t * sink_t;
+
+	if (capacity <= 0)
+		capacity = LIBJXML_SINK_BUFFER;
+
+	sink_t = (xml_sink_t *) malloc (sizeof (xml_sink_t));
+	LIBASSERT_PTR (sink_t);
+
+	sink_t->buffer = (char *) malloc ((capacity + 1) * sizeof (char));
+	LIBASSERT_PTR (sink_t->buffer);
+
+	sink_t->length = 0;
+	sink_t->capacity = capacity;
+	sink_t->written = 0;
+	sink_t->fd = fd;
+	sink_t->failed = false;
+
+	return sink_t;
+}
+
+void libjxml_sink_grow (xml_sink_t * sink_t, long length)
+{
+	while (sink_t->length + length > sink_t->capacity)
+		sink_t->capacity = sink_t->capacity * 2;
+
+	sink_t->buffer = (char *) realloc (sink_t->buffer, (sink_t->capacity + 1) * sizeof (char));
+	LIBASSERT_PTR (sink_t->buffer);
+}
+
+/*
+ * Writes the buffer followed by 'text' in a single call, going on with the rest
+ * after partial writes. The buffer is emptied even if the write fails, so a sink
+ * to a broken descriptor does not grow.
+ */
+void libjxml_sink_writev (xml_sink_t * sink_t, char * text, long length)
+{
+	struct iovec parts [2];
+	long pending;
+	long result;
+	int first = 0;
+
+	parts [0].iov_base = sink_t->buffer;
+	parts [0].iov_len = sink_t->length;
+	parts [1].iov_base = text;
+	parts [1].iov_len = length;
+	pending = sink_t->length + length;
+
+	while ((pending > 0) && (sink_t->failed == false))
+	{
+		result = writev (sink_t->fd, parts + first, 2 - first);
+		if (result < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			fprintf (stderr, "\nLibXML: Error writing file.");
+			sink_t->failed = true;
+			break;
+		}
+
+		sink_t->written = sink_t->written + result;
+		pending = pending - result;
+
+		while ((first < 2) && (result >= (long) parts [first].iov_len))
+		{
+			result = result - parts [first].iov_len;
+			first++;
+		}
+
+		if (first < 2)
+		{
+			parts [first].iov_base = (char *) parts [first].iov_base + result;
+			parts [first].iov_len = parts [first].iov_len - result;
+		}
+	}
+
+	sink_t->length = 0;
+}
@@ -0,0 +1,664 @@
+/**
+ * @file libjxml_snapshot.c
+ *
+ * @brief Binary snapshots of xml documents, loaded without parsing.
+ *
+ * The image starts with a header followed by the sections of the flat document,
+ * each one starting at a multiple of 8 bytes so the arrays are aligned once the
+ * image is mapped:
+ *
+ * - The tag arrays: name, parent, end, attribute, value and value length.
+ * - The attribute arrays: name, value and value length.
+ * - The offsets of the names in the strings, one more than names.
+ * - The strings of the names, each one null ended.
+ * - The text of the values.
+ *
+ * The checksum hashes the image after the header in four independent lanes of
+ * 8 byte words, so checking it runs close to the speed of reading memory.
+ *
+ * Every image loaded gets its header and links checked, a pass over the arrays
+ * that keeps any damaged image from being read out of its bounds. The checksum
+ * is only checked on request, as it reads the whole text too.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libjxml_snapshot.h"
+#include "libjxml_sink.h"
+#include "libstring.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_SNAPSHOT_MAGIC "JXMLSNAP"            /**< First bytes of every image */
+#define LIBJXML_SNAPSHOT_ORDER 0x01020304            /**< Written to find images with another byte order */
+#define LIBJXML_SNAPSHOT_PRIME 0x9E3779B97F4A7C15UL  /**< Odd multiplier mixing the checksum */
+#define LIBJXML_SNAPSHOT_LANES 4                     /**< Words hashed independently by the checksum */
+
+#define LIBJXML_SECTION_NAME             0  /**< Name id of each tag */
+#define LIBJXML_SECTION_PARENT           1  /**< Parent of each tag */
+#define LIBJXML_SECTION_END              2  /**< End of the nested tags of each tag */
+#define LIBJXML_SECTION_ATTRIBUTE        3  /**< First attribute of each tag, tags + 1 entries */
+#define LIBJXML_SECTION_VALUE            4  /**< Offset of the value of each tag */
+#define LIBJXML_SECTION_VALUE_LENGTH     5  /**< Length of the value of each tag */
+#define LIBJXML_SECTION_ATTRIBUTE_NAME   6  /**< Name id of each attribute */
+#define LIBJXML_SECTION_ATTRIBUTE_VALUE  7  /**< Offset of the value of each attribute */
+#define LIBJXML_SECTION_ATTRIBUTE_LENGTH 8  /**< Length of the value of each attribute */
+#define LIBJXML_SECTION_NAMES            9  /**< Offset of each name in the strings, names + 1 entries */
+#define LIBJXML_SECTION_STRINGS          10 /**< Names, each one null ended */
+#define LIBJXML_SECTION_TEXT             11 /**< Values of tags and attributes */
+#define LIBJXML_SECTIONS                 12 /**< Number of sections */
+
+#define LIBJXML_SNAPSHOT_ROUND(n) (((n) + 7) & ~7UL)
+
+/**
+ * @brief Header at the beginning of an image.
+ */
+typedef struct xml_image_t
+{
+	char     magic [8];                    /**< LIBJXML_SNAPSHOT_MAGIC */
+	uint32_t version;                      /**< LIBJXML_SNAPSHOT_VERSION */
+	uint32_t order;                        /**< LIBJXML_SNAPSHOT_ORDER in the byte order of the writer */
+	uint32_t word;                         /**< Size of long of the writer */
+	uint32_t reserved;                     /**< Kept as zero */
+	uint64_t checksum;                     /**< Checksum of the image after the header */
+	uint64_t length;                       /**< Length of the whole image */
+	uint64_t source_size;                  /**< Size of the xml file, 0 if none */
+	int64_t  source_time;                  /**< Modification time of the xml file in nanoseconds, 0 if none */
+	uint64_t tags;                         /**< Number of tags */
+	uint64_t attributes;                   /**< Number of attributes */
+	uint64_t names;                        /**< Number of names */
+	uint64_t strings;                      /**< Length of the strings of the names */
+	uint64_t text_length;                  /**< Length of the text of the values */
+	uint64_t sections [LIBJXML_SECTIONS];  /**< Offset of each section in the image */
+}xml_image_t;
+
+/**
+ * @brief State of a checksum being computed.
+ */
+typedef struct xml_checksum_t
+{
+	uint64_t lanes [LIBJXML_SNAPSHOT_LANES]; /**< Hash of each lane */
+	uint64_t words;                          /**< Number of words hashed */
+}xml_checksum_t;
+
+/**
+ * @brief State of an image being written.
+ */
+typedef struct xml_image_writer_t
+{
+	xml_sink_t     * sink_t;        /**< Sink writing the file */
+	xml_checksum_t   checksum_t;    /**< Checksum of the words written */
+	char             partial [8];   /**< Bytes of a word still not complete */
+	long             partial_length; /**< Number of bytes of the word */
+}xml_image_writer_t;
+
+/*********************************************************************************
+ *                                 DECLARATIONS
+ *********************************************************************************/
+
+void libjxml_snapshot_hash (xml_checksum_t * checksum_t, char * data, long length);
+uint64_t libjxml_snapshot_digest (xml_checksum_t * checksum_t);
+void libjxml_snapshot_sizes (xml_image_t * image_t, uint64_t * sizes);
+bool libjxml_snapshot_source (char * xml_name, uint64_t * size, int64_t * time);
+
+bool libjxml_snapshot_save (xml_flat_t * flat_t, char * image_name, uint64_t source_size, int64_t source_time);
+void libjxml_snapshot_put (xml_image_writer_t * writer_t, void * data, long length);
+void libjxml_snapshot_pad (xml_image_writer_t * writer_t);
+
+bool libjxml_snapshot_header (xml_image_t * image_t, long length);
+bool libjxml_snapshot_links (xml_flat_t * flat_t, uint64_t * offsets, uint64_t names, uint64_t strings);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+bool libjxml_flat_to_snapshot (xml_flat_t * flat_t, char * image_name, char * xml_name)
+{
+	uint64_t size = 0;
+	int64_t time = 0;
+
+	if ((xml_name != NULL) && (libjxml_snapshot_source (xml_name, &size, &time) == false))
+		return false;
+
+	return libjxml_snapshot_save (flat_t, image_name, size, time);
+}
+
+bool libjxml_mem_to_snapshot (xml_t * xml_mem_t, char * image_name, char * xml_name)
+{
+	xml_flat_t * flat_t;
+	bool saved;
+
+	flat_t = libjxml_mem_to_flat (xml_mem_t);
+	if (flat_t == NULL)
+		return false;
+
+	saved = libjxml_flat_to_snapshot (flat_t, image_name, xml_name);
+	libjxml_flat_free (flat_t);
+
+	return saved;
+}
+
+/*
+ * The arrays of the document point into the mapped image. Only the table of
+ * names is built, storing the names in the order of their ids.
+ */
+xml_flat_t * libjxml_snapshot_to_flat (char * image_name, int flags)
+{
+	struct stat image_stat;
+	xml_checksum_t checksum_t;
+	xml_image_t * image_t;
+	xml_flat_t * flat_t;
+	uint64_t * offsets;
+	char * image;
+	char * strings;
+	uint64_t i;
+	int image_fd;
+
+	image_fd = open (image_name, O_RDONLY);
+	if (image_fd < 0)
+		return NULL;
+
+	if ((fstat (image_fd, &image_stat) != 0) || (image_stat.st_size < (long) sizeof (xml_image_t)))
+	{
+		close (image_fd);
+		return NULL;
+	}
+
+	image = (char *) mmap (NULL, image_stat.st_size, PROT_READ, MAP_PRIVATE, image_fd, 0);
+	close (image_fd);
+
+	if (image == MAP_FAILED)
+		return NULL;
+
+	image_t = (xml_image_t *) image;
+
+	if (libjxml_snapshot_header (image_t, image_stat.st_size) == false)
+	{
+		fprintf (stderr, "\nLibXML: Error snapshot not valid");
+		munmap (image, image_stat.st_size);
+		return NULL;
+	}
+
+	if (flags & LIBJXML_SNAPSHOT_VERIFY)
+	{
+		memset (&checksum_t, 0, sizeof (xml_checksum_t));
+		libjxml_snapshot_hash (&checksum_t, image + sizeof (xml_image_t), image_t->length - sizeof (xml_image_t));
+
+		if (libjxml_snapshot_digest (&checksum_t) != image_t->checksum)
+		{
+			fprintf (stderr, "\nLibXML: Error snapshot checksum");
+			munmap (image, image_stat.st_size);
+			return NULL;
+		}
+	}
+
+	flat_t = (xml_flat_t *) malloc (sizeof (xml_flat_t));
+	LIBASSERT_PTR (flat_t);
+
+	flat_t->tags = image_t->tags;
+	flat_t->attributes = image_t->attributes;
+	flat_t->name = (uint32_t *) (image + image_t->sections [LIBJXML_SECTION_NAME]);
+	flat_t->parent = (uint32_t *) (image + image_t->sections [LIBJXML_SECTION_PARENT]);
+	flat_t->end = (uint32_t *) (image + image_t->sections [LIBJXML_SECTION_END]);
+	flat_t->attribute = (uint32_t *) (image + image_t->sections [LIBJXML_SECTION_ATTRIBUTE]);
+	flat_t->value = (long *) (image + image_t->sections [LIBJXML_SECTION_VALUE]);
+	flat_t->value_length = (uint32_t *) (image + image_t->sections [LIBJXML_SECTION_VALUE_LENGTH]);
+	flat_t->attribute_name = (uint32_t *) (image + image_t->sections [LIBJXML_SECTION_ATTRIBUTE_NAME]);
+	flat_t->attribute_value = (long *) (image + image_t->sections [LIBJXML_SECTION_ATTRIBUTE_VALUE]);
+	flat_t->attribute_length = (uint32_t *) (image + image_t->sections [LIBJXML_SECTION_ATTRIBUTE_LENGTH]);
+	flat_t->text = image + image_t->sections [LIBJXML_SECTION_TEXT];
+	flat_t->text_length = image_t->text_length;
+	flat_t->image = image;
+	flat_t->image_length = image_stat.st_size;
+
+	offsets = (uint64_t *) (image + image_t->sections [LIBJXML_SECTION_NAMES]);
+	strings = image + image_t->sections [LIBJXML_SECTION_STRINGS];
+
+	/* Links are always checked, as a damaged image would be read out of its bounds */
+	if (libjxml_snapshot_links (flat_t, offsets, image_t->names, image_t->strings) == false)
+	{
+		fprintf (stderr, "\nLibXML: Error snapshot links");
+		munmap (image, image_stat.st_size);
+		free (flat_t);
+		return NULL;
+	}
+
+	flat_t->names_t = libjxml_names_create (image_t->names);
+
+	for (i = 0; i < image_t->names; i++)
+	{
+		/* Repeated names would get the id of the first one */
+		if (libjxml_names_id (flat_t->names_t, strings + offsets [i], offsets [i + 1] - offsets [i] - 1) != (long) i)
+		{
+			fprintf (stderr, "\nLibXML: Error snapshot names");
+			libjxml_flat_free (flat_t);
+			return NULL;
+		}
+	}
+
+	return flat_t;
+}
+
+bool libjxml_snapshot_stale (char * image_name, char * xml_name)
+{
+	xml_image_t image_t;
+	uint64_t size;
+	int64_t time;
+	int image_fd;
+	long length;
+
+	if (libjxml_snapshot_source (xml_name, &size, &time) == false)
+		return true;
+
+	image_fd = open (image_name, O_RDONLY);
+	if (image_fd < 0)
+		return true;
+
+	length = pread (image_fd, &image_t, sizeof (xml_image_t), 0);
+	close (image_fd);
+
+	if ((length != sizeof (xml_image_t)) || (memcmp (image_t.magic, LIBJXML_SNAPSHOT_MAGIC, 8) != 0) ||
+		(image_t.version != LIBJXML_SNAPSHOT_VERSION) || (image_t.order != LIBJXML_SNAPSHOT_ORDER) ||
+		(image_t.word != sizeof (long)))
+		return true;
+
+	return (image_t.source_size != size) || (image_t.source_time != time);
+}
+
+/*
+ * The file is checked before parsing it, so a file changed while being parsed
+ * leaves a snapshot that is already stale.
+ */
+xml_flat_t * libjxml_file_to_flat (char * xml_name, char * image_name, int flags)
+{
+	xml_flat_t * flat_t;
+	xml_t * xml_mem_t;
+	uint64_t size;
+	int64_t time;
+
+	if (libjxml_snapshot_stale (image_name, xml_name) == false)
+	{
+		flat_t = libjxml_snapshot_to_flat (image_name, flags);
+		if (flat_t != NULL)
+			return flat_t;
+	}
+
+	if (libjxml_snapshot_source (xml_name, &size, &time) == false)
+		return NULL;
+
+	xml_mem_t = libjxml_file_to_mem_mode (xml_name, LIBJXML_MODE_SLICE | LIBJXML_MODE_ARENA);
+	if (xml_mem_t == NULL)
+		return NULL;
+
+	flat_t = libjxml_mem_to_flat (xml_mem_t);
+	libjxml_free_xml_mem (xml_mem_t);
+
+	if (flat_t != NULL)
+		libjxml_snapshot_save (flat_t, image_name, size, time);
+
+	return flat_t;
+}
+
+/*********************************************************************************
+ *                                    FORMAT
+ *********************************************************************************/
+
+/*
+ * Hashes whole words, following the lanes where the last call stopped.
+ */
+void libjxml_snapshot_hash (xml_checksum_t * checksum_t, char * data, long length)
+{
+	uint64_t lanes [LIBJXML_SNAPSHOT_LANES];
+	uint64_t word [LIBJXML_SNAPSHOT_LANES];
+	uint64_t lane;
+	long i;
+	int j;
+
+	/* Single words until the first lane is reached */
+	for (i = 0; (i + 8 <= length) && (checksum_t->words % LIBJXML_SNAPSHOT_LANES != 0); i = i + 8)
+	{
+		lane = checksum_t->words % LIBJXML_SNAPSHOT_LANES;
+		memcpy (word, data + i, 8);
+		checksum_t->lanes [lane] = (checksum_t->lanes [lane] ^ word [0]) * LIBJXML_SNAPSHOT_PRIME;
+		checksum_t->lanes [lane] = checksum_t->lanes [lane] ^ (checksum_t->lanes [lane] >> 32);
+		checksum_t->words++;
+	}
+
+	memcpy (lanes, checksum_t->lanes, sizeof (lanes));
+
+	for (; i + 8 * LIBJXML_SNAPSHOT_LANES <= length; i = i + 8 * LIBJXML_SNAPSHOT_LANES)
+	{
+		memcpy (word, data + i, sizeof (word));
+		for (j = 0; j < LIBJXML_SNAPSHOT_LANES; j++)
+		{
+			lanes [j] = (lanes [j] ^ word [j]) * LIBJXML_SNAPSHOT_PRIME;
+			lanes [j] = lanes [j] ^ (lanes [j] >> 32);
+		}
+		checksum_t->words = checksum_t->words + LIBJXML_SNAPSHOT_LANES;
+	}
+
+	memcpy (checksum_t->lanes, lanes, sizeof (lanes));
+
+	for (; i + 8 <= length; i = i + 8)
+	{
+		lane = checksum_t->words % LIBJXML_SNAPSHOT_LANES;
+		memcpy (word, data + i, 8);
+		checksum_t->lanes [lane] = (checksum_t->lanes [lane] ^ word [0]) * LIBJXML_SNAPSHOT_PRIME;
+		checksum_t->lanes [lane] = checksum_t->lanes [lane] ^ (checksum_t->lanes [lane] >> 32);
+		checksum_t->words++;
+	}
+}
+
+uint64_t libjxml_snapshot_digest (xml_checksum_t * checksum_t)
+{
+	uint64_t digest = checksum_t->words;
+	int j;
+
+	for (j = 0; j < LIBJXML_SNAPSHOT_LANES; j++)
+	{
+		digest = (digest ^ checksum_t->lanes [j]) * LIBJXML_SNAPSHOT_PRIME;
+		digest = digest ^ (digest >> 32);
+	}
+
+	return digest;
+}
+
+/*
+ * Computes the length of each section from the numbers of the header.
+ */
+void libjxml_snapshot_sizes (xml_image_t * image_t, uint64_t * sizes)
+{
+	sizes [LIBJXML_SECTION_NAME] = image_t->tags * sizeof (uint32_t);
+	sizes [LIBJXML_SECTION_PARENT] = image_t->tags * sizeof (uint32_t);
+	sizes [LIBJXML_SECTION_END] = image_t->tags * sizeof (uint32_t);
+	sizes [LIBJXML_SECTION_ATTRIBUTE] = (image_t->tags + 1) * sizeof (uint32_t);
+	sizes [LIBJXML_SECTION_VALUE] = image_t->tags * sizeof (long);
+	sizes [LIBJXML_SECTION_VALUE_LENGTH] = image_t->tags * sizeof (uint32_t);
+	sizes [LIBJXML_SECTION_ATTRIBUTE_NAME] = image_t->attributes * sizeof (uint32_t);
+	sizes [LIBJXML_SECTION_ATTRIBUTE_VALUE] = image_t->attributes * sizeof (long);
+	sizes [LIBJXML_SECTION_ATTRIBUTE_LENGTH] = image_t->attributes * sizeof (uint32_t);
+	sizes [LIBJXML_SECTION_NAMES] = (image_t->names + 1) * sizeof (uint64_t);
+	sizes [LIBJXML_SECTION_STRINGS] = image_t->strings;
+	sizes [LIBJXML_SECTION_TEXT] = image_t->text_length;
+}
+
+bool libjxml_snapshot_source (char * xml_name, uint64_t * size, int64_t * time)
+{
+	struct stat xml_stat;
+
+	if (stat (xml_name, &xml_stat) != 0)
+		return false;
+
+	*size = xml_stat.st_size;
+	*time = (int64_t) xml_stat.st_mtim.tv_sec * 1000000000L + xml_stat.st_mtim.tv_nsec;
+
+	return true;
+}
+
+/*********************************************************************************
+ *                                     SAVE
+ *********************************************************************************/
+
+/*
+ * The header is written last, once the checksum of the sections is known.
+ */
+bool libjxml_snapshot_save (xml_flat_t * flat_t, char * image_name, uint64_t source_size, int64_t source_time)
+{
+	xml_image_writer_t writer_t;
+	xml_image_t image_t;
+	uint64_t sizes [LIBJXML_SECTIONS];
+	uint64_t offset;
+	char * temporary;
+	char * name;
+	long length;
+	long i;
+	int image_fd;
+	bool saved;
+
+	memset (&image_t, 0, sizeof (xml_image_t));
+	memcpy (image_t.magic, LIBJXML_SNAPSHOT_MAGIC, 8);
+	image_t.version = LIBJXML_SNAPSHOT_VERSION;
+	image_t.order = LIBJXML_SNAPSHOT_ORDER;
+	image_t.word = sizeof (long);
+	image_t.source_size = source_size;
+	image_t.source_time = source_time;
+	image_t.tags = flat_t->tags;
+	image_t.attributes = flat_t->attributes;
+	image_t.names = libjxml_names_count (flat_t->names_t);
+	image_t.text_length = flat_t->text_length;
+
+	for (i = 0; i < (long) image_t.names; i++)
+	{
+		libjxml_names_get (flat_t->names_t, i, &length);
+		image_t.strings = image_t.strings + length + 1;
+	}
+
+	libjxml_snapshot_sizes (&image_t, sizes);
+
+	offset = sizeof (xml_image_t);
+	for (i = 0; i < LIBJXML_SECTIONS; i++)
+	{
+		image_t.sections [i] = offset;
+		offset = offset + LIBJXML_SNAPSHOT_ROUND (sizes [i]);
+	}
+	image_t.length = offset;
+
+	length = libstring_length (image_name);
+	temporary = (char *) malloc ((length + 5) * sizeof (char));
+	LIBASSERT_PTR (temporary);
+	memcpy (temporary, image_name, length);
+	memcpy (temporary + length, ".tmp", 5);
+
+	image_fd = open (temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (image_fd < 0)
+	{
+		fprintf (stderr, "\nLibXML: Error creating snapshot");
+		free (temporary);
+		return false;
+	}
+
+	memset (&writer_t, 0, sizeof (xml_image_writer_t));
+	writer_t.sink_t = libjxml_sink_fd (image_fd, LIBJXML_SINK_BUFFER);
+
+	/* Room for the header, not hashed */
+	libjxml_sink_write (writer_t.sink_t, (char *) &image_t, sizeof (xml_image_t));
+
+	libjxml_snapshot_put (&writer_t, flat_t->name, sizes [LIBJXML_SECTION_NAME]);
+	libjxml_snapshot_pad (&writer_t);
+	libjxml_snapshot_put (&writer_t, flat_t->parent, sizes [LIBJXML_SECTION_PARENT]);
+	libjxml_snapshot_pad (&writer_t);
+	libjxml_snapshot_put (&writer_t, flat_t->end, sizes [LIBJXML_SECTION_END]);
+	libjxml_snapshot_pad (&writer_t);
+	libjxml_snapshot_put (&writer_t, flat_t->attribute, sizes [LIBJXML_SECTION_ATTRIBUTE]);
+	libjxml_snapshot_pad (&writer_t);
+	libjxml_snapshot_put (&writer_t, flat_t->value, sizes [LIBJXML_SECTION_VALUE]);
+	libjxml_snapshot_pad (&writer_t);
+	libjxml_snapshot_put (&writer_t, flat_t->value_length, sizes [LIBJXML_SECTION_VALUE_LENGTH]);
+	libjxml_snapshot_pad (&writer_t);
+	libjxml_snapshot_put (&writer_t, flat_t->attribute_name, sizes [LIBJXML_SECTION_ATTRIBUTE_NAME]);
+	libjxml_snapshot_pad (&writer_t);
+	libjxml_snapshot_put (&writer_t, flat_t->attribute_value, sizes [LIBJXML_SECTION_ATTRIBUTE_VALUE]);
+	libjxml_snapshot_pad (&writer_t);
+	libjxml_snapshot_put (&writer_t, flat_t->attribute_length, sizes [LIBJXML_SECTION_ATTRIBUTE_LENGTH]);
+	libjxml_snapshot_pad (&writer_t);
+
+	offset = 0;
+	for (i = 0; i <= (long) image_t.names; i++)
+	{
+		libjxml_snapshot_put (&writer_t, &offset, sizeof (uint64_t));
+		if (i < (long) image_t.names)
+		{
+			libjxml_names_get (flat_t->names_t, i, &length);
+			offset = offset + length + 1;
+		}
+	}
+
+	for (i = 0; i < (long) image_t.names; i++)
+	{
+		name = libjxml_names_get (flat_t->names_t, i, &length);
+		libjxml_snapshot_put (&writer_t, name, length + 1);
+	}
+	libjxml_snapshot_pad (&writer_t);
+
+	libjxml_snapshot_put (&writer_t, flat_t->text, flat_t->text_length);
+	libjxml_snapshot_pad (&writer_t);
+
+	image_t.checksum = libjxml_snapshot_digest (&writer_t.checksum_t);
+
+	saved = libjxml_sink_close (writer_t.sink_t);
+	saved = saved && (pwrite (image_fd, &image_t, sizeof (xml_image_t), 0) == sizeof (xml_image_t));
+	saved = (close (image_fd) == 0) && saved;
+	saved = saved && (rename (temporary, image_name) == 0);
+
+	if (saved == false)
+	{
+		fprintf (stderr, "\nLibXML: Error writing snapshot");
+		unlink (temporary);
+	}
+
+	free (temporary);
+
+	return saved;
+}
+
+/*
+ * Writes part of a section, hashing it a word at a time. The bytes after the
+ * last whole word wait for the next part or for the padding.
+ */
+void libjxml_snapshot_put (xml_image_writer_t * writer_t, void * data, long length)
+{
+	char * bytes = (char *) data;
+	long whole;
+	long count;
+
+	if (length == 0)
+		return;
+
+	libjxml_sink_write (writer_t->sink_t, bytes, length);
+
+	if (writer_t->partial_length > 0)
+	{
+		count = 8 - writer_t->partial_length;
+		if (count > length)
+			count = length;
+
+		memcpy (writer_t->partial + writer_t->partial_length, bytes, count);
+		writer_t->partial_length = writer_t->partial_length + count;
+		bytes = bytes + count;
+		length = length - count;
+
+		if (writer_t->partial_length < 8)
+			return;
+
+		libjxml_snapshot_hash (&writer_t->checksum_t, writer_t->partial, 8);
+		writer_t->partial_length = 0;
+	}
+
+	whole = length & ~7L;
+	libjxml_snapshot_hash (&writer_t->checksum_t, bytes, whole);
+
+	memcpy (writer_t->partial, bytes + whole, length - whole);
+	writer_t->partial_length = length - whole;
+}
+
+/*
+ * Completes the last word of a section with zeros.
+ */
+void libjxml_snapshot_pad (xml_image_writer_t * writer_t)
+{
+	char zeros [8] = {0};
+
+	if (writer_t->partial_length > 0)
+		libjxml_snapshot_put (writer_t, zeros, 8 - writer_t->partial_length);
+}
+
+/*********************************************************************************
+ *                                     LOAD
+ *********************************************************************************/
+
+/*
+ * Checks the header and that every section lies inside the image.
+ */
+bool libjxml_snapshot_header (xml_image_t * image_t, long length)
+{
+	uint64_t sizes [LIBJXML_SECTIONS];
+	int i;
+
+	if ((memcmp (image_t->magic, LIBJXML_SNAPSHOT_MAGIC, 8) != 0) || (image_t->version != LIBJXML_SNAPSHOT_VERSION) ||
+		(image_t->order != LIBJXML_SNAPSHOT_ORDER) || (image_t->word != sizeof (long)) ||
+		(image_t->length != (uint64_t) length))
+		return false;
+
+	if ((image_t->tags >= LIBJXML_FLAT_NONE) || (image_t->attributes >= LIBJXML_FLAT_NONE) ||
+		(image_t->names >= LIBJXML_FLAT_NONE) || (image_t->strings > image_t->length) ||
+		(image_t->text_length > image_t->length))
+		return false;
+
+	libjxml_snapshot_sizes (image_t, sizes);
+
+	for (i = 0; i < LIBJXML_SECTIONS; i++)
+	{
+		if ((image_t->sections [i] % 8 != 0) || (image_t->sections [i] < sizeof (xml_image_t)) ||
+			(image_t->sections [i] > image_t->length) || (sizes [i] > image_t->length - image_t->sections [i]))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Checks that every index and offset of the document points inside it.
+ */
+bool libjxml_snapshot_links (xml_flat_t * flat_t, uint64_t * offsets, uint64_t names, uint64_t strings)
+{
+	long tags = flat_t->tags;
+	long text_length = flat_t->text_length;
+	uint32_t parent;
+	long i;
+
+	for (i = 0; i < (long) names; i++)
+		if ((offsets [i] >= offsets [i + 1]) || (offsets [i + 1] > strings))
+			return false;
+
+	if ((offsets [0] != 0) || (flat_t->attribute [0] > flat_t->attribute [tags]) ||
+		(flat_t->attribute [tags] != flat_t->attributes))
+		return false;
+
+	for (i = 0; i < tags; i++)
+	{
+		parent = flat_t->parent [i];
+
+		if ((flat_t->name [i] >= names) || (flat_t->end [i] <= i) || (flat_t->end [i] > tags) ||
+			(flat_t->attribute [i] > flat_t->attribute [i + 1]))
+			return false;
+
+		if ((parent != LIBJXML_FLAT_NONE) && ((parent >= i) || (flat_t->end [i] > flat_t->end [parent])))
+			return false;
+
+		if ((flat_t->value [i] < -1) ||
+			((flat_t->value [i] >= 0) && (flat_t->value [i] + (long) flat_t->value_length [i] >= text_length)))
+			return false;
+	}
+
+	for (i = 0; i < flat_t->attributes; i++)
+	{
+		if ((flat_t->attribute_name [i] >= names) || (flat_t->attribute_value [i] < 0) ||
+			(flat_t->attribute_value [i] + (long) flat_t->attribute_length [i] >= text_length))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file libjxml_stats.c
+ *
+ * @brief Counters of the allocations and time spent by each xml document.
+ *
+ * Blocks allocated with malloc are counted where they are allocated. The chunks
+ * of the arenas are allocated by libarena, so they are counted when the
+ * counters are read, walking the chunks kept by the document.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libjxml.h"
+#include "libjxml_stats.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+static const char * libjxml_phase_names [LIBJXML_PHASES] =
+{
+	"read",
+	"tokenize",
+	"build",
+	"write",
+};
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+double libjxml_stats_now ();
+double libjxml_stats_total (xml_stats_t * stats_t);
+void libjxml_stats_arena (xml_stats_t * stats_t, Arena_t * arena_t);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+bool libjxml_stats_get (xml_t * xml_mem_t, xml_stats_t * stats_t)
+{
+	memset (stats_t, 0, sizeof (xml_stats_t));
+
+#ifdef LIBJXML_STATS
+	memcpy (stats_t, &xml_mem_t->stats_t, sizeof (xml_stats_t));
+
+	if (xml_mem_t->arena_t != NULL)
+		libjxml_stats_arena (stats_t, xml_mem_t->arena_t);
+
+	if (xml_mem_t->decoded_t != NULL)
+		libjxml_stats_arena (stats_t, xml_mem_t->decoded_t);
+
+	return true;
+#else
+	(void) xml_mem_t;
+
+	return false;
+#endif
+}
+
+char * libjxml_stats_phase (int phase)
+{
+	if ((phase < 0) || (phase >= LIBJXML_PHASES))
+		return "unknown";
+
+	return (char *) libjxml_phase_names [phase];
+}
+
+void libjxml_stats_alloc (xml_stats_t * stats_t, long size)
+{
+	stats_t->allocations++;
+	stats_t->bytes = stats_t->bytes + size;
+}
+
+xml_clock_t libjxml_stats_start (xml_stats_t * stats_t)
+{
+	xml_clock_t start_t;
+
+	start_t.nested = libjxml_stats_total (stats_t);
+	start_t.start = libjxml_stats_now ();
+
+	return start_t;
+}
+
+void libjxml_stats_stop (xml_stats_t * stats_t, xml_clock_t * start_t, int phase)
+{
+	double elapsed;
+
+	elapsed = libjxml_stats_now () - start_t->start;
+	elapsed = elapsed - (libjxml_stats_total (stats_t) - start_t->nested);
+
+	stats_t->seconds [phase] = stats_t->seconds [phase] + elapsed;
+	stats_t->runs [phase]++;
+}
+
+void libjxml_stats_merge (xml_stats_t * stats_t, xml_stats_t * part_t)
+{
+	int phase;
+
+	stats_t->allocations = stats_t->allocations + part_t->allocations;
+	stats_t->bytes = stats_t->bytes + part_t->bytes;
+
+	for (phase = 0; phase < LIBJXML_PHASES; phase++)
+	{
+		stats_t->runs [phase] = stats_t->runs [phase] + part_t->runs [phase];
+		stats_t->seconds [phase] = stats_t->seconds [phase] + part_t->seconds [phase];
+	}
+
+	memset (part_t, 0, sizeof (xml_stats_t));
+}
+
+/*********************************************************************************
+ *                                   COUNTERS
+ *********************************************************************************/
+
+double libjxml_stats_now ()
+{
+	struct timespec now;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+double libjxml_stats_total (xml_stats_t * stats_t)
+{
+	double total = 0;
+	int phase;
+
+	for (phase = 0; phase < LIBJXML_PHASES; phase++)
+		total = total + stats_t->seconds [phase];
+
+	return total;
+}
+
+/*
+ * Chunks adopted from other arenas, like those of the parts of a parallel parse,
+ * are counted too, as they hold the document.
+ */
+void libjxml_stats_arena (xml_stats_t * stats_t, Arena_t * arena_t)
+{
+	AChunk_t * chunk;
+
+	libjxml_stats_alloc (stats_t, sizeof (Arena_t));
+
+	for (chunk = arena_t->first; chunk != NULL; chunk = chunk->next)
+		libjxml_stats_alloc (stats_t, sizeof (AChunk_t) + chunk->size);
+}
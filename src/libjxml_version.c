@@ -0,0 +1,779 @@
+/**
+ * @file libjxml_version.c
+ *
+ * @brief Versions of a document shared by many reader threads while it changes.
+ *
+ * Each version points to a segment, holding in an arena the tags, attributes and
+ * values copied or added by that version, and to the segment of the version it
+ * was made from, so the segments form a chain down to the shared document. A
+ * segment is freed with the last version or segment pointing to it. A draft knows
+ * which tags it can change looking whether they are in the arena of its segment.
+ *
+ * Names are never stored in a table used by a committed version, as readers look
+ * up names in it. A draft adding names stacks a table of its own over the table
+ * of the version it was made from, and the tables form a chain like the segments.
+ *
+ * Readers take the current version counting themselves while they increment its
+ * references, and a commit waits until no reader is counted before releasing the
+ * version it replaced, so no reader is left with a version freed under it.
+ * Readers are counted in one of two counters, chosen by a phase that each commit
+ * flips, and a commit only waits for the counter of the previous phase: readers
+ * arriving during the wait are counted apart, so they never make it longer. The
+ * wait is as short as taking a reference, and never happens in the readers.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "libjxml_version.h"
+#include "libstring.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Tags and values stored by a version, and the segments it shares.
+ */
+typedef struct xml_segment_t
+{
+	xml_t                * holder_t;   /**< Document holding the arena, NULL until something is stored */
+	long                   references; /**< Number of versions and segments pointing to it */
+	struct xml_segment_t * previous_t; /**< Segment of the version it was made from, NULL if none */
+}xml_segment_t;
+
+struct xml_version_t
+{
+	xml_t           xml_mem_t;   /**< Document of the version, sharing the tags of older versions */
+	long            references;  /**< Number of readers and shared documents holding it */
+	long            number;      /**< Number of versions committed before it */
+	long            stored;      /**< Tags and attributes stored by its chain of segments */
+	long            tables;      /**< Number of tables of names stacked since the last copy of the tree */
+	bool            names_owned; /**< Its table of names was stacked by the draft, and can store names */
+	xml_segment_t * segment_t;   /**< Segment of the version */
+};
+
+struct xml_shared_t
+{
+	xml_version_t * current_t;     /**< Version taken by the readers */
+	long            acquiring [2]; /**< Readers taking a reference to the current version, in each phase */
+	int             phase;         /**< Counter of acquiring used by new readers, flipped by each commit */
+	pthread_mutex_t lock;          /**< Held by the writer from the edit to the commit */
+};
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+xml_version_t * libjxml_version_create (xml_t * xml_mem_t, xml_segment_t * segment_t);
+xml_segment_t * libjxml_version_segment (xml_t * holder_t, xml_segment_t * previous_t);
+void libjxml_version_drop (xml_segment_t * segment_t);
+xml_t * libjxml_version_holder (xml_version_t * draft_t);
+bool libjxml_version_owns (xml_version_t * draft_t, void * pointer);
+char * libjxml_version_name (xml_version_t * draft_t, char * name);
+
+long libjxml_version_find (xml_version_t * version_t, char * path, xml_tag_t ** route);
+xml_tag_t ** libjxml_version_path (xml_version_t * draft_t, char * path);
+xml_tag_t ** libjxml_version_list (xml_version_t * draft_t, xml_tag_t ** link_t, xml_tag_t * tag_t);
+xml_attribute_t ** libjxml_version_attributes (xml_version_t * draft_t, xml_tag_t * tag_t, char * name);
+long libjxml_version_count (xml_tag_t * tag_t);
+
+xml_tag_t * libjxml_version_copy_tag (xml_version_t * draft_t, xml_tag_t * tag_t);
+xml_attribute_t * libjxml_version_copy_attribute (xml_version_t * draft_t, xml_attribute_t * attribute_t);
+
+void libjxml_version_compact (xml_version_t * draft_t);
+xml_attribute_t * libjxml_version_rebuild (xml_version_t * draft_t, xml_attribute_t * attribute_t);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+xml_shared_t * libjxml_shared_create (xml_t * xml_mem_t)
+{
+	xml_shared_t * shared_t;
+
+	shared_t = (xml_shared_t *) malloc (sizeof (xml_shared_t));
+	LIBASSERT_PTR (shared_t);
+
+	shared_t->current_t = libjxml_version_create (xml_mem_t, libjxml_version_segment (xml_mem_t, NULL));
+	shared_t->current_t->stored = xml_mem_t->nodes;
+	shared_t->acquiring [0] = 0;
+	shared_t->acquiring [1] = 0;
+	shared_t->phase = 0;
+	pthread_mutex_init (&shared_t->lock, NULL);
+
+	return shared_t;
+}
+
+void libjxml_shared_free (xml_shared_t * shared_t)
+{
+	libjxml_version_release (shared_t->current_t);
+
+	pthread_mutex_destroy (&shared_t->lock);
+	free (shared_t);
+}
+
+xml_version_t * libjxml_shared_acquire (xml_shared_t * shared_t)
+{
+	xml_version_t * version_t;
+	int phase;
+
+	phase = __atomic_load_n (&shared_t->phase, __ATOMIC_SEQ_CST);
+	__atomic_add_fetch (&shared_t->acquiring [phase], 1, __ATOMIC_SEQ_CST);
+
+	version_t = __atomic_load_n (&shared_t->current_t, __ATOMIC_SEQ_CST);
+	__atomic_add_fetch (&version_t->references, 1, __ATOMIC_SEQ_CST);
+
+	__atomic_sub_fetch (&shared_t->acquiring [phase], 1, __ATOMIC_SEQ_CST);
+
+	return version_t;
+}
+
+xml_version_t * libjxml_shared_edit (xml_shared_t * shared_t)
+{
+	xml_version_t * current_t;
+	xml_version_t * draft_t;
+
+	pthread_mutex_lock (&shared_t->lock);
+
+	/* Only writers change the current version, so it is read without atomics */
+	current_t = shared_t->current_t;
+
+	draft_t = libjxml_version_create (&current_t->xml_mem_t, libjxml_version_segment (NULL, current_t->segment_t));
+	draft_t->number = current_t->number + 1;
+	draft_t->stored = current_t->stored;
+	draft_t->tables = current_t->tables;
+
+	return draft_t;
+}
+
+/*
+ * A reader counted as acquiring may have loaded the old version before the swap,
+ * and not taken its reference yet, so the old version is released after them.
+ * Readers counted after the phase is flipped load the new version, so only the
+ * previous phase is waited for, and only writers change the phase.
+ */
+void libjxml_shared_commit (xml_shared_t * shared_t, xml_version_t * draft_t)
+{
+	xml_version_t * current_t = shared_t->current_t;
+	int phase = shared_t->phase;
+	long garbage;
+
+	garbage = draft_t->stored - draft_t->xml_mem_t.nodes;
+
+	if ((draft_t->tables > LIBJXML_VERSION_TABLES) || (garbage > draft_t->xml_mem_t.nodes))
+		libjxml_version_compact (draft_t);
+
+	__atomic_store_n (&shared_t->current_t, draft_t, __ATOMIC_SEQ_CST);
+	__atomic_store_n (&shared_t->phase, 1 - phase, __ATOMIC_SEQ_CST);
+
+	while (__atomic_load_n (&shared_t->acquiring [phase], __ATOMIC_SEQ_CST) != 0)
+		sched_yield ();
+
+	libjxml_version_release (current_t);
+
+	pthread_mutex_unlock (&shared_t->lock);
+}
+
+void libjxml_shared_abort (xml_shared_t * shared_t, xml_version_t * draft_t)
+{
+	libjxml_version_release (draft_t);
+
+	pthread_mutex_unlock (&shared_t->lock);
+}
+
+void libjxml_version_release (xml_version_t * version_t)
+{
+	if (__atomic_sub_fetch (&version_t->references, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
+	libjxml_names_free (version_t->xml_mem_t.names_t);
+	libjxml_version_drop (version_t->segment_t);
+	free (version_t);
+}
+
+xml_t * libjxml_version_xml (xml_version_t * version_t)
+{
+	return &version_t->xml_mem_t;
+}
+
+long libjxml_version_number (xml_version_t * version_t)
+{
+	return version_t->number;
+}
+
+xml_tag_t * libjxml_version_tag (xml_version_t * version_t, char * path)
+{
+	xml_tag_t * route [LIBJXML_VERSION_STEPS];
+	long depth;
+
+	depth = libjxml_version_find (version_t, path, route);
+	if (depth <= 0)
+		return NULL;
+
+	return route [depth - 1];
+}
+
+/*********************************************************************************
+ *                                    EDITION
+ *********************************************************************************/
+
+bool libjxml_version_add_tag (xml_version_t * draft_t, char * path, char * name)
+{
+	xml_tag_t ** link_t;
+	xml_tag_t * tag_t;
+
+	if ((path == NULL) || (path [0] == '\0'))
+	{
+		link_t = &draft_t->xml_mem_t.content_t;
+	}
+	else
+	{
+		link_t = libjxml_version_path (draft_t, path);
+		if (link_t == NULL)
+			return false;
+
+		link_t = &(*link_t)->nested_tag_t;
+	}
+
+	link_t = libjxml_version_list (draft_t, link_t, NULL);
+
+	tag_t = libjxml_new_tag (libjxml_version_holder (draft_t));
+	tag_t->name_length = libstring_length (name);
+	tag_t->name = libjxml_version_name (draft_t, name);
+
+	*link_t = tag_t;
+
+	draft_t->xml_mem_t.nodes++;
+	draft_t->xml_mem_t.generation++;
+	draft_t->stored++;
+
+	return true;
+}
+
+bool libjxml_version_remove_tag (xml_version_t * draft_t, char * path)
+{
+	xml_tag_t ** link_t;
+	xml_tag_t * tag_t;
+
+	link_t = libjxml_version_path (draft_t, path);
+	if (link_t == NULL)
+		return false;
+
+	/* The tag is left as it is, as older versions may still hold it */
+	tag_t = *link_t;
+	*link_t = tag_t->sibling_tag_t;
+
+	draft_t->xml_mem_t.nodes = draft_t->xml_mem_t.nodes - libjxml_version_count (tag_t);
+	draft_t->xml_mem_t.generation++;
+
+	return true;
+}
+
+bool libjxml_version_set_value (xml_version_t * draft_t, char * path, char * value, long length)
+{
+	xml_tag_t ** link_t;
+	xml_tag_t * tag_t;
+
+	link_t = libjxml_version_path (draft_t, path);
+	if (link_t == NULL)
+		return false;
+
+	tag_t = *link_t;
+	tag_t->value = NULL;
+	tag_t->value_length = 0;
+	draft_t->xml_mem_t.revision++;
+
+	if (value == NULL)
+		return true;
+
+	tag_t->value = libjxml_store_token (libjxml_version_holder (draft_t), value, length);
+	tag_t->value_length = length;
+
+	return true;
+}
+
+bool libjxml_version_set_attribute (xml_version_t * draft_t, char * path, char * name,
+									char * value, long length)
+{
+	xml_attribute_t ** link_t;
+	xml_attribute_t * attribute_t;
+	xml_tag_t ** tag_link_t;
+	xml_t * holder_t;
+	char * interned;
+
+	tag_link_t = libjxml_version_path (draft_t, path);
+	if (tag_link_t == NULL)
+		return false;
+
+	holder_t = libjxml_version_holder (draft_t);
+	interned = libjxml_version_name (draft_t, name);
+
+	link_t = libjxml_version_attributes (draft_t, *tag_link_t, interned);
+	attribute_t = *link_t;
+
+	if (attribute_t == NULL)
+	{
+		attribute_t = libjxml_new_attribute (holder_t);
+		attribute_t->name_length = libstring_length (name);
+		attribute_t->name = interned;
+
+		draft_t->xml_mem_t.nodes++;
+		draft_t->xml_mem_t.generation++;
+		draft_t->stored++;
+	}
+	else if (libjxml_version_owns (draft_t, attribute_t) == false)
+	{
+		attribute_t = libjxml_version_copy_attribute (draft_t, attribute_t);
+	}
+
+	attribute_t->value = libjxml_store_token (holder_t, value, length);
+	attribute_t->value_length = length;
+	*link_t = attribute_t;
+	draft_t->xml_mem_t.revision++;
+
+	return true;
+}
+
+bool libjxml_version_remove_attribute (xml_version_t * draft_t, char * path, char * name)
+{
+	xml_attribute_t ** link_t;
+	xml_tag_t ** tag_link_t;
+	char * interned;
+
+	interned = libjxml_names_find (draft_t->xml_mem_t.names_t, name, libstring_length (name));
+	if (interned == NULL)
+		return false;
+
+	tag_link_t = libjxml_version_path (draft_t, path);
+	if (tag_link_t == NULL)
+		return false;
+
+	link_t = libjxml_version_attributes (draft_t, *tag_link_t, interned);
+	if (*link_t == NULL)
+		return false;
+
+	*link_t = (*link_t)->next_attribute_t;
+
+	draft_t->xml_mem_t.nodes--;
+	draft_t->xml_mem_t.generation++;
+
+	return true;
+}
+
+/*********************************************************************************
+ *                                   VERSIONS
+ *********************************************************************************/
+
+/*
+ * The version starts with the tree and the names of the given document, and only
+ * holds a reference to its table of names.
+ */
+xml_version_t * libjxml_version_create (xml_t * xml_mem_t, xml_segment_t * segment_t)
+{
+	xml_version_t * version_t;
+
+	version_t = (xml_version_t *) malloc (sizeof (xml_version_t));
+	LIBASSERT_PTR (version_t);
+
+	version_t->xml_mem_t = *xml_mem_t;
+	version_t->xml_mem_t.arena_t = NULL;
+	version_t->xml_mem_t.source = NULL;
+	version_t->xml_mem_t.source_length = 0;
+	version_t->xml_mem_t.source_mapped = false;
+	version_t->xml_mem_t.decoded_t = NULL;
+	version_t->xml_mem_t.names_t = libjxml_names_share (xml_mem_t->names_t);
+	LIBJXML_STATS_INIT (&version_t->xml_mem_t);
+
+	version_t->references = 1;
+	version_t->number = 0;
+	version_t->stored = 0;
+	version_t->tables = 0;
+	version_t->names_owned = false;
+	version_t->segment_t = segment_t;
+
+	return version_t;
+}
+
+xml_segment_t * libjxml_version_segment (xml_t * holder_t, xml_segment_t * previous_t)
+{
+	xml_segment_t * segment_t;
+
+	segment_t = (xml_segment_t *) malloc (sizeof (xml_segment_t));
+	LIBASSERT_PTR (segment_t);
+
+	segment_t->holder_t = holder_t;
+	segment_t->references = 1;
+	segment_t->previous_t = previous_t;
+
+	if (previous_t != NULL)
+		__atomic_add_fetch (&previous_t->references, 1, __ATOMIC_RELAXED);
+
+	return segment_t;
+}
+
+/*
+ * Segments are released in a loop down the chain, as it can be long.
+ */
+void libjxml_version_drop (xml_segment_t * segment_t)
+{
+	xml_segment_t * previous_t;
+
+	while ((segment_t != NULL) && (__atomic_sub_fetch (&segment_t->references, 1, __ATOMIC_ACQ_REL) == 0))
+	{
+		previous_t = segment_t->previous_t;
+
+		if (segment_t->holder_t != NULL)
+			libjxml_free_xml_mem (segment_t->holder_t);
+		free (segment_t);
+
+		segment_t = previous_t;
+	}
+}
+
+/*
+ * The arena of a segment starts small, as most drafts only change a few tags, and
+ * it is counted as the tags it can hold, so many segments with a few tags each
+ * are copied too.
+ */
+xml_t * libjxml_version_holder (xml_version_t * draft_t)
+{
+	xml_segment_t * segment_t = draft_t->segment_t;
+
+	if (segment_t->holder_t == NULL)
+	{
+		segment_t->holder_t = libjxml_create_xml_names (LIBJXML_MODE_ARENA, draft_t->xml_mem_t.names_t);
+
+		libarena_delete (segment_t->holder_t->arena_t);
+		segment_t->holder_t->arena_t = libarena_create (LIBJXML_VERSION_CHUNK);
+
+		draft_t->stored = draft_t->stored + LIBJXML_VERSION_CHUNK / sizeof (xml_tag_t);
+	}
+
+	return segment_t->holder_t;
+}
+
+bool libjxml_version_owns (xml_version_t * draft_t, void * pointer)
+{
+	xml_t * holder_t = draft_t->segment_t->holder_t;
+
+	if (holder_t == NULL)
+		return false;
+
+	return libarena_owns (holder_t->arena_t, pointer);
+}
+
+char * libjxml_version_name (xml_version_t * draft_t, char * name)
+{
+	xml_names_t * names_t;
+	char * interned;
+	long length;
+
+	length = libstring_length (name);
+
+	interned = libjxml_names_find (draft_t->xml_mem_t.names_t, name, length);
+	if (interned != NULL)
+		return interned;
+
+	if (draft_t->names_owned == false)
+	{
+		names_t = libjxml_names_stack (draft_t->xml_mem_t.names_t, LIBJXML_VERSION_NAMES);
+		libjxml_names_free (draft_t->xml_mem_t.names_t);
+
+		draft_t->xml_mem_t.names_t = names_t;
+		draft_t->names_owned = true;
+		draft_t->tables++;
+	}
+
+	return libjxml_names_intern (draft_t->xml_mem_t.names_t, name, length);
+}
+
+/*********************************************************************************
+ *                                     PATHS
+ *********************************************************************************/
+
+/*
+ * Finds the tags of each step of a path, from the first level down. Returns the
+ * number of steps, or -1 if the path is not valid or a step is not found.
+ */
+long libjxml_version_find (xml_version_t * version_t, char * path, xml_tag_t ** route)
+{
+	xml_tag_t * tag_t = version_t->xml_mem_t.content_t;
+	char * interned;
+	long depth = 0;
+	long length;
+	long index;
+
+	if (path == NULL)
+		return -1;
+
+	while (*path == '/')
+	{
+		path++;
+		length = strcspn (path, "/[");
+		interned = libjxml_names_find (version_t->xml_mem_t.names_t, path, length);
+		path = path + length;
+
+		index = 1;
+		if (*path == '[')
+		{
+			index = strtol (path + 1, &path, 10);
+			if (*path != ']')
+				return -1;
+			path++;
+		}
+
+		if ((interned == NULL) || (index < 1) || (depth == LIBJXML_VERSION_STEPS))
+			return -1;
+
+		if (depth > 0)
+			tag_t = route [depth - 1]->nested_tag_t;
+
+		while ((tag_t != NULL) && ((tag_t->name != interned) || (index > 1)))
+		{
+			if (tag_t->name == interned)
+				index--;
+			tag_t = tag_t->sibling_tag_t;
+		}
+
+		if (tag_t == NULL)
+			return -1;
+
+		route [depth] = tag_t;
+		depth++;
+	}
+
+	if (*path != '\0')
+		return -1;
+
+	return depth;
+}
+
+/*
+ * Copies the tags of a path that the draft still shares, with the tags before
+ * them in their lists, so the links to them can be changed. Returns the link to
+ * the last tag of the path, a copy owned by the draft.
+ */
+xml_tag_t ** libjxml_version_path (xml_version_t * draft_t, char * path)
+{
+	xml_tag_t * route [LIBJXML_VERSION_STEPS];
+	xml_tag_t ** link_t = &draft_t->xml_mem_t.content_t;
+	long depth;
+	long i;
+
+	depth = libjxml_version_find (draft_t, path, route);
+	if (depth <= 0)
+		return NULL;
+
+	for (i = 0; i < depth; i++)
+	{
+		link_t = libjxml_version_list (draft_t, link_t, route [i]);
+
+		if (libjxml_version_owns (draft_t, *link_t) == false)
+			*link_t = libjxml_version_copy_tag (draft_t, *link_t);
+
+		if (i + 1 < depth)
+			link_t = &(*link_t)->nested_tag_t;
+	}
+
+	return link_t;
+}
+
+/*
+ * Copies the tags of a list before 'tag_t', or the whole list if NULL, that the
+ * draft still shares. Returns the link to 'tag_t'.
+ */
+xml_tag_t ** libjxml_version_list (xml_version_t * draft_t, xml_tag_t ** link_t, xml_tag_t * tag_t)
+{
+	while (*link_t != tag_t)
+	{
+		if (libjxml_version_owns (draft_t, *link_t) == false)
+			*link_t = libjxml_version_copy_tag (draft_t, *link_t);
+
+		link_t = &(*link_t)->sibling_tag_t;
+	}
+
+	return link_t;
+}
+
+/*
+ * Copies the attributes of a tag owned by the draft before the one named 'name'.
+ * Returns the link to that attribute, or to the end of the list if not found.
+ */
+xml_attribute_t ** libjxml_version_attributes (xml_version_t * draft_t, xml_tag_t * tag_t, char * name)
+{
+	xml_attribute_t ** link_t = &tag_t->attribute_t;
+
+	while ((*link_t != NULL) && ((*link_t)->name != name))
+	{
+		if (libjxml_version_owns (draft_t, *link_t) == false)
+			*link_t = libjxml_version_copy_attribute (draft_t, *link_t);
+
+		link_t = &(*link_t)->next_attribute_t;
+	}
+
+	return link_t;
+}
+
+long libjxml_version_count (xml_tag_t * tag_t)
+{
+	xml_iterator_t iterator_t;
+	xml_attribute_t * attribute_t;
+	long count = 0;
+
+	libjxml_iterator_init (&iterator_t, tag_t, LIBJXML_WALK_PRE);
+
+	while ((tag_t = libjxml_iterator_next (&iterator_t)) != NULL)
+	{
+		count++;
+		for (attribute_t = tag_t->attribute_t; attribute_t != NULL; attribute_t = attribute_t->next_attribute_t)
+			count++;
+	}
+
+	libjxml_iterator_free (&iterator_t);
+
+	return count;
+}
+
+/*
+ * Copies are made in the segment of the draft, sharing the lists and values of
+ * the tag or attribute copied.
+ */
+xml_tag_t * libjxml_version_copy_tag (xml_version_t * draft_t, xml_tag_t * tag_t)
+{
+	xml_tag_t * copy_t;
+
+	copy_t = libjxml_new_tag (libjxml_version_holder (draft_t));
+	memcpy (copy_t, tag_t, sizeof (xml_tag_t));
+	draft_t->stored++;
+
+	return copy_t;
+}
+
+xml_attribute_t * libjxml_version_copy_attribute (xml_version_t * draft_t, xml_attribute_t * attribute_t)
+{
+	xml_attribute_t * copy_t;
+
+	copy_t = libjxml_new_attribute (libjxml_version_holder (draft_t));
+	memcpy (copy_t, attribute_t, sizeof (xml_attribute_t));
+	draft_t->stored++;
+
+	return copy_t;
+}
+
+/*********************************************************************************
+ *                                  COMPACTION
+ *********************************************************************************/
+
+/*
+ * Copies the whole tree of a draft, with its names and values, to a segment and
+ * a table of names of its own, so it stops sharing the older segments. The last
+ * tag copied at each depth is kept, as the next tag at that depth is its sibling
+ * or the first tag nested in the last tag copied one level up.
+ */
+void libjxml_version_compact (xml_version_t * draft_t)
+{
+	xml_iterator_t iterator_t;
+	xml_segment_t * segment_t = draft_t->segment_t;
+	xml_names_t * names_t = draft_t->xml_mem_t.names_t;
+	xml_tag_t ** last_t;
+	xml_tag_t ** link_t;
+	xml_tag_t * tag_t;
+	xml_tag_t * copy_t;
+	xml_t * holder_t;
+	long capacity = LIBJXML_VERSION_STEPS;
+
+	last_t = (xml_tag_t **) malloc (capacity * sizeof (xml_tag_t *));
+	LIBASSERT_PTR (last_t);
+
+	libjxml_iterator_xml (&iterator_t, &draft_t->xml_mem_t, LIBJXML_WALK_PRE);
+
+	draft_t->xml_mem_t.names_t = libjxml_names_create (libjxml_names_count (names_t));
+	draft_t->xml_mem_t.content_t = NULL;
+	draft_t->xml_mem_t.mode = LIBJXML_MODE_ARENA;
+	draft_t->names_owned = true;
+	draft_t->segment_t = libjxml_version_segment (NULL, NULL);
+	draft_t->stored = 0;
+	holder_t = libjxml_version_holder (draft_t);
+
+	/* The instruction is held by the shared document, which is released too */
+	draft_t->xml_mem_t.instruction_t = libjxml_version_rebuild (draft_t, draft_t->xml_mem_t.instruction_t);
+
+	while ((tag_t = libjxml_iterator_next (&iterator_t)) != NULL)
+	{
+		copy_t = libjxml_new_tag (holder_t);
+		copy_t->name = libjxml_names_intern (draft_t->xml_mem_t.names_t, tag_t->name, tag_t->name_length);
+		copy_t->name_length = tag_t->name_length;
+		copy_t->attribute_t = libjxml_version_rebuild (draft_t, tag_t->attribute_t);
+
+		if (tag_t->value != NULL)
+		{
+			copy_t->value = libjxml_store_token (holder_t, tag_t->value, tag_t->value_length);
+			copy_t->value_length = tag_t->value_length;
+		}
+
+		if (iterator_t.depth == capacity)
+		{
+			capacity = capacity * 2;
+			last_t = (xml_tag_t **) realloc (last_t, capacity * sizeof (xml_tag_t *));
+			LIBASSERT_PTR (last_t);
+		}
+
+		if (iterator_t.depth == 0)
+			link_t = &draft_t->xml_mem_t.content_t;
+		else
+			link_t = &last_t [iterator_t.depth - 1]->nested_tag_t;
+
+		if (*link_t == NULL)
+			*link_t = copy_t;
+		else
+			last_t [iterator_t.depth]->sibling_tag_t = copy_t;
+
+		last_t [iterator_t.depth] = copy_t;
+	}
+
+	libjxml_iterator_free (&iterator_t);
+	free (last_t);
+
+	libjxml_version_drop (segment_t);
+	libjxml_names_free (names_t);
+
+	draft_t->xml_mem_t.nodes = holder_t->nodes;
+	draft_t->stored = draft_t->stored + holder_t->nodes;
+	draft_t->tables = 0;
+}
+
+/*
+ * Copies a list of attributes with their names and values, to the segment and
+ * the table of names of the draft.
+ */
+xml_attribute_t * libjxml_version_rebuild (xml_version_t * draft_t, xml_attribute_t * attribute_t)
+{
+	xml_attribute_t * first_t = NULL;
+	xml_attribute_t ** link_t = &first_t;
+	xml_t * holder_t = draft_t->segment_t->holder_t;
+
+	for (; attribute_t != NULL; attribute_t = attribute_t->next_attribute_t)
+	{
+		*link_t = libjxml_new_attribute (holder_t);
+		(*link_t)->name = libjxml_names_intern (draft_t->xml_mem_t.names_t, attribute_t->name,
+												attribute_t->name_length);
+		(*link_t)->name_length = attribute_t->name_length;
+
+		if (attribute_t->value != NULL)
+		{
+			(*link_t)->value = libjxml_store_token (holder_t, attribute_t->value, attribute_t->value_length);
+			(*link_t)->value_length = attribute_t->value_length;
+		}
+
+		link_t = &(*link_t)->next_attribute_t;
+	}
+
+	return first_t;
+}
@@ -0,0 +1,290 @@
+/**
+ * @file libjxml_writer.c
+ *
+ * @brief Streaming writer of xml documents.
+ *
+ * The names of the open tags are kept one after the other in a single buffer,
+ * with the offset of each one in a stack, so closing a tag needs no name from
+ * the caller. The open tag being written is left without its '>' until
+ * something else is written, so attributes can still be added and tags without
+ * content are written as empty tags.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libjxml_writer.h"
+#include "libstring.h"
+#include "libassert.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define LIBJXML_WRITER_DEPTH 32  /**< Initial depth of the stack of open tags */
+#define LIBJXML_WRITER_NAMES 512 /**< Initial size of the buffer of names of the open tags */
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+struct xml_writer_t
+{
+	xml_sink_t * sink_t;         /**< Sink receiving the text */
+	bool         compact;        /**< No line breaks nor indentation */
+	char       * names;          /**< Names of the open tags, one after the other */
+	long         names_length;   /**< Used length of the buffer of names */
+	long         names_capacity; /**< Allocated length of the buffer of names */
+	long       * starts;         /**< Offset of the name of each open tag */
+	long         depth;          /**< Number of open tags */
+	long         capacity;       /**< Number of offsets allocated */
+	bool         written;        /**< A tag has already been written */
+	bool         open;           /**< The last open tag is not ended with '>' yet */
+	bool         nested;         /**< The last open tag has nested tags */
+	bool         failed;         /**< A call was not valid */
+};
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+void libjxml_writer_push (xml_writer_t * writer_t, char * name, long length);
+void libjxml_writer_content (xml_writer_t * writer_t);
+bool libjxml_writer_result (xml_writer_t * writer_t);
+
+/*********************************************************************************
+ *                                      API
+ *********************************************************************************/
+
+xml_writer_t * libjxml_writer_create (xml_sink_t * sink_t, int format)
+{
+	xml_writer_t * writer_t;
+
+	writer_t = (xml_writer_t *) malloc (sizeof (xml_writer_t));
+	LIBASSERT_PTR (writer_t);
+
+	writer_t->names = (char *) malloc (LIBJXML_WRITER_NAMES * sizeof (char));
+	LIBASSERT_PTR (writer_t->names);
+
+	writer_t->starts = (long *) malloc (LIBJXML_WRITER_DEPTH * sizeof (long));
+	LIBASSERT_PTR (writer_t->starts);
+
+	writer_t->sink_t = sink_t;
+	writer_t->compact = (format & LIBJXML_FORMAT_COMPACT) != 0;
+	writer_t->names_length = 0;
+	writer_t->names_capacity = LIBJXML_WRITER_NAMES;
+	writer_t->depth = 0;
+	writer_t->capacity = LIBJXML_WRITER_DEPTH;
+	writer_t->written = false;
+	writer_t->open = false;
+	writer_t->nested = false;
+	writer_t->failed = false;
+
+	return writer_t;
+}
+
+bool libjxml_writer_declaration (xml_writer_t * writer_t, char * version, char * encoding)
+{
+	if (writer_t->written == true)
+	{
+		fprintf (stderr, "\nLibXML: Error writing declaration after a tag");
+		writer_t->failed = true;
+		return false;
+	}
+
+	libjxml_sink_string (writer_t->sink_t, "<?xml version=\"");
+	libjxml_sink_string (writer_t->sink_t, (version != NULL) ? version : "1.0");
+
+	if (encoding != NULL)
+	{
+		libjxml_sink_string (writer_t->sink_t, "\" encoding=\"");
+		libjxml_sink_string (writer_t->sink_t, encoding);
+	}
+
+	libjxml_sink_string (writer_t->sink_t, "\"?>");
+
+	return libjxml_writer_result (writer_t);
+}
+
+bool libjxml_writer_begin (xml_writer_t * writer_t, char * name)
+{
+	long length;
+
+	libjxml_writer_content (writer_t);
+
+	if (writer_t->compact == false)
+	{
+		/* The first tag of a document without declaration starts the text */
+		if (writer_t->sink_t->length + writer_t->sink_t->written > 0)
+			libjxml_sink_write (writer_t->sink_t, "\n", 1);
+		libjxml_sink_fill (writer_t->sink_t, '\t', writer_t->depth);
+	}
+
+	length = libstring_length (name);
+
+	libjxml_sink_write (writer_t->sink_t, "<", 1);
+	libjxml_sink_write (writer_t->sink_t, name, length);
+
+	libjxml_writer_push (writer_t, name, length);
+
+	writer_t->written = true;
+	writer_t->open = true;
+	writer_t->nested = false;
+
+	return libjxml_writer_result (writer_t);
+}
+
+bool libjxml_writer_attribute (xml_writer_t * writer_t, char * name, char * value)
+{
+	if (writer_t->open == false)
+	{
+		fprintf (stderr, "\nLibXML: Error writing attribute %s out of an open tag", name);
+		writer_t->failed = true;
+		return false;
+	}
+
+	libjxml_sink_write (writer_t->sink_t, " ", 1);
+	libjxml_sink_string (writer_t->sink_t, name);
+	libjxml_sink_write (writer_t->sink_t, "=\"", 2);
+	libjxml_sink_escape (writer_t->sink_t, value, libstring_length (value), true);
+	libjxml_sink_write (writer_t->sink_t, "\"", 1);
+
+	return libjxml_writer_result (writer_t);
+}
+
+bool libjxml_writer_text (xml_writer_t * writer_t, char * text, long length)
+{
+	if (writer_t->depth == 0)
+	{
+		fprintf (stderr, "\nLibXML: Error writing text out of a tag");
+		writer_t->failed = true;
+		return false;
+	}
+
+	libjxml_writer_content (writer_t);
+
+	libjxml_sink_escape (writer_t->sink_t, text, length, false);
+
+	return libjxml_writer_result (writer_t);
+}
+
+bool libjxml_writer_end (xml_writer_t * writer_t)
+{
+	char * name;
+	long length;
+
+	if (writer_t->depth == 0)
+	{
+		fprintf (stderr, "\nLibXML: Error closing a tag with no open tag");
+		writer_t->failed = true;
+		return false;
+	}
+
+	writer_t->depth--;
+	name = writer_t->names + writer_t->starts [writer_t->depth];
+	length = writer_t->names_length - writer_t->starts [writer_t->depth];
+	writer_t->names_length = writer_t->starts [writer_t->depth];
+
+	if (writer_t->open == true)
+	{
+		libjxml_sink_write (writer_t->sink_t, "/>", 2);
+	}
+	else
+	{
+		if ((writer_t->nested == true) && (writer_t->compact == false))
+		{
+			libjxml_sink_write (writer_t->sink_t, "\n", 1);
+			libjxml_sink_fill (writer_t->sink_t, '\t', writer_t->depth);
+		}
+
+		libjxml_sink_write (writer_t->sink_t, "</", 2);
+		libjxml_sink_write (writer_t->sink_t, name, length);
+		libjxml_sink_write (writer_t->sink_t, ">", 1);
+	}
+
+	/* The tag closed is nested in the one that is now the last open tag */
+	writer_t->open = false;
+	writer_t->nested = true;
+
+	return libjxml_writer_result (writer_t);
+}
+
+bool libjxml_writer_element (xml_writer_t * writer_t, char * name, char * text, long length)
+{
+	libjxml_writer_begin (writer_t, name);
+
+	if (length > 0)
+		libjxml_writer_text (writer_t, text, length);
+
+	return libjxml_writer_end (writer_t);
+}
+
+bool libjxml_writer_finish (xml_writer_t * writer_t)
+{
+	bool finished;
+
+	if (writer_t->depth > 0)
+	{
+		fprintf (stderr, "\nLibXML: Error finishing writer with %ld open tags", writer_t->depth);
+		writer_t->failed = true;
+	}
+
+	while (writer_t->depth > 0)
+		libjxml_writer_end (writer_t);
+
+	finished = libjxml_writer_result (writer_t);
+
+	free (writer_t->names);
+	free (writer_t->starts);
+	free (writer_t);
+
+	return finished;
+}
+
+/*********************************************************************************
+ *                                     STACK
+ *********************************************************************************/
+
+void libjxml_writer_push (xml_writer_t * writer_t, char * name, long length)
+{
+	if (writer_t->depth == writer_t->capacity)
+	{
+		writer_t->capacity = writer_t->capacity * 2;
+		writer_t->starts = (long *) realloc (writer_t->starts, writer_t->capacity * sizeof (long));
+		LIBASSERT_PTR (writer_t->starts);
+	}
+
+	if (writer_t->names_length + length > writer_t->names_capacity)
+	{
+		while (writer_t->names_length + length > writer_t->names_capacity)
+			writer_t->names_capacity = writer_t->names_capacity * 2;
+
+		writer_t->names = (char *) realloc (writer_t->names, writer_t->names_capacity * sizeof (char));
+		LIBASSERT_PTR (writer_t->names);
+	}
+
+	writer_t->starts [writer_t->depth++] = writer_t->names_length;
+	memcpy (writer_t->names + writer_t->names_length, name, length);
+	writer_t->names_length = writer_t->names_length + length;
+}
+
+/*
+ * Ends the open tag being written with '>', as it is going to have content.
+ */
+void libjxml_writer_content (xml_writer_t * writer_t)
+{
+	if (writer_t->open == false)
+		return;
+
+	libjxml_sink_write (writer_t->sink_t, ">", 1);
+	writer_t->open = false;
+}
+
+bool libjxml_writer_result (xml_writer_t * writer_t)
+{
+	return (writer_t->failed == false) && (writer_t->sink_t->failed == false);
+}
@@ -0,0 +1,75 @@
+/**
+ * @file libjxml_test.c
+ *
+ * @brief Runner of the tests of the libjxml modules.
+ *
+ * Usage: test
+ *
+ * Runs every test and prints the number of checks that failed. The exit status
+ * is 0 only if all of them passed.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libassert.h"
+
+#include "libjxml_test.h"
+
+/*********************************************************************************
+ *                                    CHECKS
+ *********************************************************************************/
+
+long test_checks = 0;
+long test_failures = 0;
+
+bool test_check (bool passed, char * text, char * file, int line)
+{
+	test_checks++;
+
+	if (passed == false)
+	{
+		test_failures++;
+		printf ("\nTest: Error %s:%d failed %s\n", file, line, text);
+	}
+
+	return passed;
+}
+
+char * test_text (const char * text)
+{
+	char * copy;
+	long length;
+
+	length = strlen (text);
+	copy = (char *) malloc (length + 1);
+	LIBASSERT_PTR (copy);
+	memcpy (copy, text, length + 1);
+
+	return copy;
+}
+
+/*********************************************************************************
+ *                                     MAIN
+ *********************************************************************************/
+
+int main ()
+{
+	test_edit ();
+	test_hash ();
+	test_entity ();
+	test_json ();
+	test_snapshot ();
+	test_bind ();
+	test_version ();
+	test_parallel ();
+	test_query ();
+
+	printf ("\nTest: %ld checks, %ld failed\n", test_checks, test_failures);
+
+	return (test_failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file libjxml_test.h
+ *
+ * @brief Tests of the libjxml modules.
+ *
+ * Each module has a file with its tests, run by libjxml_test.c. A check that
+ * fails prints where it is and the tests go on, so a single run reports every
+ * failure.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#ifndef _LIBJXML_TEST_H
+#define _LIBJXML_TEST_H
+
+#include <stdbool.h>
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+/**
+ * @brief Check a condition, counting it and printing it if it is false.
+ */
+#define TEST_CHECK(condition) test_check ((condition), #condition, __FILE__, __LINE__)
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+/**
+ * @brief Count a check, printing it if it failed.
+ *
+ * @param[in] passed Result of the check.
+ * @param[in] text Text of the checked condition.
+ * @param[in] file File of the check.
+ * @param[in] line Line of the check.
+ * @return The result of the check.
+ */
+bool test_check (bool passed, char * text, char * file, int line);
+
+/**
+ * @brief Copy a text to memory allocated with malloc(), as parsers may write on it.
+ *
+ * @param[in] text Null ended text.
+ * @return The copy, to be freed with free().
+ */
+char * test_text (const char * text);
+
+void test_edit ();
+void test_hash ();
+void test_entity ();
+void test_json ();
+void test_snapshot ();
+void test_bind ();
+void test_version ();
+void test_parallel ();
+void test_query ();
+
+#endif //_LIBJXML_TEST_H
@@ -0,0 +1,129 @@
+/**
+ * @file libjxml_test_bind.c
+ *
+ * @brief Tests of the binding of documents to C structures.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libjxml.h"
+#include "libjxml_bind.h"
+
+#include "libjxml_test.h"
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Nested structure of the tests.
+ */
+typedef struct test_point_t
+{
+	double x; /**< Attribute x */
+	double y; /**< Attribute y */
+}test_point_t;
+
+/**
+ * @brief Structure of the tests, with a field of each kind.
+ */
+typedef struct test_record_t
+{
+	long           id;           /**< Attribute id */
+	char           code [4];     /**< Attribute code, cut to 3 characters */
+	char         * name;         /**< Tag name */
+	bool           active;       /**< Tag active */
+	int          * values;       /**< Tags v */
+	long           values_count; /**< Number of tags v */
+	test_point_t   point;        /**< Tag point */
+}test_record_t;
+
+static const xml_field_t test_point_fields [] =
+{
+	LIBJXML_ATTRIBUTE (test_point_t, x, "x", LIBJXML_BIND_DOUBLE),
+	LIBJXML_ATTRIBUTE (test_point_t, y, "y", LIBJXML_BIND_DOUBLE),
+};
+
+static const xml_binding_t test_point_binding = LIBJXML_BINDING (test_point_t, "point", test_point_fields);
+
+static const xml_field_t test_record_fields [] =
+{
+	LIBJXML_ATTRIBUTE (test_record_t, id, "id", LIBJXML_BIND_LONG),
+	LIBJXML_ATTRIBUTE (test_record_t, code, "code", LIBJXML_BIND_TEXT),
+	LIBJXML_ELEMENT (test_record_t, name, "name", LIBJXML_BIND_STRING),
+	LIBJXML_ELEMENT (test_record_t, active, "active", LIBJXML_BIND_BOOL),
+	LIBJXML_ARRAY (test_record_t, values, values_count, "v", LIBJXML_BIND_INT),
+	LIBJXML_NESTED (test_record_t, point, "point", test_point_binding),
+};
+
+static const xml_binding_t test_record_binding = LIBJXML_BINDING (test_record_t, "record", test_record_fields);
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+bool test_bind_text (char * xml_txt, test_record_t * record_t);
+
+/*********************************************************************************
+ *                                     TESTS
+ *********************************************************************************/
+
+bool test_bind_text (char * xml_txt, test_record_t * record_t)
+{
+	return libjxml_bind_parse (&test_record_binding, record_t, xml_txt, strlen (xml_txt));
+}
+
+void test_bind ()
+{
+	test_record_t record_t;
+	test_record_t again_t;
+	long length;
+	char * text;
+
+	TEST_CHECK (test_bind_text ("<record id=\"42\" code=\"abcdef\" other=\"x\"><name>a&amp;b</name>"
+								"<active>true</active><v>1</v><skip><v>9</v></skip><v>-2</v><v>3</v>"
+								"<point x=\"1.5\" y=\"-2\"/></record>", &record_t));
+	TEST_CHECK (record_t.id == 42);
+	TEST_CHECK (strcmp (record_t.code, "abc") == 0);
+	TEST_CHECK ((record_t.name != NULL) && (strcmp (record_t.name, "a&b") == 0));
+	TEST_CHECK (record_t.active == true);
+	TEST_CHECK ((record_t.values_count == 3) && (record_t.values [0] == 1) &&
+				(record_t.values [1] == -2) && (record_t.values [2] == 3));
+	TEST_CHECK ((record_t.point.x == 1.5) && (record_t.point.y == -2));
+
+	/* The written text is bound to the same values */
+	text = libjxml_bind_to_txt (&test_record_binding, &record_t, LIBJXML_FORMAT_COMPACT, &length);
+	TEST_CHECK (test_bind_text (text, &again_t));
+	TEST_CHECK ((again_t.id == 42) && (strcmp (again_t.code, "abc") == 0) && (again_t.active == true));
+	TEST_CHECK ((again_t.name != NULL) && (strcmp (again_t.name, "a&b") == 0));
+	TEST_CHECK ((again_t.values_count == 3) && (again_t.values [2] == 3) && (again_t.point.x == 1.5));
+	free (text);
+	libjxml_bind_free (&test_record_binding, &again_t);
+	libjxml_bind_free (&test_record_binding, &record_t);
+
+	/* Fields without tags are left at 0 */
+	TEST_CHECK (test_bind_text ("<record/>", &record_t));
+	TEST_CHECK ((record_t.id == 0) && (record_t.name == NULL) && (record_t.values_count == 0));
+	libjxml_bind_free (&test_record_binding, &record_t);
+
+	/* Values not valid for their field stop the parse */
+	TEST_CHECK (test_bind_text ("<record id=\"4x\"/>", &record_t) == false);
+	TEST_CHECK (test_bind_text ("<record><v>1</v><v>z</v></record>", &record_t) == false);
+	TEST_CHECK (test_bind_text ("<record><active>yes</active></record>", &record_t) == false);
+	TEST_CHECK (test_bind_text ("<record><point x=\"1..2\"/></record>", &record_t) == false);
+	TEST_CHECK (test_bind_text ("<other/>", &record_t) == false);
+	TEST_CHECK (test_bind_text ("<record><name>x</record>", &record_t) == false);
+
+	/* Numbers can not be empty, texts can */
+	TEST_CHECK (test_bind_text ("<record><v></v></record>", &record_t) == false);
+	TEST_CHECK (test_bind_text ("<record><active> </active></record>", &record_t) == false);
+	TEST_CHECK (test_bind_text ("<record><name></name></record>", &record_t));
+	libjxml_bind_free (&test_record_binding, &record_t);
+
+	/* A document has a single root */
+	TEST_CHECK (test_bind_text ("<record id=\"1\"/><record id=\"2\"/>", &record_t) == false);
+}
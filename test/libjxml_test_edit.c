@@ -0,0 +1,67 @@
+/**
+ * @file libjxml_test_edit.c
+ *
+ * @brief Tests of the edition of documents.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libjxml.h"
+
+#include "libjxml_test.h"
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+void test_edit_mode (int mode);
+
+/*********************************************************************************
+ *                                     TESTS
+ *********************************************************************************/
+
+/*
+ * Values set from a buffer of the caller are kept once the buffer changes, in
+ * every storage mode.
+ */
+void test_edit_mode (int mode)
+{
+	xml_attribute_t * attribute_t;
+	xml_t * xml_mem_t;
+	xml_tag_t * tag_t;
+	char buffer [8];
+	char * text;
+
+	text = test_text ("<r><a k=\"v\">1</a></r>");
+	xml_mem_t = libjxml_xml_to_mem_mode (text, mode);
+	tag_t = xml_mem_t->content_t->nested_tag_t;
+
+	memcpy (buffer, "new", 4);
+	libjxml_set_value (xml_mem_t, tag_t, buffer, 3);
+	attribute_t = libjxml_set_attribute (xml_mem_t, tag_t, "k", buffer, 3);
+	libjxml_set_attribute (xml_mem_t, tag_t, "j", buffer, 2);
+	memcpy (buffer, "xxxx", 4);
+
+	TEST_CHECK ((tag_t->value_length == 3) && (memcmp (tag_t->value, "new", 3) == 0));
+	TEST_CHECK ((attribute_t->value_length == 3) && (memcmp (attribute_t->value, "new", 3) == 0));
+	TEST_CHECK ((attribute_t->next_attribute_t != NULL) && (memcmp (attribute_t->next_attribute_t->value, "ne", 2) == 0));
+
+	libjxml_set_value (xml_mem_t, tag_t, NULL, 0);
+	TEST_CHECK (tag_t->value == NULL);
+
+	libjxml_free_xml_mem (xml_mem_t);
+	free (text);
+}
+
+void test_edit ()
+{
+	test_edit_mode (LIBJXML_MODE_MALLOC);
+	test_edit_mode (LIBJXML_MODE_ARENA);
+	test_edit_mode (LIBJXML_MODE_SLICE);
+	test_edit_mode (LIBJXML_MODE_SLICE | LIBJXML_MODE_ARENA);
+	test_edit_mode (LIBJXML_MODE_INSITU);
+}
@@ -0,0 +1,104 @@
+/**
+ * @file libjxml_test_entity.c
+ *
+ * @brief Tests of the decoding and escaping of values.
+ *
+ * Texts longer than 16 bytes are checked too, as they are searched 16 bytes at a
+ * time.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libjxml.h"
+#include "libjxml_entity.h"
+
+#include "libjxml_test.h"
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+bool test_entity_decode (char * text, char * expected);
+bool test_entity_escape (char * text, bool attribute, char * expected);
+
+/*********************************************************************************
+ *                                     TESTS
+ *********************************************************************************/
+
+/*
+ * Decodes a text in place and compares it with the expected one.
+ */
+bool test_entity_decode (char * text, char * expected)
+{
+	char * copy = test_text (text);
+	long length;
+	bool equal;
+
+	length = libjxml_entity_decode (copy, copy, strlen (copy));
+	equal = (length == (long) strlen (expected)) && (memcmp (copy, expected, length) == 0);
+
+	free (copy);
+
+	return equal;
+}
+
+bool test_entity_escape (char * text, bool attribute, char * expected)
+{
+	long length = strlen (text);
+	char * escaped;
+	char * end;
+	bool equal;
+
+	if (libjxml_entity_length (text, length, attribute) != (long) strlen (expected))
+		return false;
+
+	escaped = (char *) malloc (strlen (expected) + 1);
+	end = libjxml_entity_escape (escaped, text, length, attribute);
+	equal = (end - escaped == (long) strlen (expected)) && (memcmp (escaped, expected, end - escaped) == 0);
+
+	free (escaped);
+
+	return equal;
+}
+
+void test_entity ()
+{
+	xml_t * xml_mem_t;
+	long length;
+	char * value;
+
+	TEST_CHECK (test_entity_decode ("&lt;a&amp;b&gt;&quot;&apos;", "<a&b>\"'"));
+	TEST_CHECK (test_entity_decode ("&#65;&#x42;&#xe9;&#8364;", "AB\xC3\xA9\xE2\x82\xAC"));
+	TEST_CHECK (test_entity_decode ("&#128512;", "\xF0\x9F\x98\x80"));
+	TEST_CHECK (test_entity_decode ("0123456789abcdef0123456789&amp;x", "0123456789abcdef0123456789&x"));
+
+	/* Unknown entities and references to characters not valid are kept */
+	TEST_CHECK (test_entity_decode ("&nope; & &#0; &#xD800; &amp", "&nope; & &#0; &#xD800; &amp"));
+
+	TEST_CHECK (libjxml_entity_find ("0123456789abcdef0123&", 21) == 20);
+	TEST_CHECK (libjxml_entity_find ("clean", 5) == 5);
+	TEST_CHECK (libjxml_entity_clean ("0123456789abcdef01\"3<", 21, false) == 20);
+	TEST_CHECK (libjxml_entity_clean ("0123456789abcdef01\"3<", 21, true) == 18);
+
+	TEST_CHECK (test_entity_escape ("a<b&c>\"d", false, "a&lt;b&amp;c&gt;\"d"));
+	TEST_CHECK (test_entity_escape ("a<b&c>\"d", true, "a&lt;b&amp;c&gt;&quot;d"));
+	TEST_CHECK (test_entity_escape ("0123456789abcdef0123456789", true, "0123456789abcdef0123456789"));
+
+	/* Parsed values and attributes are decoded, CDATA is kept as written */
+	xml_mem_t = libjxml_xml_to_mem ("<r k=\"&lt;&#x41;\"><a>x&amp;y</a><b><![CDATA[&amp;]]></b></r>");
+	TEST_CHECK (xml_mem_t != NULL);
+	if (xml_mem_t != NULL)
+	{
+		value = libjxml_attribute_value (xml_mem_t->content_t->attribute_t, &length);
+		TEST_CHECK ((length == 2) && (memcmp (value, "<A", 2) == 0));
+		value = libjxml_tag_value (xml_mem_t->content_t->nested_tag_t, &length);
+		TEST_CHECK ((length == 3) && (memcmp (value, "x&y", 3) == 0));
+		value = libjxml_tag_value (xml_mem_t->content_t->nested_tag_t->sibling_tag_t, &length);
+		TEST_CHECK ((length == 5) && (memcmp (value, "&amp;", 5) == 0));
+		libjxml_free_xml_mem (xml_mem_t);
+	}
+}
@@ -0,0 +1,151 @@
+/**
+ * @file libjxml_test_hash.c
+ *
+ * @brief Tests of the hashes and differences of documents.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libjxml.h"
+#include "libjxml_hash.h"
+
+#include "libjxml_test.h"
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Differences found by a diff, counted by kind.
+ */
+typedef struct test_changes_t
+{
+	long kinds [LIBJXML_DIFF_MOVED + 1]; /**< Differences of each LIBJXML_DIFF_* kind */
+	long total;                          /**< Differences of any kind */
+}test_changes_t;
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+bool test_hash_change (void * context, int change, xml_tag_t * old_t, xml_tag_t * new_t);
+long test_hash_diff (char * old_txt, char * new_txt, test_changes_t * changes_t);
+
+/*********************************************************************************
+ *                                     TESTS
+ *********************************************************************************/
+
+bool test_hash_change (void * context, int change, xml_tag_t * old_t, xml_tag_t * new_t)
+{
+	test_changes_t * changes_t = (test_changes_t *) context;
+
+	(void) old_t;
+	(void) new_t;
+
+	changes_t->kinds [change]++;
+	changes_t->total++;
+
+	return true;
+}
+
+/*
+ * Compares two texts, returning the number of differences reported.
+ */
+long test_hash_diff (char * old_txt, char * new_txt, test_changes_t * changes_t)
+{
+	xml_hashes_t * old_hashes_t;
+	xml_hashes_t * new_hashes_t;
+	xml_t * old_t;
+	xml_t * new_t;
+	long count;
+
+	memset (changes_t, 0, sizeof (test_changes_t));
+
+	old_t = libjxml_xml_to_mem (old_txt);
+	new_t = libjxml_xml_to_mem (new_txt);
+	old_hashes_t = libjxml_hash_create (old_t);
+	new_hashes_t = libjxml_hash_create (new_t);
+
+	count = libjxml_diff (old_hashes_t, new_hashes_t, test_hash_change, changes_t);
+
+	libjxml_hash_free (old_hashes_t);
+	libjxml_hash_free (new_hashes_t);
+	libjxml_free_xml_mem (old_t);
+	libjxml_free_xml_mem (new_t);
+
+	return count;
+}
+
+void test_hash ()
+{
+	test_changes_t changes_t;
+	xml_hashes_t * first_t;
+	xml_hashes_t * second_t;
+	xml_t * xml_first_t;
+	xml_t * xml_second_t;
+
+	/* Attributes in another order give the same hash */
+	xml_first_t = libjxml_xml_to_mem ("<r><a x=\"1\" y=\"2\">v</a></r>");
+	xml_second_t = libjxml_xml_to_mem ("<r><a y=\"2\" x=\"1\">v</a></r>");
+	first_t = libjxml_hash_create (xml_first_t);
+	second_t = libjxml_hash_create (xml_second_t);
+	TEST_CHECK (libjxml_hash_document (first_t) == libjxml_hash_document (second_t));
+	TEST_CHECK (libjxml_diff (first_t, second_t, test_hash_change, &changes_t) == 0);
+	libjxml_hash_free (first_t);
+	libjxml_hash_free (second_t);
+	libjxml_free_xml_mem (xml_first_t);
+	libjxml_free_xml_mem (xml_second_t);
+
+	TEST_CHECK (test_hash_diff ("<r><a>1</a><b>2</b></r>", "<r><a>1</a><b>2</b></r>", &changes_t) == 0);
+
+	TEST_CHECK (test_hash_diff ("<r><a>1</a><b>2</b></r>", "<r><a>1</a><b>3</b></r>", &changes_t) == 1);
+	TEST_CHECK (changes_t.kinds [LIBJXML_DIFF_CHANGED] == 1);
+
+	TEST_CHECK (test_hash_diff ("<r><a>1</a></r>", "<r><a>1</a><b/></r>", &changes_t) == 1);
+	TEST_CHECK (changes_t.kinds [LIBJXML_DIFF_ADDED] == 1);
+
+	TEST_CHECK (test_hash_diff ("<r><a>1</a><b/></r>", "<r><b/></r>", &changes_t) == 1);
+	TEST_CHECK (changes_t.kinds [LIBJXML_DIFF_REMOVED] == 1);
+
+	TEST_CHECK (test_hash_diff ("<r><a k=\"v\"/></r>", "<r><a k=\"w\"/></r>", &changes_t) == 1);
+	TEST_CHECK (changes_t.kinds [LIBJXML_DIFF_CHANGED] == 1);
+
+	/* Siblings out of order are reported with as few moves as possible */
+	TEST_CHECK (test_hash_diff ("<r><a>1</a><a>2</a><a>3</a></r>", "<r><a>3</a><a>1</a><a>2</a></r>", &changes_t) == 1);
+	TEST_CHECK (changes_t.kinds [LIBJXML_DIFF_MOVED] == 1);
+
+	TEST_CHECK (test_hash_diff ("<r><a/><b/><c/><d/></r>", "<r><d/><c/><b/><a/></r>", &changes_t) == 3);
+	TEST_CHECK (changes_t.kinds [LIBJXML_DIFF_MOVED] == 3);
+
+	/* Changes deep in a tree are found below equal ancestors */
+	TEST_CHECK (test_hash_diff ("<r><s><t><u>1</u></t></s><v/></r>", "<r><s><t><u>2</u></t></s><v/></r>",
+								&changes_t) == 1);
+	TEST_CHECK (changes_t.kinds [LIBJXML_DIFF_CHANGED] == 1);
+
+	/* Values set after the hashes were computed are seen by the next diff */
+	xml_first_t = libjxml_xml_to_mem ("<r><a k=\"v\">1</a></r>");
+	xml_second_t = libjxml_xml_to_mem ("<r><a k=\"v\">1</a></r>");
+	first_t = libjxml_hash_create (xml_first_t);
+	second_t = libjxml_hash_create (xml_second_t);
+	TEST_CHECK (libjxml_diff (first_t, second_t, test_hash_change, &changes_t) == 0);
+
+	libjxml_set_value (xml_second_t, xml_second_t->content_t->nested_tag_t, "2", 1);
+	memset (&changes_t, 0, sizeof (test_changes_t));
+	TEST_CHECK (libjxml_diff (first_t, second_t, test_hash_change, &changes_t) == 1);
+	TEST_CHECK (changes_t.kinds [LIBJXML_DIFF_CHANGED] == 1);
+
+	libjxml_set_value (xml_second_t, xml_second_t->content_t->nested_tag_t, "1", 1);
+	libjxml_set_attribute (xml_second_t, xml_second_t->content_t->nested_tag_t, "k", "w", 1);
+	memset (&changes_t, 0, sizeof (test_changes_t));
+	TEST_CHECK (libjxml_diff (first_t, second_t, test_hash_change, &changes_t) == 1);
+	TEST_CHECK (changes_t.kinds [LIBJXML_DIFF_CHANGED] == 1);
+
+	libjxml_hash_free (first_t);
+	libjxml_hash_free (second_t);
+	libjxml_free_xml_mem (xml_first_t);
+	libjxml_free_xml_mem (xml_second_t);
+}
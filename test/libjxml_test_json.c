@@ -0,0 +1,229 @@
+/**
+ * @file libjxml_test_json.c
+ *
+ * @brief Tests of the conversion of documents to JSON and back.
+ *
+ * Texts are converted streaming and through a tree, which must give the same
+ * JSON, or fail both, and the JSON is read back and converted again.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libjxml.h"
+#include "libjxml_sink.h"
+#include "libjxml_json.h"
+
+#include "libjxml_test.h"
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+char * test_json_stream (char * xml_txt, xml_json_options_t * options_t);
+char * test_json_tree (xml_t * xml_mem_t, xml_json_options_t * options_t);
+bool test_json_convert (char * xml_txt, xml_json_options_t * options_t, char * expected);
+bool test_json_fail (char * xml_txt, xml_json_options_t * options_t);
+bool test_json_reject (char * json_txt);
+
+/*********************************************************************************
+ *                                     TESTS
+ *********************************************************************************/
+
+/*
+ * The JSON texts are null ended, or NULL if the conversion failed.
+ */
+char * test_json_stream (char * xml_txt, xml_json_options_t * options_t)
+{
+	xml_sink_t * sink_t = libjxml_sink_mem (0);
+	bool converted;
+	long length;
+	char * json;
+
+	converted = libjxml_xml_to_json (xml_txt, strlen (xml_txt), sink_t, options_t);
+	libjxml_sink_write (sink_t, "", 1);
+	json = libjxml_sink_release (sink_t, &length);
+
+	if (converted == false)
+	{
+		free (json);
+		return NULL;
+	}
+
+	return json;
+}
+
+char * test_json_tree (xml_t * xml_mem_t, xml_json_options_t * options_t)
+{
+	xml_sink_t * sink_t = libjxml_sink_mem (0);
+	bool converted;
+	long length;
+	char * json;
+
+	converted = libjxml_mem_to_json (xml_mem_t, sink_t, options_t);
+	libjxml_sink_write (sink_t, "", 1);
+	json = libjxml_sink_release (sink_t, &length);
+
+	if (converted == false)
+	{
+		free (json);
+		return NULL;
+	}
+
+	return json;
+}
+
+/*
+ * Converts a text streaming and through its tree, then reads the JSON back and
+ * converts that document again, checking every JSON against the expected one.
+ */
+bool test_json_convert (char * xml_txt, xml_json_options_t * options_t, char * expected)
+{
+	xml_t * xml_mem_t;
+	xml_t * back_t;
+	char * json;
+	bool equal = true;
+
+	json = test_json_stream (xml_txt, options_t);
+	equal = TEST_CHECK ((json != NULL) && (strcmp (json, expected) == 0)) && equal;
+	free (json);
+
+	xml_mem_t = libjxml_xml_to_mem (xml_txt);
+	json = test_json_tree (xml_mem_t, options_t);
+	equal = TEST_CHECK ((json != NULL) && (strcmp (json, expected) == 0)) && equal;
+	free (json);
+	libjxml_free_xml_mem (xml_mem_t);
+
+	back_t = libjxml_json_to_mem (expected, strlen (expected), LIBJXML_MODE_ARENA, NULL);
+	equal = TEST_CHECK (back_t != NULL) && equal;
+	if (back_t != NULL)
+	{
+		json = test_json_tree (back_t, options_t);
+		equal = TEST_CHECK ((json != NULL) && (strcmp (json, expected) == 0)) && equal;
+		free (json);
+		libjxml_free_xml_mem (back_t);
+	}
+
+	return equal;
+}
+
+/*
+ * Checks that a text fails streaming and through its tree, as a key would be
+ * repeated.
+ */
+bool test_json_fail (char * xml_txt, xml_json_options_t * options_t)
+{
+	xml_t * xml_mem_t;
+	char * stream;
+	char * tree;
+	bool failed;
+
+	stream = test_json_stream (xml_txt, options_t);
+	xml_mem_t = libjxml_xml_to_mem (xml_txt);
+	tree = test_json_tree (xml_mem_t, options_t);
+
+	failed = (stream == NULL) && (tree == NULL);
+
+	free (stream);
+	free (tree);
+	libjxml_free_xml_mem (xml_mem_t);
+
+	return failed;
+}
+
+bool test_json_reject (char * json_txt)
+{
+	xml_t * xml_mem_t;
+
+	xml_mem_t = libjxml_json_to_mem (json_txt, strlen (json_txt), LIBJXML_MODE_MALLOC, NULL);
+	if (xml_mem_t == NULL)
+		return true;
+
+	libjxml_free_xml_mem (xml_mem_t);
+
+	return false;
+}
+
+void test_json ()
+{
+	char * text = "{\"r\":{\"n\":1.5e3,\"t\":true,\"z\":null,\"u\":\"\\u00e9\"}}";
+	char * arrays [] = {"a", NULL};
+	xml_json_options_t options_t = {NULL, NULL, arrays};
+	xml_t * xml_mem_t;
+	char * json;
+	char * tree;
+	char * big;
+	long length;
+	long index;
+
+	test_json_convert ("<r/>", NULL, "{\"r\":null}");
+	test_json_convert ("<r>t</r>", NULL, "{\"r\":\"t\"}");
+	test_json_convert ("<r a=\"1\">t</r>", NULL, "{\"r\":{\"@a\":\"1\",\"#text\":\"t\"}}");
+	test_json_convert ("<r><a>1</a><a>2</a><b k=\"v\"/></r>", NULL, "{\"r\":{\"a\":[\"1\",\"2\"],\"b\":[{\"@k\":\"v\"}]}}");
+	test_json_convert ("<r>q\"&lt;\\&#9;</r>", NULL, "{\"r\":\"q\\\"<\\\\\\t\"}");
+	test_json_convert ("<r>\xC3\xA9</r>", NULL, "{\"r\":\"\xC3\xA9\"}");
+
+	/* Text of a tag with nested tags is dropped, as the parser does */
+	test_json_convert ("<r>x<a/>y</r>", NULL, "{\"r\":{\"a\":[null]}}");
+
+	/* Only the tags named in the options are arrays, even if alone */
+	test_json_convert ("<r><a>1</a><b><a>2</a><a>3</a></b></r>", &options_t,
+					   "{\"r\":{\"a\":[\"1\"],\"b\":{\"a\":[\"2\",\"3\"]}}}");
+
+	/* Keys are never repeated, so tags of arrays must follow each other */
+	TEST_CHECK (test_json_fail ("<r><a/><b/><a/></r>", NULL));
+	TEST_CHECK (test_json_fail ("<r><a/><b/><a/></r>", &options_t));
+	TEST_CHECK (test_json_fail ("<r><b/><b/></r>", &options_t));
+	TEST_CHECK (test_json_fail ("<r><a><c/><c/></a></r>", &options_t));
+
+	/* The shape of the JSON does not depend on the size of the text */
+	big = (char *) malloc (16 * LIBJXML_JSON_BUFFER + 64);
+	length = sprintf (big, "<r><b>");
+	for (index = 0; index < 2 * LIBJXML_JSON_BUFFER; index++)
+		length += sprintf (big + length, "<a>x</a>");
+	sprintf (big + length, "</b></r>");
+	json = test_json_stream (big, &options_t);
+	TEST_CHECK ((json != NULL) && (strncmp (json, "{\"r\":{\"b\":{\"a\":[\"x\",", 20) == 0));
+	xml_mem_t = libjxml_xml_to_mem (big);
+	tree = test_json_tree (xml_mem_t, &options_t);
+	TEST_CHECK ((json != NULL) && (tree != NULL) && (strcmp (json, tree) == 0));
+	libjxml_free_xml_mem (xml_mem_t);
+	free (tree);
+	free (json);
+	free (big);
+
+	/* Values of any type become values, read back as strings */
+	xml_mem_t = libjxml_json_to_mem (text, strlen (text), LIBJXML_MODE_MALLOC, NULL);
+	TEST_CHECK (xml_mem_t != NULL);
+	if (xml_mem_t != NULL)
+	{
+		json = test_json_tree (xml_mem_t, &options_t);
+		TEST_CHECK ((json != NULL) && (strcmp (json, "{\"r\":{\"n\":\"1.5e3\",\"t\":\"true\",\"z\":null,\"u\":\"\xC3\xA9\"}}") == 0));
+		free (json);
+		libjxml_free_xml_mem (xml_mem_t);
+	}
+
+	TEST_CHECK (test_json_reject ("[1]"));
+	TEST_CHECK (test_json_reject ("{\"r\":"));
+	TEST_CHECK (test_json_reject ("{\"r\":{\"a\":[[1]]}}"));
+	TEST_CHECK (test_json_reject ("{\"r\":1} x"));
+	TEST_CHECK (test_json_reject ("{\"r\" 1}"));
+
+	/* Keys must be XML names, and the text a single root that is not an array */
+	TEST_CHECK (test_json_reject ("{\"r\":{\"bad name\":\"x\"}}"));
+	TEST_CHECK (test_json_reject ("{\"r\":{\"1a\":\"x\"}}"));
+	TEST_CHECK (test_json_reject ("{\"r\":{\"@\":\"x\"}}"));
+	TEST_CHECK (test_json_reject ("{\"r\":[1,2]}"));
+	TEST_CHECK (test_json_reject ("{\"r\":\"x\",\"q\":\"y\"}"));
+	TEST_CHECK (test_json_reject ("{}"));
+
+	/* Characters not allowed in XML are rejected, escaped or not */
+	TEST_CHECK (test_json_reject ("{\"r\":\"\\u0000\"}"));
+	TEST_CHECK (test_json_reject ("{\"r\":\"\\u0001\"}"));
+	TEST_CHECK (test_json_reject ("{\"r\":\"\\uffff\"}"));
+	TEST_CHECK (test_json_reject ("{\"r\":\"a\x01\"}"));
+	TEST_CHECK (test_json_reject ("{\"r\":{\"@k\":\"\\u0000\"}}"));
+}
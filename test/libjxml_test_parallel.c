@@ -0,0 +1,131 @@
+/**
+ * @file libjxml_test_parallel.c
+ *
+ * @brief Tests of the parse of a text split among many threads.
+ *
+ * The messages printed on errors are read back from stderr, which is sent to a
+ * temporary file during the parse.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libassert.h"
+#include "libjxml.h"
+#include "libjxml_parallel.h"
+
+#include "libjxml_test.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define TEST_PARALLEL_THREADS 4    /**< Threads parsing the big document */
+#define TEST_PARALLEL_MESSAGE 128  /**< Size of the buffer holding an error message */
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+char * test_parallel_document (long * length, long error);
+bool test_parallel_parse (char * text, long length, int threads, char * message);
+
+/*********************************************************************************
+ *                                     TESTS
+ *********************************************************************************/
+
+/*
+ * Builds a document long enough to be split among the threads. When 'error' is
+ * not negative, the item written after that offset has an attribute without
+ * quotes.
+ */
+char * test_parallel_document (long * length, long error)
+{
+	long capacity = TEST_PARALLEL_THREADS * LIBJXML_PARALLEL_SHARE + 4096;
+	char * text;
+	long i;
+
+	text = (char *) malloc (capacity);
+	LIBASSERT_PTR (text);
+
+	*length = sprintf (text, "<r>");
+
+	for (i = 0; *length < capacity - 4096; i++)
+	{
+		if ((error >= 0) && (*length >= error))
+		{
+			*length += sprintf (text + *length, "<item k=%ld/>", i);
+			error = -1;
+		}
+		else
+			*length += sprintf (text + *length, "<item k=\"%ld\"><v>%ld</v></item>", i, i);
+	}
+
+	*length += sprintf (text + *length, "</r>");
+
+	return text;
+}
+
+/*
+ * Parses a text, copying the message printed on error.
+ */
+bool test_parallel_parse (char * text, long length, int threads, char * message)
+{
+	xml_t * xml_mem_t;
+	FILE * output;
+	bool parsed;
+	int saved;
+	long read;
+
+	output = tmpfile ();
+	LIBASSERT_PTR (output);
+
+	fflush (stderr);
+	saved = dup (STDERR_FILENO);
+	dup2 (fileno (output), STDERR_FILENO);
+
+	xml_mem_t = libjxml_create_xml_mem (LIBJXML_MODE_MALLOC);
+
+	if (threads > 1)
+		parsed = (libjxml_parse_parallel (xml_mem_t, text, length, threads) != NULL);
+	else
+		parsed = (libjxml_parse_xml_mem (xml_mem_t, text, length) != NULL);
+
+	libjxml_free_xml_mem (xml_mem_t);
+
+	fflush (stderr);
+	dup2 (saved, STDERR_FILENO);
+	close (saved);
+
+	rewind (output);
+	read = fread (message, 1, TEST_PARALLEL_MESSAGE - 1, output);
+	message [read] = '\0';
+	fclose (output);
+
+	return parsed;
+}
+
+void test_parallel ()
+{
+	char sequential [TEST_PARALLEL_MESSAGE];
+	char parallel [TEST_PARALLEL_MESSAGE];
+	char * text;
+	long length;
+
+	text = test_parallel_document (&length, -1);
+	TEST_CHECK (test_parallel_parse (text, length, TEST_PARALLEL_THREADS, parallel));
+	free (text);
+
+	/* The error is in the last part, far from the beginning of the text */
+	text = test_parallel_document (&length, (TEST_PARALLEL_THREADS - 1) * LIBJXML_PARALLEL_SHARE + 1024);
+	TEST_CHECK (test_parallel_parse (text, length, 1, sequential) == false);
+	TEST_CHECK (test_parallel_parse (text, length, TEST_PARALLEL_THREADS, parallel) == false);
+	TEST_CHECK (strstr (sequential, "Error parsing at") != NULL);
+	TEST_CHECK (strcmp (sequential, parallel) == 0);
+	free (text);
+}
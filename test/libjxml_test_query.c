@@ -0,0 +1,77 @@
+/**
+ * @file libjxml_test_query.c
+ *
+ * @brief Tests of the queries run on a tree and while parsing a text.
+ *
+ * Both ways must select the same tags, comparing the decoded values with the
+ * predicates.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libjxml.h"
+#include "libjxml_query.h"
+
+#include "libjxml_test.h"
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+bool test_query_found (void * context, char * name, long name_length, char * value, long value_length);
+bool test_query_count (char * path, char * xml_txt, long expected);
+
+/*********************************************************************************
+ *                                     TESTS
+ *********************************************************************************/
+
+bool test_query_found (void * context, char * name, long name_length, char * value, long value_length)
+{
+	(void) name;
+	(void) name_length;
+	(void) value;
+	(void) value_length;
+
+	(*(long *) context)++;
+
+	return true;
+}
+
+/*
+ * Runs a query on the tree of a text and while parsing it, checking that both
+ * find the expected number of tags.
+ */
+bool test_query_count (char * path, char * xml_txt, long expected)
+{
+	xml_query_t * query_t;
+	xml_t * xml_mem_t;
+	long found = 0;
+	bool passed;
+
+	query_t = libjxml_query_compile (path);
+	xml_mem_t = libjxml_xml_to_mem (xml_txt);
+
+	passed = libjxml_query_stream_buffer (query_t, xml_txt, strlen (xml_txt), test_query_found, &found);
+	passed = passed && (found == expected);
+	passed = passed && (libjxml_query_run (query_t, xml_mem_t, NULL, NULL) == expected);
+
+	libjxml_free_xml_mem (xml_mem_t);
+	libjxml_query_free (query_t);
+
+	return passed;
+}
+
+void test_query ()
+{
+	TEST_CHECK (test_query_count ("//a/b", "<r><a><b/><b/></a><b/></r>", 2));
+	TEST_CHECK (test_query_count ("//a[@k=\"v\"]", "<r><a k=\"v\"/><a k=\"w\"/></r>", 1));
+
+	/* Predicates compare decoded values, on attributes and on the last tag */
+	TEST_CHECK (test_query_count ("//db[@k=\"a<b\"]/host[.=\"c&\"]",
+								  "<r><db k=\"a&lt;b\"><host>c&amp;</host></db></r>", 1));
+	TEST_CHECK (test_query_count ("//db[@k=\"a&lt;b\"]", "<r><db k=\"a&lt;b\"/></r>", 0));
+}
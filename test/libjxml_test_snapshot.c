@@ -0,0 +1,122 @@
+/**
+ * @file libjxml_test_snapshot.c
+ *
+ * @brief Tests of the binary snapshots of documents.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libjxml.h"
+#include "libjxml_flat.h"
+#include "libjxml_snapshot.h"
+
+#include "libjxml_test.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define TEST_SNAPSHOT_IMAGE "/tmp/libjxml_test.snap" /**< Image written by the tests */
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+char * test_snapshot_read (long * length);
+void test_snapshot_write (char * image, long length);
+
+/*********************************************************************************
+ *                                     TESTS
+ *********************************************************************************/
+
+char * test_snapshot_read (long * length)
+{
+	FILE * image_file;
+	char * image;
+
+	image_file = fopen (TEST_SNAPSHOT_IMAGE, "rb");
+	fseek (image_file, 0, SEEK_END);
+	*length = ftell (image_file);
+	rewind (image_file);
+
+	image = (char *) malloc (*length);
+	*length = fread (image, 1, *length, image_file);
+	fclose (image_file);
+
+	return image;
+}
+
+void test_snapshot_write (char * image, long length)
+{
+	FILE * image_file;
+
+	image_file = fopen (TEST_SNAPSHOT_IMAGE, "wb");
+	fwrite (image, 1, length, image_file);
+	fclose (image_file);
+}
+
+/*
+ * Every word of the image is damaged in turn and loaded without checking the
+ * checksum, which must either fail or give a document that can be read whole.
+ */
+void test_snapshot ()
+{
+	xml_flat_t * flat_t;
+	xml_t * xml_mem_t;
+	long rejected = 0;
+	long position;
+	long length;
+	char * image;
+	char * damaged;
+	char * text;
+
+	xml_mem_t = libjxml_xml_to_mem ("<r a=\"1\"><b>x</b><c><d k=\"v\" j=\"w\">y</d></c><b/></r>");
+	TEST_CHECK (libjxml_mem_to_snapshot (xml_mem_t, TEST_SNAPSHOT_IMAGE, NULL));
+	libjxml_free_xml_mem (xml_mem_t);
+
+	flat_t = libjxml_snapshot_to_flat (TEST_SNAPSHOT_IMAGE, LIBJXML_SNAPSHOT_VERIFY);
+	TEST_CHECK (flat_t != NULL);
+	if (flat_t != NULL)
+	{
+		text = libjxml_flat_to_txt (flat_t, LIBJXML_FORMAT_COMPACT, &length);
+		TEST_CHECK (strstr (text, "<d k=\"v\" j=\"w\">y</d>") != NULL);
+		free (text);
+		libjxml_flat_free (flat_t);
+	}
+
+	image = test_snapshot_read (&length);
+	damaged = (char *) malloc (length);
+
+	for (position = 0; position + 8 <= length; position = position + 8)
+	{
+		memcpy (damaged, image, length);
+		memset (damaged + position, 0xFF, 8);
+		test_snapshot_write (damaged, length);
+
+		flat_t = libjxml_snapshot_to_flat (TEST_SNAPSHOT_IMAGE, 0);
+		if (flat_t == NULL)
+		{
+			rejected++;
+			continue;
+		}
+
+		text = libjxml_flat_to_txt (flat_t, LIBJXML_FORMAT_COMPACT, NULL);
+		free (text);
+		libjxml_flat_free (flat_t);
+	}
+
+	TEST_CHECK (rejected > 0);
+
+	/* A truncated image is never mapped */
+	test_snapshot_write (image, length - 8);
+	TEST_CHECK (libjxml_snapshot_to_flat (TEST_SNAPSHOT_IMAGE, 0) == NULL);
+
+	free (damaged);
+	free (image);
+	remove (TEST_SNAPSHOT_IMAGE);
+}
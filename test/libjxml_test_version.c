@@ -0,0 +1,206 @@
+/**
+ * @file libjxml_test_version.c
+ *
+ * @brief Tests of the versions of shared documents.
+ *
+ * @author Joseba R.G.
+ *         joseba.rg@protonmail.com
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "libjxml.h"
+#include "libjxml_version.h"
+
+#include "libjxml_test.h"
+
+/*********************************************************************************
+ *                                  DEFINITIONS
+ *********************************************************************************/
+
+#define TEST_VERSION_READERS 4    /**< Threads taking versions while the writer commits */
+#define TEST_VERSION_COMMITS 2000 /**< Commits made while the readers run */
+
+/*********************************************************************************
+ *                                    STRUCTS
+ *********************************************************************************/
+
+/**
+ * @brief Reader taking versions of a shared document until it is stopped.
+ */
+typedef struct test_reader_t
+{
+	xml_shared_t * shared_t; /**< Shared document */
+	bool         * stop;     /**< Set once the writer is done */
+	bool           ordered;  /**< Each version taken was not older than the previous one */
+}test_reader_t;
+
+/*********************************************************************************
+ *                                  DECLARATIONS
+ *********************************************************************************/
+
+bool test_version_value (xml_version_t * version_t, char * path, char * expected);
+void * test_version_reader (void * context);
+void test_version_threads ();
+
+/*********************************************************************************
+ *                                     TESTS
+ *********************************************************************************/
+
+/*
+ * Checks the value of a tag, NULL expecting the tag without value.
+ */
+bool test_version_value (xml_version_t * version_t, char * path, char * expected)
+{
+	xml_tag_t * tag_t;
+	long length;
+	char * value;
+
+	tag_t = libjxml_version_tag (version_t, path);
+	if (tag_t == NULL)
+		return false;
+
+	value = libjxml_tag_value (tag_t, &length);
+	if (expected == NULL)
+		return value == NULL;
+
+	return (value != NULL) && (length == (long) strlen (expected)) && (memcmp (value, expected, length) == 0);
+}
+
+/*
+ * Takes versions without pause, so a writer waiting for the readers to be gone
+ * would never commit.
+ */
+void * test_version_reader (void * context)
+{
+	test_reader_t * reader_t = (test_reader_t *) context;
+	xml_version_t * version_t;
+	long number = 0;
+
+	while (__atomic_load_n (reader_t->stop, __ATOMIC_ACQUIRE) == false)
+	{
+		version_t = libjxml_shared_acquire (reader_t->shared_t);
+
+		if (libjxml_version_number (version_t) < number)
+			reader_t->ordered = false;
+
+		number = libjxml_version_number (version_t);
+		libjxml_version_release (version_t);
+	}
+
+	return NULL;
+}
+
+void test_version_threads ()
+{
+	test_reader_t readers [TEST_VERSION_READERS];
+	pthread_t threads [TEST_VERSION_READERS];
+	xml_version_t * draft_t;
+	xml_shared_t * shared_t;
+	bool stop = false;
+	long round;
+	char value [32];
+	int i;
+
+	shared_t = libjxml_shared_create (libjxml_xml_to_mem ("<config><db>a</db></config>"));
+
+	for (i = 0; i < TEST_VERSION_READERS; i++)
+	{
+		readers [i].shared_t = shared_t;
+		readers [i].stop = &stop;
+		readers [i].ordered = true;
+		pthread_create (&threads [i], NULL, test_version_reader, &readers [i]);
+	}
+
+	for (round = 0; round < TEST_VERSION_COMMITS; round++)
+	{
+		snprintf (value, sizeof (value), "v%ld", round);
+		draft_t = libjxml_shared_edit (shared_t);
+		libjxml_version_set_value (draft_t, "/config/db", value, strlen (value));
+		libjxml_shared_commit (shared_t, draft_t);
+	}
+
+	__atomic_store_n (&stop, true, __ATOMIC_RELEASE);
+
+	for (i = 0; i < TEST_VERSION_READERS; i++)
+	{
+		pthread_join (threads [i], NULL);
+		TEST_CHECK (readers [i].ordered);
+	}
+
+	draft_t = libjxml_shared_acquire (shared_t);
+	TEST_CHECK (libjxml_version_number (draft_t) == TEST_VERSION_COMMITS);
+	TEST_CHECK (test_version_value (draft_t, "/config/db", value));
+	libjxml_version_release (draft_t);
+
+	libjxml_shared_free (shared_t);
+}
+
+void test_version ()
+{
+	xml_version_t * first_t;
+	xml_version_t * second_t;
+	xml_version_t * draft_t;
+	xml_shared_t * shared_t;
+	long round;
+	char value [32];
+
+	shared_t = libjxml_shared_create (libjxml_xml_to_mem ("<config><db>a</db><db><host>h</host></db><log/></config>"));
+
+	first_t = libjxml_shared_acquire (shared_t);
+	TEST_CHECK (libjxml_version_number (first_t) == 0);
+	TEST_CHECK (test_version_value (first_t, "/config/db[2]/host", "h"));
+
+	draft_t = libjxml_shared_edit (shared_t);
+	TEST_CHECK (libjxml_version_set_value (draft_t, "/config/db[2]/host", "new", 3));
+	TEST_CHECK (libjxml_version_set_attribute (draft_t, "/config/log", "level", "3", 1));
+	TEST_CHECK (libjxml_version_add_tag (draft_t, "/config", "cache"));
+	TEST_CHECK (libjxml_version_remove_tag (draft_t, "/config/db[1]"));
+	TEST_CHECK (libjxml_version_set_value (draft_t, "/config/missing", "x", 1) == false);
+	libjxml_shared_commit (shared_t, draft_t);
+
+	/* The version taken before the commit does not change */
+	second_t = libjxml_shared_acquire (shared_t);
+	TEST_CHECK (libjxml_version_number (second_t) == 1);
+	TEST_CHECK (test_version_value (first_t, "/config/db[2]/host", "h"));
+	TEST_CHECK (test_version_value (first_t, "/config/db[1]", "a"));
+	TEST_CHECK (libjxml_version_tag (first_t, "/config/cache") == NULL);
+	TEST_CHECK (test_version_value (second_t, "/config/db[1]/host", "new"));
+	TEST_CHECK (libjxml_version_tag (second_t, "/config/db[2]") == NULL);
+	TEST_CHECK (libjxml_version_tag (second_t, "/config/cache") != NULL);
+	TEST_CHECK (libjxml_version_xml (second_t)->content_t->nested_tag_t->sibling_tag_t->attribute_t != NULL);
+	libjxml_version_release (first_t);
+
+	/* An aborted draft leaves the current version */
+	draft_t = libjxml_shared_edit (shared_t);
+	TEST_CHECK (libjxml_version_remove_attribute (draft_t, "/config/log", "level"));
+	libjxml_shared_abort (shared_t, draft_t);
+	first_t = libjxml_shared_acquire (shared_t);
+	TEST_CHECK (first_t == second_t);
+	libjxml_version_release (first_t);
+
+	/* Many commits with new names copy the tree, keeping every value */
+	for (round = 0; round < 4 * LIBJXML_VERSION_TABLES; round++)
+	{
+		snprintf (value, sizeof (value), "n%ld", round);
+		draft_t = libjxml_shared_edit (shared_t);
+		TEST_CHECK (libjxml_version_add_tag (draft_t, "/config", value));
+		TEST_CHECK (libjxml_version_set_value (draft_t, "/config/db/host", value, strlen (value)));
+		libjxml_shared_commit (shared_t, draft_t);
+	}
+
+	first_t = libjxml_shared_acquire (shared_t);
+	TEST_CHECK (test_version_value (first_t, "/config/db/host", value));
+	TEST_CHECK (libjxml_version_tag (first_t, "/config/n0") != NULL);
+	TEST_CHECK (test_version_value (second_t, "/config/db[1]/host", "new"));
+	libjxml_version_release (first_t);
+	libjxml_version_release (second_t);
+
+	libjxml_shared_free (shared_t);
+
+	/* Commits end while readers keep taking versions */
+	test_version_threads ();
+}